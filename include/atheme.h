@@ -19,6 +19,7 @@
 #include <atheme/base64.h>
 #include <atheme/bcrypt.h>
 #include <atheme/botserv.h>
+#include <atheme/capture.h>
 #include <atheme/channels.h>
 #include <atheme/commandhelp.h>
 #include <atheme/commandtree.h>
@@ -37,6 +38,7 @@
 #include <atheme/entity-validation.h>
 #include <atheme/flags.h>
 #include <atheme/global.h>
+#include <atheme/hashmap.h>
 #include <atheme/hook.h>
 #include <atheme/hooktypes.h>
 #include <atheme/httpd.h>
@@ -52,6 +54,7 @@
 #include <atheme/phandler.h>
 #include <atheme/pmodule.h>
 #include <atheme/privs.h>
+#include <atheme/profile.h>
 #include <atheme/random.h>
 #include <atheme/sasl.h>
 #include <atheme/scrypt.h>
@@ -61,15 +64,18 @@
 #include <atheme/servtree.h>
 #include <atheme/sharedheap.h>
 #include <atheme/sourceinfo.h>
+#include <atheme/stats.h>
 #include <atheme/stdheaders.h>
 #include <atheme/string.h>
 #include <atheme/structures.h>
 #include <atheme/table.h>
 #include <atheme/taint.h>
 #include <atheme/template.h>
+#include <atheme/timeindex.h>
 #include <atheme/tools.h>
 #include <atheme/uid.h>
 #include <atheme/uplink.h>
 #include <atheme/users.h>
+#include <atheme/warmstate.h>
 
 #endif /* !ATHEME_INC_ATHEME_H */
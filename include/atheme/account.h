@@ -12,6 +12,7 @@
 
 #include <atheme/attributes.h>
 #include <atheme/entity.h>
+#include <atheme/match.h>
 #include <atheme/object.h>
 #include <atheme/stdheaders.h>
 #include <atheme/structures.h>
@@ -23,6 +24,8 @@ struct kline
 	char *          host;
 	char *          reason;
 	char *          setby;
+	struct match_pattern *user_pattern;
+	struct match_pattern *host_pattern;
 	unsigned long   number;
 	long            duration;
 	time_t          settime;
@@ -35,6 +38,7 @@ struct xline
 	char *          realname;
 	char *          reason;
 	char *          setby;
+	struct match_pattern *realname_pattern;
 	unsigned int    number;
 	long            duration;
 	time_t          settime;
@@ -47,6 +51,7 @@ struct qline
 	char *          mask;
 	char *          reason;
 	char *          setby;
+	struct match_pattern *pattern;
 	unsigned int    number;
 	long            duration;
 	time_t          settime;
@@ -58,32 +63,46 @@ struct svsignore
 {
 	struct svsignore *      svsignore;
 	char *                  mask;
+	struct match_pattern *  pattern;
 	time_t                  settime;
 	char *                  setby;
 	char *                  reason;
 };
 
-/* services accounts */
+/* services accounts
+ *
+ * Only the fields that lookups, logins and iteration touch live here; state
+ * that most accounts never have (memos, memo ignores, access masks and
+ * certificate fingerprints) lives in struct myuser_cold, which is allocated
+ * on first use. Use myuser_cold() to modify it and myuser_cold_ro() to read
+ * it.
+ */
 struct myuser
 {
 	struct myentity         ent;
-	char                    pass[PASSLEN + 1];
+	char *                  pass;                   // see myuser_set_pass()
 	stringref               email;
 	stringref               email_canonical;
 	mowgli_list_t           logins;                 // 'struct user's currently logged in to this
+	mowgli_list_t           nicks;                  // registered nicks, must include mu->name if nonempty
 	time_t                  registered;
 	time_t                  lastlogin;
 	struct soper *          soper;
+	struct language *       language;
+	struct myuser_cold *    cold;                   // NULL until needed
 	unsigned int            flags;
+	unsigned int            pwhash;                 // enum pwhash_type of pass, for stats_counters
+};
+
+struct myuser_cold
+{
 	mowgli_list_t           memos;                  // store memos
-	unsigned int            memoct_new;
-	unsigned int            memo_ratelimit_num;     // memos sent recently
-	time_t                  memo_ratelimit_time;    // last time a memo was sent
 	mowgli_list_t           memo_ignores;
 	mowgli_list_t           access_list;
-	mowgli_list_t           nicks;                  // registered nicks, must include mu->name if nonempty
-	struct language *       language;
 	mowgli_list_t           cert_fingerprints;
+	unsigned int            memoct_new;
+	unsigned int            memo_ratelimit_num;     // memos sent recently
+	time_t                  memo_ratelimit_time;    // last time a memo was sent
 };
 
 /* Keep this synchronized with mu_flags in libathemecore/flags.c */
@@ -182,6 +201,7 @@ struct chanacs
 	struct myentity *       entity;
 	struct mychan *         mychan;
 	char *                  host;
+	struct mask_matcher     matcher;        // compiled host, for host entries
 	unsigned int            level;
 	time_t                  tmodified;
 	mowgli_node_t           cnode;
@@ -281,11 +301,14 @@ struct groupacs
 #define GA_ALL			(GA_FLAGS | GA_CHANACS | GA_MEMOS | GA_SET | GA_VHOST | GA_INVITE | GA_ACLVIEW)
 #define GA_ALL_OLD		(GA_FLAGS | GA_CHANACS | GA_MEMOS | GA_SET | GA_VHOST | GA_INVITE)
 
-/* struct for account memos */
+/* struct for account memos; the sender and the text are shared strings,
+ * so a memo sent to many accounts is only stored once
+ */
 struct mymemo
 {
-	char            sender[NICKLEN + 1];
-	char            text[MEMOLEN + 1];
+	mowgli_node_t   node;
+	stringref       sender;
+	stringref       text;
 	time_t          sent;
 	unsigned int    status;
 };
@@ -351,6 +374,8 @@ void qline_expire(void *arg);
 extern mowgli_patricia_t *nicklist;
 extern mowgli_patricia_t *oldnameslist;
 extern mowgli_patricia_t *mclist;
+extern struct hashmap *nicklist_index;
+extern struct hashmap *mclist_index;
 
 void init_accounts(void);
 
@@ -362,6 +387,11 @@ void myuser_rename(struct myuser *mu, const char *name);
 void myuser_set_email(struct myuser *mu, const char *newemail);
 struct myuser *myuser_find_ext(const char *name);
 void myuser_notice(const char *from, struct myuser *target, const char *fmt, ...) ATHEME_FATTR_PRINTF(3, 4);
+void myuser_set_pass(struct myuser *mu, const char *pass);
+
+extern const struct myuser_cold myuser_cold_empty;
+struct myuser_cold *myuser_cold(struct myuser *mu);
+void myuser_cold_trim(struct myuser *mu);
 
 bool myuser_access_verify(struct user *u, struct myuser *mu);
 bool myuser_access_add(struct myuser *mu, const char *mask);
@@ -379,6 +409,10 @@ struct mycertfp *mycertfp_add(struct myuser *mu, const char *certfp, bool force)
 void mycertfp_delete(struct mycertfp *mcfp);
 struct mycertfp *mycertfp_find(const char *certfp);
 
+struct mymemo *mymemo_add(struct myuser *mu, const char *sender, const char *text, time_t sent, unsigned int status);
+struct mymemo *mymemo_add_shared(struct myuser *mu, stringref sender, stringref text, time_t sent, unsigned int status);
+void mymemo_delete(struct myuser *mu, struct mymemo *memo);
+
 struct mychan *mychan_add(char *name);
 //inline struct mychan *mychan_find(const char *name);
 bool mychan_isused(struct mychan *mc);
@@ -0,0 +1,63 @@
+/*
+ * SPDX-License-Identifier: ISC
+ * SPDX-URL: https://spdx.org/licenses/ISC.html
+ *
+ * Copyright (C) 2026 Atheme Development Group (https://atheme.github.io/)
+ *
+ * Capture and replay of uplink traffic.
+ */
+
+#ifndef ATHEME_INC_CAPTURE_H
+#define ATHEME_INC_CAPTURE_H 1
+
+#include <atheme/attributes.h>
+#include <atheme/constants.h>
+#include <atheme/stdheaders.h>
+
+/* A capture file starts with CAPTURE_MAGIC and is followed by records. Every
+ * record is a type byte and the number of nanoseconds (monotonic clock) since
+ * the previous record, as a varint (7 bits per byte, least significant group
+ * first, high bit set on all bytes but the last). CAPTURE_LINE records then
+ * have the length of the line as a varint and the line itself, without CR,
+ * LF or terminating NUL; CAPTURE_START records have the wall clock time the
+ * capture was started at, as a varint. A capture file may be appended to,
+ * so it may contain several CAPTURE_START records.
+ */
+#define CAPTURE_MAGIC           "ATHCAP1\n"
+#define CAPTURE_MAGIC_LEN       8U
+
+enum capture_record
+{
+	CAPTURE_EOF     = 0,            // (reader only) end of file or read error
+	CAPTURE_START   = 'S',          // capturing started
+	CAPTURE_CONNECT = 'C',          // connection to the uplink established
+	CAPTURE_LINE    = 'L',          // line received from the uplink
+	CAPTURE_EOB     = 'E',          // uplink finished its burst
+};
+
+struct capture_reader
+{
+	FILE *          fp;
+	char *          path;
+	uint64_t        ns;             // time of the last record since the start of the file
+	uint64_t        delta_ns;       // time of the last record since the one before it
+	time_t          started;        // value of the last CAPTURE_START record
+	size_t          len;            // length of line
+	char            line[BUFSIZE + 1];
+	bool            error;
+};
+
+extern bool capture_enabled;
+extern bool capture_suppressed;
+
+/* capture.c */
+void capture_init(void);
+bool capture_start(const char *path);
+void capture_stop(void);
+void capture_record(enum capture_record type, const char *line, size_t len);
+
+bool capture_reader_open(struct capture_reader *reader, const char *path) ATHEME_FATTR_WUR;
+enum capture_record capture_reader_next(struct capture_reader *reader) ATHEME_FATTR_WUR;
+void capture_reader_close(struct capture_reader *reader);
+
+#endif /* !ATHEME_INC_CAPTURE_H */
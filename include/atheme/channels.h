@@ -10,6 +10,7 @@
 #ifndef ATHEME_INC_CHANNELS_H
 #define ATHEME_INC_CHANNELS_H 1
 
+#include <atheme/match.h>
 #include <atheme/stdheaders.h>
 #include <atheme/structures.h>
 
@@ -20,19 +21,20 @@ struct channel
 {
 	char *          name;
 	unsigned int    modes;
-	char *          key;
 	unsigned int    limit;
-	char **         extmodes;       // non-standard simple modes with param eg +j
 	unsigned int    nummembers;
 	unsigned int    numsvcmembers;
+	unsigned int    flags;
 	time_t          ts;
+	mowgli_list_t   members;
+	struct mychan * mychan;
+	char *          key;
+	char **         extmodes;       // non-standard simple modes with param eg +j; NULL until one is set
 	char *          topic;
 	char *          topic_setter;
 	time_t          topicts;
-	mowgli_list_t   members;
 	mowgli_list_t   bans;
-	unsigned int    flags;
-	struct mychan * mychan;
+	struct chanuser_index *index;   // NULL unless the channel has at least CHANUSER_INDEX_MIN members
 };
 
 /* struct for channel memberships */
@@ -43,8 +45,40 @@ struct chanuser
 	unsigned int    modes;
 	mowgli_node_t   unode;
 	mowgli_node_t   cnode;
+	unsigned int    pos;            // position in chan->index->members, if the channel is indexed
+};
+
+/* Large channels get a vector of their members and an open addressing hash
+ * of it by user, in addition to the member list, so that chanuser_find()
+ * does not have to scan either list and iterating over the members touches
+ * less memory. The index is built when a channel reaches CHANUSER_INDEX_MIN
+ * members and dropped again when it falls below half of that.
+ */
+#define CHANUSER_INDEX_MIN      64U
+
+struct chanuser_index
+{
+	struct chanuser **  members;        // in no particular order
+	unsigned int *      slots;          // position in members + 1, or 0 if the slot is free
+	unsigned int        count;
+	unsigned int        alloc;          // size of members
+	unsigned int        mask;           // size of slots - 1
 };
 
+/* see CHANNEL_MEMBER_FOREACH() */
+struct chanuser_iter
+{
+	const struct chanuser_index *   index;
+	mowgli_node_t *                 node;
+	unsigned int                    pos;
+};
+
+/* Iterates over the members of a channel, using the member vector if the
+ * channel is indexed. No members may be added or removed during the loop.
+ */
+#define CHANNEL_MEMBER_FOREACH(cu, iter, chan) \
+	for (chanuser_iter_init((iter), (chan)); ((cu) = chanuser_iter_next((iter))) != NULL; )
+
 struct chanban
 {
 	struct channel *chan;
@@ -52,6 +86,7 @@ struct chanban
 	int             type;   // 'b', 'e', 'I', etc -- jilles
 	mowgli_node_t   node;   // for struct channel -> bans
 	unsigned int    flags;
+	struct mask_matcher matcher;
 };
 
 /* for struct channel -> modes */
@@ -121,6 +156,7 @@ void modestack_flush_now(void);
 
 /* channels.c */
 extern mowgli_patricia_t *chanlist;
+extern struct hashmap *chanlist_index;
 
 void init_channels(void);
 
@@ -130,6 +166,7 @@ void channel_delete(struct channel *c);
 
 struct chanuser *chanuser_add(struct channel *chan, const char *user);
 void chanuser_delete(struct channel *chan, struct user *user);
+void chanuser_delete_users(struct user **users, size_t count);
 struct chanuser *chanuser_find(struct channel *chan, struct user *user);
 
 struct chanban *chanban_add(struct channel *chan, const char *mask, int type);
@@ -25,6 +25,13 @@ struct command
 		const char *    path;
 		void          (*func)(struct sourceinfo *, const char *subcmd);
 	}                       help;
+
+	// Filled in by command_exec() when general::profile_commands is enabled
+	struct {
+		struct profile_counter *        counter;
+		const struct service *          svs;
+		const struct profile_counter *  parent;
+	}                       profile;
 };
 
 /* commandtree.c */
@@ -36,6 +43,8 @@ void command_exec(struct service *, struct sourceinfo *, struct command *, int,
 void command_exec_split(struct service *, struct sourceinfo *, const char *, char *, mowgli_patricia_t *);
 void subcommand_dispatch_simple(struct service *, struct sourceinfo *, int, char **, mowgli_patricia_t *, const char *);
 extern bool (*command_authorize)(struct service *, struct sourceinfo *, struct command *c, const char *userlevel);
+extern mowgli_patricia_t *command_profile_stats;
+extern unsigned long command_fail_count;
 
 /* logger.c */
 void logaudit_denycmd(struct sourceinfo *si, struct command *cmd, const char *userlevel);
@@ -49,11 +49,35 @@
 
 typedef void (*connection_evhandler)(struct connection *);
 
+/* Output to the uplink is queued in one of these classes, see sendq_set_class().
+ * Lines within a class are sent in order; the classes share the socket by
+ * weighted round robin, so later lines of one class may overtake earlier lines
+ * of another.
+ */
+enum sendq_class
+{
+	SENDQ_CONTROL = 0,      // protocol state (the default)
+	SENDQ_ENFORCEMENT,      // network bans
+	SENDQ_LOGIN,            // SASL and logins
+	SENDQ_BULK,             // mass notices
+	SENDQ_CLASS_COUNT
+};
+
+struct sendq_queue
+{
+	mowgli_list_t           chunks;
+	size_t                  length;         // bytes waiting to be sent
+	uint64_t                queued;         // bytes ever added
+	uint64_t                sent;           // bytes ever sent
+	long                    deficit;        // bytes this class may send before the next one's turn
+};
+
 struct connection
 {
 	mowgli_node_t                   node;
 	mowgli_list_t                   recvq;
-	mowgli_list_t                   sendq;
+	struct sendq_queue              sendq[SENDQ_CLASS_COUNT];
+	enum sendq_class                sendq_turn;     // class whose turn it is in sendq_flush()
 	struct connection *             listener;
 	mowgli_eventloop_pollable_t *   pollable;
 	void *                          userdata;
@@ -82,6 +106,7 @@ struct connection *connection_find(int);
 void connection_setselect_read(struct connection *, connection_evhandler);
 void connection_setselect_write(struct connection *, connection_evhandler);
 void connection_close(struct connection *);
+int connection_detach(struct connection *);
 void connection_close_children(struct connection *);
 void connection_close_soon(struct connection *);
 void connection_close_soon_children(struct connection *);
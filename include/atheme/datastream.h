@@ -10,17 +10,24 @@
 #ifndef ATHEME_INC_DATASTREAM_H
 #define ATHEME_INC_DATASTREAM_H 1
 
+#include <atheme/connection.h>
 #include <atheme/stdheaders.h>
 #include <atheme/structures.h>
 
+typedef void (*sendq_stats_cb)(const char *name, const struct sendq_queue *queue, void *privdata);
+
 void sendq_add(struct connection *cptr, char *buf, size_t len);
+void sendq_add_class(struct connection *cptr, enum sendq_class cls, char *buf, size_t len);
 void sendq_add_eof(struct connection *cptr);
 void sendq_flush(struct connection *cptr);
 bool sendq_nonempty(struct connection *cptr);
+size_t sendq_length(struct connection *cptr);
+void sendq_stats(struct connection *cptr, sendq_stats_cb cb, void *privdata);
 void sendq_set_limit(struct connection *cptr, size_t len);
 
 int recvq_length(struct connection *cptr);
 void recvq_put(struct connection *cptr);
+void recvq_add(struct connection *cptr, const char *buf, size_t len);
 int recvq_get(struct connection *cptr, char *buf, size_t len);
 int recvq_getline(struct connection *cptr, char *buf, size_t len);
 
@@ -91,6 +91,10 @@ struct ConfOption
 	unsigned int    default_clone_warn;     // default clone warn
 	bool            clone_increase;         // If the clone limit will increase based on # of identified clones
 	unsigned int    uplink_sendq_limit;
+	unsigned int    join_rate;              // channels joined per second from the join queue
+	unsigned int    stall_threshold;        // milliseconds a single callback may run before it is logged
+	bool            profile_commands;       // time every command executed through command_exec()
+	char *          uplink_capture;         // file to record uplink traffic to (if any)
 	char *          language;               // default language
 	mowgli_list_t   exempts;                // List of masks never to automatically kline
 	bool            allow_taint;            // allow tainted operation
@@ -153,6 +157,7 @@ extern int runflags;
 #define RF_STARTING     0x00000004U      /* starting up */
 #define RF_RESTART      0x00000008U      /* restart     */
 #define RF_REHASHING    0x00000010U      /* rehashing   */
+#define RF_WARM         0x00000020U      /* keep the uplink across the restart */
 
 /* node.c */
 void init_nodes(void);
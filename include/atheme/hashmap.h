@@ -0,0 +1,99 @@
+/*
+ * SPDX-License-Identifier: ISC
+ * SPDX-URL: https://spdx.org/licenses/ISC.html
+ *
+ * Copyright (C) 2026 Atheme Development Group (https://atheme.github.io/)
+ *
+ * Open-addressing hash tables keyed by name.
+ */
+
+#ifndef ATHEME_INC_HASHMAP_H
+#define ATHEME_INC_HASHMAP_H 1
+
+#include <atheme/attributes.h>
+#include <atheme/stdheaders.h>
+
+/* A Robin Hood hash table (linear probing; entries that are further from
+ * their home slot take the place of those that are closer to theirs, and
+ * deletion shifts the entries that follow back), for the global indexes that
+ * are looked up on every protocol message. Each slot keeps the hash of its
+ * key, so that a probe only touches the key of an entry whose hash matches.
+ *
+ * Keys are copied. A case-insensitive table folds keys the way irccasecanon()
+ * does, so it can stand in for a patricia created with irccasecanon. There is
+ * no ordering; the indexes keep their patricia for ordered iteration, and
+ * HASHMAP_FOREACH() visits the entries of a table in slot order. Values may
+ * not be NULL.
+ */
+
+struct hashmap_slot
+{
+	uint32_t        hash;           // 0 if the slot is empty
+	char *          key;
+	void *          value;
+};
+
+struct hashmap
+{
+	struct hashmap_slot *   slots;
+	size_t                  mask;           // number of slots - 1 (a power of two)
+	size_t                  count;
+	bool                    casefold;
+};
+
+/* see HASHMAP_FOREACH() */
+struct hashmap_iter
+{
+	const struct hashmap *  map;
+	size_t                  pos;
+	const char *            key;            // key of the entry the loop is at
+};
+
+/* Iterates over the entries of a hash table, setting value to each value and
+ * iter->key to its key. Nothing may be added to or deleted from the table
+ * during the loop.
+ */
+#define HASHMAP_FOREACH(value, iter, map) \
+	for (hashmap_iter_init((iter), (map)); ((value) = hashmap_iter_next((iter))) != NULL; )
+
+typedef void (*hashmap_stats_cb)(const char *line, void *privdata);
+
+/* hashmap.c */
+struct hashmap *hashmap_create(bool casefold) ATHEME_FATTR_MALLOC ATHEME_FATTR_RETURNS_NONNULL;
+void hashmap_destroy(struct hashmap *map);
+bool hashmap_add(struct hashmap *map, const char *key, void *value);
+void *hashmap_retrieve(const struct hashmap *map, const char *key) ATHEME_FATTR_WUR;
+void *hashmap_delete(struct hashmap *map, const char *key);
+void hashmap_stats(const struct hashmap *map, const char *name, hashmap_stats_cb cb, void *privdata);
+
+static inline size_t hashmap_size(const struct hashmap *const restrict map)
+{
+	return map->count;
+}
+
+static inline void hashmap_iter_init(struct hashmap_iter *const restrict iter, const struct hashmap *const restrict map)
+{
+	iter->map = map;
+	iter->pos = 0;
+	iter->key = NULL;
+}
+
+static inline void *hashmap_iter_next(struct hashmap_iter *const restrict iter)
+{
+	for (; iter->pos <= iter->map->mask; iter->pos++)
+	{
+		const struct hashmap_slot *const slot = &iter->map->slots[iter->pos];
+
+		if (! slot->hash)
+			continue;
+
+		iter->pos++;
+		iter->key = slot->key;
+
+		return slot->value;
+	}
+
+	return NULL;
+}
+
+#endif /* !ATHEME_INC_HASHMAP_H */
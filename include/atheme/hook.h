@@ -40,6 +40,7 @@ struct hook_channel_joinpart
 	 * this is NULL, a previous function kicked the user.
 	 */
 	struct chanuser *   cu;
+	bool                split;          // a part because of a netsplit; channel_split has been called already
 };
 
 struct hook_channel_message
@@ -76,6 +77,17 @@ struct hook_channel_req
 	struct sourceinfo * si;
 };
 
+struct hook_channel_split
+{
+	/* Called once per channel when users leave in a netsplit, before channel_part is called (with split set)
+	 * for every member. The members have not been removed yet. The hook may not kick anyone or destroy the
+	 * channel.
+	 */
+	struct channel *    c;
+	struct chanuser **  members;        // the members that are leaving
+	size_t              count;
+};
+
 struct hook_channel_succession_req
 {
 	struct mychan * mc;
@@ -254,10 +266,24 @@ struct hook_user_certfp
 	char                certfp[512];
 };
 
+/* State of the protocol module that a warm restart has to carry over, as
+ * strings by name. On save, the values are allocated by the hook function
+ * and freed by the core; on restore, they are only valid during the hook.
+ * A protocol module that can resume a link sets supported on both hooks;
+ * without it, the restart is a cold one.
+ */
+struct hook_warm_restart
+{
+	struct hashmap *    state;
+	bool                supported;
+};
+
 void hook_del_hook(const char *, hook_fn);
 void hook_add_hook(const char *, hook_fn);
 void hook_add_hook_first(const char *, hook_fn);
 void hook_call_event(const char *, void *);
+extern bool hook_profile;
+extern uint64_t hook_profile_ns;
 
 void hook_stop(void);
 void hook_continue(void *newptr);
@@ -13,10 +13,15 @@
 #include <atheme/stdheaders.h>
 #include <atheme/structures.h>
 
+/* handler is called with the body of a POST request; get_handler, if it is
+ * not NULL, is called for a GET request. Either must send the whole reply;
+ * after a GET handler, the httpd closes the connection if it was asked to.
+ */
 struct path_handler
 {
 	const char *    path;
 	void          (*handler)(struct connection *, void *);
+	void          (*get_handler)(struct connection *);
 };
 
 struct httpddata
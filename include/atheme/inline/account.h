@@ -40,6 +40,26 @@ static inline struct myuser *myuser_find_uid(const char *uid)
 	return uid ? user(myentity_find_uid(uid)) : NULL;
 }
 
+/*
+ * myuser_cold_ro(const struct myuser *mu)
+ *
+ * Returns the rarely-used part of an account for reading, without
+ * allocating it.
+ *
+ * Inputs:
+ *      - account to look at
+ *
+ * Outputs:
+ *      - the account's cold extension, or an empty one if it has none
+ *
+ * Side Effects:
+ *      - none
+ */
+static inline const struct myuser_cold *myuser_cold_ro(const struct myuser *mu)
+{
+	return mu->cold != NULL ? mu->cold : &myuser_cold_empty;
+}
+
 /*
  * mynick_find(const char *name)
  *
@@ -56,7 +76,7 @@ static inline struct myuser *myuser_find_uid(const char *uid)
  */
 static inline struct mynick *mynick_find(const char *name)
 {
-	return name ? mowgli_patricia_retrieve(nicklist, name) : NULL;
+	return name ? hashmap_retrieve(nicklist_index, name) : NULL;
 }
 
 static inline struct myuser *myuser_find_by_nick(const char *name)
@@ -99,7 +119,7 @@ static inline struct myuser_name *myuser_name_find(const char *name)
 
 static inline struct mychan *mychan_find(const char *name)
 {
-	return name ? mowgli_patricia_retrieve(mclist, name) : NULL;
+	return name ? hashmap_retrieve(mclist_index, name) : NULL;
 }
 
 static inline struct mychan *mychan_from(struct channel *chan)
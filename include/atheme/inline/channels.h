@@ -28,7 +28,51 @@
  */
 static inline struct channel *channel_find(const char *name)
 {
-	return name ? mowgli_patricia_retrieve(chanlist, name) : NULL;
+	return name ? hashmap_retrieve(chanlist_index, name) : NULL;
+}
+
+/*
+ * channel_extmode(const struct channel *chan, unsigned int i)
+ *
+ * Looks up the parameter of a non-standard simple mode on a channel.
+ *
+ * Inputs:
+ *     - channel to look at
+ *     - index of the mode in ignore_mode_list
+ *
+ * Outputs:
+ *     - the mode parameter if the mode is set
+ *     - NULL otherwise
+ *
+ * Side Effects:
+ *     - none
+ */
+static inline const char *channel_extmode(const struct channel *chan, unsigned int i)
+{
+	return chan->extmodes != NULL ? chan->extmodes[i] : NULL;
+}
+
+static inline void chanuser_iter_init(struct chanuser_iter *iter, const struct channel *chan)
+{
+	iter->index = chan->index;
+	iter->node = chan->members.head;
+	iter->pos = 0;
+}
+
+static inline struct chanuser *chanuser_iter_next(struct chanuser_iter *iter)
+{
+	struct chanuser *cu;
+
+	if (iter->index != NULL)
+		return iter->pos < iter->index->count ? iter->index->members[iter->pos++] : NULL;
+
+	if (iter->node == NULL)
+		return NULL;
+
+	cu = iter->node->data;
+	iter->node = iter->node->next;
+
+	return cu;
 }
 
 /*
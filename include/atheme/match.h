@@ -36,9 +36,63 @@ struct atheme_regex
 	} un;
 };
 
+struct cidr_addr
+{
+	unsigned char   addr[16];
+	bool            ipv6;
+};
+
+enum match_shape
+{
+	MATCH_SHAPE_GENERIC     = 0,    // none of the below
+	MATCH_SHAPE_ALL,                // only '*'s
+	MATCH_SHAPE_LITERAL,            // no special characters
+	MATCH_SHAPE_PREFIX,             // "literal*"
+	MATCH_SHAPE_SUFFIX,             // "*literal"
+	MATCH_SHAPE_SUBSTRING,          // "*literal*"
+};
+
+struct match_segment
+{
+	size_t                  offset;         // in folded
+	size_t                  len;
+	unsigned char           first[2];       // characters that fold to the first one
+	unsigned int            nfirst;         // 0 if there are more than two of them
+};
+
+/* A mask preprocessed by match_compile(). Every subject that match() can
+ * accept starts with the first prefixlen and ends with the last suffixlen
+ * characters of folded, and contains the segments in between, in order.
+ */
+struct match_pattern
+{
+	char *                  mask;
+	char *                  folded;         // mask run through ToLower()
+	size_t                  len;
+	int                     mapping;        // match_mapping the mask was folded with
+	enum match_shape        shape;
+	size_t                  prefixlen;
+	size_t                  suffixlen;
+	struct match_segment *  segments;
+	size_t                  nsegments;
+};
+
+/* A ban or access list mask, preprocessed by mask_matcher_compile() so that
+ * it can be tested against many users without reparsing it.
+ */
+struct mask_matcher
+{
+	struct match_pattern *  pattern;        // NULL if not compiled
+	char *                  cidr_nickuser;  // nick!user part of a nick!user@ip/bits mask
+	unsigned int            cidr_bits;      // 0 if the mask is not a valid CIDR mask
+	struct cidr_addr        cidr_addr;
+};
+
 /* cidr.c */
 int match_ips(const char *mask, const char *address);
 int match_cidr(const char *mask, const char *address);
+bool cidr_parse(const char *ip, struct cidr_addr *addr);
+bool cidr_match(const struct cidr_addr *net, unsigned int bits, const struct cidr_addr *addr);
 
 /* match.c */
 #define MATCH_RFC1459   0
@@ -81,6 +135,13 @@ void noopcanon(char *);
 int match(const char *, const char *);
 char *collapse(char *);
 
+struct match_pattern *match_compile(const char *mask) ATHEME_FATTR_MALLOC;
+int match_compiled(const struct match_pattern *pattern, const char *name);
+void match_pattern_free(struct match_pattern *pattern);
+
+void mask_matcher_compile(struct mask_matcher *mm, const char *mask);
+void mask_matcher_free(struct mask_matcher *mm);
+
 /* regex_create() flags */
 #define AREGEX_ICASE	1 /* case insensitive */
 #define AREGEX_PCRE	2 /* use libpcre engine */
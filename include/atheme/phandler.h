@@ -102,6 +102,11 @@ extern void (*wallops_sts)(const char *text);
  * modes is a convenience argument giving the simple modes with parameters
  * do not rely upon chanuser_find(c,u) */
 extern void (*join_sts)(struct channel *c, struct user *u, bool isnew, char *modes);
+/* join several channels that do not exist yet with a client on the services
+ * server, as join_sts() does with isnew set and channel_modes(c, true)
+ * protocols that can create more than one channel per line set this, the
+ * default calls join_sts() for each channel */
+extern void (*join_batch_sts)(struct user *u, struct channel **chans, size_t count);
 /* lower the TS of a channel, joining it with the given client on the
  * services server (opped), replacing the current simple modes with the
  * ones stored in the struct channel and clearing all other statuses
@@ -266,6 +271,7 @@ void generic_invite_sts(struct user *source, struct user *target, struct channel
 void generic_quit_sts(struct user *u, const char *reason);
 void generic_wallops_sts(const char *text);
 void generic_join_sts(struct channel *c, struct user *u, bool isnew, char *modes);
+void generic_join_batch_sts(struct user *u, struct channel **chans, size_t count);
 void generic_chan_lowerts(struct channel *c, struct user *u);
 void generic_kick(struct user *source, struct channel *c, struct user *u, const char *reason);
 void generic_msg(const char *from, const char *target, const char *fmt, ...) ATHEME_FATTR_PRINTF(3, 4);
@@ -311,6 +317,8 @@ bool generic_is_ircop(struct user *u);
 bool generic_is_admin(struct user *u);
 bool generic_is_service(struct user *u);
 
+bool matcher_matches_user(struct mask_matcher *mm, const char *mask, struct user *u);
+
 extern const struct cmode *mode_list;
 extern struct extmode *ignore_mode_list;
 extern size_t ignore_mode_list_size;
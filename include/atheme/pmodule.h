@@ -11,15 +11,37 @@
 #ifndef ATHEME_INC_PMODULE_H
 #define ATHEME_INC_PMODULE_H 1
 
+#include <atheme/profile.h>
 #include <atheme/sourceinfo.h>
 #include <atheme/stdheaders.h>
 
+struct pcommand_stats
+{
+	struct profile_counter  handler;        // handler run time, including hooks
+	uint64_t                bytes;          // length of the lines, without CRLF
+	uint64_t                hook_ns;        // time spent in hooks called by the handler
+};
+
 struct proto_cmd
 {
-	char *  token;
-	void  (*handler)(struct sourceinfo *si, int parc, char *parv[]);
-	int     minparc;
-	int     sourcetype;
+	char *                  token;
+	void                  (*handler)(struct sourceinfo *si, int parc, char *parv[]);
+	int                     minparc;
+	int                     sourcetype;
+	struct pcommand_stats   stats;          // since startup or PROFILE RESET
+	struct pcommand_stats   burst;          // during the last burst only
+};
+
+// Totals for the burst from our uplink, from connecting until its EOB
+struct pcommand_burst
+{
+	time_t                  start;
+	uint64_t                start_ns;
+	uint64_t                wall_ns;        // 0 while the burst is in progress
+	uint64_t                messages;
+	uint64_t                bytes;
+	uint64_t                handler_ns;
+	uint64_t                hook_ns;
 };
 
 /* values for sourcetype */
@@ -33,6 +55,7 @@ struct proto_cmd
 extern mowgli_heap_t *pcommand_heap;
 extern mowgli_heap_t *messagetree_heap;
 extern mowgli_patricia_t *pcommands;
+extern struct pcommand_burst pcommand_burst;
 
 void pcommand_init(void);
 void pcommand_add(const char *token,
@@ -40,6 +63,10 @@ void pcommand_add(const char *token,
 	int minparc, int sourcetype);
 void pcommand_delete(const char *token);
 struct proto_cmd *pcommand_find(const char *token);
+void pcommand_exec(struct proto_cmd *pcmd, struct sourceinfo *si, int parc, char *parv[], size_t len);
+void pcommand_burst_begin(void);
+void pcommand_stats_reset(void);
+size_t pcommand_stats_sorted(struct proto_cmd ***out, bool burst);
 
 /* ptasks.c */
 const char *get_build_date(void);
@@ -0,0 +1,72 @@
+/*
+ * SPDX-License-Identifier: ISC
+ * SPDX-URL: https://spdx.org/licenses/ISC.html
+ *
+ * Copyright (C) 2026 Atheme Development Group (https://atheme.github.io/)
+ *
+ * Run-time profiling counters and event loop instrumentation.
+ */
+
+#ifndef ATHEME_INC_PROFILE_H
+#define ATHEME_INC_PROFILE_H 1
+
+#include <atheme/attributes.h>
+#include <atheme/constants.h>
+#include <atheme/stdheaders.h>
+
+/* Bucket 0 counts durations below 2us; bucket i (i > 0) counts durations in
+ * [2^i, 2^(i+1)) us; the last bucket also counts everything longer.
+ */
+#define PROFILE_HIST_BUCKETS    24U
+
+struct profile_counter
+{
+	char *          name;
+	uint64_t        calls;
+	uint64_t        failures;
+	uint64_t        total_ns;
+	uint64_t        max_ns;
+	uint64_t        hist[PROFILE_HIST_BUCKETS];
+};
+
+struct eventloop_stall
+{
+	char            culprit[BUFSIZE];
+	uint64_t        duration_ns;
+	time_t          when;
+};
+
+struct eventloop_stats
+{
+	struct profile_counter  iteration;      // busy time per loop iteration
+	uint64_t                idle_iterations;// iterations that ran no callback at all
+	uint64_t                stalls;
+	struct eventloop_stall  last_stall;
+	struct eventloop_stall  worst_stall;
+	time_t                  since;          // when the counters were last reset
+};
+
+extern struct eventloop_stats eventloop_stats;
+extern mowgli_patricia_t *eventloop_timer_stats;
+extern mowgli_patricia_t *eventloop_io_stats;
+
+/* profile.c */
+uint64_t profile_time_ns(void);
+unsigned int profile_hist_bucket(uint64_t ns) ATHEME_FATTR_WUR;
+uint64_t profile_hist_bucket_limit_us(unsigned int bucket) ATHEME_FATTR_WUR;
+uint64_t profile_hist_percentile_us(const struct profile_counter *pc, unsigned int percent) ATHEME_FATTR_WUR;
+void profile_counter_record(struct profile_counter *pc, uint64_t ns);
+void profile_counter_reset(struct profile_counter *pc);
+struct profile_counter *profile_counter_get(mowgli_patricia_t *table, const char *name) ATHEME_FATTR_RETURNS_NONNULL;
+size_t profile_table_sorted(mowgli_patricia_t *table, struct profile_counter ***out);
+void profile_table_reset(mowgli_patricia_t *table);
+void profile_table_destroy(mowgli_patricia_t *table);
+
+void eventloop_stats_init(void);
+void eventloop_stats_reset(void);
+void eventloop_hook_timers(void);
+void eventloop_iteration_begin(void);
+void eventloop_iteration_end(void);
+void eventloop_callback_done(mowgli_patricia_t *table, const char *name, uint64_t start_ns);
+
+#endif /* !ATHEME_INC_PROFILE_H */
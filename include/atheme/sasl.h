@@ -34,7 +34,6 @@
 
 // Flags for sasl_session->flags
 #define ASASL_SFLAG_NONE                0x00000000U // Nothing special
-#define ASASL_SFLAG_MARKED_FOR_DELETION 0x00000001U // See sasl_delete_stale() in modules/saslserv/main.c
 #define ASASL_SFLAG_CLIENT_SECURE       0x00000002U // The client is connected to the network securely
 
 // Flags for sasl_input_buf->flags
@@ -48,7 +47,7 @@
 
 struct sasl_session
 {
-	mowgli_node_t                   node;                   // Node for entry into the active sessions list
+	mowgli_node_t                   node;                   // Node for entry into the session deadline queue
 	const struct sasl_mechanism *   mechptr;                // Mechanism they're using
 	struct server *                 server;                 // Server they're on
 	struct sourceinfo *             si;                     // The source info for logcommand(), bad_password(), and login hooks
@@ -59,6 +58,7 @@ struct sasl_session
 	char *                          buf;                    // Buffered Base-64 data from them (so far)
 	size_t                          len;                    // Length of buffered Base-64 data
 	unsigned int                    flags;                  // Flags (described above)
+	time_t                          deadline;               // When the session is dropped unless it makes progress
 	char                            authcid[NICKLEN + 1];   // Authentication identity (user having credentials verified)
 	char                            authzid[NICKLEN + 1];   // Authorization identity (user being logged in)
 	char                            authceid[IDLEN + 1];    // Entity ID for authcid
@@ -47,6 +47,7 @@ struct tld
 
 /* servers.c */
 extern mowgli_patricia_t *servlist;
+extern struct hashmap *servlist_index;
 extern mowgli_list_t tldlist;
 
 void init_servers(void);
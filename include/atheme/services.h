@@ -86,6 +86,7 @@ extern bool (*try_kick)(struct user *source, struct channel *chan, struct user *
 void kill_user(struct user *source, struct user *victim, const char *fmt, ...) ATHEME_FATTR_PRINTF(3, 4);
 void introduce_enforcer(const char *nick);
 void join(const char *chan, const char *nick);
+void join_schedule(const char *chan, const char *nick, const char *replace);
 void joinall(const char *name);
 void part(const char *chan, const char *nick);
 void partall(const char *name);
@@ -95,12 +96,16 @@ extern void (*notice)(const char *from, const char *target, const char *fmt, ...
 void change_notify(const char *from, struct user *to, const char *message, ...) ATHEME_FATTR_PRINTF(3, 4);
 bool bad_password(struct sourceinfo *si, struct myuser *mu);
 bool ircd_logout_or_kill(struct user *u, const char *login);
+bool uplink_congested(void);
 
 struct sourceinfo *sourceinfo_create(void);
 void command_fail(struct sourceinfo *si, enum cmd_faultcode code, const char *fmt, ...) ATHEME_FATTR_PRINTF(3, 4);
 void command_success_nodata(struct sourceinfo *si, const char *fmt, ...) ATHEME_FATTR_PRINTF(2, 3);
 void command_success_string(struct sourceinfo *si, const char *result, const char *fmt, ...) ATHEME_FATTR_PRINTF(3, 4);
 void command_success_table(struct sourceinfo *si, struct atheme_table *table);
+struct command_stream *command_stream_begin(struct sourceinfo *si) ATHEME_FATTR_RETURNS_NONNULL;
+void command_stream_printf(struct command_stream *cs, const char *fmt, ...) ATHEME_FATTR_PRINTF(2, 3);
+void command_stream_end(struct command_stream *cs);
 const char *get_source_name(struct sourceinfo *si);
 const char *get_source_mask(struct sourceinfo *si);
 const char *get_oper_name(struct sourceinfo *si);
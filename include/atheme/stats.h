@@ -0,0 +1,107 @@
+/*
+ * SPDX-License-Identifier: ISC
+ * SPDX-URL: https://spdx.org/licenses/ISC.html
+ *
+ * Copyright (C) 2026 Atheme Development Group (https://atheme.github.io/)
+ *
+ * Aggregate statistics maintained as objects are added, changed and deleted.
+ */
+
+#ifndef ATHEME_INC_STATS_H
+#define ATHEME_INC_STATS_H 1
+
+#include <atheme/attributes.h>
+#include <atheme/hashmap.h>
+#include <atheme/stdheaders.h>
+#include <atheme/structures.h>
+
+/* Bucket 0 counts empty (permanent) channels; bucket i (i > 0) counts
+ * channels with [2^(i-1), 2^i) members; the last bucket also counts all
+ * larger channels.
+ */
+#define STATS_CHANNEL_BUCKETS   12U
+
+enum pwhash_type
+{
+	PWHASH_NONE = 0,
+	PWHASH_UNKNOWN,
+	PWHASH_ANOPE_ENC_SHA256,
+	PWHASH_ARGON2D,
+	PWHASH_ARGON2I,
+	PWHASH_ARGON2ID,
+	PWHASH_BASE64,
+	PWHASH_BCRYPT,
+	PWHASH_CRYPT3_DES,
+	PWHASH_CRYPT3_MD5,
+	PWHASH_CRYPT3_SHA2_256,
+	PWHASH_CRYPT3_SHA2_512,
+	PWHASH_IRCSERVICES,
+	PWHASH_PBKDF2,
+	PWHASH_PBKDF2V2_SCRAM_MD5,
+	PWHASH_PBKDF2V2_SCRAM_SHA1,
+	PWHASH_PBKDF2V2_SCRAM_SHA2_256,
+	PWHASH_PBKDF2V2_SCRAM_SHA2_512,
+	PWHASH_PBKDF2V2_HMAC_MD5,
+	PWHASH_PBKDF2V2_HMAC_SHA1,
+	PWHASH_PBKDF2V2_HMAC_SHA2_256,
+	PWHASH_PBKDF2V2_HMAC_SHA2_512,
+	PWHASH_RAWMD5,
+	PWHASH_RAWSHA1,
+	PWHASH_RAWSHA2_256,
+	PWHASH_RAWSHA2_512,
+	PWHASH_SCRYPT,
+	PWHASH_TYPE_COUNT,
+};
+
+struct stats_login
+{
+	char *          method;
+	uint64_t        count;
+};
+
+/* Unlike struct cnt, which counts objects, these break objects down by some
+ * property; every counter is kept up to date by the code that changes that
+ * property, so reading one never walks a table.
+ */
+struct stats_counters
+{
+	unsigned int            pwhash[PWHASH_TYPE_COUNT];      // accounts by password hash type
+	unsigned int            chansize[STATS_CHANNEL_BUCKETS];// channels by member count
+	struct hashmap *        logins;                         // method name -> struct stats_login
+};
+
+extern struct stats_counters stats_counters;
+
+/* stats.c */
+void stats_init(void);
+enum pwhash_type pwhash_classify(const struct myuser *mu) ATHEME_FATTR_WUR;
+const char *pwhash_type_label(enum pwhash_type type) ATHEME_FATTR_WUR;
+const char *stats_chansize_label(unsigned int bucket) ATHEME_FATTR_WUR;
+void stats_login_count(const char *method);
+
+static inline unsigned int
+stats_chansize_bucket(unsigned int members)
+{
+	unsigned int bucket = 0;
+
+	for (; members && bucket < STATS_CHANNEL_BUCKETS - 1U; members >>= 1)
+		bucket++;
+
+	return bucket;
+}
+
+// Called on every join and part, so it only touches the counters when a bucket boundary is crossed
+static inline void
+stats_channel_resized(const unsigned int from, const unsigned int to)
+{
+	const unsigned int b_from = stats_chansize_bucket(from);
+	const unsigned int b_to = stats_chansize_bucket(to);
+
+	if (b_from == b_to)
+		return;
+
+	stats_counters.chansize[b_from]--;
+	stats_counters.chansize[b_to]++;
+}
+
+#endif /* !ATHEME_INC_STATS_H */
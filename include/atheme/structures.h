@@ -60,6 +60,9 @@ struct gflags;
 // Defined in atheme/global.h
 struct me;
 
+// Defined in atheme/hashmap.h
+struct hashmap;
+
 // Defined in atheme/hook.h
 struct hook;
 
@@ -68,6 +71,8 @@ struct path_handler;
 
 // Defined in atheme/match.h
 struct atheme_regex;
+struct mask_matcher;
+struct match_pattern;
 
 // Defined in atheme/module.h
 struct module;
@@ -77,7 +82,9 @@ struct v4_moduleheader;
 struct atheme_object;
 struct metadata;
 
-// Defined in atheme/pcommand.h
+// Defined in atheme/pmodule.h
+struct pcommand_burst;
+struct pcommand_stats;
 struct proto_cmd;
 
 // Defined in atheme/phandler.h
@@ -87,6 +94,11 @@ struct ircd;
 struct operclass;
 struct soper;
 
+// Defined in atheme/profile.h
+struct eventloop_stall;
+struct eventloop_stats;
+struct profile_counter;
+
 // Defined in atheme/res.h
 struct nsaddr;
 struct res_dns_query;
@@ -105,6 +117,7 @@ struct tld;
 
 // Defined in atheme/services.h
 struct chansvs;
+struct command_stream;  // opaque, see command_stream_begin()
 struct nicksvs;
 
 // Defined in atheme/servtree.h
@@ -0,0 +1,34 @@
+/*
+ * SPDX-License-Identifier: ISC
+ * SPDX-URL: https://spdx.org/licenses/ISC.html
+ *
+ * Copyright (C) 2026 Atheme Development Group (https://atheme.github.io/)
+ *
+ * Indexes of entries by the day of a timestamp.
+ */
+
+#ifndef ATHEME_INC_TIMEINDEX_H
+#define ATHEME_INC_TIMEINDEX_H 1
+
+#include <atheme/stdheaders.h>
+
+/* Entries filed under the day of a timestamp, such as a registration time,
+ * for queries like "older than N days" that only need to visit the days up
+ * to a cut-off. days[i] holds the entries of day first_day + i; an entry
+ * embeds the node it is filed with. A zeroed struct is an empty index.
+ */
+struct time_index
+{
+	mowgli_list_t *         days;
+	unsigned int            first_day;
+	unsigned int            ndays;
+};
+
+/* timeindex.c */
+unsigned int time_index_day(time_t ts);
+void time_index_add(struct time_index *ti, void *data, mowgli_node_t *n, unsigned int day);
+void time_index_delete(struct time_index *ti, mowgli_node_t *n, unsigned int day);
+size_t time_index_count(const struct time_index *ti, unsigned int last_day);
+void time_index_clear(struct time_index *ti);
+
+#endif /* !ATHEME_INC_TIMEINDEX_H */
@@ -147,6 +147,7 @@ int tokenize(char *message, char **parv);
 /* ubase64.c */
 const char *uinttobase64(char *buf, uint64_t v, int64_t count);
 unsigned int base64touint(const char *buf);
+bool base64tonum(const char *buf, size_t len, unsigned int *value) ATHEME_FATTR_WUR;
 void decode_p10_ip(const char *b64, char ipstring[HOSTIPLEN + 1]);
 
 #endif /* !ATHEME_INC_TOOLS_H */
@@ -12,6 +12,7 @@
 #define ATHEME_INC_UPLINK_H 1
 
 #include <atheme/attributes.h>
+#include <atheme/connection.h>
 #include <atheme/stdheaders.h>
 #include <atheme/structures.h>
 
@@ -39,6 +40,9 @@ struct uplink *uplink_add(const char *name, const char *host, const char *send_p
 void uplink_delete(struct uplink *u);
 struct uplink *uplink_find(const char *name);
 void uplink_connect(void);
+struct connection *uplink_resume(const char *name, int fd);
+struct connection *uplink_connect_loopback(int *peerfd);
+uint64_t uplink_loopback_drain(int peerfd);
 
 /* packet.c */
 /* bursting timer */
@@ -48,8 +52,10 @@ extern struct timeval burstime;
 
 extern void (*parse)(char *line);
 void irc_handle_connect(struct connection *cptr);
+void irc_handle_resume(struct connection *cptr);
 
 /* send.c */
+enum sendq_class sts_set_class(enum sendq_class cls);
 int sts(const char *fmt, ...) ATHEME_FATTR_PRINTF(1, 2);
 void io_loop(void);
 
@@ -10,7 +10,9 @@
 #ifndef ATHEME_INC_USERS_H
 #define ATHEME_INC_USERS_H 1
 
+#include <atheme/attributes.h>
 #include <atheme/common.h>
+#include <atheme/match.h>
 #include <atheme/object.h>
 #include <atheme/stdheaders.h>
 #include <atheme/structures.h>
@@ -36,6 +38,37 @@ struct user
 	time_t                  ts;
 	mowgli_node_t           snode;          // for struct server -> userlist
 	char *                  certfp;         // client certificate fingerprint
+	struct user_masks *     masks;          // see user_get_masks()
+};
+
+enum user_mask_form
+{
+	USER_MASK_VHOST = 0,    // nick!user@vhost
+	USER_MASK_CHOST,        // nick!user@chost
+	USER_MASK_HOST,         // nick!user@host
+	USER_MASK_IP,           // nick!user@ip
+	USER_MASK_COUNT
+};
+
+#define USER_MASK_BUFLEN        (NICKLEN + 1 + USERLEN + 1 + HOSTLEN + 1)
+
+/* The forms of a user that bans and host access entries are matched against.
+ * The strings they were built from are referenced, so the cache stays valid
+ * exactly as long as the user's fields still point to the same strings.
+ */
+struct user_masks
+{
+	stringref               nick;
+	stringref               user;
+	stringref               host;
+	stringref               chost;
+	stringref               vhost;
+	stringref               ip;
+	const char *            form[USER_MASK_COUNT];
+	const char *            nickuser;                       // form[USER_MASK_IP] up to its last '@'
+	struct cidr_addr        addr;
+	bool                    addr_valid;
+	char *                  buf;
 };
 
 #define UF_AWAY        0x00000002U
@@ -67,11 +100,14 @@ bool is_autokline_exempt(struct user *user);
 /* users.c */
 extern mowgli_patricia_t *userlist;
 extern mowgli_patricia_t *uidlist;
+extern struct hashmap *userlist_index;
+extern struct hashmap *uidlist_index;
 
 void init_users(void);
 
 struct user *user_add(const char *nick, const char *user, const char *host, const char *vhost, const char *ip, const char *uid, const char *gecos, struct server *server, time_t ts);
 void user_delete(struct user *u, const char *comment);
+void user_delete_batch(struct user **users, size_t count, const char *comment);
 struct user *user_find(const char *nick);
 struct user *user_find_named(const char *nick);
 void user_changeuid(struct user *u, const char *uid);
@@ -79,10 +115,22 @@ bool user_changenick(struct user *u, const char *nick, time_t ts);
 void user_mode(struct user *user, const char *modes);
 void user_sethost(struct user *source, struct user *target, const char *host);
 const char *user_get_umodestr(struct user *u);
+const struct user_masks *user_get_masks(struct user *u);
 struct chanuser *find_user_banned_channel(struct user *u, char ban_type);
 
 /* uid.c */
 void init_uid(void);
 const char *uid_get(void);
+unsigned int uid_get_count(void);
+void uid_skip(unsigned int count);
+const char *uid_base36_encode(char *buf, unsigned int value, size_t len);
+bool uid_base36_decode(const char *buf, size_t len, unsigned int *value) ATHEME_FATTR_WUR;
+void uid_directory_add(struct user *u);
+void uid_directory_delete(struct user *u);
+struct user *uid_directory_find(const char *uid, bool *decoded);
+void uid_directory_add_server(struct server *s);
+void uid_directory_delete_server(struct server *s);
+struct server *uid_directory_find_server(const char *sid, bool *decoded);
+void uid_directory_stats(void (*cb)(const char *line, void *privdata), void *privdata);
 
 #endif /* !ATHEME_INC_USERS_H */
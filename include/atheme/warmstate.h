@@ -0,0 +1,46 @@
+/*
+ * SPDX-License-Identifier: ISC
+ * SPDX-URL: https://spdx.org/licenses/ISC.html
+ *
+ * Copyright (C) 2026 Atheme Development Group (https://atheme.github.io/)
+ *
+ * Warm restarts: handing the network state and the uplink connection over
+ * to the process services re-exec themselves as.
+ */
+
+#ifndef ATHEME_INC_WARMSTATE_H
+#define ATHEME_INC_WARMSTATE_H 1
+
+#include <atheme/stdheaders.h>
+
+/* The snapshot is written to WARMSTATE_FILE in the data directory and the
+ * socket of the uplink connection is inherited by the new process, which is
+ * told its number with -W. The snapshot starts with WARMSTATE_MAGIC and is
+ * followed by records, in the order below: a type byte and then the fields
+ * of the record. Numbers are varints as in capture files; strings are their
+ * length plus one as a varint (0 for a NULL string), the bytes of the string
+ * and a NUL. Every server record is followed by the records of its users;
+ * servers come after their uplink.
+ */
+#define WARMSTATE_MAGIC         "ATHWRM1\n"
+#define WARMSTATE_MAGIC_LEN     8U
+#define WARMSTATE_FILE          "services.warm"
+
+enum warmstate_record
+{
+	WARMSTATE_HEADER        = 'H',          // uplink{} name, uplink name, uses UIDs, UIDs handed out
+	WARMSTATE_PROTOCOL      = 'P',          // protocol module state: name, value
+	WARMSTATE_SERVICE       = 'I',          // one of our own clients: nick, UID
+	WARMSTATE_SERVER        = 'S',
+	WARMSTATE_USER          = 'U',          // a user on the last server
+	WARMSTATE_CHANNEL       = 'C',
+	WARMSTATE_RECVQ         = 'R',          // received from the uplink, not parsed yet
+	WARMSTATE_END           = 'E',          // how many servers, users and channels were written
+};
+
+/* warmstate.c */
+int warmstate_save(void);
+bool warmstate_restore(int fd);
+void warmstate_resume_cancel(void);
+
+#endif /* !ATHEME_INC_WARMSTATE_H */
@@ -19,12 +19,16 @@
 mowgli_patricia_t *nicklist;
 mowgli_patricia_t *oldnameslist;
 mowgli_patricia_t *mclist;
+struct hashmap *nicklist_index;
+struct hashmap *mclist_index;
 
 static mowgli_patricia_t *certfplist;
 
 static mowgli_heap_t *myuser_heap;   /* HEAP_USER */
+static mowgli_heap_t *myuser_cold_heap;	/* HEAP_USER */
 static mowgli_heap_t *mynick_heap;   /* HEAP_USER */
 static mowgli_heap_t *mycertfp_heap; /* HEAP_USER */
+static mowgli_heap_t *mymemo_heap;   /* HEAP_USER */
 static mowgli_heap_t *myuser_name_heap;	/* HEAP_USER / 2 */
 static mowgli_heap_t *mychan_heap;	/* HEAP_CHANNEL */
 static mowgli_heap_t *chanacs_heap;	/* HEAP_CHANACS */
@@ -47,14 +51,16 @@ void
 init_accounts(void)
 {
 	myuser_heap = sharedheap_get(sizeof(struct myuser));
-	mynick_heap = sharedheap_get(sizeof(struct myuser));
+	myuser_cold_heap = sharedheap_get(sizeof(struct myuser_cold));
+	mynick_heap = sharedheap_get(sizeof(struct mynick));
 	myuser_name_heap = sharedheap_get(sizeof(struct myuser_name));
 	mychan_heap = sharedheap_get(sizeof(struct mychan));
 	chanacs_heap = sharedheap_get(sizeof(struct chanacs));
 	mycertfp_heap = sharedheap_get(sizeof(struct mycertfp));
+	mymemo_heap = sharedheap_get(sizeof(struct mymemo));
 
-	if (myuser_heap == NULL || mynick_heap == NULL || mychan_heap == NULL
-			|| chanacs_heap == NULL || mycertfp_heap == NULL)
+	if (myuser_heap == NULL || myuser_cold_heap == NULL || mynick_heap == NULL || mychan_heap == NULL
+			|| chanacs_heap == NULL || mycertfp_heap == NULL || mymemo_heap == NULL)
 	{
 		slog(LG_ERROR, "init_accounts(): block allocator failure.");
 		exit(EXIT_FAILURE);
@@ -63,6 +69,8 @@ init_accounts(void)
 	nicklist = mowgli_patricia_create(irccasecanon);
 	oldnameslist = mowgli_patricia_create(irccasecanon);
 	mclist = mowgli_patricia_create(irccasecanon);
+	nicklist_index = hashmap_create(true);
+	mclist_index = hashmap_create(true);
 	certfplist = mowgli_patricia_create(strcasecanon);
 }
 
@@ -85,6 +93,8 @@ init_accounts(void)
  * Side Effects:
  *      - the created account is added to the accounts DTree,
  *        this may be undesirable for a factory.
+ *      - myuser_add hook is called, before the caller has filled in
+ *        the rest of the account
  *
  * Caveats:
  *      - if nicksvs.no_nick_ownership is not enabled, the caller is
@@ -146,7 +156,7 @@ myuser_add_id(const char *id, const char *name, const char *pass, const char *em
 	 * try to encrypt it, or continue to store it plain if this fails.
 	 */
 	if ((mu->flags & MU_CRYPTPASS) || (! set_password(mu, pass)))
-		(void) mowgli_strlcpy(mu->pass, pass, sizeof mu->pass);
+		(void) myuser_set_pass(mu, pass);
 
 	if ((soper = soper_find_named(entity(mu)->name)) != NULL
 		|| (soper = soper_find_eid(entity(mu)->id)) != NULL)
@@ -160,6 +170,8 @@ myuser_add_id(const char *id, const char *name, const char *pass, const char *em
 
 	cnt.myuser++;
 
+	hook_call_myuser_add(mu);
+
 	return mu;
 }
 
@@ -185,7 +197,6 @@ myuser_delete(struct myuser *mu)
 	struct mynick *mn;
 	struct user *u;
 	mowgli_node_t *n, *tn;
-	struct mymemo *memo;
 	struct chanacs *ca;
 	char nicks[200];
 
@@ -263,23 +274,34 @@ myuser_delete(struct myuser *mu)
 	/* kill any authcookies */
 	authcookie_destroy_all(mu);
 
-	/* delete memos */
-	MOWGLI_ITER_FOREACH_SAFE(n, tn, mu->memos.head)
+	if (mu->cold != NULL)
 	{
-		memo = (struct mymemo *)n->data;
+		/* delete memos */
+		MOWGLI_ITER_FOREACH_SAFE(n, tn, mu->cold->memos.head)
+			mymemo_delete(mu, n->data);
 
-		mowgli_node_delete(n, &mu->memos);
-		mowgli_node_free(n);
-		sfree(memo);
-	}
+		/* delete memo ignores */
+		MOWGLI_ITER_FOREACH_SAFE(n, tn, mu->cold->memo_ignores.head)
+		{
+			sfree(n->data);
+			mowgli_node_delete(n, &mu->cold->memo_ignores);
+			mowgli_node_free(n);
+		}
+
+		mu->cold->memoct_new = 0;
 
-	/* delete access entries */
-	MOWGLI_ITER_FOREACH_SAFE(n, tn, mu->access_list.head)
-		myuser_access_delete(mu, (char *)n->data);
+		/* delete access entries and certfp entries; these release the
+		 * cold extension once it becomes empty, so recheck it each time
+		 */
+		while (mu->cold != NULL && mu->cold->access_list.head != NULL)
+			myuser_access_delete(mu, (char *) mu->cold->access_list.head->data);
 
-	/* delete certfp entries */
-	MOWGLI_ITER_FOREACH_SAFE(n, tn, mu->cert_fingerprints.head)
-		mycertfp_delete((struct mycertfp *) n->data);
+		while (mu->cold != NULL && mu->cold->cert_fingerprints.head != NULL)
+			mycertfp_delete((struct mycertfp *) mu->cold->cert_fingerprints.head->data);
+
+		if (mu->cold != NULL)
+			mowgli_heap_free(myuser_cold_heap, mu->cold);
+	}
 
 	/* delete their nicks and report them */
 	nicks[0] = '\0';
@@ -315,6 +337,12 @@ myuser_delete(struct myuser *mu)
 	strshare_unref(mu->email_canonical);
 	strshare_unref(entity(mu)->name);
 
+	if (mu->pass != NULL)
+	{
+		stats_counters.pwhash[mu->pwhash]--;
+		smemzerofree(mu->pass, strlen(mu->pass) + 1);
+	}
+
 	mowgli_heap_free(myuser_heap, mu);
 
 	cnt.myuser--;
@@ -395,6 +423,7 @@ myuser_rename(struct myuser *mu, const char *name)
  *
  * Side Effects:
  *      - email address is changed
+ *      - the myuser_changed_email hook is called
  */
 void
 myuser_set_email(struct myuser *mu, const char *newemail)
@@ -407,6 +436,109 @@ myuser_set_email(struct myuser *mu, const char *newemail)
 
 	mu->email = strshare_get(newemail);
 	mu->email_canonical = canonicalize_email(newemail);
+
+	hook_call_myuser_changed_email(mu);
+}
+
+/*
+ * myuser_set_pass(struct myuser *mu, const char *pass)
+ *
+ * Replaces the stored password (or password hash) of an account. Passwords
+ * are allocated to their actual length rather than stored in a PASSLEN
+ * buffer inside every account.
+ *
+ * Inputs:
+ *      - account to change
+ *      - new password or password hash
+ *
+ * Outputs:
+ *      - nothing
+ *
+ * Side Effects:
+ *      - the previous password is erased and freed
+ *      - the account is moved to the counter of its new hash type
+ */
+void
+myuser_set_pass(struct myuser *const restrict mu, const char *const restrict pass)
+{
+	return_if_fail(mu != NULL);
+	return_if_fail(pass != NULL);
+
+	const size_t len = strnlen(pass, PASSLEN);
+	char *const buf = smalloc(len + 1);
+
+	(void) memcpy(buf, pass, len);
+
+	if (mu->pass != NULL)
+	{
+		stats_counters.pwhash[mu->pwhash]--;
+		(void) smemzerofree(mu->pass, strlen(mu->pass) + 1);
+	}
+
+	mu->pass = buf;
+	mu->pwhash = pwhash_classify(mu);
+	stats_counters.pwhash[mu->pwhash]++;
+}
+
+/*
+ * myuser_cold(struct myuser *mu)
+ *
+ * Returns the rarely-used part of an account for modification, allocating
+ * it if the account does not have one yet.
+ *
+ * Inputs:
+ *      - account to look at
+ *
+ * Outputs:
+ *      - the account's cold extension
+ *
+ * Side Effects:
+ *      - the cold extension may be allocated
+ */
+const struct myuser_cold myuser_cold_empty;
+
+struct myuser_cold *
+myuser_cold(struct myuser *mu)
+{
+	if (mu->cold == NULL)
+		mu->cold = mowgli_heap_alloc(myuser_cold_heap);
+
+	return mu->cold;
+}
+
+/*
+ * myuser_cold_trim(struct myuser *mu)
+ *
+ * Releases the cold extension of an account again if it holds nothing
+ * that needs to be remembered.
+ *
+ * Inputs:
+ *      - account to look at
+ *
+ * Outputs:
+ *      - nothing
+ *
+ * Side Effects:
+ *      - the cold extension may be freed
+ */
+void
+myuser_cold_trim(struct myuser *mu)
+{
+	const struct myuser_cold *const mcold = mu->cold;
+
+	if (mcold == NULL)
+		return;
+
+	if (MOWGLI_LIST_LENGTH(&mcold->memos) || MOWGLI_LIST_LENGTH(&mcold->memo_ignores) ||
+	    MOWGLI_LIST_LENGTH(&mcold->access_list) || MOWGLI_LIST_LENGTH(&mcold->cert_fingerprints))
+		return;
+
+	// A recent rate limit is still worth keeping around
+	if (mcold->memoct_new || CURRTIME - mcold->memo_ratelimit_time <= MEMO_MAX_TIME)
+		return;
+
+	mowgli_heap_free(myuser_cold_heap, mu->cold);
+	mu->cold = NULL;
 }
 
 /*
@@ -521,6 +653,9 @@ myuser_access_verify(struct user *u, struct myuser *mu)
 	if (!use_myuser_access)
 		return false;
 
+	if (! MOWGLI_LIST_LENGTH(&myuser_cold_ro(mu)->access_list))
+		return false;
+
 	if (metadata_find(mu, "private:freeze:freezer"))
 		return false;
 
@@ -529,7 +664,7 @@ myuser_access_verify(struct user *u, struct myuser *mu)
 	snprintf(buf3, sizeof buf3, "%s@%s", u->user, u->ip);
 	snprintf(buf4, sizeof buf4, "%s@%s", u->user, u->chost);
 
-	MOWGLI_ITER_FOREACH(n, mu->access_list.head)
+	MOWGLI_ITER_FOREACH(n, myuser_cold_ro(mu)->access_list.head)
 	{
 		char *entry = (char *) n->data;
 
@@ -562,7 +697,7 @@ myuser_access_add(struct myuser *mu, const char *mask)
 	return_val_if_fail(mu != NULL, false);
 	return_val_if_fail(mask != NULL, false);
 
-	if (MOWGLI_LIST_LENGTH(&mu->access_list) > me.mdlimit)
+	if (MOWGLI_LIST_LENGTH(&myuser_cold_ro(mu)->access_list) > me.mdlimit)
 	{
 		slog(LG_DEBUG, "myuser_access_add(): access entry limit reached for %s", entity(mu)->name);
 		return false;
@@ -570,7 +705,7 @@ myuser_access_add(struct myuser *mu, const char *mask)
 
 	msk = sstrdup(mask);
 	n = mowgli_node_create();
-	mowgli_node_add(msk, n, &mu->access_list);
+	mowgli_node_add(msk, n, &myuser_cold(mu)->access_list);
 
 	cnt.myuser_access++;
 
@@ -597,7 +732,7 @@ myuser_access_find(struct myuser *mu, const char *mask)
 	return_val_if_fail(mu != NULL, NULL);
 	return_val_if_fail(mask != NULL, NULL);
 
-	MOWGLI_ITER_FOREACH(n, mu->access_list.head)
+	MOWGLI_ITER_FOREACH(n, myuser_cold_ro(mu)->access_list.head)
 	{
 		char *entry = (char *) n->data;
 
@@ -627,18 +762,19 @@ myuser_access_delete(struct myuser *mu, const char *mask)
 	return_if_fail(mu != NULL);
 	return_if_fail(mask != NULL);
 
-	MOWGLI_ITER_FOREACH_SAFE(n, tn, mu->access_list.head)
+	MOWGLI_ITER_FOREACH_SAFE(n, tn, myuser_cold_ro(mu)->access_list.head)
 	{
 		char *entry = (char *) n->data;
 
 		if (!strcasecmp(entry, mask))
 		{
-			mowgli_node_delete(n, &mu->access_list);
+			mowgli_node_delete(n, &mu->cold->access_list);
 			mowgli_node_free(n);
 			sfree(entry);
 
 			cnt.myuser_access--;
 
+			myuser_cold_trim(mu);
 			return;
 		}
 	}
@@ -684,6 +820,7 @@ mynick_add(struct myuser *mu, const char *name)
 	mn->registered = CURRTIME;
 
 	mowgli_patricia_add(nicklist, mn->nick, mn);
+	hashmap_add(nicklist_index, mn->nick, mn);
 	mowgli_node_add(mn, &mn->node, &mu->nicks);
 
 	myuser_name_restore(mn->nick, mu);
@@ -718,6 +855,7 @@ mynick_delete(struct mynick *mn)
 	myuser_name_remember(mn->nick, mn->owner);
 
 	mowgli_patricia_delete(nicklist, mn->nick);
+	hashmap_delete(nicklist_index, mn->nick);
 	mowgli_node_delete(&mn->node, &mn->owner->nicks);
 
 	mowgli_heap_free(mynick_heap, mn);
@@ -922,7 +1060,7 @@ mycertfp_add(struct myuser *mu, const char *certfp, const bool force)
 	return_val_if_fail(mu != NULL, NULL);
 	return_val_if_fail(certfp != NULL, NULL);
 
-	if (me.maxcertfp && MOWGLI_LIST_LENGTH(&mu->cert_fingerprints) >= me.maxcertfp && ! force)
+	if (me.maxcertfp && MOWGLI_LIST_LENGTH(&myuser_cold_ro(mu)->cert_fingerprints) >= me.maxcertfp && ! force)
 		return NULL;
 
 	struct mycertfp *const mcfp = mowgli_heap_alloc(mycertfp_heap);
@@ -930,7 +1068,7 @@ mycertfp_add(struct myuser *mu, const char *certfp, const bool force)
 	mcfp->mu = mu;
 	mcfp->certfp = sstrdup(certfp);
 
-	(void) mowgli_node_add(mcfp, &mcfp->node, &mu->cert_fingerprints);
+	(void) mowgli_node_add(mcfp, &mcfp->node, &myuser_cold(mu)->cert_fingerprints);
 	(void) mowgli_patricia_add(certfplist, mcfp->certfp, mcfp);
 
 	return mcfp;
@@ -943,9 +1081,11 @@ mycertfp_delete(struct mycertfp *mcfp)
 	return_if_fail(mcfp->mu != NULL);
 	return_if_fail(mcfp->certfp != NULL);
 
-	mowgli_node_delete(&mcfp->node, &mcfp->mu->cert_fingerprints);
+	mowgli_node_delete(&mcfp->node, &mcfp->mu->cold->cert_fingerprints);
 	mowgli_patricia_delete(certfplist, mcfp->certfp);
 
+	myuser_cold_trim(mcfp->mu);
+
 	sfree(mcfp->certfp);
 	mowgli_heap_free(mycertfp_heap, mcfp);
 }
@@ -958,6 +1098,129 @@ mycertfp_find(const char *certfp)
 	return mowgli_patricia_retrieve(certfplist, certfp);
 }
 
+/***************
+ * M Y M E M O *
+ ***************/
+
+/*
+ * mymemo_add(struct myuser *mu, const char *sender, const char *text,
+ *            time_t sent, unsigned int status)
+ *
+ * Adds a memo to the end of the inbox of an account.
+ *
+ * Inputs:
+ *      - account to add the memo to
+ *      - name of the sender
+ *      - text of the memo
+ *      - when the memo was sent
+ *      - MEMO_* flags
+ *
+ * Outputs:
+ *      - the new memo
+ *
+ * Side Effects:
+ *      - the sender and the text are shared with every other memo that has
+ *        the same ones
+ *      - the count of new memos is raised if the memo is unread
+ */
+struct mymemo *
+mymemo_add(struct myuser *mu, const char *sender, const char *text, time_t sent, unsigned int status)
+{
+	struct mymemo *memo;
+	stringref ssender, stext;
+
+	return_val_if_fail(mu != NULL, NULL);
+	return_val_if_fail(sender != NULL, NULL);
+	return_val_if_fail(text != NULL, NULL);
+
+	ssender = strshare_get(sender);
+	stext = strshare_get(text);
+	memo = mymemo_add_shared(mu, ssender, stext, sent, status);
+	strshare_unref(ssender);
+	strshare_unref(stext);
+
+	return memo;
+}
+
+/*
+ * mymemo_add_shared(struct myuser *mu, stringref sender, stringref text,
+ *                   time_t sent, unsigned int status)
+ *
+ * Like mymemo_add(), for a sender and a text that are already shared
+ * strings. This is what a memo to many accounts should use; adding it
+ * costs no more than a small header per account.
+ *
+ * Inputs:
+ *      - account to add the memo to
+ *      - name of the sender, from strshare_get()
+ *      - text of the memo, from strshare_get()
+ *      - when the memo was sent
+ *      - MEMO_* flags
+ *
+ * Outputs:
+ *      - the new memo
+ *
+ * Side Effects:
+ *      - a reference to the sender and to the text is taken
+ *      - the count of new memos is raised if the memo is unread
+ */
+struct mymemo *
+mymemo_add_shared(struct myuser *mu, stringref sender, stringref text, time_t sent, unsigned int status)
+{
+	struct mymemo *memo;
+
+	return_val_if_fail(mu != NULL, NULL);
+	return_val_if_fail(sender != NULL, NULL);
+	return_val_if_fail(text != NULL, NULL);
+
+	memo = mowgli_heap_alloc(mymemo_heap);
+	memo->sender = strshare_ref(sender);
+	memo->text = strshare_ref(text);
+	memo->sent = sent;
+	memo->status = status;
+
+	mowgli_node_add(memo, &memo->node, &myuser_cold(mu)->memos);
+
+	if (!(status & MEMO_READ))
+		mu->cold->memoct_new++;
+
+	return memo;
+}
+
+/*
+ * mymemo_delete(struct myuser *mu, struct mymemo *memo)
+ *
+ * Removes a memo from the inbox of an account and frees it.
+ *
+ * Inputs:
+ *      - account the memo belongs to
+ *      - memo to delete
+ *
+ * Outputs:
+ *      - nothing
+ *
+ * Side Effects:
+ *      - the count of new memos is lowered if the memo was unread
+ *      - the cold extension of the account is not trimmed; callers that
+ *        may have emptied it should call myuser_cold_trim()
+ */
+void
+mymemo_delete(struct myuser *mu, struct mymemo *memo)
+{
+	return_if_fail(mu != NULL);
+	return_if_fail(mu->cold != NULL);
+	return_if_fail(memo != NULL);
+
+	mowgli_node_delete(&memo->node, &mu->cold->memos);
+
+	if (!(memo->status & MEMO_READ) && mu->cold->memoct_new > 0)
+		mu->cold->memoct_new--;
+
+	strshare_unref(memo->sender);
+	strshare_unref(memo->text);
+	mowgli_heap_free(mymemo_heap, memo);
+}
+
 /***************
  * M Y C H A N *
  ***************/
@@ -973,6 +1236,8 @@ mychan_delete(struct mychan *mc)
 	if (!(runflags & RF_STARTING))
 		slog(LG_DEBUG, "mychan_delete(): %s", mc->name);
 
+	hook_call_mychan_delete(mc);
+
 	if (mc->chan != NULL)
 		mc->chan->mychan = NULL;
 
@@ -983,6 +1248,7 @@ mychan_delete(struct mychan *mc)
 	metadata_delete_all(mc);
 
 	mowgli_patricia_delete(mclist, mc->name);
+	hashmap_delete(mclist_index, mc->name);
 
 	strshare_unref(mc->name);
 
@@ -1013,9 +1279,12 @@ mychan_add(char *name)
 		mc->chan->mychan = mc;
 
 	mowgli_patricia_add(mclist, mc->name, mc);
+	hashmap_add(mclist_index, mc->name, mc);
 
 	cnt.mychan++;
 
+	hook_call_mychan_add(mc);
+
 	return mc;
 }
 
@@ -1026,7 +1295,7 @@ mychan_add(char *name)
 bool
 mychan_isused(struct mychan *mc)
 {
-	mowgli_node_t *n;
+	struct chanuser_iter iter;
 	struct channel *c;
 	struct chanuser *cu;
 
@@ -1035,9 +1304,8 @@ mychan_isused(struct mychan *mc)
 	c = mc->chan;
 	if (c == NULL)
 		return false;
-	MOWGLI_ITER_FOREACH(n, c->members.head)
+	CHANNEL_MEMBER_FOREACH(cu, &iter, c)
 	{
-		cu = n->data;
 		if (chanacs_user_flags(mc, cu->user) & CA_USEDUPDATE)
 			return true;
 	}
@@ -1394,6 +1662,7 @@ chanacs_delete(struct chanacs *ca)
 
 	metadata_delete_all(ca);
 
+	mask_matcher_free(&ca->matcher);
 	sfree(ca->host);
 
 	mowgli_heap_free(chanacs_heap, ca);
@@ -1496,6 +1765,8 @@ chanacs_add_host(struct mychan *mychan, const char *host, unsigned int level, ti
 	ca->entity = NULL;
 	ca->host = sstrdup(host);
 	ca->level = level & ca_all;
+
+	mask_matcher_compile(&ca->matcher, ca->host);
 	ca->tmodified = ts;
 
 	if (setter != NULL)
@@ -1613,10 +1884,10 @@ chanacs_find_host(struct mychan *mychan, const char *host, unsigned int level)
 
 		if (level != 0x0)
 		{
-			if ((ca->entity == NULL) && (!match(ca->host, host)) && ((ca->level & level) == level))
+			if ((ca->entity == NULL) && (!match_compiled(ca->matcher.pattern, host)) && ((ca->level & level) == level))
 				return ca;
 		}
-		else if ((ca->entity == NULL) && (!match(ca->host, host)))
+		else if ((ca->entity == NULL) && (!match_compiled(ca->matcher.pattern, host)))
 			return ca;
 	}
 
@@ -1636,7 +1907,7 @@ chanacs_host_flags(struct mychan *mychan, const char *host)
 	{
 		ca = (struct chanacs *)n->data;
 
-		if (ca->entity == NULL && !match(ca->host, host))
+		if (ca->entity == NULL && !match_compiled(ca->matcher.pattern, host))
 			result |= ca->level;
 	}
 
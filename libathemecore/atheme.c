@@ -75,7 +75,8 @@ print_help(void)
 	       "-n           Don't fork into the background (log screen + log file)\n"
 	       "-p <file>    Specify the pid file (will be overwritten)\n"
 	       "-D <dir>     Specify the data directory\n"
-	       "-v           Print version information and exit\n");
+	       "-v           Print version information and exit\n"
+	       "-W <fd>      Resume the uplink connection on fd (used by RESTART WARM)\n");
 }
 /* *INDENT-ON* */
 
@@ -363,6 +364,7 @@ atheme_setup(void)
 	language_init();
 #endif
 	init_nodes();
+	stats_init();
 	init_confprocess();
 	init_newconf();
 	servtree_init();
@@ -374,6 +376,34 @@ atheme_setup(void)
 
 	authcookie_init();
 	common_ctcp_init();
+	eventloop_stats_init();
+	capture_init();
+}
+
+/* The arguments we were started with, less any -W of an earlier warm
+ * restart, and a -W for the uplink connection the new process takes over.
+ */
+static char **
+warm_restart_argv(int argc, char *argv[], int fd)
+{
+	char **nargv = smalloc((argc + 3) * sizeof *nargv);
+	static char fdbuf[16];
+	int i, j = 0;
+
+	for (i = 0; i < argc; i++)
+	{
+		if (!strcmp(argv[i], "-W") && i + 1 < argc)
+			i++;
+		else if (strncmp(argv[i], "-W", 2))
+			nargv[j++] = argv[i];
+	}
+
+	snprintf(fdbuf, sizeof fdbuf, "%d", fd);
+	nargv[j++] = "-W";
+	nargv[j++] = fdbuf;
+	nargv[j] = NULL;
+
+	return nargv;
 }
 
 void
@@ -396,6 +426,7 @@ atheme_main(int argc, char *argv[])
 	FILE *pid_file;
 	const char *pidfilename = RUNDIR "/atheme.pid";
 	char *log_p = NULL;
+	int warm_fd = -1;
 	mowgli_getopt_option_t long_opts[] = {
 		{ NULL, 0, NULL, 0, 0 },
 	};
@@ -409,7 +440,7 @@ atheme_main(int argc, char *argv[])
 	atheme_bootstrap();
 
 	/* do command-line options */
-	while ((r = mowgli_getopt_long(argc, argv, "c:bdhrl:np:D:v", long_opts, NULL)) != -1)
+	while ((r = mowgli_getopt_long(argc, argv, "c:bdhrl:np:D:vW:", long_opts, NULL)) != -1)
 	{
 		switch (r)
 		{
@@ -446,6 +477,9 @@ atheme_main(int argc, char *argv[])
 		  case 'v':
 			  print_version();
 			  exit(EXIT_SUCCESS);
+		  case 'W':
+			  warm_fd = atoi(mowgli_optarg);
+			  break;
 		  default:
 			  fprintf(stderr, "usage: atheme-services [-bdhnvr] [-c conf] [-l logfile] [-p pidfile]\n");
 			  exit(EXIT_FAILURE);
@@ -501,6 +535,8 @@ atheme_main(int argc, char *argv[])
 
 	(void) slog(LG_INFO, "digest testsuite passed");
 
+	(void) casemap_init();
+
 	if (!(runflags & RF_LIVE))
 		daemonize(daemonize_pipe);
 
@@ -602,7 +638,8 @@ atheme_main(int argc, char *argv[])
 	mowgli_timer_add(base_eventloop, "authcookie_expire", authcookie_expire, NULL, 10 * SECONDS_PER_MINUTE);
 
 	me.connected = false;
-	uplink_connect();
+	if (warm_fd < 0 || !warmstate_restore(warm_fd))
+		uplink_connect();
 
 	/* main loop */
 	io_loop();
@@ -615,6 +652,9 @@ atheme_main(int argc, char *argv[])
 
 	remove(pidfilename);
 	errno = 0;
+	warm_fd = -1;
+	if ((runflags & RF_RESTART) && (runflags & RF_WARM) && (warm_fd = warmstate_save()) < 0)
+		runflags &= ~RF_WARM;
 	if (curr_uplink != NULL && curr_uplink->conn != NULL)
 		sendq_flush(curr_uplink->conn);
 	connection_close_all();
@@ -624,10 +664,13 @@ atheme_main(int argc, char *argv[])
 	/* should we restart? */
 	if (runflags & RF_RESTART)
 	{
-		slog(LG_INFO, "main(): restarting");
+		slog(LG_INFO, "main(): restarting%s", warm_fd >= 0 ? " warm" : "");
 
 #ifdef HAVE_EXECVE
-		execv(BINDIR "/atheme-services", argv);
+		if (warm_fd >= 0)
+			execv(BINDIR "/atheme-services", warm_restart_argv(argc, argv, warm_fd));
+		else
+			execv(BINDIR "/atheme-services", argv);
 #endif
 	}
 
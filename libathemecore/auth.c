@@ -37,8 +37,7 @@ set_password(struct myuser *const restrict mu, const char *const restrict passwo
 
 	mu->flags |= MU_CRYPTPASS;
 
-	(void) smemzero(mu->pass, sizeof mu->pass);
-	(void) mowgli_strlcpy(mu->pass, hash, sizeof mu->pass);
+	(void) myuser_set_pass(mu, hash);
 	(void) hook_call_myuser_changed_password_or_hash(mu);
 
 	return true;
@@ -110,8 +109,7 @@ verify_password(struct myuser *const restrict mu, const char *const restrict pas
 		return true;
 	}
 
-	(void) smemzero(mu->pass, sizeof mu->pass);
-	(void) mowgli_strlcpy(mu->pass, new_hash, sizeof mu->pass);
+	(void) myuser_set_pass(mu, new_hash);
 	(void) hook_call_myuser_changed_password_or_hash(mu);
 
 	// Verification succeeded and user's password re-encrypted
@@ -0,0 +1,323 @@
+/*
+ * SPDX-License-Identifier: ISC
+ * SPDX-URL: https://spdx.org/licenses/ISC.html
+ *
+ * Copyright (C) 2026 Atheme Development Group (https://atheme.github.io/)
+ *
+ * Permission to use, copy, modify, and/or distribute this software for any
+ * purpose with or without fee is hereby granted, provided that the above
+ * copyright notice and this permission notice appear in all copies.
+ *
+ * atheme-services: A collection of minimalist IRC services
+ * capture.c: Capture and replay of uplink traffic
+ */
+
+#include <atheme.h>
+#include "internal.h"
+
+#define CAPTURE_VARINT_MAX      10U
+
+bool capture_enabled = false;
+bool capture_suppressed = false;        // set by tools that must never record, whatever the config says
+
+static FILE *capture_fp = NULL;
+static char *capture_path = NULL;
+static uint64_t capture_last_ns = 0;
+
+static void
+capture_write_varint(uint64_t value)
+{
+	while (value >= 0x80U)
+	{
+		(void) putc((int) ((value & 0x7FU) | 0x80U), capture_fp);
+		value >>= 7;
+	}
+
+	(void) putc((int) value, capture_fp);
+}
+
+/* capture_record()
+ *
+ * Appends a record to the capture file, if capturing is enabled.
+ *
+ * Inputs:
+ *       type of the record, and for CAPTURE_LINE the line and its length
+ *
+ * Outputs:
+ *       none
+ *
+ * Side Effects:
+ *       capturing is stopped if the file cannot be written to
+ */
+void
+capture_record(const enum capture_record type, const char *const restrict line, const size_t len)
+{
+	if (! capture_enabled)
+		return;
+
+	const uint64_t now_ns = profile_time_ns();
+
+	(void) putc((int) type, capture_fp);
+	(void) capture_write_varint(now_ns - capture_last_ns);
+
+	capture_last_ns = now_ns;
+
+	if (type == CAPTURE_LINE)
+	{
+		(void) capture_write_varint((uint64_t) len);
+		(void) fwrite(line, 1, len, capture_fp);
+	}
+	else if (type == CAPTURE_START)
+		(void) capture_write_varint((uint64_t) time(NULL));
+
+	// Bursts are the interesting part of most captures; make sure they hit the disk
+	if (type == CAPTURE_EOB)
+		(void) fflush(capture_fp);
+
+	if (ferror(capture_fp))
+	{
+		(void) slog(LG_ERROR, "%s: error writing to %s: %s; capture stopped", MOWGLI_FUNC_NAME,
+		            capture_path, strerror(errno));
+
+		(void) capture_stop();
+	}
+}
+
+/* capture_start()
+ *
+ * Starts recording every line received from the uplink to a file, which is
+ * created if it does not exist and appended to otherwise.
+ *
+ * Inputs:
+ *       path of the capture file, relative to the data directory
+ *
+ * Outputs:
+ *       whether capturing was started
+ *
+ * Side Effects:
+ *       a capture that was already running is stopped first
+ */
+bool
+capture_start(const char *const restrict path)
+{
+	char fullpath[BUFSIZE];
+	long size;
+
+	return_val_if_fail(path != NULL, false);
+
+	(void) capture_stop();
+
+	if (*path == '/')
+		(void) mowgli_strlcpy(fullpath, path, sizeof fullpath);
+	else
+		(void) snprintf(fullpath, sizeof fullpath, "%s/%s", datadir, path);
+
+	if (! (capture_fp = fopen(fullpath, "ab")))
+	{
+		(void) slog(LG_ERROR, "%s: cannot open %s: %s", MOWGLI_FUNC_NAME, fullpath, strerror(errno));
+		return false;
+	}
+
+	(void) setvbuf(capture_fp, NULL, _IOFBF, 65536);
+
+	if (fseek(capture_fp, 0, SEEK_END) != 0 || (size = ftell(capture_fp)) < 0)
+		size = 0;
+
+	if (! size)
+		(void) fwrite(CAPTURE_MAGIC, 1, CAPTURE_MAGIC_LEN, capture_fp);
+
+	capture_path = sstrdup(path);
+	capture_last_ns = profile_time_ns();
+	capture_enabled = true;
+
+	(void) capture_record(CAPTURE_START, NULL, 0);
+
+	(void) slog(LG_INFO, "%s: recording uplink traffic to %s", MOWGLI_FUNC_NAME, fullpath);
+
+	return capture_enabled;
+}
+
+void
+capture_stop(void)
+{
+	if (capture_fp == NULL)
+		return;
+
+	if (fclose(capture_fp) != 0)
+		(void) slog(LG_ERROR, "%s: error closing %s: %s", MOWGLI_FUNC_NAME, capture_path, strerror(errno));
+	else
+		(void) slog(LG_INFO, "%s: stopped recording uplink traffic to %s", MOWGLI_FUNC_NAME, capture_path);
+
+	(void) sfree(capture_path);
+
+	capture_fp = NULL;
+	capture_path = NULL;
+	capture_enabled = false;
+}
+
+/* Applies general::uplink_capture; a capture is only restarted if the file
+ * name changed, so that rehashing does not insert a CAPTURE_START record.
+ */
+static void
+capture_config_ready(void ATHEME_VATTR_UNUSED *const restrict unused)
+{
+	const char *const path = config_options.uplink_capture;
+
+	if (capture_suppressed || path == NULL || ! *path)
+	{
+		(void) capture_stop();
+		return;
+	}
+
+	if (capture_path != NULL && strcmp(capture_path, path) == 0)
+		return;
+
+	(void) capture_start(path);
+}
+
+static void
+capture_shutdown(void ATHEME_VATTR_UNUSED *const restrict unused)
+{
+	(void) capture_stop();
+}
+
+void
+capture_init(void)
+{
+	(void) hook_add_config_ready(&capture_config_ready);
+	(void) hook_add_shutdown(&capture_shutdown);
+}
+
+static bool
+capture_read_varint(struct capture_reader *const restrict reader, uint64_t *const restrict value)
+{
+	*value = 0;
+
+	for (unsigned int i = 0; i < CAPTURE_VARINT_MAX; i++)
+	{
+		const int c = getc(reader->fp);
+
+		if (c == EOF)
+			return false;
+
+		*value |= ((uint64_t) (c & 0x7F)) << (7U * i);
+
+		if (! (c & 0x80))
+			return true;
+	}
+
+	return false;
+}
+
+/* capture_reader_open()
+ *
+ * Opens a capture file for reading.
+ *
+ * Inputs:
+ *       reader state to initialise, path of the capture file
+ *
+ * Outputs:
+ *       whether the file could be opened and is a capture file
+ *
+ * Side Effects:
+ *       an error is logged if not
+ */
+bool
+capture_reader_open(struct capture_reader *const restrict reader, const char *const restrict path)
+{
+	char magic[CAPTURE_MAGIC_LEN];
+
+	(void) memset(reader, 0x00, sizeof *reader);
+
+	if (! (reader->fp = fopen(path, "rb")))
+	{
+		(void) slog(LG_ERROR, "%s: cannot open %s: %s", MOWGLI_FUNC_NAME, path, strerror(errno));
+		return false;
+	}
+
+	if (fread(magic, 1, sizeof magic, reader->fp) != sizeof magic || memcmp(magic, CAPTURE_MAGIC, sizeof magic))
+	{
+		(void) slog(LG_ERROR, "%s: %s is not a capture file", MOWGLI_FUNC_NAME, path);
+		(void) fclose(reader->fp);
+
+		reader->fp = NULL;
+		return false;
+	}
+
+	reader->path = sstrdup(path);
+
+	return true;
+}
+
+/* capture_reader_next()
+ *
+ * Reads the next record of a capture file; for CAPTURE_LINE records, the
+ * line is NUL-terminated in reader->line.
+ *
+ * Inputs:
+ *       reader state
+ *
+ * Outputs:
+ *       type of the record, or CAPTURE_EOF at the end of the file; in
+ *       that case reader->error is set if the file is damaged
+ *
+ * Side Effects:
+ *       none
+ */
+enum capture_record
+capture_reader_next(struct capture_reader *const restrict reader)
+{
+	uint64_t value;
+	int type;
+
+	return_val_if_fail(reader->fp != NULL, CAPTURE_EOF);
+
+	if ((type = getc(reader->fp)) == EOF)
+		return CAPTURE_EOF;
+
+	if (! capture_read_varint(reader, &reader->delta_ns))
+		goto damaged;
+
+	reader->ns += reader->delta_ns;
+
+	switch (type)
+	{
+		case CAPTURE_START:
+			if (! capture_read_varint(reader, &value))
+				goto damaged;
+
+			reader->started = (time_t) value;
+			return CAPTURE_START;
+
+		case CAPTURE_LINE:
+			if (! capture_read_varint(reader, &value) || value > BUFSIZE)
+				goto damaged;
+
+			if (fread(reader->line, 1, (size_t) value, reader->fp) != (size_t) value)
+				goto damaged;
+
+			reader->len = (size_t) value;
+			reader->line[reader->len] = '\0';
+			return CAPTURE_LINE;
+
+		case CAPTURE_CONNECT:
+		case CAPTURE_EOB:
+			return (enum capture_record) type;
+	}
+
+damaged:
+	(void) slog(LG_ERROR, "%s: %s is damaged at offset %ld", MOWGLI_FUNC_NAME, reader->path, ftell(reader->fp));
+
+	reader->error = true;
+	return CAPTURE_EOF;
+}
+
+void
+capture_reader_close(struct capture_reader *const restrict reader)
+{
+	if (reader->fp != NULL)
+		(void) fclose(reader->fp);
+
+	(void) sfree(reader->path);
+	(void) memset(reader, 0x00, sizeof *reader);
+}
@@ -0,0 +1,542 @@
+/*
+ * SPDX-License-Identifier: ISC
+ * SPDX-URL: https://spdx.org/licenses/ISC.html
+ *
+ * Copyright (C) 2026 Atheme Development Group (https://atheme.github.io/)
+ *
+ * Permission to use, copy, modify, and/or distribute this software for any
+ * purpose with or without fee is hereby granted, provided that the above
+ * copyright notice and this permission notice appear in all copies.
+ *
+ * atheme-services: A collection of minimalist IRC services
+ * casemap.c: Vectorized casemapping for irccasecanon() and friends
+ */
+
+#include <atheme.h>
+#include "internal.h"
+
+#if defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__))
+#  define CASEMAP_HAVE_X86 1
+#  include <immintrin.h>
+#endif
+
+#if defined(__aarch64__) && defined(__ARM_NEON)
+#  define CASEMAP_HAVE_NEON 1
+#  include <arm_neon.h>
+#endif
+
+/* Both mappings uppercase by subtracting 0x20 from the bytes in [0x61, hi];
+ * hi is '~' for RFC1459 and 'z' for ASCII. The latter is only true of the C
+ * locale (and of the UTF-8 locales of most systems), so casemap_init() checks
+ * toupper(3) before letting strcasecanon() use the vector code.
+ */
+#define CASEMAP_LOW             0x61U
+#define CASEMAP_HI_RFC1459      0x7EU
+#define CASEMAP_HI_ASCII        0x7AU
+
+// Strings shorter than this are not worth setting up vector registers for
+#define CASEMAP_VECTOR_MIN      16U
+
+// Longest string the self-test builds
+#define CASEMAP_TEST_LEN        80U
+
+struct casemap_impl
+{
+	const char *    name;
+	bool          (*available)(void);
+
+	// Uppercases len (>= CASEMAP_VECTOR_MIN) bytes of buf
+	void          (*upper)(unsigned char *buf, size_t len, unsigned char hi);
+
+	// Returns the length of the leading run of len (>= CASEMAP_VECTOR_MIN) bytes that fold the same
+	size_t        (*equal)(const unsigned char *s1, const unsigned char *s2, size_t len, unsigned char hi);
+};
+
+static inline unsigned char
+casemap_fold(const unsigned char c, const unsigned char hi)
+{
+	return (unsigned char) (((unsigned char) (c - CASEMAP_LOW) <= (unsigned char) (hi - CASEMAP_LOW)) ? c - 0x20U : c);
+}
+
+static bool
+casemap_scalar_available(void)
+{
+	return true;
+}
+
+static void
+casemap_scalar_upper(unsigned char *const restrict buf, const size_t len, const unsigned char hi)
+{
+	for (size_t i = 0; i < len; i++)
+		buf[i] = casemap_fold(buf[i], hi);
+}
+
+static size_t
+casemap_scalar_equal(const unsigned char *const restrict s1, const unsigned char *const restrict s2,
+                     const size_t len, const unsigned char hi)
+{
+	size_t i;
+
+	for (i = 0; i < len; i++)
+		if (casemap_fold(s1[i], hi) != casemap_fold(s2[i], hi))
+			break;
+
+	return i;
+}
+
+#ifdef CASEMAP_HAVE_X86
+
+/* The last block is loaded so that it ends at buf + len and may overlap the
+ * one before it, which is harmless because folding is idempotent.
+ */
+
+static bool
+casemap_sse2_available(void)
+{
+	return __builtin_cpu_supports("sse2");
+}
+
+static inline __attribute__((target("sse2"))) __m128i
+casemap_sse2_fold(const __m128i v, const __m128i low, const __m128i range, const __m128i bit)
+{
+	const __m128i t = _mm_sub_epi8(v, low);
+	const __m128i m = _mm_cmpeq_epi8(_mm_min_epu8(t, range), t);
+
+	return _mm_sub_epi8(v, _mm_and_si128(m, bit));
+}
+
+static __attribute__((target("sse2"))) void
+casemap_sse2_upper(unsigned char *const restrict buf, const size_t len, const unsigned char hi)
+{
+	const __m128i low = _mm_set1_epi8((char) CASEMAP_LOW);
+	const __m128i range = _mm_set1_epi8((char) (hi - CASEMAP_LOW));
+	const __m128i bit = _mm_set1_epi8(0x20);
+	size_t i;
+
+	for (i = 0; i + 16U <= len; i += 16U)
+	{
+		__m128i *const p = (__m128i *) (void *) (buf + i);
+
+		(void) _mm_storeu_si128(p, casemap_sse2_fold(_mm_loadu_si128(p), low, range, bit));
+	}
+
+	if (i < len)
+	{
+		__m128i *const p = (__m128i *) (void *) (buf + len - 16U);
+
+		(void) _mm_storeu_si128(p, casemap_sse2_fold(_mm_loadu_si128(p), low, range, bit));
+	}
+}
+
+static __attribute__((target("sse2"))) size_t
+casemap_sse2_equal(const unsigned char *const restrict s1, const unsigned char *const restrict s2,
+                   const size_t len, const unsigned char hi)
+{
+	const __m128i low = _mm_set1_epi8((char) CASEMAP_LOW);
+	const __m128i range = _mm_set1_epi8((char) (hi - CASEMAP_LOW));
+	const __m128i bit = _mm_set1_epi8(0x20);
+	size_t i = 0;
+
+	for (;;)
+	{
+		if (i + 16U > len)
+		{
+			if (i == len)
+				return len;
+
+			i = len - 16U;
+		}
+
+		const __m128i a = casemap_sse2_fold(_mm_loadu_si128((const __m128i *) (const void *) (s1 + i)),
+		                                    low, range, bit);
+		const __m128i b = casemap_sse2_fold(_mm_loadu_si128((const __m128i *) (const void *) (s2 + i)),
+		                                    low, range, bit);
+		const unsigned int diff = 0xFFFFU & ~((unsigned int) _mm_movemask_epi8(_mm_cmpeq_epi8(a, b)));
+
+		if (diff)
+			return i + (size_t) __builtin_ctz(diff);
+
+		i += 16U;
+	}
+}
+
+static bool
+casemap_avx2_available(void)
+{
+	return __builtin_cpu_supports("avx2");
+}
+
+static inline __attribute__((target("avx2"))) __m256i
+casemap_avx2_fold(const __m256i v, const __m256i low, const __m256i range, const __m256i bit)
+{
+	const __m256i t = _mm256_sub_epi8(v, low);
+	const __m256i m = _mm256_cmpeq_epi8(_mm256_min_epu8(t, range), t);
+
+	return _mm256_sub_epi8(v, _mm256_and_si256(m, bit));
+}
+
+static __attribute__((target("avx2"))) void
+casemap_avx2_upper(unsigned char *const restrict buf, const size_t len, const unsigned char hi)
+{
+	if (len < 32U)
+	{
+		(void) casemap_sse2_upper(buf, len, hi);
+		return;
+	}
+
+	const __m256i low = _mm256_set1_epi8((char) CASEMAP_LOW);
+	const __m256i range = _mm256_set1_epi8((char) (hi - CASEMAP_LOW));
+	const __m256i bit = _mm256_set1_epi8(0x20);
+	size_t i;
+
+	for (i = 0; i + 32U <= len; i += 32U)
+	{
+		__m256i *const p = (__m256i *) (void *) (buf + i);
+
+		(void) _mm256_storeu_si256(p, casemap_avx2_fold(_mm256_loadu_si256(p), low, range, bit));
+	}
+
+	if (i < len)
+	{
+		__m256i *const p = (__m256i *) (void *) (buf + len - 32U);
+
+		(void) _mm256_storeu_si256(p, casemap_avx2_fold(_mm256_loadu_si256(p), low, range, bit));
+	}
+}
+
+static __attribute__((target("avx2"))) size_t
+casemap_avx2_equal(const unsigned char *const restrict s1, const unsigned char *const restrict s2,
+                   const size_t len, const unsigned char hi)
+{
+	if (len < 32U)
+		return casemap_sse2_equal(s1, s2, len, hi);
+
+	const __m256i low = _mm256_set1_epi8((char) CASEMAP_LOW);
+	const __m256i range = _mm256_set1_epi8((char) (hi - CASEMAP_LOW));
+	const __m256i bit = _mm256_set1_epi8(0x20);
+	size_t i = 0;
+
+	for (;;)
+	{
+		if (i + 32U > len)
+		{
+			if (i == len)
+				return len;
+
+			i = len - 32U;
+		}
+
+		const __m256i a = casemap_avx2_fold(_mm256_loadu_si256((const __m256i *) (const void *) (s1 + i)),
+		                                    low, range, bit);
+		const __m256i b = casemap_avx2_fold(_mm256_loadu_si256((const __m256i *) (const void *) (s2 + i)),
+		                                    low, range, bit);
+		const unsigned int diff = ~((unsigned int) _mm256_movemask_epi8(_mm256_cmpeq_epi8(a, b)));
+
+		if (diff)
+			return i + (size_t) __builtin_ctz(diff);
+
+		i += 32U;
+	}
+}
+
+#endif /* CASEMAP_HAVE_X86 */
+
+#ifdef CASEMAP_HAVE_NEON
+
+static bool
+casemap_neon_available(void)
+{
+	// Advanced SIMD is mandatory on AArch64
+	return true;
+}
+
+static inline uint8x16_t
+casemap_neon_fold(const uint8x16_t v, const uint8x16_t low, const uint8x16_t range, const uint8x16_t bit)
+{
+	const uint8x16_t m = vcleq_u8(vsubq_u8(v, low), range);
+
+	return vsubq_u8(v, vandq_u8(m, bit));
+}
+
+static void
+casemap_neon_upper(unsigned char *const restrict buf, const size_t len, const unsigned char hi)
+{
+	const uint8x16_t low = vdupq_n_u8(CASEMAP_LOW);
+	const uint8x16_t range = vdupq_n_u8((uint8_t) (hi - CASEMAP_LOW));
+	const uint8x16_t bit = vdupq_n_u8(0x20U);
+	size_t i;
+
+	for (i = 0; i + 16U <= len; i += 16U)
+		(void) vst1q_u8(buf + i, casemap_neon_fold(vld1q_u8(buf + i), low, range, bit));
+
+	if (i < len)
+		(void) vst1q_u8(buf + len - 16U, casemap_neon_fold(vld1q_u8(buf + len - 16U), low, range, bit));
+}
+
+static size_t
+casemap_neon_equal(const unsigned char *const restrict s1, const unsigned char *const restrict s2,
+                   const size_t len, const unsigned char hi)
+{
+	const uint8x16_t low = vdupq_n_u8(CASEMAP_LOW);
+	const uint8x16_t range = vdupq_n_u8((uint8_t) (hi - CASEMAP_LOW));
+	const uint8x16_t bit = vdupq_n_u8(0x20U);
+	size_t i = 0;
+
+	for (;;)
+	{
+		if (i + 16U > len)
+		{
+			if (i == len)
+				return len;
+
+			i = len - 16U;
+		}
+
+		const uint8x16_t a = casemap_neon_fold(vld1q_u8(s1 + i), low, range, bit);
+		const uint8x16_t b = casemap_neon_fold(vld1q_u8(s2 + i), low, range, bit);
+
+		// There is no movemask; find the mismatch within the block the slow way
+		if (vminvq_u8(vceqq_u8(a, b)) != 0xFFU)
+			return i + casemap_scalar_equal(s1 + i, s2 + i, 16U, hi);
+
+		i += 16U;
+	}
+}
+
+#endif /* CASEMAP_HAVE_NEON */
+
+// In order of preference; the scalar code must stay last
+static const struct casemap_impl casemap_impls[] = {
+#ifdef CASEMAP_HAVE_X86
+	{ "AVX2",       &casemap_avx2_available,        &casemap_avx2_upper,    &casemap_avx2_equal     },
+	{ "SSE2",       &casemap_sse2_available,        &casemap_sse2_upper,    &casemap_sse2_equal     },
+#endif
+#ifdef CASEMAP_HAVE_NEON
+	{ "NEON",       &casemap_neon_available,        &casemap_neon_upper,    &casemap_neon_equal     },
+#endif
+	{ "scalar",     &casemap_scalar_available,      &casemap_scalar_upper,  &casemap_scalar_equal   },
+};
+
+#define CASEMAP_SCALAR_IMPL     (&casemap_impls[ARRAY_SIZE(casemap_impls) - 1U])
+
+// Until casemap_init() has run, only the scalar code is used
+static const struct casemap_impl *casemap_active = CASEMAP_SCALAR_IMPL;
+static bool casemap_ascii_vector = false;
+
+static unsigned char
+casemap_test_byte(const unsigned int value, const size_t pos)
+{
+	// Every non-NUL byte value turns up at every position as value varies
+	return (unsigned char) (1U + ((value + (unsigned int) pos * 37U) % 255U));
+}
+
+/* Checks an implementation against the casemapping tables (which are the
+ * reference, as is toupper(3) for ASCII): every non-NUL byte value at every
+ * position of strings of up to CASEMAP_TEST_LEN bytes,
+ * at several alignments, and every pair of byte values on both sides of the
+ * block boundaries for the comparison.
+ */
+static bool
+casemap_selftest(const struct casemap_impl *const restrict impl, const bool ascii)
+{
+	static const size_t pairpos[] = { 0, 15, 16, 31, 32, 63, 79 };
+
+	unsigned char buf[CASEMAP_TEST_LEN + 16U];
+	unsigned char cmp[CASEMAP_TEST_LEN + 16U];
+	const unsigned char hi = ascii ? CASEMAP_HI_ASCII : CASEMAP_HI_RFC1459;
+
+	for (unsigned int value = 0; value < 255U; value++)
+	{
+		for (size_t len = CASEMAP_VECTOR_MIN; len <= CASEMAP_TEST_LEN; len++)
+		{
+			for (size_t align = 0; align < 16U; align += 3U)
+			{
+				unsigned char *const p = buf + align;
+
+				for (size_t i = 0; i < len; i++)
+					p[i] = casemap_test_byte(value, i);
+
+				(void) impl->upper(p, len, hi);
+
+				for (size_t i = 0; i < len; i++)
+				{
+					const unsigned char c = casemap_test_byte(value, i);
+					const int want = ascii ? toupper(c) : ToUpperTab[c];
+
+					if (p[i] != (unsigned char) want)
+						return false;
+				}
+			}
+		}
+	}
+
+	if (ascii)
+		return true;
+
+	// Strings that are equal but differ in case at every position
+	for (size_t i = 0; i < CASEMAP_TEST_LEN; i++)
+	{
+		buf[i] = (unsigned char) ('a' + (i % 30U));
+		cmp[i] = ToUpperTab[buf[i]];
+	}
+
+	for (size_t len = CASEMAP_VECTOR_MIN; len <= CASEMAP_TEST_LEN; len++)
+		if (impl->equal(buf, cmp, len, hi) != len)
+			return false;
+
+	for (size_t n = 0; n < ARRAY_SIZE(pairpos); n++)
+	{
+		const size_t pos = pairpos[n];
+		const unsigned char save1 = buf[pos];
+		const unsigned char save2 = cmp[pos];
+
+		for (unsigned int a = 1; a < 256U; a++)
+		{
+			for (unsigned int b = 1; b < 256U; b++)
+			{
+				buf[pos] = (unsigned char) a;
+				cmp[pos] = (unsigned char) b;
+
+				const size_t want = (ToUpperTab[a] == ToUpperTab[b]) ? CASEMAP_TEST_LEN : pos;
+
+				if (impl->equal(buf, cmp, CASEMAP_TEST_LEN, hi) != want)
+					return false;
+			}
+		}
+
+		buf[pos] = save1;
+		cmp[pos] = save2;
+	}
+
+	return true;
+}
+
+/* casemap_init()
+ *
+ * Picks the fastest casemapping implementation that the CPU supports and
+ * that passes the self-test.
+ *
+ * Inputs:
+ *       none
+ *
+ * Outputs:
+ *       none
+ *
+ * Side Effects:
+ *       irccasecanon(), strcasecanon(), irccasecmp() and ircncasecmp() use it
+ */
+void
+casemap_init(void)
+{
+	// strcasecanon() uses toupper(3), so the vector code can only stand in for it if that agrees
+	casemap_ascii_vector = true;
+
+	for (unsigned int c = 0; c < 256U; c++)
+	{
+		if (toupper((int) c) != (int) casemap_fold((unsigned char) c, CASEMAP_HI_ASCII))
+		{
+			casemap_ascii_vector = false;
+			break;
+		}
+	}
+
+	for (size_t i = 0; i < ARRAY_SIZE(casemap_impls); i++)
+	{
+		const struct casemap_impl *const impl = &casemap_impls[i];
+
+		if (! impl->available())
+			continue;
+
+		if (! casemap_selftest(impl, false) || (casemap_ascii_vector && ! casemap_selftest(impl, true)))
+		{
+			(void) slog(LG_ERROR, "%s: %s casemapping failed its self-test; not using it",
+			            MOWGLI_FUNC_NAME, impl->name);
+			continue;
+		}
+
+		casemap_active = impl;
+		break;
+	}
+
+	(void) slog(LG_INFO, "Using casemapping implementation: %s%s", casemap_active->name,
+	            casemap_ascii_vector ? "" : " (rfc1459 only)");
+}
+
+/* casemap_upper()
+ *
+ * Uppercases a string in place with the RFC1459 or ASCII (toupper(3))
+ * casemapping.
+ *
+ * Inputs:
+ *       string to uppercase, whether to use the ASCII casemapping
+ *
+ * Outputs:
+ *       none
+ *
+ * Side Effects:
+ *       the string is modified
+ */
+void
+casemap_upper(char *const restrict str, const bool ascii)
+{
+	unsigned char *const buf = (unsigned char *) str;
+	const size_t len = strlen(str);
+
+	if (ascii && ! casemap_ascii_vector)
+	{
+		for (size_t i = 0; i < len; i++)
+			buf[i] = (unsigned char) toupper(buf[i]);
+
+		return;
+	}
+
+	const unsigned char hi = ascii ? CASEMAP_HI_ASCII : CASEMAP_HI_RFC1459;
+
+	if (len < CASEMAP_VECTOR_MIN)
+		(void) casemap_scalar_upper(buf, len, hi);
+	else
+		(void) casemap_active->upper(buf, len, hi);
+}
+
+/* casemap_equal_prefix()
+ *
+ * Finds how many leading bytes of two strings are equal under the RFC1459
+ * casemapping.
+ *
+ * Inputs:
+ *       the strings, the most bytes to compare
+ *
+ * Outputs:
+ *       the length of the longest common prefix (up to limit) that does
+ *       not contain a NUL byte
+ *
+ * Side Effects:
+ *       none
+ */
+size_t
+casemap_equal_prefix(const char *const restrict str1, const char *const restrict str2, const size_t limit)
+{
+	const unsigned char *const s1 = (const unsigned char *) str1;
+	const unsigned char *const s2 = (const unsigned char *) str2;
+	size_t i;
+
+	// Most strings compared are nicknames and channel names, which differ early if at all
+	for (i = 0; i < limit && i < CASEMAP_VECTOR_MIN; i++)
+		if (! s1[i] || ToUpperTab[s1[i]] != ToUpperTab[s2[i]])
+			return i;
+
+	if (i == limit)
+		return i;
+
+	// Only compare bytes that both strings have, so that the vector loads stay in bounds
+	size_t len = strnlen(str1 + i, limit - i);
+	const size_t len2 = strnlen(str2 + i, len);
+
+	if (len2 < len)
+		len = len2;
+
+	if (len < CASEMAP_VECTOR_MIN)
+		return i + casemap_scalar_equal(s1 + i, s2 + i, len, CASEMAP_HI_RFC1459);
+
+	return i + casemap_active->equal(s1 + i, s2 + i, len, CASEMAP_HI_RFC1459);
+}
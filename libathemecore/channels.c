@@ -17,11 +17,160 @@
 #include "internal.h"
 
 mowgli_patricia_t *chanlist;
+struct hashmap *chanlist_index;
 
 static mowgli_heap_t *chan_heap = NULL;
 static mowgli_heap_t *chanuser_heap = NULL;
 static mowgli_heap_t *chanban_heap = NULL;
 
+/* membership index of large channels, see CHANUSER_INDEX_MIN */
+
+static inline unsigned int
+chanuser_index_hash(const struct user *u)
+{
+	/* users come from a block heap, so the low bits say little;
+	 * multiply by 2^64 / phi and keep the high bits (Fibonacci hashing)
+	 */
+	return (unsigned int)(((uint64_t)(uintptr_t)u * UINT64_C(0x9E3779B97F4A7C15)) >> 32);
+}
+
+/* returns the slot holding user, or the free slot where it would go */
+static unsigned int
+chanuser_index_slot(const struct chanuser_index *idx, const struct user *u)
+{
+	unsigned int i = chanuser_index_hash(u) & idx->mask;
+
+	while (idx->slots[i] != 0 && idx->members[idx->slots[i] - 1]->user != u)
+		i = (i + 1) & idx->mask;
+
+	return i;
+}
+
+static void
+chanuser_index_rehash(struct chanuser_index *idx, unsigned int size)
+{
+	unsigned int i;
+
+	sfree(idx->slots);
+	idx->slots = scalloc(size, sizeof *idx->slots);
+	idx->mask = size - 1;
+
+	for (i = 0; i < idx->count; i++)
+		idx->slots[chanuser_index_slot(idx, idx->members[i]->user)] = i + 1;
+}
+
+static void
+chanuser_index_build(struct channel *chan)
+{
+	struct chanuser_index *idx;
+	mowgli_node_t *n;
+	unsigned int size = 16;
+
+	idx = smalloc(sizeof *idx);
+	idx->alloc = chan->nummembers * 2;
+	idx->members = smalloc(idx->alloc * sizeof *idx->members);
+	idx->slots = NULL;
+	idx->count = 0;
+
+	MOWGLI_ITER_FOREACH(n, chan->members.head)
+	{
+		struct chanuser *cu = n->data;
+
+		cu->pos = idx->count;
+		idx->members[idx->count++] = cu;
+	}
+
+	/* keep the table at most half full */
+	while (size < idx->count * 2)
+		size *= 2;
+
+	chanuser_index_rehash(idx, size);
+
+	chan->index = idx;
+}
+
+static void
+chanuser_index_free(struct channel *chan)
+{
+	if (chan->index == NULL)
+		return;
+
+	sfree(chan->index->members);
+	sfree(chan->index->slots);
+	sfree(chan->index);
+
+	chan->index = NULL;
+}
+
+static void
+chanuser_index_add(struct channel *chan, struct chanuser *cu)
+{
+	struct chanuser_index *idx = chan->index;
+
+	if (idx == NULL)
+	{
+		if (chan->nummembers >= CHANUSER_INDEX_MIN)
+			chanuser_index_build(chan);
+		return;
+	}
+
+	if (idx->count == idx->alloc)
+	{
+		idx->alloc *= 2;
+		idx->members = srealloc(idx->members, idx->alloc * sizeof *idx->members);
+	}
+
+	cu->pos = idx->count;
+	idx->members[idx->count++] = cu;
+
+	if (idx->count * 2 > idx->mask + 1)
+		chanuser_index_rehash(idx, (idx->mask + 1) * 2);
+	else
+		idx->slots[chanuser_index_slot(idx, cu->user)] = idx->count;
+}
+
+static void
+chanuser_index_remove(struct channel *chan, struct chanuser *cu)
+{
+	struct chanuser_index *idx = chan->index;
+	struct chanuser *last;
+	unsigned int i, j, k;
+
+	if (idx == NULL)
+		return;
+
+	/* delete the slot, moving later entries of the same probe
+	 * sequence back so that no lookup stops short of them
+	 */
+	i = chanuser_index_slot(idx, cu->user);
+	idx->slots[i] = 0;
+
+	for (j = (i + 1) & idx->mask; idx->slots[j] != 0; j = (j + 1) & idx->mask)
+	{
+		k = chanuser_index_hash(idx->members[idx->slots[j] - 1]->user) & idx->mask;
+
+		if (i <= j ? (i < k && k <= j) : (i < k || k <= j))
+			continue;
+
+		idx->slots[i] = idx->slots[j];
+		idx->slots[j] = 0;
+		i = j;
+	}
+
+	/* fill the hole in the member vector with the last member */
+	last = idx->members[--idx->count];
+
+	if (last != cu)
+	{
+		idx->slots[chanuser_index_slot(idx, last->user)] = cu->pos + 1;
+		idx->members[cu->pos] = last;
+		last->pos = cu->pos;
+	}
+
+	if (idx->count < CHANUSER_INDEX_MIN / 2)
+		chanuser_index_free(chan);
+}
+
 /*
  * init_channels()
  *
@@ -50,6 +199,7 @@ init_channels(void)
 	}
 
 	chanlist = mowgli_patricia_create(irccasecanon);
+	chanlist_index = hashmap_create(true);
 }
 
 /*
@@ -104,8 +254,7 @@ channel_add(const char *name, time_t ts, struct server *creator)
 	c->topic = NULL;
 	c->topic_setter = NULL;
 
-	if (ignore_mode_list_size != 0)
-		c->extmodes = scalloc(ignore_mode_list_size, sizeof(char *));
+	/* c->extmodes is allocated by channel_mode() when the first one is set */
 
 	c->bans.head = NULL;
 	c->bans.tail = NULL;
@@ -115,8 +264,10 @@ channel_add(const char *name, time_t ts, struct server *creator)
 		mc->chan = c;
 
 	mowgli_patricia_add(chanlist, c->name, c);
+	hashmap_add(chanlist_index, c->name, c);
 
 	cnt.chan++;
+	stats_counters.chansize[0]++;
 
 	if (creator != me.me)
 	{
@@ -169,12 +320,16 @@ channel_delete(struct channel *c)
 		mowgli_heap_free(chanuser_heap, cu);
 		cnt.chanuser--;
 	}
+	stats_counters.chansize[stats_chansize_bucket(c->nummembers)]--;
 	c->nummembers = 0;
 	c->numsvcmembers = 0;
 
+	chanuser_index_free(c);
+
 	hook_call_channel_delete(c);
 
 	mowgli_patricia_delete(chanlist, c->name);
+	hashmap_delete(chanlist_index, c->name);
 
 	if ((mc = mychan_find(c->name)))
 		mc->chan = NULL;
@@ -240,6 +395,8 @@ chanban_add(struct channel *chan, const char *mask, int type)
 	c->mask = sstrdup(mask);
 	c->type = type;
 
+	mask_matcher_compile(&c->matcher, c->mask);
+
 	mowgli_node_add(c, &c->node, &chan->bans);
 
 	return c;
@@ -266,6 +423,7 @@ chanban_delete(struct chanban * c)
 
 	mowgli_node_delete(&c->node, &c->chan->bans);
 
+	mask_matcher_free(&c->matcher);
 	sfree(c->mask);
 	mowgli_heap_free(chanban_heap, c);
 }
@@ -397,15 +555,19 @@ chanuser_add(struct channel *chan, const char *nick)
 	cu->modes = flags;
 
 	chan->nummembers++;
+	stats_channel_resized(chan->nummembers - 1, chan->nummembers);
 	if (is_internal_client(u))
 		chan->numsvcmembers++;
 
 	mowgli_node_add(cu, &cu->cnode, &chan->members);
 	mowgli_node_add(cu, &cu->unode, &u->channels);
 
+	chanuser_index_add(chan, cu);
+
 	cnt.chanuser++;
 
 	hdata.cu = cu;
+	hdata.split = false;
 	hook_call_channel_join(&hdata);
 
 	/* Return NULL if a hook function kicked the user out */
@@ -447,16 +609,19 @@ chanuser_delete(struct channel *chan, struct user *user)
 
 	/* this is called BEFORE we remove the user */
 	hdata.cu = cu;
+	hdata.split = false;
 	hook_call_channel_part(&hdata);
 
 	slog(LG_DEBUG, "chanuser_delete(): %s -> %s (%u)", cu->chan->name, cu->user->nick, cu->chan->nummembers - 1);
 
+	chanuser_index_remove(chan, cu);
 	mowgli_node_delete(&cu->cnode, &chan->members);
 	mowgli_node_delete(&cu->unode, &user->channels);
 
 	mowgli_heap_free(chanuser_heap, cu);
 
 	chan->nummembers--;
+	stats_channel_resized(chan->nummembers + 1, chan->nummembers);
 	cnt.chanuser--;
 
 	if (is_internal_client(user))
@@ -471,6 +636,111 @@ chanuser_delete(struct channel *chan, struct user *user)
 	}
 }
 
+static int
+chanuser_cmp_chan(const void *a, const void *b)
+{
+	const struct chanuser *cua = *(struct chanuser *const *)a;
+	const struct chanuser *cub = *(struct chanuser *const *)b;
+
+	if (cua->chan != cub->chan)
+		return ((uintptr_t)cua->chan < (uintptr_t)cub->chan) ? -1 : 1;
+
+	return 0;
+}
+
+/*
+ * chanuser_delete_users(struct user **users, size_t count)
+ *
+ * Removes a set of users that leave the network together (because their
+ * server split) from all of their channels, one channel at a time.
+ *
+ * Inputs:
+ *     - array of users
+ *     - number of users in the array
+ *
+ * Outputs:
+ *     - nothing
+ *
+ * Side Effects:
+ *     - the users' channel user objects are destroyed
+ *     - channel_split hook is called once for each channel they were on,
+ *       then channel_part (with split set) for every membership, for
+ *       modules that do not handle channel_split
+ *     - channels that are emptied and not set permanent are deleted
+ */
+void
+chanuser_delete_users(struct user **users, size_t count)
+{
+	struct chanuser **cus;
+	mowgli_node_t *n;
+	size_t i, j, k, total = 0;
+
+	for (i = 0; i < count; i++)
+		total += MOWGLI_LIST_LENGTH(&users[i]->channels);
+
+	if (total == 0)
+		return;
+
+	/* sort the memberships by channel, so that every channel is
+	 * visited once no matter how many of its members are leaving
+	 */
+	cus = smalloc(total * sizeof *cus);
+
+	for (i = 0, k = 0; i < count; i++)
+		MOWGLI_ITER_FOREACH(n, users[i]->channels.head)
+			cus[k++] = n->data;
+
+	qsort(cus, total, sizeof *cus, chanuser_cmp_chan);
+
+	for (i = 0; i < total; i = j)
+	{
+		struct channel *chan = cus[i]->chan;
+
+		for (j = i + 1; j < total && cus[j]->chan == chan; j++)
+			;
+
+		/* this is called BEFORE we remove the users */
+		hook_call_channel_split((&(struct hook_channel_split){ .c = chan, .members = &cus[i], .count = j - i }));
+
+		slog(LG_DEBUG, "chanuser_delete_users(): %s -> %zu users (%u)", chan->name, j - i, chan->nummembers - (unsigned int)(j - i));
+
+		const unsigned int nummembers = chan->nummembers;
+
+		for (k = i; k < j; k++)
+		{
+			struct chanuser *cu = cus[k];
+
+			/* for modules that only track channel_part; those that
+			 * handle channel_split ignore parts with split set
+			 */
+			hook_call_channel_part((&(struct hook_channel_joinpart){ .cu = cu, .split = true }));
+
+			chanuser_index_remove(chan, cu);
+			mowgli_node_delete(&cu->cnode, &chan->members);
+			mowgli_node_delete(&cu->unode, &cu->user->channels);
+
+			if (is_internal_client(cu->user))
+				chan->numsvcmembers--;
+
+			mowgli_heap_free(chanuser_heap, cu);
+			chan->nummembers--;
+			cnt.chanuser--;
+		}
+
+		stats_channel_resized(nummembers, chan->nummembers);
+
+		if (chan->nummembers == 0 && !(chan->modes & ircd->perm_mode))
+		{
+			/* empty channels die */
+			slog(LG_DEBUG, "chanuser_delete_users(): `%s' is empty, removing", chan->name);
+
+			channel_delete(chan);
+		}
+	}
+
+	sfree(cus);
+}
+
 /*
  * chanuser_find(struct channel *chan, struct user *user)
  *
@@ -496,6 +766,13 @@ chanuser_find(struct channel *chan, struct user *user)
 	return_val_if_fail(chan != NULL, NULL);
 	return_val_if_fail(user != NULL, NULL);
 
+	if (chan->index != NULL)
+	{
+		unsigned int pos = chan->index->slots[chanuser_index_slot(chan->index, user)];
+
+		return pos != 0 ? chan->index->members[pos - 1] : NULL;
+	}
+
 	/* choose shortest list to search -- jilles */
 	if (MOWGLI_LIST_LENGTH(&user->channels) < MOWGLI_LIST_LENGTH(&chan->members))
 	{
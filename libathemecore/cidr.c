@@ -35,13 +35,13 @@
 /* compares the first 'mask' bits
  * returns 1 if equal, 0 if not */
 static int
-comp_with_mask(void *addr, void *dest, unsigned int mask)
+comp_with_mask(const void *addr, const void *dest, unsigned int mask)
 {
 	if (memcmp(addr, dest, mask / 8) == 0)
 	{
 		int n = mask / 8;
 		int m = ((-1) << (8 - (mask % 8)));
-		if (mask % 8 == 0 || (((unsigned char *) addr)[n] & m) == (((unsigned char *) dest)[n] & m))
+		if (mask % 8 == 0 || (((const unsigned char *) addr)[n] & m) == (((const unsigned char *) dest)[n] & m))
 		{
 			return (1);
 		}
@@ -360,6 +360,40 @@ match_cidr(const char *s1, const char *s2)
 		return 1;
 }
 
+/* cidr_parse()
+ *
+ * Input - address, without a CIDR length
+ * Output - whether the address is valid; the address family is decided by
+ *          the presence of a colon, as in match_cidr()
+ */
+bool
+cidr_parse(const char *ip, struct cidr_addr *addr)
+{
+	return_val_if_fail(ip != NULL, false);
+	return_val_if_fail(addr != NULL, false);
+
+	addr->ipv6 = (strchr(ip, ':') != NULL);
+
+	if (addr->ipv6)
+		return inet_pton6(ip, addr->addr) > 0;
+	else
+		return inet_pton4(ip, addr->addr) > 0;
+}
+
+/* cidr_match()
+ *
+ * Input - network address and length in bits, address
+ * Output - true = Matched false = Did not match
+ */
+bool
+cidr_match(const struct cidr_addr *net, unsigned int bits, const struct cidr_addr *addr)
+{
+	if (net->ipv6 != addr->ipv6 || bits == 0 || bits > (net->ipv6 ? 128U : 32U))
+		return false;
+
+	return comp_with_mask(addr->addr, net->addr, bits);
+}
+
 int
 valid_ip_or_mask(const char *src)
 {
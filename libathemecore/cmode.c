@@ -164,6 +164,8 @@ channel_mode(struct user *source, struct channel *chan, int parc, char *parv[])
 						break;
 					if (source && !ignore_mode_list[i].check(parv[parpos], chan, NULL, NULL, NULL))
 						break;
+					if (chan->extmodes == NULL)
+						chan->extmodes = scalloc(ignore_mode_list_size, sizeof(char *));
 					if (chan->extmodes[i])
 					{
 						if (strcmp(chan->extmodes[i], parv[parpos]))
@@ -178,7 +180,7 @@ channel_mode(struct user *source, struct channel *chan, int parc, char *parv[])
 				}
 				else
 				{
-					if (chan->extmodes[i])
+					if (channel_extmode(chan, i))
 					{
 						simple_modes_changed = true;
 						sfree(chan->extmodes[i]);
@@ -840,14 +842,14 @@ clear_simple_modes(struct channel *c)
 	sfree(c->key);
 	c->key = NULL;
 
+	if (c->extmodes == NULL)
+		return;
+
 	for (i = 0; i < ignore_mode_list_size; i++)
-	{
-		if (c->extmodes[i] != NULL)
-		{
-			sfree(c->extmodes[i]);
-			c->extmodes[i] = NULL;
-		}
-	}
+		sfree(c->extmodes[i]);
+
+	sfree(c->extmodes);
+	c->extmodes = NULL;
 }
 
 char *
@@ -892,7 +894,7 @@ channel_modes(const struct channel *c, bool doparams)
 	}
 	for (i = 0; ignore_mode_list[i].mode != '\0'; i++)
 	{
-		if (c->extmodes[i] != NULL)
+		if (channel_extmode(c, i) != NULL)
 		{
 			*p++ = ignore_mode_list[i].mode;
 			if (doparams)
@@ -986,7 +988,7 @@ check_modes(struct mychan *mychan, bool sendnow)
 			{
 				if (ignore_mode_list[i].mode == *p)
 				{
-					if ((p[1] == ' ' || p[1] == '\0') && mychan->chan->extmodes[i] != NULL)
+					if ((p[1] == ' ' || p[1] == '\0') && channel_extmode(mychan->chan, i) != NULL)
 					{
 						sfree(mychan->chan->extmodes[i]);
 						mychan->chan->extmodes[i] = NULL;
@@ -999,10 +1001,11 @@ check_modes(struct mychan *mychan, bool sendnow)
 						q = strchr(str2, ' ');
 						if (q != NULL)
 							*q = '\0';
-						if ((mychan->chan->extmodes[i] == NULL || strcmp(mychan->chan->extmodes[i], str2)) && ignore_mode_list[i].check(str2, mychan->chan, mychan, NULL, NULL))
+						if ((channel_extmode(mychan->chan, i) == NULL || strcmp(mychan->chan->extmodes[i], str2)) && ignore_mode_list[i].check(str2, mychan->chan, mychan, NULL, NULL))
 						{
-							if (mychan->chan->extmodes[i] != NULL)
-								sfree(mychan->chan->extmodes[i]);
+							if (mychan->chan->extmodes == NULL)
+								mychan->chan->extmodes = scalloc(ignore_mode_list_size, sizeof(char *));
+							sfree(mychan->chan->extmodes[i]);
 							mychan->chan->extmodes[i] = sstrdup(str2);
 							if (sendnow)
 								modestack_mode_ext(chansvs.nick, mychan->chan, MTYPE_ADD, i, mychan->chan->extmodes[i]);
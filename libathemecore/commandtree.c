@@ -16,7 +16,11 @@
 #include <atheme.h>
 #include "internal.h"
 
+mowgli_patricia_t *command_profile_stats = NULL;
+unsigned long command_fail_count = 0;
+
 static bool permissive_mode_fallback = false;
+static struct profile_counter *command_profile_current = NULL;
 
 static int
 text_to_parv(char *text, int maxparc, char **parv)
@@ -122,6 +126,68 @@ command_find(mowgli_patricia_t *commandtree, const char *command)
 	return mowgli_patricia_retrieve(commandtree, command);
 }
 
+/* Finds the counter for a command as executed by a service, possibly as a
+ * subcommand of another command. The result is cached in the command, so
+ * that the lookup only happens the first time, or when the same command is
+ * bound to several services or parents.
+ */
+static struct profile_counter *
+command_profile_counter(const struct service *const restrict svs, struct command *const restrict c)
+{
+	const struct profile_counter *const parent = command_profile_current;
+
+	if (c->profile.counter != NULL && c->profile.svs == svs && c->profile.parent == parent)
+		return c->profile.counter;
+
+	if (! command_profile_stats)
+		command_profile_stats = mowgli_patricia_create(&strcasecanon);
+
+	char name[BUFSIZE];
+
+	if (parent != NULL)
+		(void) snprintf(name, sizeof name, "%s %s", parent->name, c->name);
+	else
+		(void) snprintf(name, sizeof name, "%s %s", svs->internal_name, c->name);
+
+	c->profile.counter = profile_counter_get(command_profile_stats, name);
+	c->profile.svs = svs;
+	c->profile.parent = parent;
+
+	return c->profile.counter;
+}
+
+/* Runs a command that has passed the access checks, timing it if command
+ * profiling is enabled; subcommands dispatched from within it are counted
+ * under their parent's name (e.g. "chanserv SET FOUNDER").
+ */
+static void
+command_run(struct service *const restrict svs, struct sourceinfo *const restrict si, struct command *const restrict c,
+            const int parc, char **const restrict parv)
+{
+	if (! config_options.profile_commands)
+	{
+		c->cmd(si, parc, parv);
+		return;
+	}
+
+	struct profile_counter *const pc = command_profile_counter(svs, c);
+	struct profile_counter *const parent = command_profile_current;
+	const unsigned long failures = command_fail_count;
+
+	command_profile_current = pc;
+
+	const uint64_t start_ns = profile_time_ns();
+	c->cmd(si, parc, parv);
+	const uint64_t ns = profile_time_ns() - start_ns;
+
+	command_profile_current = parent;
+
+	(void) profile_counter_record(pc, ns);
+
+	if (command_fail_count != failures)
+		pc->failures++;
+}
+
 void
 command_exec(struct service *svs, struct sourceinfo *si, struct command *c, int parc, char *parv[])
 {
@@ -146,7 +212,7 @@ command_exec(struct service *svs, struct sourceinfo *si, struct command *c, int
 			language_set_active(si->force_language);
 
 		si->command = c;
-		c->cmd(si, parc, parv);
+		command_run(svs, si, c, parc, parv);
 		language_set_active(NULL);
 		return;
 	}
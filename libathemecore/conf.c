@@ -318,6 +318,10 @@ init_newconf(void)
 	add_bool_conf_item("CLONE_IDENTIFIED_INCREASE_LIMIT", &conf_gi_table, 0, &config_options.clone_increase, false);
 
 	add_uint_conf_item("UPLINK_SENDQ_LIMIT", &conf_gi_table, 0, &config_options.uplink_sendq_limit, 10240, INT_MAX, 1048576);
+	add_uint_conf_item("JOIN_RATE", &conf_gi_table, 0, &config_options.join_rate, 1, INT_MAX, 250);
+	add_uint_conf_item("STALL_THRESHOLD", &conf_gi_table, 0, &config_options.stall_threshold, 0, INT_MAX, 1000);
+	add_bool_conf_item("PROFILE_COMMANDS", &conf_gi_table, 0, &config_options.profile_commands, false);
+	add_dupstr_conf_item("UPLINK_CAPTURE", &conf_gi_table, 0, &config_options.uplink_capture, NULL);
 	add_dupstr_conf_item("LANGUAGE", &conf_gi_table, 0, &config_options.language, "en");
 	add_conf_item("EXEMPTS", &conf_gi_table, c_gi_exempts);
 	add_bool_conf_item("ALLOW_TAINT", &conf_gi_table, 0, &config_options.allow_taint, false);
@@ -129,17 +129,35 @@ connection_trampoline(mowgli_eventloop_t *const restrict eventloop, mowgli_event
 {
 	struct connection *const cptr = userdata;
 
+	/* The handler may close the connection, so work out what to charge the
+	 * time to beforehand. Connections accepted from a listener are charged
+	 * to the listener, so that e.g. every HTTP client shares one counter.
+	 */
+	const char *const what = (dir == MOWGLI_EVENTLOOP_IO_READ) ? "read" : "write";
+	char name[BUFSIZE];
+
+	if (CF_IS_UPLINK(cptr))
+		(void) snprintf(name, sizeof name, "uplink (%s)", what);
+	else if (cptr->listener != NULL)
+		(void) snprintf(name, sizeof name, "clients of %s (%s)", cptr->listener->name, what);
+	else
+		(void) snprintf(name, sizeof name, "%s (%s)", cptr->name, what);
+
+	const uint64_t start_ns = profile_time_ns();
+
 	switch (dir)
 	{
 		case MOWGLI_EVENTLOOP_IO_READ:
 			(void) cptr->read_handler(cptr);
-			return;
+			break;
 
 		case MOWGLI_EVENTLOOP_IO_WRITE:
 		case MOWGLI_EVENTLOOP_IO_ERROR:
 			(void) cptr->write_handler(cptr);
-			return;
+			break;
 	}
+
+	(void) eventloop_callback_done(eventloop_io_stats, name, start_ns);
 }
 
 struct connection * ATHEME_FATTR_MALLOC
@@ -237,6 +255,43 @@ connection_close(struct connection *const restrict cptr)
 	(void) sfree(cptr);
 }
 
+/* connection_detach()
+ *
+ * Forgets about a connection without closing its socket, so that it can be
+ * handed to another process.
+ *
+ * Inputs:
+ *       connection to forget about
+ *
+ * Outputs:
+ *       the file descriptor of its socket, which is no longer close-on-exec
+ *
+ * Side Effects:
+ *       the close handler is not called; whatever is left in the queues is
+ *       discarded
+ */
+int
+connection_detach(struct connection *const restrict cptr)
+{
+	const int fd = cptr->fd;
+
+	(void) slog(LG_DEBUG, "%s: detaching connection %d ('%s')", MOWGLI_FUNC_NAME, fd, cptr->name);
+
+	(void) mowgli_pollable_destroy(base_eventloop, cptr->pollable);
+	(void) mowgli_node_delete(&cptr->node, &connection_list);
+	(void) sendqrecvq_free(cptr);
+	(void) sfree(cptr);
+
+#ifndef MOWGLI_OS_WIN
+	const int flags = fcntl(fd, F_GETFD, NULL);
+
+	if (flags != -1)
+		(void) fcntl(fd, F_SETFD, (flags & ~FD_CLOEXEC));
+#endif
+
+	return fd;
+}
+
 void
 connection_close_children(struct connection *const restrict cptr)
 {
@@ -32,15 +32,32 @@ struct sendq {
 	char buf[SENDQSIZE];
 };
 
+/* Bytes a class may send, per SENDQSIZE, each time its turn comes round */
+static const unsigned int sendq_weights[SENDQ_CLASS_COUNT] = {
+	[SENDQ_CONTROL]         = 4,
+	[SENDQ_ENFORCEMENT]     = 2,
+	[SENDQ_LOGIN]           = 4,
+	[SENDQ_BULK]            = 1,
+};
+
+static const char *const sendq_class_names[SENDQ_CLASS_COUNT] = {
+	[SENDQ_CONTROL]         = "control",
+	[SENDQ_ENFORCEMENT]     = "enforcement",
+	[SENDQ_LOGIN]           = "login",
+	[SENDQ_BULK]            = "bulk",
+};
+
 void
-sendq_add(struct connection * cptr, char *buf, size_t len)
+sendq_add_class(struct connection * cptr, enum sendq_class cls, char *buf, size_t len)
 {
+	struct sendq_queue *q;
 	mowgli_node_t *n;
 	struct sendq *sq;
 	size_t l;
 	int pos = 0;
 
 	return_if_fail(cptr != NULL);
+	return_if_fail(cls < SENDQ_CLASS_COUNT);
 
 	if (CF_IS_DEAD(cptr) || CF_IS_SEND_EOF(cptr))
 	{
@@ -51,8 +68,7 @@ sendq_add(struct connection * cptr, char *buf, size_t len)
 	if (len == 0)
 		return;
 
-	if (cptr->sendq_limit != 0 &&
-			MOWGLI_LIST_LENGTH(&cptr->sendq) * SENDQSIZE + len > cptr->sendq_limit)
+	if (cptr->sendq_limit != 0 && sendq_length(cptr) + len > cptr->sendq_limit)
 	{
 		slog(LG_INFO, "sendq_add(): sendq limit exceeded on connection %s[%d]",
 				cptr->name, cptr->fd);
@@ -63,23 +79,32 @@ sendq_add(struct connection * cptr, char *buf, size_t len)
 	if (!sendq_nonempty(cptr))
 		connection_setselect_write(cptr, sendq_flush);
 
-	n = cptr->sendq.tail;
+	q = &cptr->sendq[cls];
+	q->length += len;
+	q->queued += len;
+
+	/* sendq_flush() only switches classes between chunks, so a line
+	 * that fits in a chunk is never split across two of them */
+	n = q->chunks.tail;
 	if (n != NULL)
 	{
 		sq = n->data;
 		l = SENDQSIZE - sq->firstfree;
-		if (l > len)
-			l = len;
-		memcpy(sq->buf + sq->firstfree, buf + pos, l);
-		sq->firstfree += l;
-		pos += l;
-		len -= l;
+		if (l >= len || len > SENDQSIZE)
+		{
+			if (l > len)
+				l = len;
+			memcpy(sq->buf + sq->firstfree, buf + pos, l);
+			sq->firstfree += l;
+			pos += l;
+			len -= l;
+		}
 	}
 
 	while (len > 0)
 	{
 		sq = smalloc(sizeof *sq);
-		mowgli_node_add(sq, &sq->node, &cptr->sendq);
+		mowgli_node_add(sq, &sq->node, &q->chunks);
 		l = SENDQSIZE;
 		if (l > len)
 			l = len;
@@ -90,6 +115,12 @@ sendq_add(struct connection * cptr, char *buf, size_t len)
 	}
 }
 
+void
+sendq_add(struct connection * cptr, char *buf, size_t len)
+{
+	sendq_add_class(cptr, SENDQ_CONTROL, buf, len);
+}
+
 void
 sendq_add_eof(struct connection * cptr)
 {
@@ -105,52 +136,97 @@ sendq_add_eof(struct connection * cptr)
 	cptr->flags |= CF_SEND_EOF;
 }
 
+static inline bool
+sendq_class_nonempty(const struct sendq_queue *q)
+{
+	const struct sendq *sq;
+
+	if (q->chunks.head == NULL)
+		return false;
+	sq = q->chunks.head->data;
+	return sq->firstfree > sq->firstused;
+}
+
+/* deficit round robin over the classes: a class whose turn it is sends
+ * whole chunks until its credit is used up or it has nothing left, then the
+ * next class with something to send gets its weight in credit */
 void
 sendq_flush(struct connection * cptr)
 {
-        mowgli_node_t *n, *tn;
-        struct sendq *sq;
-        int l;
+	struct sendq_queue *q;
+	struct sendq *sq;
+	unsigned int i;
+	int l;
 
 	return_if_fail(cptr != NULL);
 
-        MOWGLI_ITER_FOREACH_SAFE(n, tn, cptr->sendq.head)
-        {
-                sq = (struct sendq *)n->data;
-
-                if (sq->firstused == sq->firstfree)
-                        break;
+	for (;;)
+	{
+		q = &cptr->sendq[cptr->sendq_turn];
 
-                if ((l = send(cptr->fd, sq->buf + sq->firstused, sq->firstfree - sq->firstused, 0)) == -1)
-                {
-                        int err = ioerrno();
+		if (!sendq_class_nonempty(q))
+			q->deficit = 0;
+		else
+		{
+			sq = q->chunks.head->data;
 
-                        if (!mowgli_eventloop_ignore_errno(err))
+			/* a chunk that has been partly sent is finished
+			 * first, whatever the credit */
+			if (q->deficit > 0 || sq->firstused != 0)
 			{
-				slog(LG_DEBUG, "sendq_flush(): write error %d (%s) on connection %s[%d]",
-						err, strerror(err),
-						cptr->name, cptr->fd);
-				cptr->flags |= CF_DEAD;
+				if ((l = send(cptr->fd, sq->buf + sq->firstused, sq->firstfree - sq->firstused, 0)) == -1)
+				{
+					int err = ioerrno();
+
+					if (!mowgli_eventloop_ignore_errno(err))
+					{
+						slog(LG_DEBUG, "sendq_flush(): write error %d (%s) on connection %s[%d]",
+								err, strerror(err),
+								cptr->name, cptr->fd);
+						cptr->flags |= CF_DEAD;
+					}
+
+					return;
+				}
+
+				sq->firstused += l;
+				q->length -= l;
+				q->sent += l;
+				q->deficit -= l;
+
+				if (sq->firstused != sq->firstfree)
+					return;
+
+				if (MOWGLI_LIST_LENGTH(&q->chunks) > 1)
+				{
+					mowgli_node_delete(&sq->node, &q->chunks);
+					sfree(sq);
+				}
+				else
+					/* keep one struct sendq */
+					sq->firstused = sq->firstfree = 0;
+
+				continue;
 			}
+		}
 
-                        return;
-                }
+		/* pass the turn on to the next class with something to send */
+		for (i = 1; i <= SENDQ_CLASS_COUNT; i++)
+		{
+			enum sendq_class next = (cptr->sendq_turn + i) % SENDQ_CLASS_COUNT;
+
+			if (sendq_class_nonempty(&cptr->sendq[next]))
+				break;
+		}
+
+		if (i > SENDQ_CLASS_COUNT)
+			break;
+
+		cptr->sendq_turn = (cptr->sendq_turn + i) % SENDQ_CLASS_COUNT;
+		q = &cptr->sendq[cptr->sendq_turn];
+		q->deficit += (long) sendq_weights[cptr->sendq_turn] * SENDQSIZE;
+	}
 
-                sq->firstused += l;
-                if (sq->firstused == sq->firstfree)
-                {
-			if (MOWGLI_LIST_LENGTH(&cptr->sendq) > 1)
-			{
-                        	mowgli_node_delete(&sq->node, &cptr->sendq);
-				sfree(sq);
-			}
-			else
-				/* keep one struct sendq */
-				sq->firstused = sq->firstfree = 0;
-                }
-                else
-                        return;
-        }
 	if (CF_IS_SEND_EOF(cptr))
 	{
 		/* shut down write end, kill entire connection
@@ -168,18 +244,54 @@ sendq_flush(struct connection * cptr)
 bool
 sendq_nonempty(struct connection *cptr)
 {
-	mowgli_node_t *n;
-	struct sendq *sq;
+	unsigned int i;
 
 	if (CF_IS_SEND_DEAD(cptr))
 		return false;
 	if (CF_IS_SEND_EOF(cptr))
 		return true;
-	n = cptr->sendq.head;
-	if (n == NULL)
-		return false;
-	sq = n->data;
-	return sq->firstfree > sq->firstused;
+	for (i = 0; i < SENDQ_CLASS_COUNT; i++)
+		if (sendq_class_nonempty(&cptr->sendq[i]))
+			return true;
+	return false;
+}
+
+/* number of bytes waiting to be sent, in all classes */
+size_t
+sendq_length(struct connection *cptr)
+{
+	size_t len = 0;
+	unsigned int i;
+
+	for (i = 0; i < SENDQ_CLASS_COUNT; i++)
+		len += cptr->sendq[i].length;
+	return len;
+}
+
+/*
+ * sendq_stats(struct connection *cptr, sendq_stats_cb cb, void *privdata)
+ *
+ * Reports how much output each class has waiting and has sent so far.
+ *
+ * Inputs:
+ *       - connection, callback to call with every class and its private data
+ *
+ * Outputs:
+ *       - nothing
+ *
+ * Side Effects:
+ *       - none
+ */
+void
+sendq_stats(struct connection *cptr, sendq_stats_cb cb, void *privdata)
+{
+	unsigned int i;
+
+	return_if_fail(cptr != NULL);
+	return_if_fail(cb != NULL);
+
+	for (i = 0; i < SENDQ_CLASS_COUNT; i++)
+		cb(sendq_class_names[i], &cptr->sendq[i], privdata);
 }
 
 void
@@ -268,6 +380,37 @@ recvq_put(struct connection *cptr)
 	return;
 }
 
+/* queue data as if it had been received; used to hand over what the old
+ * process had not parsed yet on a warm restart */
+void
+recvq_add(struct connection *cptr, const char *buf, size_t len)
+{
+	struct sendq *sq = NULL;
+	size_t l;
+
+	return_if_fail(cptr != NULL);
+
+	while (len > 0)
+	{
+		if (cptr->recvq.tail != NULL)
+			sq = cptr->recvq.tail->data;
+		if (sq == NULL || sq->firstfree == SENDQSIZE)
+		{
+			sq = smalloc(sizeof *sq);
+			mowgli_node_add(sq, &sq->node, &cptr->recvq);
+		}
+
+		l = SENDQSIZE - sq->firstfree;
+		if (l > len)
+			l = len;
+		memcpy(sq->buf + sq->firstfree, buf, l);
+
+		sq->firstfree += l;
+		buf += l;
+		len -= l;
+	}
+}
+
 int
 recvq_get(struct connection *cptr, char *buf, size_t len)
 {
@@ -375,6 +518,7 @@ sendqrecvq_free(struct connection *cptr)
 {
 	mowgli_node_t *nptr, *nptr2;
 	struct sendq *sq;
+	unsigned int i;
 
 	MOWGLI_ITER_FOREACH_SAFE(nptr, nptr2, cptr->recvq.head)
 	{
@@ -384,12 +528,17 @@ sendqrecvq_free(struct connection *cptr)
 		sfree(sq);
 	}
 
-	MOWGLI_ITER_FOREACH_SAFE(nptr, nptr2, cptr->sendq.head)
+	for (i = 0; i < SENDQ_CLASS_COUNT; i++)
 	{
-		sq = nptr->data;
+		MOWGLI_ITER_FOREACH_SAFE(nptr, nptr2, cptr->sendq[i].chunks.head)
+		{
+			sq = nptr->data;
 
-		mowgli_node_delete(&sq->node, &cptr->sendq);
-		sfree(sq);
+			mowgli_node_delete(&sq->node, &cptr->sendq[i].chunks);
+			sfree(sq);
+		}
+
+		cptr->sendq[i].length = 0;
 	}
 }
 
@@ -0,0 +1,372 @@
+/*
+ * SPDX-License-Identifier: ISC
+ * SPDX-URL: https://spdx.org/licenses/ISC.html
+ *
+ * Copyright (C) 2026 Atheme Development Group (https://atheme.github.io/)
+ *
+ * Permission to use, copy, modify, and/or distribute this software for any
+ * purpose with or without fee is hereby granted, provided that the above
+ * copyright notice and this permission notice appear in all copies.
+ *
+ * atheme-services: A collection of minimalist IRC services
+ * hashmap.c: Open-addressing hash tables keyed by name
+ */
+
+#include <atheme.h>
+#include "internal.h"
+
+#define HASHMAP_MIN_SLOTS       16U
+
+// Probe lengths counted separately by hashmap_stats(); longer ones share the last bucket
+#define HASHMAP_STATS_PROBES    16U
+
+static const unsigned char *
+hashmap_fold_table(const struct hashmap *const restrict map)
+{
+	static unsigned char ascii_table[256];
+	static bool ascii_table_ready = false;
+
+	if (! map->casefold)
+		return NULL;
+
+	if (match_mapping != MATCH_ASCII)
+		return ToUpperTab;
+
+	// The locale does not change once services are running
+	if (! ascii_table_ready)
+	{
+		for (unsigned int c = 0; c < 256U; c++)
+			ascii_table[c] = (unsigned char) toupper((int) c);
+
+		ascii_table_ready = true;
+	}
+
+	return ascii_table;
+}
+
+static uint32_t
+hashmap_hash(const unsigned char *const restrict fold, const char *const restrict key)
+{
+	const unsigned char *p = (const unsigned char *) key;
+	uint32_t hash = 0x811C9DC5U;
+
+	// FNV-1a, then the MurmurHash3 finalizer, as the low bits pick the home slot
+	if (fold != NULL)
+		for (; *p; p++)
+			hash = (hash ^ fold[*p]) * 0x01000193U;
+	else
+		for (; *p; p++)
+			hash = (hash ^ *p) * 0x01000193U;
+
+	hash ^= hash >> 16;
+	hash *= 0x85EBCA6BU;
+	hash ^= hash >> 13;
+	hash *= 0xC2B2AE35U;
+	hash ^= hash >> 16;
+
+	return hash ? hash : 1U;
+}
+
+static bool
+hashmap_key_equal(const unsigned char *const restrict fold, const char *const restrict k1,
+                  const char *const restrict k2)
+{
+	if (fold == NULL)
+		return strcmp(k1, k2) == 0;
+
+	const unsigned char *p1 = (const unsigned char *) k1;
+	const unsigned char *p2 = (const unsigned char *) k2;
+
+	for (; fold[*p1] == fold[*p2]; p1++, p2++)
+		if (! *p1)
+			return true;
+
+	return false;
+}
+
+static inline size_t
+hashmap_probe_length(const struct hashmap *const restrict map, const size_t i)
+{
+	return (i - (map->slots[i].hash & map->mask)) & map->mask;
+}
+
+// Places an entry that is known not to be in the table yet
+static void
+hashmap_place(struct hashmap *const restrict map, uint32_t hash, char *key, void *value)
+{
+	size_t i = hash & map->mask;
+
+	for (size_t dist = 0; /* */; i = (i + 1U) & map->mask, dist++)
+	{
+		struct hashmap_slot *const slot = &map->slots[i];
+
+		if (! slot->hash)
+		{
+			slot->hash = hash;
+			slot->key = key;
+			slot->value = value;
+			return;
+		}
+
+		const size_t slot_dist = hashmap_probe_length(map, i);
+
+		if (slot_dist < dist)
+		{
+			const struct hashmap_slot evicted = *slot;
+
+			slot->hash = hash;
+			slot->key = key;
+			slot->value = value;
+
+			hash = evicted.hash;
+			key = evicted.key;
+			value = evicted.value;
+			dist = slot_dist;
+		}
+	}
+}
+
+static void
+hashmap_resize(struct hashmap *const restrict map, const size_t nslots)
+{
+	struct hashmap_slot *const old = map->slots;
+	const size_t old_nslots = map->mask + 1U;
+
+	map->slots = scalloc(nslots, sizeof *map->slots);
+	map->mask = nslots - 1U;
+
+	for (size_t i = 0; i < old_nslots; i++)
+		if (old[i].hash)
+			(void) hashmap_place(map, old[i].hash, old[i].key, old[i].value);
+
+	(void) sfree(old);
+}
+
+static size_t
+hashmap_find(const struct hashmap *const restrict map, const unsigned char *const restrict fold, const uint32_t hash,
+             const char *const restrict key, bool *const restrict found)
+{
+	size_t i = hash & map->mask;
+
+	for (size_t dist = 0; /* */; i = (i + 1U) & map->mask, dist++)
+	{
+		const struct hashmap_slot *const slot = &map->slots[i];
+
+		// An entry with our key would have displaced one closer to its home slot than we are
+		if (! slot->hash || hashmap_probe_length(map, i) < dist)
+			break;
+
+		if (slot->hash == hash && hashmap_key_equal(fold, slot->key, key))
+		{
+			*found = true;
+			return i;
+		}
+	}
+
+	*found = false;
+	return 0;
+}
+
+/* hashmap_create()
+ *
+ * Creates an empty hash table.
+ *
+ * Inputs:
+ *       whether keys are compared case-insensitively (as irccasecanon()
+ *       folds them) or exactly
+ *
+ * Outputs:
+ *       the new hash table
+ *
+ * Side Effects:
+ *       none
+ */
+struct hashmap *
+hashmap_create(const bool casefold)
+{
+	struct hashmap *const map = smalloc(sizeof *map);
+
+	map->slots = scalloc(HASHMAP_MIN_SLOTS, sizeof *map->slots);
+	map->mask = HASHMAP_MIN_SLOTS - 1U;
+	map->casefold = casefold;
+
+	return map;
+}
+
+void
+hashmap_destroy(struct hashmap *const restrict map)
+{
+	if (map == NULL)
+		return;
+
+	for (size_t i = 0; i <= map->mask; i++)
+		if (map->slots[i].hash)
+			(void) sfree(map->slots[i].key);
+
+	(void) sfree(map->slots);
+	(void) sfree(map);
+}
+
+/* hashmap_add()
+ *
+ * Adds an entry to a hash table.
+ *
+ * Inputs:
+ *       hash table, key (which is copied), value
+ *
+ * Outputs:
+ *       false if an entry with that key already exists, true otherwise
+ *
+ * Side Effects:
+ *       the table grows once it is 80% full
+ */
+bool
+hashmap_add(struct hashmap *const restrict map, const char *const restrict key, void *const restrict value)
+{
+	bool found;
+
+	return_val_if_fail(map != NULL, false);
+	return_val_if_fail(key != NULL, false);
+
+	const unsigned char *const fold = hashmap_fold_table(map);
+	const uint32_t hash = hashmap_hash(fold, key);
+
+	(void) hashmap_find(map, fold, hash, key, &found);
+
+	if (found)
+		return false;
+
+	if ((map->count + 1U) * 5U > (map->mask + 1U) * 4U)
+		(void) hashmap_resize(map, (map->mask + 1U) * 2U);
+
+	(void) hashmap_place(map, hash, sstrdup(key), value);
+
+	map->count++;
+
+	return true;
+}
+
+void *
+hashmap_retrieve(const struct hashmap *const restrict map, const char *const restrict key)
+{
+	bool found;
+
+	return_val_if_fail(map != NULL, NULL);
+	return_val_if_fail(key != NULL, NULL);
+
+	const unsigned char *const fold = hashmap_fold_table(map);
+	const size_t i = hashmap_find(map, fold, hashmap_hash(fold, key), key, &found);
+
+	return found ? map->slots[i].value : NULL;
+}
+
+/* hashmap_delete()
+ *
+ * Removes an entry from a hash table.
+ *
+ * Inputs:
+ *       hash table, key
+ *
+ * Outputs:
+ *       the value of the entry, or NULL if there was none
+ *
+ * Side Effects:
+ *       the table shrinks once it is less than 1/8 full
+ */
+void *
+hashmap_delete(struct hashmap *const restrict map, const char *const restrict key)
+{
+	bool found;
+
+	return_val_if_fail(map != NULL, NULL);
+	return_val_if_fail(key != NULL, NULL);
+
+	const unsigned char *const fold = hashmap_fold_table(map);
+	size_t i = hashmap_find(map, fold, hashmap_hash(fold, key), key, &found);
+
+	if (! found)
+		return NULL;
+
+	void *const value = map->slots[i].value;
+
+	(void) sfree(map->slots[i].key);
+
+	// Shift the entries that follow back until one is in its home slot
+	for (size_t next = (i + 1U) & map->mask; map->slots[next].hash && hashmap_probe_length(map, next);
+	     i = next, next = (next + 1U) & map->mask)
+		map->slots[i] = map->slots[next];
+
+	(void) memset(&map->slots[i], 0x00, sizeof map->slots[i]);
+
+	map->count--;
+
+	if (map->mask + 1U > HASHMAP_MIN_SLOTS && map->count * 8U < map->mask + 1U)
+		(void) hashmap_resize(map, (map->mask + 1U) / 2U);
+
+	return value;
+}
+
+/* hashmap_stats()
+ *
+ * Describes the occupancy of a hash table and the distribution of probe
+ * lengths, like mowgli_patricia_stats() does for patricia trees.
+ *
+ * Inputs:
+ *       hash table, a name for it, callback to call with every line and
+ *       its private data
+ *
+ * Outputs:
+ *       none
+ *
+ * Side Effects:
+ *       none
+ */
+void
+hashmap_stats(const struct hashmap *const restrict map, const char *const restrict name,
+              const hashmap_stats_cb cb, void *const restrict privdata)
+{
+	size_t probes[HASHMAP_STATS_PROBES];
+	size_t longest = 0;
+	uint64_t total = 0;
+	char buf[BUFSIZE];
+
+	return_if_fail(map != NULL);
+	return_if_fail(cb != NULL);
+
+	(void) memset(probes, 0x00, sizeof probes);
+
+	for (size_t i = 0; i <= map->mask; i++)
+	{
+		if (! map->slots[i].hash)
+			continue;
+
+		const size_t dist = hashmap_probe_length(map, i);
+
+		probes[(dist < HASHMAP_STATS_PROBES) ? dist : (HASHMAP_STATS_PROBES - 1U)]++;
+		total += dist;
+
+		if (dist > longest)
+			longest = dist;
+	}
+
+	(void) snprintf(buf, sizeof buf, "Hash table stats for %s (%zu entries, %zu slots, %zu%% full)", name,
+	                map->count, map->mask + 1U, (map->count * 100U) / (map->mask + 1U));
+	(void) cb(buf, privdata);
+
+	if (! map->count)
+		return;
+
+	(void) snprintf(buf, sizeof buf, "Probe length: average %.2f, longest %zu",
+	                (double) total / (double) map->count, longest);
+	(void) cb(buf, privdata);
+
+	for (size_t i = 0; i < HASHMAP_STATS_PROBES; i++)
+	{
+		if (! probes[i])
+			continue;
+
+		(void) snprintf(buf, sizeof buf, "Probe length %zu%s: %zu entries", i,
+		                (i == HASHMAP_STATS_PROBES - 1U) ? "+" : "", probes[i]);
+		(void) cb(buf, privdata);
+	}
+}
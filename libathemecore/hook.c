@@ -38,6 +38,13 @@ typedef struct {
 
 static mowgli_list_t hook_run_stack = { NULL, NULL, 0 };
 
+/* While hook_profile is set, the time spent in outermost hook calls is added
+ * to hook_profile_ns; pcommand_exec() uses this to tell apart the time spent
+ * in protocol handlers from the time spent in the hooks they call.
+ */
+bool hook_profile = false;
+uint64_t hook_profile_ns = 0;
+
 void
 hooks_init(void)
 {
@@ -168,6 +175,9 @@ hook_call_event(const char *event, void *dptr)
 	ctx.dptr = dptr;
 	ctx.flags = HF_RUN;
 
+	const bool timed = hook_profile && hook_run_stack.head == NULL;
+	const uint64_t start_ns = timed ? profile_time_ns() : 0;
+
 	mowgli_node_add_head(&ctx, &ctx.node, &hook_run_stack);
 
 	MOWGLI_ITER_FOREACH_SAFE(n, tn, ctx.hook->hooks.head)
@@ -181,6 +191,9 @@ hook_call_event(const char *event, void *dptr)
 
 out:
 	mowgli_node_delete(&ctx.node, &hook_run_stack);
+
+	if (timed)
+		hook_profile_ns += profile_time_ns() - start_ns;
 }
 
 static inline hook_run_ctx_t *
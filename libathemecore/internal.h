@@ -14,6 +14,10 @@
 #include <atheme/stdheaders.h>
 
 /* internal functions */
+void casemap_init(void);
+void command_stream_user_delete(struct user *u);
+void casemap_upper(char *str, bool ascii);
+size_t casemap_equal_prefix(const char *str1, const char *str2, size_t limit);
 void event_init(void);
 void hooks_init(void);
 void init_dlink_nodes(void);
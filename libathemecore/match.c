@@ -208,6 +208,377 @@ match(const char *mask, const char *name)
 }
 
 
+/* characters that match() does not compare literally */
+static inline bool
+match_is_special(const char c)
+{
+	return c == '*' || c == '?' || c == '&' || c == '#' || c == '%' || c == '\\';
+}
+
+static unsigned char match_ascii_lower[256];
+static bool match_ascii_lower_done = false;
+
+/* ToLower() as a table, for the current match_mapping */
+static const unsigned char *
+match_fold_table(void)
+{
+	if (match_mapping != MATCH_ASCII)
+		return ToLowerTab;
+
+	if (!match_ascii_lower_done)
+	{
+		for (unsigned int c = 0; c < 256; c++)
+			match_ascii_lower[c] = (unsigned char) tolower((int) c);
+
+		match_ascii_lower_done = true;
+	}
+
+	return match_ascii_lower;
+}
+
+static inline bool
+match_fold_equal(const unsigned char *fold, const char *s, const char *folded, size_t len)
+{
+	for (size_t i = 0; i < len; i++)
+		if (fold[(unsigned char) s[i]] != (unsigned char) folded[i])
+			return false;
+
+	return true;
+}
+
+/* finds the first occurrence of a segment that starts in [start, end - seg->len] */
+static const char *
+match_find_segment(const unsigned char *fold, const char *start, const char *end, const char *folded,
+                   const struct match_segment *seg)
+{
+	const char *const lit = folded + seg->offset;
+	const char *p = start, *a = NULL, *b = NULL;
+
+	if (end - start < (ptrdiff_t) seg->len)
+		return NULL;
+
+	const char *const last = end - seg->len + 1;
+
+	while (p < last)
+	{
+		if (seg->nfirst == 1)
+		{
+			if ((p = memchr(p, seg->first[0], (size_t) (last - p))) == NULL)
+				return NULL;
+		}
+		else if (seg->nfirst == 2)
+		{
+			// keep the next occurrence of both characters, so that neither is searched twice
+			if ((a == NULL || a < p) && (a = memchr(p, seg->first[0], (size_t) (last - p))) == NULL)
+				a = last;
+			if ((b == NULL || b < p) && (b = memchr(p, seg->first[1], (size_t) (last - p))) == NULL)
+				b = last;
+			if ((p = (a < b) ? a : b) == last)
+				return NULL;
+		}
+		else
+		{
+			while (p < last && fold[(unsigned char) *p] != (unsigned char) *lit)
+				p++;
+			if (p == last)
+				return NULL;
+		}
+
+		if (match_fold_equal(fold, p + 1, lit + 1, seg->len - 1))
+			return p;
+
+		p++;
+	}
+
+	return NULL;
+}
+
+static void
+match_add_segment(struct match_pattern *mp, const unsigned char *fold, size_t offset, size_t len)
+{
+	struct match_segment *const seg = &mp->segments[mp->nsegments++];
+	const unsigned char c = (unsigned char) mp->folded[offset];
+
+	seg->offset = offset;
+	seg->len = len;
+
+	for (unsigned int i = 0; i < 256; i++)
+	{
+		if (fold[i] != c)
+			continue;
+
+		if (seg->nfirst == 2)
+		{
+			seg->nfirst = 0;
+			break;
+		}
+
+		seg->first[seg->nfirst++] = (unsigned char) i;
+	}
+}
+
+/*
+ * match_compile(const char *mask)
+ *
+ * Preprocesses a mask that is going to be matched against many strings.
+ * The mask is split into its literal parts, which are case-folded once;
+ * match_compiled() looks for those before doing any wildcard matching and
+ * can decide masks of the most common shapes on its own.
+ *
+ * Inputs:
+ *     - mask, as for match()
+ *
+ * Outputs:
+ *     - compiled pattern, to be freed with match_pattern_free()
+ *
+ * Side Effects:
+ *     - none
+ */
+struct match_pattern *
+match_compile(const char *mask)
+{
+	struct match_pattern *mp;
+	const unsigned char *fold;
+	size_t i, j, len, stars;
+
+	return_val_if_fail(mask != NULL, NULL);
+
+	fold = match_fold_table();
+	len = strlen(mask);
+
+	mp = smalloc(sizeof *mp);
+	mp->mask = sstrdup(mask);
+	mp->folded = smalloc(len + 1);
+	mp->len = len;
+	mp->mapping = match_mapping;
+
+	for (i = 0; i < len; i++)
+		mp->folded[i] = (char) fold[(unsigned char) mask[i]];
+
+	/* before the first wildcard, match() fails on the first mismatch; if
+	 * the mask ends in literal characters, match() can only succeed once
+	 * both strings are exhausted, so the subject must end in them too.
+	 */
+	while (mp->prefixlen < len && !match_is_special(mask[mp->prefixlen]))
+		mp->prefixlen++;
+
+	if (mp->prefixlen == len)
+	{
+		mp->shape = MATCH_SHAPE_LITERAL;
+		return mp;
+	}
+
+	while (!match_is_special(mask[len - mp->suffixlen - 1]))
+		mp->suffixlen++;
+
+	/* every other run of literal characters between the anchors must be
+	 * found in the subject in order; match() never backtracks before the
+	 * last '*' it has seen, so every run is compared against consecutive
+	 * characters, after those the previous runs were compared against.
+	 */
+	mp->segments = smalloc(sizeof *mp->segments * (len / 2 + 1));
+
+	for (i = mp->prefixlen; i < len - mp->suffixlen; i = j)
+	{
+		for (j = i; j < len - mp->suffixlen && !match_is_special(mask[j]); j++)
+			;
+
+		if (j > i)
+			match_add_segment(mp, fold, i, j - i);
+		else
+			j++;
+	}
+
+	for (stars = 0; stars < len && mask[stars] == '*'; stars++)
+		;
+
+	if (stars == len)
+		mp->shape = MATCH_SHAPE_ALL;
+	else if (mp->prefixlen + strspn(mask + mp->prefixlen, "*") == len)
+		mp->shape = MATCH_SHAPE_PREFIX;
+	else if (stars && stars + mp->suffixlen == len)
+		mp->shape = MATCH_SHAPE_SUFFIX;
+	else if (stars && mp->nsegments == 1 && mp->segments[0].offset == stars &&
+	         stars + mp->segments[0].len + strspn(mask + stars + mp->segments[0].len, "*") == len)
+		mp->shape = MATCH_SHAPE_SUBSTRING;
+	else
+		mp->shape = MATCH_SHAPE_GENERIC;
+
+	return mp;
+}
+
+/*
+ * match_compiled(const struct match_pattern *mp, const char *name)
+ *
+ * Matches a string against a compiled mask; the result is always the same
+ * as that of match() for the mask the pattern was compiled from, including
+ * its limit on the amount of work done for a single string.
+ *
+ * Inputs:
+ *     - compiled pattern
+ *     - string to match
+ *
+ * Outputs:
+ *     - 0 if the string matches, 1 if not
+ *
+ * Side Effects:
+ *     - none
+ */
+int
+match_compiled(const struct match_pattern *mp, const char *name)
+{
+	const unsigned char *fold;
+	const char *p, *end;
+	size_t nlen;
+
+	if (mp == NULL || name == NULL)
+		return 1;
+
+	// the folded parts are useless if the casemapping changed since
+	if (mp->mapping != match_mapping)
+		return match(mp->mask, name);
+
+	fold = match_fold_table();
+	nlen = strlen(name);
+
+	/* For the fixed shapes, match() compares each character of the mask
+	 * against at most as many characters as computed below, once per
+	 * iteration; if that stays below MAX_ITERATIONS, the result is known.
+	 */
+	switch (mp->shape)
+	{
+		case MATCH_SHAPE_ALL:
+			return 0;
+
+		case MATCH_SHAPE_LITERAL:
+			if (nlen != mp->len || !match_fold_equal(fold, name, mp->folded, nlen))
+				return 1;
+			if (nlen <= MAX_ITERATIONS)
+				return 0;
+			break;
+
+		case MATCH_SHAPE_PREFIX:
+			if (nlen < mp->prefixlen || !match_fold_equal(fold, name, mp->folded, mp->prefixlen))
+				return 1;
+			if (mp->prefixlen <= MAX_ITERATIONS)
+				return 0;
+			break;
+
+		case MATCH_SHAPE_SUFFIX:
+			if (nlen < mp->suffixlen ||
+			    !match_fold_equal(fold, name + nlen - mp->suffixlen, mp->folded + mp->len - mp->suffixlen, mp->suffixlen))
+				return 1;
+			if (nlen - mp->suffixlen + 1 <= MAX_ITERATIONS / mp->suffixlen)
+				return 0;
+			break;
+
+		case MATCH_SHAPE_SUBSTRING:
+			if ((p = match_find_segment(fold, name, name + nlen, mp->folded, &mp->segments[0])) == NULL)
+				return 1;
+			if ((size_t) (p - name) + 1 <= MAX_ITERATIONS / mp->segments[0].len)
+				return 0;
+			break;
+
+		case MATCH_SHAPE_GENERIC:
+			if (nlen < mp->prefixlen + mp->suffixlen)
+				return 1;
+			if (!match_fold_equal(fold, name, mp->folded, mp->prefixlen))
+				return 1;
+			if (!match_fold_equal(fold, name + nlen - mp->suffixlen, mp->folded + mp->len - mp->suffixlen, mp->suffixlen))
+				return 1;
+
+			p = name + mp->prefixlen;
+			end = name + nlen - mp->suffixlen;
+
+			for (size_t i = 0; i < mp->nsegments; i++)
+			{
+				if ((p = match_find_segment(fold, p, end, mp->folded, &mp->segments[i])) == NULL)
+					return 1;
+
+				p += mp->segments[i].len;
+			}
+			break;
+	}
+
+	return match(mp->mask, name);
+}
+
+void
+match_pattern_free(struct match_pattern *mp)
+{
+	if (mp == NULL)
+		return;
+
+	sfree(mp->mask);
+	sfree(mp->folded);
+	sfree(mp->segments);
+	sfree(mp);
+}
+
+/*
+ * mask_matcher_compile(struct mask_matcher *mm, const char *mask)
+ *
+ * Compiles a ban or access list mask with match_compile() and, if it is of
+ * the form nick!user@ip/bits, parses its network for CIDR matching.
+ *
+ * Inputs:
+ *     - matcher to fill in; it is freed first if it was compiled before
+ *     - mask to compile
+ *
+ * Outputs:
+ *     - nothing
+ *
+ * Side Effects:
+ *     - memory is allocated for the matcher
+ */
+void
+mask_matcher_compile(struct mask_matcher *mm, const char *mask)
+{
+	char buf[BUFSIZE];
+	char *ipmask, *len;
+	int cidrlen;
+
+	return_if_fail(mm != NULL);
+	return_if_fail(mask != NULL);
+
+	mask_matcher_free(mm);
+
+	mm->pattern = match_compile(mask);
+
+	/* parsed the same way as match_cidr() does it */
+	mowgli_strlcpy(buf, mask, sizeof buf);
+
+	if ((ipmask = strrchr(buf, '@')) == NULL)
+		return;
+
+	*ipmask++ = '\0';
+
+	if ((len = strrchr(ipmask, '/')) == NULL)
+		return;
+
+	*len++ = '\0';
+
+	if ((cidrlen = atoi(len)) <= 0 || !cidr_parse(ipmask, &mm->cidr_addr))
+		return;
+
+	if ((unsigned int) cidrlen > (mm->cidr_addr.ipv6 ? 128U : 32U))
+		return;
+
+	mm->cidr_bits = (unsigned int) cidrlen;
+	mm->cidr_nickuser = sstrdup(buf);
+}
+
+void
+mask_matcher_free(struct mask_matcher *mm)
+{
+	return_if_fail(mm != NULL);
+
+	match_pattern_free(mm->pattern);
+	sfree(mm->cidr_nickuser);
+	memset(mm, 0, sizeof *mm);
+}
+
+
 /*
 ** collapse a pattern string into minimal components.
 ** This particular version is "in place", so that it changes the pattern
@@ -264,6 +635,11 @@ irccasecmp(const char *s1, const char *s2)
 	if (match_mapping == MATCH_ASCII)
 		return strcasecmp(s1, s2);
 
+	const size_t skip = casemap_equal_prefix(s1, s2, SIZE_MAX);
+
+	str1 += skip;
+	str2 += skip;
+
 	while ((res = ToUpper(*str1) - ToUpper(*str2)) == 0)
 	{
 		if (*str1 == '\0')
@@ -284,6 +660,22 @@ ircncasecmp(const char *str1, const char *str2, size_t n)
 	if (match_mapping == MATCH_ASCII)
 		return strncasecmp(str1, str2, n);
 
+	// The loop below always compares the first byte, so leave it at least one
+	if (n > 1)
+	{
+		const size_t skip = casemap_equal_prefix(str1, str2, n - 1);
+
+		if (skip)
+		{
+			s1 += skip;
+			s2 += skip;
+			n -= skip;
+
+			if (*s1 == '\0' && *s2 == '\0')
+				return 0;
+		}
+	}
+
 	while ((res = ToUpper(*s1) - ToUpper(*s2)) == 0)
 	{
 		s1++;
@@ -298,23 +690,13 @@ ircncasecmp(const char *str1, const char *str2, size_t n)
 void
 irccasecanon(char *str)
 {
-	while (*str)
-	{
-		*str = ToUpper(*str);
-		str++;
-	}
-	return;
+	casemap_upper(str, match_mapping == MATCH_ASCII);
 }
 
 void
 strcasecanon(char *str)
 {
-	while (*str)
-	{
-		*str = toupper((unsigned char)*str);
-		str++;
-	}
-	return;
+	casemap_upper(str, true);
 }
 
 void
@@ -128,6 +128,8 @@ kline_add_with_id(const char *user, const char *host, const char *reason, long d
 
 	k->user = sstrdup(user);
 	k->host = sstrdup(host);
+	k->user_pattern = match_compile(k->user);
+	k->host_pattern = match_compile(k->host);
 	k->reason = sstrdup(reason);
 	k->setby = sstrdup(setby);
 	k->duration = duration;
@@ -142,7 +144,12 @@ kline_add_with_id(const char *user, const char *host, const char *reason, long d
 	snprintf(treason, sizeof(treason), "[#%lu] %s", k->number, k->reason);
 
 	if (me.connected)
+	{
+		const enum sendq_class cls = sts_set_class(SENDQ_ENFORCEMENT);
+
 		kline_sts("*", user, host, duration, treason);
+		(void) sts_set_class(cls);
+	}
 
 	return k;
 }
@@ -172,12 +179,19 @@ kline_delete(struct kline *k)
 
 	/* only unkline if ircd has not already removed this -- jilles */
 	if (me.connected && (k->duration == 0 || k->expires > CURRTIME))
+	{
+		const enum sendq_class cls = sts_set_class(SENDQ_ENFORCEMENT);
+
 		unkline_sts("*", k->user, k->host);
+		(void) sts_set_class(cls);
+	}
 
 	n = mowgli_node_find(k, &klnlist);
 	mowgli_node_delete(n, &klnlist);
 	mowgli_node_free(n);
 
+	match_pattern_free(k->user_pattern);
+	match_pattern_free(k->host_pattern);
 	sfree(k->user);
 	sfree(k->host);
 	sfree(k->reason);
@@ -198,7 +212,7 @@ kline_find(const char *user, const char *host)
 	{
 		k = (struct kline *)n->data;
 
-		if ((!match(k->user, user)) && (!match(k->host, host)))
+		if ((!match_compiled(k->user_pattern, user)) && (!match_compiled(k->host_pattern, host)))
 			return k;
 	}
 
@@ -234,7 +248,8 @@ kline_find_user(struct user *u)
 
 		if (k->duration != 0 && k->expires <= CURRTIME)
 			continue;
-		if (!match(k->user, u->user) && (!match(k->host, u->host) || !match(k->host, u->ip) || !match_ips(k->host, u->ip)))
+		if (!match_compiled(k->user_pattern, u->user) &&
+		    (!match_compiled(k->host_pattern, u->host) || !match_compiled(k->host_pattern, u->ip) || !match_ips(k->host, u->ip)))
 			return k;
 	}
 
@@ -289,6 +304,7 @@ xline_add(const char *realname, const char *reason, long duration, const char *s
 	mowgli_node_add(x, n, &xlnlist);
 
 	x->realname = sstrdup(realname);
+	x->realname_pattern = match_compile(x->realname);
 	x->reason = sstrdup(reason);
 	x->setby = sstrdup(setby);
 	x->duration = duration;
@@ -299,7 +315,12 @@ xline_add(const char *realname, const char *reason, long duration, const char *s
 	cnt.xline++;
 
 	if (me.connected)
+	{
+		const enum sendq_class cls = sts_set_class(SENDQ_ENFORCEMENT);
+
 		xline_sts("*", realname, duration, reason);
+		(void) sts_set_class(cls);
+	}
 
 	return x;
 }
@@ -320,12 +341,18 @@ xline_delete(const char *realname)
 
 	/* only unxline if ircd has not already removed this -- jilles */
 	if (me.connected && (x->duration == 0 || x->expires > CURRTIME))
+	{
+		const enum sendq_class cls = sts_set_class(SENDQ_ENFORCEMENT);
+
 		unxline_sts("*", x->realname);
+		(void) sts_set_class(cls);
+	}
 
 	n = mowgli_node_find(x, &xlnlist);
 	mowgli_node_delete(n, &xlnlist);
 	mowgli_node_free(n);
 
+	match_pattern_free(x->realname_pattern);
 	sfree(x->realname);
 	sfree(x->reason);
 	sfree(x->setby);
@@ -345,7 +372,7 @@ xline_find(const char *realname)
 	{
 		x = (struct xline *)n->data;
 
-		if (!match(x->realname, realname))
+		if (!match_compiled(x->realname_pattern, realname))
 			return x;
 	}
 
@@ -382,7 +409,7 @@ xline_find_user(struct user *u)
 		if (x->duration != 0 && x->expires <= CURRTIME)
 			continue;
 
-		if (!match(x->realname, u->gecos))
+		if (!match_compiled(x->realname_pattern, u->gecos))
 			return x;
 	}
 
@@ -432,6 +459,7 @@ qline_add(const char *mask, const char *reason, long duration, const char *setby
 	mowgli_node_add(q, n, &qlnlist);
 
 	q->mask = sstrdup(mask);
+	q->pattern = match_compile(q->mask);
 	q->reason = sstrdup(reason);
 	q->setby = sstrdup(setby);
 	q->duration = duration;
@@ -442,7 +470,12 @@ qline_add(const char *mask, const char *reason, long duration, const char *setby
 	cnt.qline++;
 
 	if (me.connected)
+	{
+		const enum sendq_class cls = sts_set_class(SENDQ_ENFORCEMENT);
+
 		qline_sts("*", mask, duration, reason);
+		(void) sts_set_class(cls);
+	}
 
 	return q;
 }
@@ -463,12 +496,18 @@ qline_delete(const char *mask)
 
 	/* only unqline if ircd has not already removed this -- jilles */
 	if (me.connected && (q->duration == 0 || q->expires > CURRTIME))
+	{
+		const enum sendq_class cls = sts_set_class(SENDQ_ENFORCEMENT);
+
 		unqline_sts("*", q->mask);
+		(void) sts_set_class(cls);
+	}
 
 	n = mowgli_node_find(q, &qlnlist);
 	mowgli_node_delete(n, &qlnlist);
 	mowgli_node_free(n);
 
+	match_pattern_free(q->pattern);
 	sfree(q->mask);
 	sfree(q->reason);
 	sfree(q->setby);
@@ -507,7 +546,7 @@ qline_find_match(const char *mask)
 
 		if (q->duration != 0 && q->expires <= CURRTIME)
 			continue;
-		if (!match(q->mask, mask))
+		if (!match_compiled(q->pattern, mask))
 			return q;
 	}
 
@@ -545,7 +584,7 @@ qline_find_user(struct user *u)
 			continue;
 		if (q->mask[0] == '#' || q->mask[0] == '&')
 			continue;
-		if (!match(q->mask, u->nick))
+		if (!match_compiled(q->pattern, u->nick))
 			return q;
 	}
 
@@ -43,6 +43,20 @@ irc_recvq_handler(struct connection *cptr)
 	if (count > 0 && parsebuf[count - 1] == '\r')
 		count--;
 	parsebuf[count] = '\0';
+
+	if (capture_enabled)
+	{
+		const bool wasbursting = me.bursting;
+
+		capture_record(CAPTURE_LINE, parsebuf, (size_t) count);
+		parse(parsebuf);
+
+		if (wasbursting && !me.bursting)
+			capture_record(CAPTURE_EOB, NULL, 0);
+
+		return;
+	}
+
 	parse(parsebuf);
 }
 
@@ -87,6 +101,7 @@ irc_handle_connect(struct connection *cptr)
 		/* no SERVER message received */
 		me.recvsvr = false;
 
+		capture_record(CAPTURE_CONNECT, NULL, 0);
 
 		server_login();
 
@@ -94,6 +109,7 @@ irc_handle_connect(struct connection *cptr)
 		/* start our burst timer */
 		s_time(&burstime);
 #endif
+		pcommand_burst_begin();
 
 		/* done bursting by this time... */
 		ping_sts();
@@ -108,6 +124,27 @@ irc_handle_connect(struct connection *cptr)
 	}
 }
 
+/* Takes over a connection to the uplink that a previous process had already
+ * logged in and synced; no login or burst is sent.
+ */
+void
+irc_handle_resume(struct connection *cptr)
+{
+	cptr->flags = CF_UPLINK;
+	cptr->recvq_handler = irc_recvq_handler;
+	connection_setselect_read(cptr, recvq_put);
+	slog(LG_INFO, "irc_handle_resume(): resuming connection to uplink");
+	me.connected = true;
+	me.recvsvr = true;
+
+	if (ping_uplink_timer != NULL)
+		mowgli_timer_destroy(base_eventloop, ping_uplink_timer);
+
+	ping_uplink_timer = mowgli_timer_add(base_eventloop, "ping_uplink", ping_uplink, NULL, 300);
+
+	me.uplinkpong = time(NULL);
+}
+
 /* vim:cinoptions=>s,e0,n0,f0,{0,}0,^0,=s,ps,t0,c3,+s,(2s,us,)20,*30,gs,hs
  * vim:ts=8
  * vim:sw=8
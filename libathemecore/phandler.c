@@ -20,6 +20,7 @@ unsigned int(*server_login) (void) = generic_server_login;
 void (*introduce_nick) (struct user *u) = generic_introduce_nick;
 void (*wallops_sts) (const char *text) = generic_wallops_sts;
 void (*join_sts) (struct channel *c, struct user *u, bool isnew, char *modes) = generic_join_sts;
+void (*join_batch_sts) (struct user *u, struct channel **chans, size_t count) = generic_join_batch_sts;
 void (*chan_lowerts) (struct channel *c, struct user *u) = generic_chan_lowerts;
 void (*kick) (struct user *source, struct channel *c, struct user *u, const char *reason) = generic_kick;
 void (*msg) (const char *from, const char *target, const char *fmt, ...) = generic_msg;
@@ -102,6 +103,13 @@ generic_join_sts(struct channel *c, struct user *u, bool isnew, char *modes)
 	/* We can't do anything here. Bail. */
 }
 
+void
+generic_join_batch_sts(struct user *u, struct channel **chans, size_t count)
+{
+	for (size_t i = 0; i < count; i++)
+		join_sts(chans[i], u, true, channel_modes(chans[i], true));
+}
+
 void
 generic_chan_lowerts(struct channel *c, struct user *u)
 {
@@ -160,12 +168,11 @@ void
 generic_wallchops(struct user *sender, struct channel *channel, const char *message)
 {
 	/* ugly, but always works -- jilles */
-	mowgli_node_t *n;
+	struct chanuser_iter iter;
 	struct chanuser *cu;
 
-	MOWGLI_ITER_FOREACH(n, channel->members.head)
+	CHANNEL_MEMBER_FOREACH(cu, &iter, channel)
 	{
-		cu = (struct chanuser *)n->data;
 		if (cu->user->server != me.me && cu->modes & CSTATUS_OP)
 			notice(sender->nick, cu->user->nick, "[@%s] %s", channel->name, message);
 	}
@@ -337,26 +344,64 @@ generic_sasl_mechlist_sts(const char *mechlist)
 bool
 generic_mask_matches_user(const char *mask, struct user *u)
 {
-	char hostbuf[NICKLEN + 1 + USERLEN + 1 + HOSTLEN + 1];
-	char cloakbuf[NICKLEN + 1 + USERLEN + 1 + HOSTLEN + 1];
-	char realbuf[NICKLEN + 1 + USERLEN + 1 + HOSTLEN + 1];
-	char ipbuf[NICKLEN + 1 + USERLEN + 1 + HOSTLEN + 1];
-
-	snprintf(hostbuf, sizeof hostbuf, "%s!%s@%s", u->nick, u->user, u->vhost);
-	snprintf(cloakbuf, sizeof cloakbuf, "%s!%s@%s", u->nick, u->user, u->chost);
+	const struct user_masks *const um = user_get_masks(u);
 
-	bool result = !match(mask, hostbuf) || !match(mask, cloakbuf);
+	bool result = !match(mask, um->form[USER_MASK_VHOST]) || !match(mask, um->form[USER_MASK_CHOST]);
 
 	// return if configured not to check further, or if we already have a match
 	if ((!config_options.masks_through_vhost && u->host != u->vhost) || result)
 		return result;
 
-	snprintf(realbuf, sizeof realbuf, "%s!%s@%s", u->nick, u->user, u->host);
-	/* will be nick!user@ if ip unknown, doesn't matter */
-	snprintf(ipbuf, sizeof ipbuf, "%s!%s@%s", u->nick, u->user, u->ip);
+	return !match(mask, um->form[USER_MASK_HOST]) || !match(mask, um->form[USER_MASK_IP]) ||
+		(ircd->flags & IRCD_CIDR_BANS && !match_cidr(mask, um->form[USER_MASK_IP]));
+}
 
-	return !match(mask, realbuf) || !match(mask, ipbuf) || (ircd->flags & IRCD_CIDR_BANS && !match_cidr(mask, ipbuf));
+/*
+ * matcher_matches_user(struct mask_matcher *mm, const char *mask, struct user *u)
+ *
+ * Same as mask_matches_user(mask, u), but for a mask that is compiled in mm,
+ * which lets most non-matching masks be rejected by looking for their literal
+ * parts in the user's cached mask forms.
+ *
+ * Inputs:
+ *     - matcher of the mask, compiled or not
+ *     - the mask
+ *     - user to match
+ *
+ * Outputs:
+ *     - whether the mask matches the user
+ *
+ * Side Effects:
+ *     - the matcher is (re)compiled if needed
+ */
+bool
+matcher_matches_user(struct mask_matcher *mm, const char *mask, struct user *u)
+{
+	if (mask_matches_user != &generic_mask_matches_user)
+		return mask_matches_user(mask, u);
+
+	const struct user_masks *const um = user_get_masks(u);
+
+	if (mm->pattern == NULL)
+		mask_matcher_compile(mm, mask);
+
+	// identical strings give identical forms, which need not be matched twice
+	if (!match_compiled(mm->pattern, um->form[USER_MASK_VHOST]))
+		return true;
+	if (u->chost != u->vhost && !match_compiled(mm->pattern, um->form[USER_MASK_CHOST]))
+		return true;
+
+	if (!config_options.masks_through_vhost && u->host != u->vhost)
+		return false;
+
+	if (u->host != u->vhost && u->host != u->chost && !match_compiled(mm->pattern, um->form[USER_MASK_HOST]))
+		return true;
+	if (!match_compiled(mm->pattern, um->form[USER_MASK_IP]))
+		return true;
 
+	// what match_cidr() does, without parsing either address again
+	return (ircd->flags & IRCD_CIDR_BANS) && mm->cidr_bits != 0 && um->addr_valid &&
+		cidr_match(&mm->cidr_addr, mm->cidr_bits, &um->addr) && !match(mm->cidr_nickuser, um->nickuser);
 }
 
 mowgli_node_t *
@@ -368,7 +413,7 @@ generic_next_matching_ban(struct channel *c, struct user *u, int type, mowgli_no
 	{
 		struct chanban *cb = n->data;
 
-		if (cb->type == type && mask_matches_user(cb->mask, u))
+		if (cb->type == type && matcher_matches_user(&cb->matcher, cb->mask, u))
 			return n;
 	}
 	return NULL;
@@ -385,7 +430,7 @@ generic_next_matching_host_chanacs(struct mychan *mc, struct user *u, mowgli_nod
 
 		if (ca->entity != NULL)
 		       continue;
-		if (mask_matches_user(ca->host, u))
+		if (matcher_matches_user(&ca->matcher, ca->host, u))
 			return n;
 	}
 	return NULL;
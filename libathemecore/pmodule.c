@@ -17,6 +17,7 @@
 #include "internal.h"
 
 mowgli_patricia_t *pcommands;
+struct pcommand_burst pcommand_burst;
 
 mowgli_heap_t *pcommand_heap;
 mowgli_heap_t *messagetree_heap;
@@ -60,6 +61,8 @@ pcommand_add(const char *token, void (*handler) (struct sourceinfo *si, int parc
 	pcmd->handler = handler;
 	pcmd->minparc = minparc;
 	pcmd->sourcetype = sourcetype;
+	pcmd->stats.handler.name = pcmd->token;
+	pcmd->burst.handler.name = pcmd->token;
 
 	mowgli_patricia_add(pcommands, pcmd->token, pcmd);
 }
@@ -88,6 +91,177 @@ pcommand_find(const char *token)
 	return mowgli_patricia_retrieve(pcommands, token);
 }
 
+static void
+pcommand_stats_record(struct pcommand_stats *const restrict ps, const uint64_t ns, const size_t len,
+                      const uint64_t hook_ns)
+{
+	(void) profile_counter_record(&ps->handler, ns);
+
+	ps->bytes += len;
+	ps->hook_ns += hook_ns;
+}
+
+static void
+pcommand_stats_clear(struct pcommand_stats *const restrict ps)
+{
+	(void) profile_counter_reset(&ps->handler);
+
+	ps->bytes = 0;
+	ps->hook_ns = 0;
+}
+
+static void
+pcommand_burst_end(void)
+{
+	struct proto_cmd **pcmds;
+
+	pcommand_burst.wall_ns = profile_time_ns() - pcommand_burst.start_ns;
+
+	(void) slog(LG_INFO, "burst: %" PRIu64 " messages (%" PRIu64 " bytes) in %" PRIu64 " ms; %" PRIu64 " ms in "
+	                     "protocol handlers, of which %" PRIu64 " ms in hooks",
+	                     pcommand_burst.messages, pcommand_burst.bytes, pcommand_burst.wall_ns / UINT64_C(1000000),
+	                     pcommand_burst.handler_ns / UINT64_C(1000000), pcommand_burst.hook_ns / UINT64_C(1000000));
+
+	const size_t count = pcommand_stats_sorted(&pcmds, true);
+
+	// The five most expensive message types are usually all there is to see
+	for (size_t i = 0; i < count && i < 5U; i++)
+	{
+		const struct pcommand_stats *const ps = &pcmds[i]->burst;
+
+		(void) slog(LG_INFO, "burst:   %-10s %10" PRIu64 " messages %12" PRIu64 " bytes %8" PRIu64 " ms "
+		                     "(%" PRIu64 " ms in hooks)", pcmds[i]->token, ps->handler.calls, ps->bytes,
+		                     ps->handler.total_ns / UINT64_C(1000000), ps->hook_ns / UINT64_C(1000000));
+	}
+
+	(void) sfree(pcmds);
+}
+
+/* pcommand_exec()
+ *
+ * Runs the handler of a protocol message, accounting the message, its length
+ * and the time spent in the handler and in hooks to the message type; while
+ * bursting, this is also accounted to the burst.
+ *
+ * Inputs:
+ *       the protocol command, the source and parameters of the message, and
+ *       the length of the line it was parsed from
+ *
+ * Outputs:
+ *       none
+ *
+ * Side Effects:
+ *       the handler is called; if it ends the burst, the burst statistics are
+ *       logged
+ */
+void
+pcommand_exec(struct proto_cmd *const restrict pcmd, struct sourceinfo *const restrict si, const int parc,
+              char *parv[], const size_t len)
+{
+	if (! pcmd->handler)
+		return;
+
+	const bool bursting = me.bursting;
+
+	hook_profile = true;
+	hook_profile_ns = 0;
+
+	const uint64_t start_ns = profile_time_ns();
+	pcmd->handler(si, parc, parv);
+	const uint64_t ns = profile_time_ns() - start_ns;
+
+	hook_profile = false;
+
+	(void) pcommand_stats_record(&pcmd->stats, ns, len, hook_profile_ns);
+
+	if (! bursting)
+		return;
+
+	(void) pcommand_stats_record(&pcmd->burst, ns, len, hook_profile_ns);
+
+	pcommand_burst.messages++;
+	pcommand_burst.bytes += len;
+	pcommand_burst.handler_ns += ns;
+	pcommand_burst.hook_ns += hook_profile_ns;
+
+	if (! me.bursting)
+		(void) pcommand_burst_end();
+}
+
+/* Called when the connection to the uplink has been established; the burst
+ * lasts until the protocol module clears me.bursting at end of burst.
+ */
+void
+pcommand_burst_begin(void)
+{
+	mowgli_patricia_iteration_state_t state;
+	struct proto_cmd *pcmd;
+
+	MOWGLI_PATRICIA_FOREACH(pcmd, &state, pcommands)
+		(void) pcommand_stats_clear(&pcmd->burst);
+
+	(void) memset(&pcommand_burst, 0x00, sizeof pcommand_burst);
+
+	pcommand_burst.start = CURRTIME;
+	pcommand_burst.start_ns = profile_time_ns();
+}
+
+void
+pcommand_stats_reset(void)
+{
+	mowgli_patricia_iteration_state_t state;
+	struct proto_cmd *pcmd;
+
+	MOWGLI_PATRICIA_FOREACH(pcmd, &state, pcommands)
+		(void) pcommand_stats_clear(&pcmd->stats);
+}
+
+static int
+pcommand_cmp_total(const void *const restrict a, const void *const restrict b)
+{
+	const struct proto_cmd *const pa = *((const struct proto_cmd *const *) a);
+	const struct proto_cmd *const pb = *((const struct proto_cmd *const *) b);
+
+	if (pa->stats.handler.total_ns != pb->stats.handler.total_ns)
+		return (pa->stats.handler.total_ns < pb->stats.handler.total_ns) ? 1 : -1;
+
+	return strcmp(pa->token, pb->token);
+}
+
+static int
+pcommand_cmp_burst(const void *const restrict a, const void *const restrict b)
+{
+	const struct proto_cmd *const pa = *((const struct proto_cmd *const *) a);
+	const struct proto_cmd *const pb = *((const struct proto_cmd *const *) b);
+
+	if (pa->burst.handler.total_ns != pb->burst.handler.total_ns)
+		return (pa->burst.handler.total_ns < pb->burst.handler.total_ns) ? 1 : -1;
+
+	return strcmp(pa->token, pb->token);
+}
+
+/* Collects the protocol commands that have handled at least one message
+ * (overall, or during the last burst), most expensive first. The array
+ * must be freed with sfree().
+ */
+size_t
+pcommand_stats_sorted(struct proto_cmd ***const restrict out, const bool burst)
+{
+	mowgli_patricia_iteration_state_t state;
+	struct proto_cmd *pcmd;
+	size_t count = 0;
+
+	*out = smalloc(sizeof **out * (mowgli_patricia_size(pcommands) + 1U));
+
+	MOWGLI_PATRICIA_FOREACH(pcmd, &state, pcommands)
+		if ((burst ? pcmd->burst.handler.calls : pcmd->stats.handler.calls) != 0)
+			(*out)[count++] = pcmd;
+
+	(void) qsort(*out, count, sizeof **out, burst ? &pcommand_cmp_burst : &pcommand_cmp_total);
+
+	return count;
+}
+
 /* vim:cinoptions=>s,e0,n0,f0,{0,}0,^0,=s,ps,t0,c3,+s,(2s,us,)20,*30,gs,hs
  * vim:ts=8
  * vim:sw=8
@@ -0,0 +1,387 @@
+/*
+ * SPDX-License-Identifier: ISC
+ * SPDX-URL: https://spdx.org/licenses/ISC.html
+ *
+ * Copyright (C) 2026 Atheme Development Group (https://atheme.github.io/)
+ *
+ * Permission to use, copy, modify, and/or distribute this software for any
+ * purpose with or without fee is hereby granted, provided that the above
+ * copyright notice and this permission notice appear in all copies.
+ *
+ * atheme-services: A collection of minimalist IRC services
+ * profile.c: Run-time profiling counters and event loop instrumentation
+ */
+
+#include <atheme.h>
+#include "internal.h"
+
+/* A timer whose callback has been redirected through eventloop_timer_trampoline()
+ * so that it can be timed; the original callback and argument are kept here.
+ * Hooks are freed once their timer has disappeared from the event loop.
+ */
+struct eventloop_timer_hook
+{
+	mowgli_node_t                   node;
+	mowgli_eventloop_timer_t *      timer;
+	mowgli_event_dispatch_func_t *  func;
+	void *                          arg;
+	bool                            seen;
+};
+
+struct eventloop_stats eventloop_stats;
+mowgli_patricia_t *eventloop_timer_stats = NULL;
+mowgli_patricia_t *eventloop_io_stats = NULL;
+
+static mowgli_heap_t *eventloop_timer_hook_heap = NULL;
+static mowgli_list_t eventloop_timer_hooks;
+static uint64_t eventloop_busy_ns = 0;
+static unsigned int eventloop_callbacks = 0;
+
+uint64_t
+profile_time_ns(void)
+{
+	struct timespec ts;
+
+#ifdef CLOCK_MONOTONIC
+	(void) clock_gettime(CLOCK_MONOTONIC, &ts);
+#else
+	(void) clock_gettime(CLOCK_REALTIME, &ts);
+#endif
+
+	return (((uint64_t) ts.tv_sec) * UINT64_C(1000000000)) + ((uint64_t) ts.tv_nsec);
+}
+
+unsigned int
+profile_hist_bucket(const uint64_t ns)
+{
+	uint64_t us = ns / 1000U;
+	unsigned int bucket = 0;
+
+	while (us > 1U && bucket < (PROFILE_HIST_BUCKETS - 1U))
+	{
+		us >>= 1;
+		bucket++;
+	}
+
+	return bucket;
+}
+
+/* Returns the exclusive upper bound of a histogram bucket in microseconds,
+ * or 0 for the last bucket, which is unbounded.
+ */
+uint64_t
+profile_hist_bucket_limit_us(const unsigned int bucket)
+{
+	if (bucket >= (PROFILE_HIST_BUCKETS - 1U))
+		return 0;
+
+	return UINT64_C(2) << bucket;
+}
+
+/* Returns the upper bound (in microseconds) of the bucket containing the
+ * requested percentile, which is as precise as a log-bucketed histogram can
+ * be. The last bucket is unbounded, so the maximum is returned for it.
+ */
+uint64_t
+profile_hist_percentile_us(const struct profile_counter *const restrict pc, const unsigned int percent)
+{
+	return_val_if_fail(pc != NULL, 0);
+
+	if (! pc->calls)
+		return 0;
+
+	const uint64_t want = ((pc->calls * percent) + 99U) / 100U;
+	uint64_t seen = 0;
+
+	for (unsigned int i = 0; i < PROFILE_HIST_BUCKETS; i++)
+	{
+		seen += pc->hist[i];
+
+		if (seen >= want && profile_hist_bucket_limit_us(i))
+			return profile_hist_bucket_limit_us(i);
+
+		if (seen >= want)
+			break;
+	}
+
+	return pc->max_ns / 1000U;
+}
+
+void
+profile_counter_record(struct profile_counter *const restrict pc, const uint64_t ns)
+{
+	pc->calls++;
+	pc->total_ns += ns;
+	pc->hist[profile_hist_bucket(ns)]++;
+
+	if (ns > pc->max_ns)
+		pc->max_ns = ns;
+}
+
+void
+profile_counter_reset(struct profile_counter *const restrict pc)
+{
+	char *const name = pc->name;
+
+	(void) memset(pc, 0x00, sizeof *pc);
+
+	pc->name = name;
+}
+
+/* profile_counter_get()
+ *
+ * Finds the counter for a name in a table of counters, creating it if it
+ * does not exist yet.
+ *
+ * Inputs:
+ *       table to search and the name of the counter
+ *
+ * Outputs:
+ *       the counter
+ *
+ * Side Effects:
+ *       a zeroed counter is added to the table if none existed
+ */
+struct profile_counter *
+profile_counter_get(mowgli_patricia_t *const restrict table, const char *const restrict name)
+{
+	struct profile_counter *pc;
+
+	if ((pc = mowgli_patricia_retrieve(table, name)) != NULL)
+		return pc;
+
+	pc = smalloc(sizeof *pc);
+	pc->name = sstrdup(name);
+
+	(void) mowgli_patricia_add(table, pc->name, pc);
+
+	return pc;
+}
+
+void
+profile_table_reset(mowgli_patricia_t *const restrict table)
+{
+	mowgli_patricia_iteration_state_t state;
+	struct profile_counter *pc;
+
+	MOWGLI_PATRICIA_FOREACH(pc, &state, table)
+		(void) profile_counter_reset(pc);
+}
+
+static int
+profile_counter_cmp_total(const void *const restrict a, const void *const restrict b)
+{
+	const struct profile_counter *const pa = *((const struct profile_counter *const *) a);
+	const struct profile_counter *const pb = *((const struct profile_counter *const *) b);
+
+	if (pa->total_ns != pb->total_ns)
+		return (pa->total_ns < pb->total_ns) ? 1 : -1;
+
+	return strcmp(pa->name, pb->name);
+}
+
+/* profile_table_sorted()
+ *
+ * Collects the counters of a table that have recorded at least one call,
+ * most expensive (by cumulative time) first.
+ *
+ * Inputs:
+ *       table of counters, and where to store the array
+ *
+ * Outputs:
+ *       the number of counters in the array, which must be freed with sfree()
+ *
+ * Side Effects:
+ *       none
+ */
+size_t
+profile_table_sorted(mowgli_patricia_t *const restrict table, struct profile_counter ***const restrict out)
+{
+	mowgli_patricia_iteration_state_t state;
+	struct profile_counter *pc;
+	size_t count = 0;
+
+	*out = smalloc(sizeof **out * (mowgli_patricia_size(table) + 1U));
+
+	MOWGLI_PATRICIA_FOREACH(pc, &state, table)
+		if (pc->calls)
+			(*out)[count++] = pc;
+
+	(void) qsort(*out, count, sizeof **out, &profile_counter_cmp_total);
+
+	return count;
+}
+
+static void
+profile_counter_destroy(const char ATHEME_VATTR_UNUSED *const restrict key, void *const restrict data,
+                        void ATHEME_VATTR_UNUSED *const restrict privdata)
+{
+	struct profile_counter *const pc = data;
+
+	(void) sfree(pc->name);
+	(void) sfree(pc);
+}
+
+void
+profile_table_destroy(mowgli_patricia_t *const restrict table)
+{
+	(void) mowgli_patricia_destroy(table, &profile_counter_destroy, NULL);
+}
+
+/* Called after every timed callback; charges the time to the named counter
+ * and reports it if it ran for longer than general::stall_threshold.
+ */
+void
+eventloop_callback_done(mowgli_patricia_t *const restrict table, const char *const restrict name,
+                        const uint64_t start_ns)
+{
+	const uint64_t ns = profile_time_ns() - start_ns;
+
+	(void) profile_counter_record(profile_counter_get(table, name), ns);
+
+	eventloop_busy_ns += ns;
+	eventloop_callbacks++;
+
+	if (! config_options.stall_threshold || ns < (config_options.stall_threshold * UINT64_C(1000000)))
+		return;
+
+	struct eventloop_stall *const ls = &eventloop_stats.last_stall;
+
+	(void) mowgli_strlcpy(ls->culprit, name, sizeof ls->culprit);
+	ls->duration_ns = ns;
+	ls->when = CURRTIME;
+
+	if (ns > eventloop_stats.worst_stall.duration_ns)
+		eventloop_stats.worst_stall = *ls;
+
+	eventloop_stats.stalls++;
+
+	(void) slog(LG_INFO, "eventloop: %s %s blocked the event loop for %" PRIu64 " ms",
+	            (table == eventloop_timer_stats) ? "timer" : "I/O callback", name, ns / UINT64_C(1000000));
+}
+
+static void
+eventloop_timer_trampoline(void *const restrict arg)
+{
+	const struct eventloop_timer_hook *const hook = arg;
+
+	// The callback may destroy its own timer, so copy everything we need first
+	mowgli_event_dispatch_func_t *const func = hook->func;
+	void *const func_arg = hook->arg;
+	const char *const name = (hook->timer->name != NULL) ? hook->timer->name : "<unnamed>";
+	const uint64_t start_ns = profile_time_ns();
+
+	(void) func(func_arg);
+	(void) eventloop_callback_done(eventloop_timer_stats, name, start_ns);
+}
+
+/* eventloop_hook_timers()
+ *
+ * Redirects every timer registered with mowgli_timer_add() (or its _once
+ * variant) through a trampoline that times it, and forgets about timers
+ * that have been destroyed since the last call. Timers are owned by the
+ * event loop and may be created or destroyed by any callback, so this is
+ * done once per event loop iteration; it only walks the timer list.
+ *
+ * Inputs:
+ *       none
+ *
+ * Outputs:
+ *       none
+ *
+ * Side Effects:
+ *       the func and arg members of new timers are replaced
+ */
+void
+eventloop_hook_timers(void)
+{
+	mowgli_node_t *n, *tn;
+
+	MOWGLI_ITER_FOREACH(n, eventloop_timer_hooks.head)
+		((struct eventloop_timer_hook *) n->data)->seen = false;
+
+	MOWGLI_ITER_FOREACH(n, base_eventloop->timer_list.head)
+	{
+		mowgli_eventloop_timer_t *const timer = n->data;
+
+		if (timer->func == &eventloop_timer_trampoline)
+		{
+			((struct eventloop_timer_hook *) timer->arg)->seen = true;
+			continue;
+		}
+
+		struct eventloop_timer_hook *const hook = mowgli_heap_alloc(eventloop_timer_hook_heap);
+
+		hook->timer = timer;
+		hook->func = timer->func;
+		hook->arg = timer->arg;
+		hook->seen = true;
+
+		timer->func = &eventloop_timer_trampoline;
+		timer->arg = hook;
+
+		(void) mowgli_node_add(hook, &hook->node, &eventloop_timer_hooks);
+	}
+
+	MOWGLI_ITER_FOREACH_SAFE(n, tn, eventloop_timer_hooks.head)
+	{
+		struct eventloop_timer_hook *const hook = n->data;
+
+		if (hook->seen)
+			continue;
+
+		(void) mowgli_node_delete(&hook->node, &eventloop_timer_hooks);
+		(void) mowgli_heap_free(eventloop_timer_hook_heap, hook);
+	}
+}
+
+void
+eventloop_iteration_begin(void)
+{
+	eventloop_busy_ns = 0;
+	eventloop_callbacks = 0;
+}
+
+void
+eventloop_iteration_end(void)
+{
+	if (! eventloop_callbacks)
+	{
+		eventloop_stats.idle_iterations++;
+		return;
+	}
+
+	(void) profile_counter_record(&eventloop_stats.iteration, eventloop_busy_ns);
+}
+
+void
+eventloop_stats_reset(void)
+{
+	(void) profile_counter_reset(&eventloop_stats.iteration);
+
+	eventloop_stats.idle_iterations = 0;
+	eventloop_stats.stalls = 0;
+	eventloop_stats.since = CURRTIME;
+
+	(void) memset(&eventloop_stats.last_stall, 0x00, sizeof eventloop_stats.last_stall);
+	(void) memset(&eventloop_stats.worst_stall, 0x00, sizeof eventloop_stats.worst_stall);
+
+	(void) profile_table_reset(eventloop_timer_stats);
+	(void) profile_table_reset(eventloop_io_stats);
+}
+
+void
+eventloop_stats_init(void)
+{
+	if (! (eventloop_timer_hook_heap = sharedheap_get(sizeof(struct eventloop_timer_hook))))
+	{
+		(void) slog(LG_ERROR, "%s: block allocator failed", MOWGLI_FUNC_NAME);
+		exit(EXIT_FAILURE);
+	}
+
+	eventloop_timer_stats = mowgli_patricia_create(&noopcanon);
+	eventloop_io_stats = mowgli_patricia_create(&noopcanon);
+
+	eventloop_stats.iteration.name = sstrdup("iteration");
+	eventloop_stats.since = CURRTIME;
+}
@@ -101,6 +101,13 @@ dictionary_stats_cb(const char *line, void *privdata)
 	numeric_sts(me.me, 249, ((struct user *)privdata), "B :%s", line);
 }
 
+static void
+sendq_class_stats_cb(const char *name, const struct sendq_queue *queue, void *privdata)
+{
+	numeric_sts(me.me, 249, ((struct user *)privdata), "Y :sendq %-11s %8zu bytes queued %12" PRIu64 " bytes sent",
+			name, queue->length, queue->sent);
+}
+
 static void
 connection_stats_cb(const char *line, void *privdata)
 {
@@ -136,6 +143,13 @@ handle_stats(struct user *u, char req)
 		  myentity_stats(dictionary_stats_cb, u);
 		  mowgli_patricia_stats(nicklist, dictionary_stats_cb, u);
 		  mowgli_patricia_stats(mclist, dictionary_stats_cb, u);
+		  hashmap_stats(userlist_index, "users", dictionary_stats_cb, u);
+		  hashmap_stats(uidlist_index, "UIDs", dictionary_stats_cb, u);
+		  uid_directory_stats(dictionary_stats_cb, u);
+		  hashmap_stats(chanlist_index, "channels", dictionary_stats_cb, u);
+		  hashmap_stats(servlist_index, "servers", dictionary_stats_cb, u);
+		  hashmap_stats(nicklist_index, "nicks", dictionary_stats_cb, u);
+		  hashmap_stats(mclist_index, "registered channels", dictionary_stats_cb, u);
 		  break;
 
 	  case 'C':
@@ -337,6 +351,8 @@ handle_stats(struct user *u, char req)
 
 		  numeric_sts(me.me, 218, u, "Y uplink 300 %u 1 %u 0.0 0.0 1",
 				  me.recontime, config_options.uplink_sendq_limit);
+		  if (curr_uplink != NULL && curr_uplink->conn != NULL)
+			  sendq_stats(curr_uplink->conn, sendq_class_stats_cb, u);
 		  break;
 
 	  default:
@@ -506,6 +522,9 @@ handle_channel_message(struct sourceinfo *si, char *target, bool is_notice, char
 	mowgli_node_t *n, *tn;
 	mowgli_list_t l = { NULL, NULL, 0 };
 	struct service *svs;
+	struct chanuser_iter iter;
+	struct chanuser *cu;
+	unsigned int svcseen = 0;
 
 	/* Call hook here */
 	cdata.u = si->su;
@@ -522,13 +541,17 @@ handle_channel_message(struct sourceinfo *si, char *target, bool is_notice, char
 	vec[1] = message;
 	vec[2] = NULL;
 
-	MOWGLI_ITER_FOREACH(n, cdata.c->members.head)
+	CHANNEL_MEMBER_FOREACH(cu, &iter, cdata.c)
 	{
-		struct chanuser *cu = (struct chanuser *) n->data;
+		/* no need to look at the rest of a large channel */
+		if (svcseen == cdata.c->numsvcmembers)
+			break;
 
 		if (!is_internal_client(cu->user))
 			continue;
 
+		svcseen++;
+
 		svs = service_find_nick(cu->user->nick);
 
 		if (svs == NULL)
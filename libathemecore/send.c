@@ -15,6 +15,38 @@
 #include <atheme.h>
 #include "internal.h"
 
+static enum sendq_class sts_class = SENDQ_CONTROL;
+
+/*
+ * sts_set_class(enum sendq_class cls)
+ *
+ * Sets the sendq class that sts() queues lines in from now on. Lines in
+ * different classes may be sent to the uplink in a different order than
+ * they were queued in, so only output that does not depend on anything sent
+ * before it (e.g. notices, network bans or SASL replies) should leave the
+ * default class, SENDQ_CONTROL.
+ *
+ * Inputs:
+ *       - the class to use
+ *
+ * Outputs:
+ *       - the class that was used before, to be restored when done
+ *
+ * Side Effects:
+ *       - none
+ */
+enum sendq_class
+sts_set_class(enum sendq_class cls)
+{
+	const enum sendq_class prev = sts_class;
+
+	return_val_if_fail(cls < SENDQ_CLASS_COUNT, prev);
+
+	sts_class = cls;
+
+	return prev;
+}
+
 /* send a line to the server, append the \r\n */
 int ATHEME_FATTR_PRINTF(1, 2)
 sts(const char *fmt, ...)
@@ -41,7 +73,7 @@ sts(const char *fmt, ...)
 
 	cnt.bout += len;
 
-	sendq_add(curr_uplink->conn, buf, len);
+	sendq_add_class(curr_uplink->conn, sts_class, buf, len);
 
 	slog(LG_RAWDATA, "<- %.*s", len, buf);
 
@@ -58,7 +90,8 @@ sts(const char *fmt, ...)
  *       none
  *
  * side effects:
- *       everything happens inside this loop.
+ *       everything happens inside this loop; the time spent in timer and
+ *       I/O callbacks is accounted in eventloop_stats.
  */
 void
 io_loop(void)
@@ -66,7 +99,10 @@ io_loop(void)
 	while (!(runflags & (RF_SHUTDOWN | RF_RESTART)))
 	{
 		CURRTIME = mowgli_eventloop_get_time(base_eventloop);
+		eventloop_hook_timers();
+		eventloop_iteration_begin();
 		mowgli_eventloop_run_once(base_eventloop);
+		eventloop_iteration_end();
 		check_signals();
 	}
 }
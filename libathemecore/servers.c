@@ -19,10 +19,12 @@
 static void server_delete_serv(struct server *s);
 
 static mowgli_patricia_t *sidlist = NULL;
+static struct hashmap *sidlist_index = NULL;
 static mowgli_heap_t *serv_heap = NULL;
 static mowgli_heap_t *tld_heap = NULL;
 
 mowgli_patricia_t *servlist;
+struct hashmap *servlist_index;
 mowgli_list_t tldlist;
 
 /*
@@ -54,6 +56,8 @@ init_servers(void)
 
 	servlist = mowgli_patricia_create(irccasecanon);
 	sidlist = mowgli_patricia_create(noopcanon);
+	servlist_index = hashmap_create(true);
+	sidlist_index = hashmap_create(false);
 }
 
 /*
@@ -104,6 +108,8 @@ server_add(const char *name, unsigned int hops, struct server *uplink, const cha
 	{
 		s->sid = sstrdup(id);
 		mowgli_patricia_add(sidlist, s->sid, s);
+		hashmap_add(sidlist_index, s->sid, s);
+		uid_directory_add_server(s);
 	}
 
 	/* check to see if it's hidden */
@@ -121,7 +127,10 @@ server_add(const char *name, unsigned int hops, struct server *uplink, const cha
 	s->connected_since = CURRTIME;
 
 	if (name != NULL)
+	{
 		mowgli_patricia_add(servlist, s->name, s);
+		hashmap_add(servlist_index, s->name, s);
+	}
 	else
 		s->flags |= SF_MASKED;
 
@@ -160,6 +169,7 @@ server_add(const char *name, unsigned int hops, struct server *uplink, const cha
  *
  * Side Effects:
  *     - all users and servers attached to the target are recursively deleted
+ *     - the users are deleted together with user_delete_batch() (q.v.)
  */
 void
 server_delete(const char *name)
@@ -176,58 +186,50 @@ server_delete(const char *name)
 }
 
 static void
-server_delete_serv(struct server *s)
+server_count_tree(struct server *s, size_t *nservers, size_t *nusers)
 {
-	struct server *child;
-	struct user *u;
-	mowgli_node_t *n, *tn;
+	mowgli_node_t *n;
 
-	if (s == me.me)
-	{
-		/* Deleting this would cause confusion, so let's not do it.
-		 * Some ircds send SQUIT <myname> when atheme is squitted.
-		 * -- jilles
-		 */
-		slog(LG_DEBUG, "server_delete(): tried to delete myself");
-		return;
-	}
+	(*nservers)++;
+	*nusers += MOWGLI_LIST_LENGTH(&s->userlist);
 
-	if (s->sid)
-		slog(me.connected ? LG_NETWORK : LG_DEBUG, "server_delete(): %s (%s), uplink %s (%u users)",
-				s->name, s->sid,
-				s->uplink != NULL ? s->uplink->name : "<none>",
-				s->users);
-	else
-		slog(me.connected ? LG_NETWORK : LG_DEBUG, "server_delete(): %s, uplink %s (%u users)",
-				s->name, s->uplink != NULL ? s->uplink->name : "<none>",
-				s->users);
+	MOWGLI_ITER_FOREACH(n, s->children.head)
+		server_count_tree(n->data, nservers, nusers);
+}
 
-	hook_call_server_delete((&(struct hook_server_delete){ .s = s }));
+/* parents are always collected before their children */
+static void
+server_collect_tree(struct server *s, struct server **servers, size_t *nservers, struct user **users, size_t *nusers)
+{
+	mowgli_node_t *n;
 
-	/* first go through it's users and kill all of them */
-	MOWGLI_ITER_FOREACH_SAFE(n, tn, s->userlist.head)
-	{
-		u = (struct user *)n->data;
-		/* This user split, allow bursted logins for the account.
-		 * XXX should we do this here?
-		 * -- jilles */
-		if (u->myuser != NULL)
-			u->myuser->flags &= ~MU_NOBURSTLOGIN;
-		user_delete(u, "*.net *.split");
-	}
+	servers[(*nservers)++] = s;
 
-	MOWGLI_ITER_FOREACH_SAFE(n, tn, s->children.head)
-	{
-		child = n->data;
-		server_delete_serv(child);
-	}
+	MOWGLI_ITER_FOREACH(n, s->userlist.head)
+		users[(*nusers)++] = n->data;
+
+	MOWGLI_ITER_FOREACH(n, s->children.head)
+		server_collect_tree(n->data, servers, nservers, users, nusers);
+}
+
+static void
+server_free(struct server *s)
+{
+	mowgli_node_t *n;
 
 	/* now remove the server */
 	if (!(s->flags & SF_MASKED))
+	{
 		mowgli_patricia_delete(servlist, s->name);
+		hashmap_delete(servlist_index, s->name);
+	}
 
 	if (s->sid)
+	{
 		mowgli_patricia_delete(sidlist, s->sid);
+		hashmap_delete(sidlist_index, s->sid);
+		uid_directory_delete_server(s);
+	}
 
 	if (s->uplink)
 	{
@@ -251,6 +253,76 @@ server_delete_serv(struct server *s)
 	cnt.server--;
 }
 
+/* A server and everything behind it leave at once, so the whole subtree is
+ * collected first: the server_delete hook is called for every server, the
+ * users are removed together with user_delete_batch() (which visits each
+ * of their channels once, rather than once per membership), and finally
+ * the servers are freed, children before their parents.
+ */
+static void
+server_delete_serv(struct server *s)
+{
+	struct server **servers;
+	struct user **users;
+	struct server *sp;
+	struct user *u;
+	size_t nservers = 0, nusers = 0, i;
+
+	if (s == me.me)
+	{
+		/* Deleting this would cause confusion, so let's not do it.
+		 * Some ircds send SQUIT <myname> when atheme is squitted.
+		 * -- jilles
+		 */
+		slog(LG_DEBUG, "server_delete(): tried to delete myself");
+		return;
+	}
+
+	server_count_tree(s, &nservers, &nusers);
+
+	servers = smalloc(nservers * sizeof *servers);
+	users = smalloc((nusers + 1) * sizeof *users);
+	nservers = nusers = 0;
+
+	server_collect_tree(s, servers, &nservers, users, &nusers);
+
+	for (i = 0; i < nservers; i++)
+	{
+		sp = servers[i];
+
+		if (sp->sid)
+			slog(me.connected ? LG_NETWORK : LG_DEBUG, "server_delete(): %s (%s), uplink %s (%u users)",
+					sp->name, sp->sid,
+					sp->uplink != NULL ? sp->uplink->name : "<none>",
+					sp->users);
+		else
+			slog(me.connected ? LG_NETWORK : LG_DEBUG, "server_delete(): %s, uplink %s (%u users)",
+					sp->name, sp->uplink != NULL ? sp->uplink->name : "<none>",
+					sp->users);
+
+		hook_call_server_delete((&(struct hook_server_delete){ .s = sp }));
+	}
+
+	/* then go through their users and kill all of them */
+	for (i = 0; i < nusers; i++)
+	{
+		u = users[i];
+		/* This user split, allow bursted logins for the account.
+		 * XXX should we do this here?
+		 * -- jilles */
+		if (u->myuser != NULL)
+			u->myuser->flags &= ~MU_NOBURSTLOGIN;
+	}
+
+	user_delete_batch(users, nusers, "*.net *.split");
+
+	for (i = nservers; i > 0; i--)
+		server_free(servers[i - 1]);
+
+	sfree(servers);
+	sfree(users);
+}
+
 /*
  * server_find(const char *name)
  *
@@ -270,12 +342,14 @@ struct server *
 server_find(const char *name)
 {
 	struct server *s;
+	bool decoded;
 
-	s = mowgli_patricia_retrieve(sidlist, name);
+	if ((s = uid_directory_find_server(name, &decoded)) == NULL && ! decoded)
+		s = hashmap_retrieve(sidlist_index, name);
 	if (s != NULL)
 		return s;
 
-	return mowgli_patricia_retrieve(servlist, name);
+	return hashmap_retrieve(servlist_index, name);
 }
 
 /*
@@ -177,21 +177,36 @@ introduce_enforcer(const char *nick)
 	introduce_nick(u);
 }
 
-/* join a channel, creating it if necessary */
-void
-join(const char *chan, const char *nick)
+// Most channels joined with a single join_batch_sts() call
+#define JOIN_BATCH_MAX          64U
+
+struct join_request
+{
+	mowgli_node_t           node;
+	char *                  key;            // "nick channel", for join_queue_index
+	char *                  chan;
+	char *                  nick;
+	char *                  replace;        // service to part once nick is in (if any)
+	bool                    populated;      // in join_queue_populated
+};
+
+static mowgli_patricia_t *join_queue_index = NULL;
+static mowgli_list_t join_queue_populated;      // channels that had users in them when queued
+static mowgli_list_t join_queue_empty;
+static mowgli_eventloop_timer_t *join_queue_timer = NULL;
+
+/* find or create the channel a service is joining, or NULL if it is in
+ * there already */
+static struct channel *
+join_prepare(const char *chan, struct user *u, bool *isnew)
 {
 	struct channel *c;
-	struct user *u;
-	struct chanuser *cu;
-	bool isnew = false;
 	struct mychan *mc;
 	struct metadata *md;
 	time_t ts;
 
-	u = user_find_named(nick);
-	if (!u)
-		return;
+	*isnew = false;
+
 	c = channel_find(chan);
 	if (c == NULL)
 	{
@@ -214,14 +229,24 @@ join(const char *chan, const char *nick)
 		c->modes |= CMODE_NOEXT | CMODE_TOPIC;
 		if (mc != NULL)
 			check_modes(mc, false);
-		isnew = true;
+		*isnew = true;
 	}
 	else if (chanuser_find(c, u))
 	{
 		slog(LG_DEBUG, "join(): i'm already in `%s'", c->name);
-		return;
+		return NULL;
 	}
-	join_sts(c, u, isnew, channel_modes(c, true));
+
+	return c;
+}
+
+/* record a service in a channel once join_sts() or join_batch_sts() has
+ * been sent */
+static void
+join_finish(struct channel *c, struct user *u, bool isnew)
+{
+	struct chanuser *cu;
+
 	cu = chanuser_add(c, CLIENT_NAME(u));
 	cu->modes |= CSTATUS_OP;
 	if (isnew)
@@ -230,6 +255,209 @@ join(const char *chan, const char *nick)
 	}
 }
 
+/* join a channel, creating it if necessary */
+void
+join(const char *chan, const char *nick)
+{
+	struct channel *c;
+	struct user *u;
+	bool isnew;
+
+	u = user_find_named(nick);
+	if (!u)
+		return;
+	c = join_prepare(chan, u, &isnew);
+	if (c == NULL)
+		return;
+	join_sts(c, u, isnew, channel_modes(c, true));
+	join_finish(c, u, isnew);
+}
+
+static void
+join_request_free(struct join_request *req)
+{
+	mowgli_node_delete(&req->node, req->populated ? &join_queue_populated : &join_queue_empty);
+	mowgli_patricia_delete(join_queue_index, req->key);
+	sfree(req->key);
+	sfree(req->chan);
+	sfree(req->nick);
+	sfree(req->replace);
+	sfree(req);
+}
+
+/* Whether the uplink sendq is more than half full; work that sends a lot
+ * and can wait should wait for it to drain.
+ */
+bool
+uplink_congested(void)
+{
+	if (curr_uplink == NULL || curr_uplink->conn == NULL)
+		return true;
+
+	return sendq_length(curr_uplink->conn) > config_options.uplink_sendq_limit / 2;
+}
+
+static void
+join_batch_flush(struct user *u, struct channel **batch, size_t *count)
+{
+	if (*count == 0)
+		return;
+
+	join_batch_sts(u, batch, *count);
+	for (size_t i = 0; i < *count; i++)
+		join_finish(batch[i], u, true);
+	*count = 0;
+}
+
+static void
+join_queue_run(void *unused)
+{
+	struct channel *batch[JOIN_BATCH_MAX];
+	struct user *batch_user = NULL;
+	size_t batch_count = 0;
+	unsigned int budget = config_options.join_rate;
+
+	join_queue_timer = NULL;
+
+	while (me.connected && budget > 0 && !uplink_congested())
+	{
+		struct join_request *req;
+		struct channel *c;
+		struct user *u, *old;
+		bool isnew = false;
+
+		if (join_queue_populated.head != NULL)
+			req = join_queue_populated.head->data;
+		else if (join_queue_empty.head != NULL)
+			req = join_queue_empty.head->data;
+		else
+			break;
+
+		budget--;
+
+		u = user_find_named(req->nick);
+		c = (u != NULL) ? join_prepare(req->chan, u, &isnew) : NULL;
+
+		if (c != NULL && isnew)
+		{
+			/* nobody else is in a channel we have just created,
+			 * so there is nothing to replace */
+			if (batch_count == JOIN_BATCH_MAX || (batch_count > 0 && batch_user != u))
+				join_batch_flush(batch_user, batch, &batch_count);
+
+			batch_user = u;
+			batch[batch_count++] = c;
+		}
+		else if (c != NULL)
+		{
+			/* a channel in the batch may be joined by
+			 * another service next, so send the batch first */
+			join_batch_flush(batch_user, batch, &batch_count);
+
+			join_sts(c, u, false, channel_modes(c, true));
+			join_finish(c, u, false);
+		}
+		else if (u != NULL)
+		{
+			/* join_prepare() returns NULL if the service is in the
+			 * channel already, like a bot assigned to a channel it
+			 * was in; the one it replaces still has to go */
+			c = channel_find(req->chan);
+		}
+
+		if (c != NULL && !isnew && req->replace != NULL && (old = user_find_named(req->replace)) != NULL &&
+				old != u && chanuser_find(c, old))
+			part(c->name, old->nick);
+
+		join_request_free(req);
+	}
+
+	join_batch_flush(batch_user, batch, &batch_count);
+
+	if (join_queue_populated.head != NULL || join_queue_empty.head != NULL)
+		join_queue_timer = mowgli_timer_add_once(base_eventloop, "join_queue_run", join_queue_run, NULL, 1);
+}
+
+/*
+ * join_schedule(const char *chan, const char *nick, const char *replace)
+ *
+ * Queues a service to join a channel, creating it if necessary, like join().
+ * Queued joins are sent at most config_options.join_rate per second and not
+ * while the uplink sendq is more than half full, so that joining many
+ * channels at once does not flood the uplink. Channels that have users in
+ * them are joined before empty ones.
+ *
+ * Inputs:
+ *       - channel name
+ *       - nick of the service to join
+ *       - nick of a service to part once the first one has joined, or NULL
+ *
+ * Outputs:
+ *       - nothing
+ *
+ * Side Effects:
+ *       - a join already queued for the same service and channel is moved
+ *         ahead of the empty channels if the channel has users now
+ */
+void
+join_schedule(const char *chan, const char *nick, const char *replace)
+{
+	struct join_request *req;
+	struct channel *c;
+	char key[BUFSIZE];
+	bool populated;
+
+	return_if_fail(chan != NULL);
+	return_if_fail(nick != NULL);
+
+	c = channel_find(chan);
+	populated = c != NULL && c->nummembers > c->numsvcmembers;
+
+	if (join_queue_index == NULL)
+		join_queue_index = mowgli_patricia_create(irccasecanon);
+
+	snprintf(key, sizeof key, "%s %s", nick, chan);
+
+	if ((req = mowgli_patricia_retrieve(join_queue_index, key)) != NULL)
+	{
+		if (populated && !req->populated)
+		{
+			mowgli_node_delete(&req->node, &join_queue_empty);
+			mowgli_node_add(req, &req->node, &join_queue_populated);
+			req->populated = true;
+		}
+		return;
+	}
+
+	req = smalloc(sizeof *req);
+	req->key = sstrdup(key);
+	req->chan = sstrdup(chan);
+	req->nick = sstrdup(nick);
+	req->replace = (replace != NULL) ? sstrdup(replace) : NULL;
+	req->populated = populated;
+	mowgli_node_add(req, &req->node, populated ? &join_queue_populated : &join_queue_empty);
+	mowgli_patricia_add(join_queue_index, req->key, req);
+
+	if (join_queue_timer == NULL)
+		join_queue_timer = mowgli_timer_add_once(base_eventloop, "join_queue_run", join_queue_run, NULL, 0);
+}
+
+/* forget a queued join, e.g. because the service has been told to part */
+static void
+join_unschedule(const char *chan, const char *nick)
+{
+	struct join_request *req;
+	char key[BUFSIZE];
+
+	if (join_queue_index == NULL)
+		return;
+
+	snprintf(key, sizeof key, "%s %s", nick, chan);
+
+	if ((req = mowgli_patricia_retrieve(join_queue_index, key)) != NULL)
+		join_request_free(req);
+}
+
 /* part a channel */
 void
 part(const char *chan, const char *nick)
@@ -237,6 +465,8 @@ part(const char *chan, const char *nick)
 	struct channel *c = channel_find(chan);
 	struct user *u = user_find_named(nick);
 
+	join_unschedule(chan, nick);
+
 	if (!u || !c)
 		return;
 	if (!chanuser_find(c, u))
@@ -652,6 +882,7 @@ handle_certfp(struct sourceinfo *si, struct user *u, const char *certfp)
 	notice(svs->me->nick, u->nick, nicksvs.no_nick_ownership ? "You are now logged in as \2%s\2." : "You are now identified for \2%s\2.", entity(mu)->name);
 
 	myuser_login(svs, u, mu, true);
+	stats_login_count("CERTFP");
 	logcommand_user(svs, u, CMDLOG_LOGIN, "LOGIN via CERTFP (%s)", certfp);
 }
 
@@ -939,6 +1170,8 @@ command_fail(struct sourceinfo *si, enum cmd_faultcode code, const char *fmt, ..
 	va_list args;
 	char buf[BUFSIZE];
 
+	command_fail_count++;
+
 	va_start(args, fmt);
 	vsnprintf(buf, sizeof buf, fmt, args);
 	va_end(args);
@@ -1049,6 +1282,181 @@ command_success_table(struct sourceinfo *si, struct atheme_table *table)
 	table_render(table, command_table_cb, si);
 }
 
+/* Lines of streamed command output sent per stream and event loop turn */
+#define COMMAND_STREAM_CHUNK    100U
+
+struct command_stream
+{
+	mowgli_node_t           node;
+	struct sourceinfo *     si;
+	char **                 lines;
+	size_t                  count;
+	size_t                  alloc;
+	size_t                  next;           // first line not sent yet
+	bool                    deferred;
+};
+
+static mowgli_list_t command_streams;
+static mowgli_eventloop_timer_t *command_stream_timer = NULL;
+
+static void
+command_stream_free(struct command_stream *cs)
+{
+	for (size_t i = cs->next; i < cs->count; i++)
+		sfree(cs->lines[i]);
+
+	if (cs->deferred)
+		atheme_object_unref(cs->si);
+
+	sfree(cs->lines);
+	sfree(cs);
+}
+
+static void
+command_stream_run(void *unused)
+{
+	mowgli_node_t *n, *tn;
+	const enum sendq_class prev = sts_set_class(SENDQ_BULK);
+
+	command_stream_timer = NULL;
+
+	MOWGLI_ITER_FOREACH_SAFE(n, tn, command_streams.head)
+	{
+		struct command_stream *cs = n->data;
+
+		if (uplink_congested())
+			break;
+
+		// the account may have been dropped since the command ran
+		cs->si->smu = cs->si->su->myuser;
+
+		for (unsigned int i = 0; i < COMMAND_STREAM_CHUNK && cs->next < cs->count; i++)
+		{
+			command_success_nodata(cs->si, "%s", cs->lines[cs->next]);
+			sfree(cs->lines[cs->next++]);
+		}
+
+		if (cs->next < cs->count)
+			continue;
+
+		mowgli_node_delete(&cs->node, &command_streams);
+		command_stream_free(cs);
+	}
+
+	(void) sts_set_class(prev);
+
+	if (command_streams.head != NULL)
+		command_stream_timer = mowgli_timer_add_once(base_eventloop, "command_stream_run", command_stream_run,
+		                                             NULL, uplink_congested() ? 1 : 0);
+}
+
+/*
+ * command_stream_begin(struct sourceinfo *si)
+ *
+ * Starts the output of a command that may reply with a great many lines,
+ * such as a LIST. Lines added with command_stream_printf() to a stream for
+ * an IRC user are queued and sent COMMAND_STREAM_CHUNK at a time on later
+ * turns of the event loop, as bulk traffic and not while the uplink sendq
+ * is more than half full, so that the reply does not hold up the main loop
+ * or other traffic. For other sources they are sent at once.
+ *
+ * Inputs:
+ *       - the source of the command
+ *
+ * Outputs:
+ *       - a stream to add the lines of the reply to
+ *
+ * Side Effects:
+ *       - none until command_stream_end() is called
+ */
+struct command_stream *
+command_stream_begin(struct sourceinfo *si)
+{
+	struct command_stream *cs = smalloc(sizeof *cs);
+
+	cs->si = si;
+	cs->deferred = si->su != NULL && si->v == NULL;
+
+	if (cs->deferred)
+		atheme_object_ref(si);
+
+	return cs;
+}
+
+void ATHEME_FATTR_PRINTF(2, 3)
+command_stream_printf(struct command_stream *cs, const char *fmt, ...)
+{
+	va_list args;
+	char buf[BUFSIZE];
+
+	va_start(args, fmt);
+	vsnprintf(buf, sizeof buf, fmt, args);
+	va_end(args);
+
+	if (! cs->deferred)
+	{
+		command_success_nodata(cs->si, "%s", buf);
+		return;
+	}
+
+	if (cs->count == cs->alloc)
+	{
+		cs->alloc = cs->alloc ? cs->alloc * 2U : 64U;
+		cs->lines = srealloc(cs->lines, cs->alloc * sizeof *cs->lines);
+	}
+
+	cs->lines[cs->count++] = sstrdup(buf);
+}
+
+/*
+ * command_stream_end(struct command_stream *cs)
+ *
+ * Finishes a stream started by command_stream_begin(); its lines are sent
+ * from now on, and the stream is freed once they have all been sent.
+ *
+ * Inputs:
+ *       - the stream
+ *
+ * Outputs:
+ *       - nothing
+ *
+ * Side Effects:
+ *       - the stream must not be used any more
+ */
+void
+command_stream_end(struct command_stream *cs)
+{
+	if (cs->next == cs->count)
+	{
+		command_stream_free(cs);
+		return;
+	}
+
+	mowgli_node_add(cs, &cs->node, &command_streams);
+
+	if (command_stream_timer == NULL)
+		command_stream_timer = mowgli_timer_add_once(base_eventloop, "command_stream_run", command_stream_run,
+		                                             NULL, 0);
+}
+
+// Drops the output that is still queued for a user who is leaving
+void
+command_stream_user_delete(struct user *u)
+{
+	mowgli_node_t *n, *tn;
+
+	MOWGLI_ITER_FOREACH_SAFE(n, tn, command_streams.head)
+	{
+		struct command_stream *cs = n->data;
+
+		if (cs->si->su != u && cs->si->service->me != u)
+			continue;
+
+		mowgli_node_delete(&cs->node, &command_streams);
+		command_stream_free(cs);
+	}
+}
+
 const char *
 get_source_name(struct sourceinfo *si)
 {
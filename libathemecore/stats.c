@@ -0,0 +1,299 @@
+/*
+ * SPDX-License-Identifier: ISC
+ * SPDX-URL: https://spdx.org/licenses/ISC.html
+ *
+ * Copyright (C) 2020 Atheme Development Group (https://atheme.github.io/)
+ * Copyright (C) 2026 Atheme Development Group (https://atheme.github.io/)
+ *
+ * Permission to use, copy, modify, and/or distribute this software for any
+ * purpose with or without fee is hereby granted, provided that the above
+ * copyright notice and this permission notice appear in all copies.
+ *
+ * atheme-services: A collection of minimalist IRC services
+ * stats.c: Aggregate statistics maintained as objects change
+ */
+
+#include <atheme.h>
+#include "internal.h"
+
+#define SCANFMT_BASE64_CRYPT3       "%[" BASE64_ALPHABET_CRYPT3 "]"
+#define SCANFMT_BASE64_RFC4648      "%[" BASE64_ALPHABET_RFC4648 "]"
+#define SCANFMT_HEXADECIMAL         "%[A-Fa-f0-9]"
+
+#define SCANFMT_ANOPE_ENC_SHA256    "$anope$enc_sha256$" SCANFMT_BASE64_RFC4648 "$" SCANFMT_BASE64_RFC4648
+#define SCANFMT_ARGON2              "$%[A-Za-z0-9]$v=%u$m=%u,t=%u,p=%u$" SCANFMT_BASE64_RFC4648 "$" SCANFMT_BASE64_RFC4648
+#define SCANFMT_BASE64              "$base64$" SCANFMT_BASE64_RFC4648
+#define SCANFMT_BCRYPT              "$2%1[ab]$%2u$%22[" BASE64_ALPHABET_CRYPT3 "]%31[" BASE64_ALPHABET_CRYPT3 "]"
+#define SCANFMT_CRYPT3_DES          SCANFMT_BASE64_CRYPT3
+#define SCANFMT_CRYPT3_MD5          "$1$" SCANFMT_BASE64_CRYPT3 "$" SCANFMT_BASE64_CRYPT3
+#define SCANFMT_CRYPT3_SHA2_256     "$5$" SCANFMT_BASE64_CRYPT3 "$" SCANFMT_BASE64_CRYPT3
+#define SCANFMT_CRYPT3_SHA2_256_EXT "$5$rounds=%u$" SCANFMT_BASE64_CRYPT3 "$" SCANFMT_BASE64_CRYPT3
+#define SCANFMT_CRYPT3_SHA2_512     "$6$" SCANFMT_BASE64_CRYPT3 "$" SCANFMT_BASE64_CRYPT3
+#define SCANFMT_CRYPT3_SHA2_512_EXT "$6$rounds=%u$" SCANFMT_BASE64_CRYPT3 "$" SCANFMT_BASE64_CRYPT3
+#define SCANFMT_IRCSERVICES         "$ircservices$" SCANFMT_HEXADECIMAL
+#define SCANFMT_PBKDF2              "%16[A-Za-z0-9]%128[A-Fa-f0-9]"
+#define SCANFMT_PBKDF2V2_SCRAM      "$z$%u$%u$" SCANFMT_BASE64_RFC4648 "$" SCANFMT_BASE64_RFC4648 "$" SCANFMT_BASE64_RFC4648
+#define SCANFMT_PBKDF2V2_HMAC       "$z$%u$%u$" SCANFMT_BASE64_RFC4648 "$" SCANFMT_BASE64_RFC4648
+#define SCANFMT_RAWMD5              "$rawmd5$" SCANFMT_HEXADECIMAL
+#define SCANFMT_RAWSHA1             "$rawsha1$" SCANFMT_HEXADECIMAL
+#define SCANFMT_RAWSHA2_256         "$rawsha256$" SCANFMT_HEXADECIMAL
+#define SCANFMT_RAWSHA2_512         "$rawsha512$" SCANFMT_HEXADECIMAL
+#define SCANFMT_SCRYPT              "$scrypt$ln=%u,r=%u,p=%u$" SCANFMT_BASE64_CRYPT3 "$" SCANFMT_BASE64_CRYPT3
+
+#define HAS_PREFIX(str, prefix)     (strncmp((str), (prefix), sizeof (prefix) - 1U) == 0)
+
+struct stats_counters stats_counters;
+
+static const char *const pwhash_type_labels[PWHASH_TYPE_COUNT] = {
+	[PWHASH_NONE]                   = "none",
+	[PWHASH_UNKNOWN]                = "unknown",
+	[PWHASH_ANOPE_ENC_SHA256]       = "anope-enc-sha256",
+	[PWHASH_ARGON2D]                = "argon2d",
+	[PWHASH_ARGON2I]                = "argon2i",
+	[PWHASH_ARGON2ID]               = "argon2id",
+	[PWHASH_BASE64]                 = "base64",
+	[PWHASH_BCRYPT]                 = "bcrypt",
+	[PWHASH_CRYPT3_DES]             = "crypt3-des",
+	[PWHASH_CRYPT3_MD5]             = "crypt3-md5",
+	[PWHASH_CRYPT3_SHA2_256]        = "crypt3-sha2-256",
+	[PWHASH_CRYPT3_SHA2_512]        = "crypt3-sha2-512",
+	[PWHASH_IRCSERVICES]            = "ircservices",
+	[PWHASH_PBKDF2]                 = "pbkdf2",
+	[PWHASH_PBKDF2V2_SCRAM_MD5]     = "pbkdf2v2-scram-md5",
+	[PWHASH_PBKDF2V2_SCRAM_SHA1]    = "pbkdf2v2-scram-sha1",
+	[PWHASH_PBKDF2V2_SCRAM_SHA2_256]= "pbkdf2v2-scram-sha2-256",
+	[PWHASH_PBKDF2V2_SCRAM_SHA2_512]= "pbkdf2v2-scram-sha2-512",
+	[PWHASH_PBKDF2V2_HMAC_MD5]      = "pbkdf2v2-hmac-md5",
+	[PWHASH_PBKDF2V2_HMAC_SHA1]     = "pbkdf2v2-hmac-sha1",
+	[PWHASH_PBKDF2V2_HMAC_SHA2_256] = "pbkdf2v2-hmac-sha2-256",
+	[PWHASH_PBKDF2V2_HMAC_SHA2_512] = "pbkdf2v2-hmac-sha2-512",
+	[PWHASH_RAWMD5]                 = "rawmd5",
+	[PWHASH_RAWSHA1]                = "rawsha1",
+	[PWHASH_RAWSHA2_256]            = "rawsha2-256",
+	[PWHASH_RAWSHA2_512]            = "rawsha2-512",
+	[PWHASH_SCRYPT]                 = "scrypt",
+};
+
+static const char *const stats_chansize_labels[STATS_CHANNEL_BUCKETS] = {
+	"0", "1", "2-3", "4-7", "8-15", "16-31", "32-63", "64-127", "128-255", "256-511", "512-1023", "1024+",
+};
+
+void
+stats_init(void)
+{
+	(void) memset(&stats_counters, 0x00, sizeof stats_counters);
+
+	stats_counters.logins = hashmap_create(false);
+}
+
+static enum pwhash_type
+pwhash_classify_pbkdf2v2(const unsigned int prf)
+{
+	switch (prf)
+	{
+		case PBKDF2_PRF_SCRAM_MD5:
+		case PBKDF2_PRF_SCRAM_MD5_S64:
+			return PWHASH_PBKDF2V2_SCRAM_MD5;
+		case PBKDF2_PRF_SCRAM_SHA1:
+		case PBKDF2_PRF_SCRAM_SHA1_S64:
+			return PWHASH_PBKDF2V2_SCRAM_SHA1;
+		case PBKDF2_PRF_SCRAM_SHA2_256:
+		case PBKDF2_PRF_SCRAM_SHA2_256_S64:
+			return PWHASH_PBKDF2V2_SCRAM_SHA2_256;
+		case PBKDF2_PRF_SCRAM_SHA2_512:
+		case PBKDF2_PRF_SCRAM_SHA2_512_S64:
+			return PWHASH_PBKDF2V2_SCRAM_SHA2_512;
+		case PBKDF2_PRF_HMAC_MD5:
+		case PBKDF2_PRF_HMAC_MD5_S64:
+			return PWHASH_PBKDF2V2_HMAC_MD5;
+		case PBKDF2_PRF_HMAC_SHA1:
+		case PBKDF2_PRF_HMAC_SHA1_S64:
+			return PWHASH_PBKDF2V2_HMAC_SHA1;
+		case PBKDF2_PRF_HMAC_SHA2_256:
+		case PBKDF2_PRF_HMAC_SHA2_256_S64:
+			return PWHASH_PBKDF2V2_HMAC_SHA2_256;
+		case PBKDF2_PRF_HMAC_SHA2_512:
+		case PBKDF2_PRF_HMAC_SHA2_512_S64:
+			return PWHASH_PBKDF2V2_HMAC_SHA2_512;
+	}
+
+	return PWHASH_UNKNOWN;
+}
+
+/* pwhash_classify()
+ *
+ * Works out which crypto module produced the password hash of an account,
+ * from the format of the hash. This used to be done for every account by
+ * StatServ PWHASHES; it now runs once whenever a password is set, and only
+ * parses the hash with the format that its prefix selects.
+ *
+ * Inputs:
+ *       account to look at
+ *
+ * Outputs:
+ *       the type of its password hash
+ *
+ * Side Effects:
+ *       none
+ */
+enum pwhash_type
+pwhash_classify(const struct myuser *const restrict mu)
+{
+	enum pwhash_type type = PWHASH_UNKNOWN;
+	char s1[BUFSIZE];
+	char s2[BUFSIZE];
+	char s3[BUFSIZE];
+	unsigned int i1;
+	unsigned int i2;
+	unsigned int i3;
+	unsigned int i4;
+
+	if (! (mu->flags & MU_CRYPTPASS))
+		return PWHASH_NONE;
+
+	const char *const pw = mu->pass;
+	const size_t pwlen = strlen(pw);
+
+	if (*pw != '$')
+	{
+		// Fuzzy (no rigid format)
+		if (pwlen == 13U && sscanf(pw, SCANFMT_CRYPT3_DES, s1) == 1 && strcmp(s1, pw) == 0)
+			type = PWHASH_CRYPT3_DES;
+		else if (pwlen == 144U && sscanf(pw, SCANFMT_PBKDF2, s1, s2) == 2 &&
+		         strlen(s1) == 16U && strlen(s2) == 128U)
+			type = PWHASH_PBKDF2;
+	}
+	else if (HAS_PREFIX(pw, "$anope$"))
+	{
+		if (sscanf(pw, SCANFMT_ANOPE_ENC_SHA256, s1, s2) == 2)
+			type = PWHASH_ANOPE_ENC_SHA256;
+	}
+	else if (HAS_PREFIX(pw, "$argon2"))
+	{
+		if (sscanf(pw, SCANFMT_ARGON2, s1, &i1, &i2, &i3, &i4, s2, s3) != 7)
+			;
+		else if (strcasecmp(s1, "argon2d") == 0)
+			type = PWHASH_ARGON2D;
+		else if (strcasecmp(s1, "argon2i") == 0)
+			type = PWHASH_ARGON2I;
+		else if (strcasecmp(s1, "argon2id") == 0)
+			type = PWHASH_ARGON2ID;
+	}
+	else if (HAS_PREFIX(pw, "$base64$"))
+	{
+		if (sscanf(pw, SCANFMT_BASE64, s1) == 1)
+			type = PWHASH_BASE64;
+	}
+	else if (HAS_PREFIX(pw, "$2"))
+	{
+		if (pwlen >= 60U && sscanf(pw, SCANFMT_BCRYPT, s1, &i1, s2, s3) == 4)
+			type = PWHASH_BCRYPT;
+	}
+	else if (HAS_PREFIX(pw, "$1$"))
+	{
+		if (sscanf(pw, SCANFMT_CRYPT3_MD5, s1, s2) == 2)
+			type = PWHASH_CRYPT3_MD5;
+	}
+	else if (HAS_PREFIX(pw, "$5$"))
+	{
+		if (sscanf(pw, SCANFMT_CRYPT3_SHA2_256, s1, s2) == 2 ||
+		    sscanf(pw, SCANFMT_CRYPT3_SHA2_256_EXT, &i1, s1, s2) == 3)
+			type = PWHASH_CRYPT3_SHA2_256;
+	}
+	else if (HAS_PREFIX(pw, "$6$"))
+	{
+		if (sscanf(pw, SCANFMT_CRYPT3_SHA2_512, s1, s2) == 2 ||
+		    sscanf(pw, SCANFMT_CRYPT3_SHA2_512_EXT, &i1, s1, s2) == 3)
+			type = PWHASH_CRYPT3_SHA2_512;
+	}
+	else if (HAS_PREFIX(pw, "$ircservices$"))
+	{
+		if (sscanf(pw, SCANFMT_IRCSERVICES, s1) == 1)
+			type = PWHASH_IRCSERVICES;
+	}
+	else if (HAS_PREFIX(pw, "$z$"))
+	{
+		if (sscanf(pw, SCANFMT_PBKDF2V2_SCRAM, &i1, &i2, s1, s2, s3) == 5 ||
+		    sscanf(pw, SCANFMT_PBKDF2V2_HMAC, &i1, &i2, s1, s2) == 4)
+			type = pwhash_classify_pbkdf2v2(i1);
+	}
+	else if (HAS_PREFIX(pw, "$rawmd5$"))
+	{
+		if (sscanf(pw, SCANFMT_RAWMD5, s1) == 1)
+			type = PWHASH_RAWMD5;
+	}
+	else if (HAS_PREFIX(pw, "$rawsha1$"))
+	{
+		if (sscanf(pw, SCANFMT_RAWSHA1, s1) == 1)
+			type = PWHASH_RAWSHA1;
+	}
+	else if (HAS_PREFIX(pw, "$rawsha256$"))
+	{
+		if (sscanf(pw, SCANFMT_RAWSHA2_256, s1) == 1)
+			type = PWHASH_RAWSHA2_256;
+	}
+	else if (HAS_PREFIX(pw, "$rawsha512$"))
+	{
+		if (sscanf(pw, SCANFMT_RAWSHA2_512, s1) == 1)
+			type = PWHASH_RAWSHA2_512;
+	}
+	else if (HAS_PREFIX(pw, "$scrypt$"))
+	{
+		if (sscanf(pw, SCANFMT_SCRYPT, &i1, &i2, &i3, s1, s2) == 5)
+			type = PWHASH_SCRYPT;
+	}
+
+	(void) smemzero(s1, sizeof s1);
+	(void) smemzero(s2, sizeof s2);
+	(void) smemzero(s3, sizeof s3);
+
+	return type;
+}
+
+const char *
+pwhash_type_label(const enum pwhash_type type)
+{
+	return_val_if_fail(type < PWHASH_TYPE_COUNT, NULL);
+
+	return pwhash_type_labels[type];
+}
+
+const char *
+stats_chansize_label(const unsigned int bucket)
+{
+	return_val_if_fail(bucket < STATS_CHANNEL_BUCKETS, NULL);
+
+	return stats_chansize_labels[bucket];
+}
+
+/* stats_login_count()
+ *
+ * Counts a successful login.
+ *
+ * Inputs:
+ *       the method used, e.g. "IDENTIFY", "CERTFP" or "SASL/PLAIN"
+ *
+ * Outputs:
+ *       none
+ *
+ * Side Effects:
+ *       the method is added to stats_counters.logins the first time it is
+ *       seen; methods are never removed, so the counters only ever grow
+ */
+void
+stats_login_count(const char *const restrict method)
+{
+	return_if_fail(method != NULL);
+
+	struct stats_login *sl = hashmap_retrieve(stats_counters.logins, method);
+
+	if (sl == NULL)
+	{
+		sl = smalloc(sizeof *sl);
+		sl->method = sstrdup(method);
+
+		(void) hashmap_add(stats_counters.logins, method, sl);
+	}
+
+	sl->count++;
+}
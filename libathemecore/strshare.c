@@ -84,6 +84,23 @@ strshare_unref(stringref str)
 	}
 }
 
+/* Returns how many references there are to a shared string; a string that
+ * is referenced more than once may be worth writing out only once.
+ */
+unsigned int
+strshare_refcount(stringref str)
+{
+	const struct strshare *ss;
+
+	if (str == NULL)
+		return 0;
+
+	/* intermediate cast to suppress gcc -Wcast-qual */
+	ss = (const struct strshare *)(uintptr_t)str - 1;
+
+	return (unsigned int) ss->refcount;
+}
+
 /* vim:cinoptions=>s,e0,n0,f0,{0,}0,^0,=s,ps,t0,c3,+s,(2s,us,)20,*30,gs,hs
  * vim:ts=8
  * vim:sw=8
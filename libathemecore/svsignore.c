@@ -42,6 +42,7 @@ svsignore_add(const char *mask, const char *reason)
         struct svsignore *const svsignore = smalloc(sizeof *svsignore);
 
         svsignore->mask = sstrdup(mask);
+        svsignore->pattern = match_compile(svsignore->mask);
         svsignore->settime = CURRTIME;
         svsignore->reason = sstrdup(reason);
 
@@ -88,7 +89,7 @@ svsignore_find(struct user *source)
         {
                 svsignore = (struct svsignore *)n->data;
 
-                if (!match(svsignore->mask, host))
+                if (!match_compiled(svsignore->pattern, host))
                         return svsignore;
         }
 
@@ -118,6 +119,7 @@ svsignore_delete(struct svsignore *svsignore)
 	mowgli_node_delete(n, &svs_ignore_list);
 	mowgli_node_free(n);
 
+	match_pattern_free(svsignore->pattern);
 	sfree(svsignore->mask);
 	sfree(svsignore->setby);
 	sfree(svsignore->reason);
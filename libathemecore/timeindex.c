@@ -0,0 +1,158 @@
+/*
+ * SPDX-License-Identifier: ISC
+ * SPDX-URL: https://spdx.org/licenses/ISC.html
+ *
+ * Copyright (C) 2026 Atheme Development Group (https://atheme.github.io/)
+ *
+ * Permission to use, copy, modify, and/or distribute this software for any
+ * purpose with or without fee is hereby granted, provided that the above
+ * copyright notice and this permission notice appear in all copies.
+ *
+ * atheme-services: A collection of minimalist IRC services
+ * timeindex.c: Indexes of entries by the day of a timestamp
+ */
+
+#include <atheme.h>
+#include "internal.h"
+
+/*
+ * time_index_day(time_t ts)
+ *
+ * Returns the day a timestamp falls on, as used by a time index.
+ *
+ * Inputs:
+ *      - timestamp; 0 or less is day 0
+ *
+ * Outputs:
+ *      - days since the epoch
+ *
+ * Side Effects:
+ *      - none
+ */
+unsigned int
+time_index_day(const time_t ts)
+{
+	return (ts > 0) ? (unsigned int) (ts / SECONDS_PER_DAY) : 0;
+}
+
+/*
+ * time_index_add(struct time_index *ti, void *data, mowgli_node_t *n,
+ *                unsigned int day)
+ *
+ * Files an entry under a day.
+ *
+ * Inputs:
+ *      - index
+ *      - the entry
+ *      - node of the entry to file it with
+ *      - day, from time_index_day()
+ *
+ * Outputs:
+ *      - nothing
+ *
+ * Side Effects:
+ *      - the index grows to cover the day if it does not yet
+ */
+void
+time_index_add(struct time_index *const restrict ti, void *const restrict data, mowgli_node_t *const restrict n,
+               const unsigned int day)
+{
+	if (ti->ndays == 0)
+	{
+		ti->days = scalloc(1, sizeof *ti->days);
+		ti->first_day = day;
+		ti->ndays = 1;
+	}
+	else if (day < ti->first_day)
+	{
+		const unsigned int shift = ti->first_day - day;
+		mowgli_list_t *const days = scalloc(ti->ndays + shift, sizeof *days);
+
+		// mowgli nodes do not point back at their list, so the heads may move
+		(void) memcpy(days + shift, ti->days, ti->ndays * sizeof *days);
+		(void) sfree(ti->days);
+
+		ti->days = days;
+		ti->first_day = day;
+		ti->ndays += shift;
+	}
+	else if (day - ti->first_day >= ti->ndays)
+	{
+		const unsigned int ndays = day - ti->first_day + 1;
+
+		ti->days = srealloc(ti->days, ndays * sizeof *ti->days);
+		(void) memset(ti->days + ti->ndays, 0x00, (ndays - ti->ndays) * sizeof *ti->days);
+		ti->ndays = ndays;
+	}
+
+	(void) mowgli_node_add(data, n, &ti->days[day - ti->first_day]);
+}
+
+/*
+ * time_index_delete(struct time_index *ti, mowgli_node_t *n, unsigned int day)
+ *
+ * Removes an entry from the day it was filed under.
+ *
+ * Inputs:
+ *      - index
+ *      - node the entry was filed with
+ *      - day it was filed under
+ *
+ * Outputs:
+ *      - nothing
+ *
+ * Side Effects:
+ *      - none
+ */
+void
+time_index_delete(struct time_index *const restrict ti, mowgli_node_t *const restrict n, const unsigned int day)
+{
+	(void) mowgli_node_delete(n, &ti->days[day - ti->first_day]);
+}
+
+/*
+ * time_index_count(const struct time_index *ti, unsigned int last_day)
+ *
+ * Counts the entries filed under any day up to a cut-off.
+ *
+ * Inputs:
+ *      - index
+ *      - last day to count
+ *
+ * Outputs:
+ *      - number of entries
+ *
+ * Side Effects:
+ *      - none
+ */
+size_t
+time_index_count(const struct time_index *const restrict ti, const unsigned int last_day)
+{
+	size_t count = 0;
+
+	for (unsigned int i = 0; i < ti->ndays && ti->first_day + i <= last_day; i++)
+		count += MOWGLI_LIST_LENGTH(&ti->days[i]);
+
+	return count;
+}
+
+/*
+ * time_index_clear(struct time_index *ti)
+ *
+ * Empties an index, without touching the entries.
+ *
+ * Inputs:
+ *      - index
+ *
+ * Outputs:
+ *      - nothing
+ *
+ * Side Effects:
+ *      - the days are freed, and the index is zeroed
+ */
+void
+time_index_clear(struct time_index *const restrict ti)
+{
+	(void) sfree(ti->days);
+	(void) memset(ti, 0x00, sizeof *ti);
+}
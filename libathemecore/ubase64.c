@@ -66,6 +66,28 @@ base64touint(const char *buf)
 	return v;
 }
 
+/* Decodes exactly len characters (P10 numerics), unlike base64touint(),
+ * which stops at the first character that is not base64.
+ */
+bool
+base64tonum(const char *const restrict buf, const size_t len, unsigned int *const restrict value)
+{
+	unsigned int v = 0;
+
+	for (size_t i = 0; i < len; i++)
+	{
+		const int bits = ub64_lookuptab[255 & buf[i]];
+
+		if (bits == '\377')
+			return false;
+
+		v = v << 6 | (unsigned int) bits;
+	}
+
+	*value = v;
+	return true;
+}
+
 void
 decode_p10_ip(const char *b64, char ipstring[HOSTIPLEN + 1])
 {
@@ -15,6 +15,46 @@
 #include <atheme.h>
 #include "internal.h"
 
+/* The UID directory resolves the numerics of TS6 (a 3 character SID and 6
+ * characters of [A-Z0-9]) and P10 (2 and 3 characters of base64) by decoding
+ * them rather than looking them up by name: the SID indexes uid_slots, and
+ * the client part indexes that server's pages of UID_PAGE_SIZE users. ircds
+ * hand out numerics sequentially, so the pages a server has are few and
+ * mostly full. Numerics that do not decode, or that are too large for the
+ * directory, are only found through uidlist_index.
+ */
+#define UID_SID_SLOTS           46656U          // 36^3; P10 SIDs need 64^2
+#define UID_PAGE_BITS           10U
+#define UID_PAGE_SIZE           (1U << UID_PAGE_BITS)
+#define UID_MAX_PAGES           65536U          // so client numbers below 2^26
+
+#define UID_TS6_SIDLEN          3U
+#define UID_TS6_LEN             9U
+#define UID_P10_SIDLEN          2U
+#define UID_P10_LEN             5U
+
+struct uid_page
+{
+	struct user *   users[UID_PAGE_SIZE];
+	unsigned int    count;
+};
+
+struct uid_slot
+{
+	struct server *         server;
+	struct uid_page **      pages;
+	unsigned int            npages;         // size of pages
+	unsigned int            live_pages;     // pages that are allocated
+	unsigned int            users;
+};
+
+static const char uid_base36_alphabet[] = "ABCDEFGHIJKLMNOPQRSTUVWXYZ0123456789";
+
+static struct uid_slot **uid_slots = NULL;
+
+// How many UIDs uid_get() handed out, so that a warm restart can carry on after them
+static unsigned int uid_issued = 0;
+
 const struct uid_provider *uid_provider_impl = NULL;
 
 void
@@ -28,11 +68,367 @@ const char *
 uid_get(void)
 {
 	if (uid_provider_impl != NULL)
+	{
+		uid_issued++;
 		return uid_provider_impl->uid_get();
+	}
 
 	return NULL;
 }
 
+unsigned int
+uid_get_count(void)
+{
+	return uid_issued;
+}
+
+/* uid_skip()
+ *
+ * Advances the UID provider past the UIDs a previous process handed out,
+ * which may still be in use on the network.
+ *
+ * Inputs:
+ *       how many UIDs the previous process had handed out
+ *
+ * Outputs:
+ *       none
+ *
+ * Side Effects:
+ *       uid_get() is called until that many have been handed out
+ */
+void
+uid_skip(const unsigned int count)
+{
+	while (uid_provider_impl != NULL && uid_issued < count)
+		(void) uid_get();
+}
+
+/* uid_base36_encode()
+ *
+ * Writes a number as TS6 UID characters: A-Z are 0-25 and 0-9 are 26-35,
+ * so that counting up gives the sequence ircds (and protocol/base36uid)
+ * hand client numerics out in.
+ *
+ * Inputs:
+ *       buffer of at least len + 1 bytes, number, number of characters
+ *
+ * Outputs:
+ *       the buffer, NUL-terminated
+ *
+ * Side Effects:
+ *       none
+ */
+const char *
+uid_base36_encode(char *const restrict buf, unsigned int value, size_t len)
+{
+	buf[len] = '\0';
+
+	while (len > 0)
+	{
+		buf[--len] = uid_base36_alphabet[value % 36U];
+		value /= 36U;
+	}
+
+	return buf;
+}
+
+/* uid_base36_decode()
+ *
+ * The reverse of uid_base36_encode().
+ *
+ * Inputs:
+ *       characters to decode, how many
+ *
+ * Outputs:
+ *       false if any of them is not A-Z or 0-9, else true and the number
+ *
+ * Side Effects:
+ *       none
+ */
+bool
+uid_base36_decode(const char *const restrict buf, const size_t len, unsigned int *const restrict value)
+{
+	unsigned int v = 0;
+
+	for (size_t i = 0; i < len; i++)
+	{
+		const char c = buf[i];
+
+		if (c >= 'A' && c <= 'Z')
+			v = (v * 36U) + (unsigned int) (c - 'A');
+		else if (c >= '0' && c <= '9')
+			v = (v * 36U) + 26U + (unsigned int) (c - '0');
+		else
+			return false;
+	}
+
+	*value = v;
+	return true;
+}
+
+static bool
+uid_decode_sid(const char *const restrict sid, unsigned int *const restrict slot)
+{
+	if (ircd == NULL)
+		return false;
+
+	if (ircd->uses_p10)
+		return strnlen(sid, UID_P10_SIDLEN + 1U) == UID_P10_SIDLEN && base64tonum(sid, UID_P10_SIDLEN, slot);
+
+	return strnlen(sid, UID_TS6_SIDLEN + 1U) == UID_TS6_SIDLEN && uid_base36_decode(sid, UID_TS6_SIDLEN, slot);
+}
+
+static bool
+uid_decode(const char *const restrict uid, unsigned int *const restrict slot, unsigned int *const restrict client)
+{
+	if (ircd == NULL)
+		return false;
+
+	if (ircd->uses_p10)
+	{
+		if (strnlen(uid, UID_P10_LEN + 1U) != UID_P10_LEN || ! base64tonum(uid, UID_P10_SIDLEN, slot)
+		    || ! base64tonum(uid + UID_P10_SIDLEN, UID_P10_LEN - UID_P10_SIDLEN, client))
+			return false;
+	}
+	else if (strnlen(uid, UID_TS6_LEN + 1U) != UID_TS6_LEN || ! uid_base36_decode(uid, UID_TS6_SIDLEN, slot)
+	         || ! uid_base36_decode(uid + UID_TS6_SIDLEN, UID_TS6_LEN - UID_TS6_SIDLEN, client))
+		return false;
+
+	return (*client >> UID_PAGE_BITS) < UID_MAX_PAGES;
+}
+
+static struct uid_slot *
+uid_slot_get(const unsigned int index)
+{
+	if (uid_slots == NULL)
+		uid_slots = scalloc(UID_SID_SLOTS, sizeof *uid_slots);
+
+	if (uid_slots[index] == NULL)
+		uid_slots[index] = scalloc(1, sizeof *uid_slots[index]);
+
+	return uid_slots[index];
+}
+
+static void
+uid_slot_release(const unsigned int index)
+{
+	struct uid_slot *const slot = uid_slots[index];
+
+	if (slot->server != NULL || slot->live_pages)
+		return;
+
+	(void) sfree(slot->pages);
+	(void) sfree(slot);
+
+	uid_slots[index] = NULL;
+}
+
+/* uid_directory_add()
+ *
+ * Adds a user to the UID directory, if its UID decodes.
+ *
+ * Inputs:
+ *       user, with u->uid set
+ *
+ * Outputs:
+ *       none
+ *
+ * Side Effects:
+ *       pages of the directory are allocated as needed
+ */
+void
+uid_directory_add(struct user *const restrict u)
+{
+	unsigned int index;
+	unsigned int client;
+
+	if (u->uid == NULL || ! uid_decode(u->uid, &index, &client))
+		return;
+
+	struct uid_slot *const slot = uid_slot_get(index);
+	const unsigned int page = client >> UID_PAGE_BITS;
+
+	if (page >= slot->npages)
+	{
+		// Grow to the next power of two, as numerics are handed out in order
+		unsigned int npages = slot->npages ? slot->npages : 1U;
+
+		while (npages <= page)
+			npages *= 2U;
+
+		slot->pages = sreallocarray(slot->pages, npages, sizeof *slot->pages);
+
+		(void) memset(slot->pages + slot->npages, 0x00, (npages - slot->npages) * sizeof *slot->pages);
+
+		slot->npages = npages;
+	}
+
+	if (slot->pages[page] == NULL)
+	{
+		slot->pages[page] = scalloc(1, sizeof *slot->pages[page]);
+		slot->live_pages++;
+	}
+
+	struct uid_page *const pg = slot->pages[page];
+	struct user **const entry = &pg->users[client & (UID_PAGE_SIZE - 1U)];
+
+	// Like the uidlist patricia, keep the user that was there first
+	if (*entry != NULL)
+		return;
+
+	*entry = u;
+	pg->count++;
+	slot->users++;
+}
+
+void
+uid_directory_delete(struct user *const restrict u)
+{
+	unsigned int index;
+	unsigned int client;
+
+	if (u->uid == NULL || ! uid_decode(u->uid, &index, &client) || uid_slots == NULL || uid_slots[index] == NULL)
+		return;
+
+	struct uid_slot *const slot = uid_slots[index];
+	const unsigned int page = client >> UID_PAGE_BITS;
+
+	if (page >= slot->npages || slot->pages[page] == NULL)
+		return;
+
+	struct uid_page *const pg = slot->pages[page];
+	struct user **const entry = &pg->users[client & (UID_PAGE_SIZE - 1U)];
+
+	if (*entry != u)
+		return;
+
+	*entry = NULL;
+	slot->users--;
+
+	if (--pg->count == 0)
+	{
+		(void) sfree(pg);
+
+		slot->pages[page] = NULL;
+		slot->live_pages--;
+	}
+
+	(void) uid_slot_release(index);
+}
+
+/* uid_directory_find()
+ *
+ * Looks up a user by UID in the UID directory.
+ *
+ * Inputs:
+ *       UID, and where to store whether it decoded
+ *
+ * Outputs:
+ *       the user, or NULL; if the UID did not decode, the user may still
+ *       be in uidlist_index
+ *
+ * Side Effects:
+ *       none
+ */
+struct user *
+uid_directory_find(const char *const restrict uid, bool *const restrict decoded)
+{
+	unsigned int index;
+	unsigned int client;
+
+	if (! (*decoded = uid_decode(uid, &index, &client)))
+		return NULL;
+
+	const struct uid_slot *const slot = uid_slots ? uid_slots[index] : NULL;
+	const unsigned int page = client >> UID_PAGE_BITS;
+
+	if (slot == NULL || page >= slot->npages || slot->pages[page] == NULL)
+		return NULL;
+
+	return slot->pages[page]->users[client & (UID_PAGE_SIZE - 1U)];
+}
+
+void
+uid_directory_add_server(struct server *const restrict s)
+{
+	unsigned int index;
+
+	if (s->sid == NULL || ! uid_decode_sid(s->sid, &index))
+		return;
+
+	struct uid_slot *const slot = uid_slot_get(index);
+
+	if (slot->server == NULL)
+		slot->server = s;
+}
+
+void
+uid_directory_delete_server(struct server *const restrict s)
+{
+	unsigned int index;
+
+	if (s->sid == NULL || ! uid_decode_sid(s->sid, &index) || uid_slots == NULL || uid_slots[index] == NULL)
+		return;
+
+	if (uid_slots[index]->server != s)
+		return;
+
+	uid_slots[index]->server = NULL;
+
+	(void) uid_slot_release(index);
+}
+
+/* uid_directory_find_server()
+ *
+ * Looks up a server by SID in the UID directory.
+ *
+ * Inputs:
+ *       SID, and where to store whether it decoded
+ *
+ * Outputs:
+ *       the server, or NULL; if the SID did not decode, the server may
+ *       still be known by that SID or name
+ *
+ * Side Effects:
+ *       none
+ */
+struct server *
+uid_directory_find_server(const char *const restrict sid, bool *const restrict decoded)
+{
+	unsigned int index;
+
+	if (! (*decoded = uid_decode_sid(sid, &index)))
+		return NULL;
+
+	if (uid_slots == NULL || uid_slots[index] == NULL)
+		return NULL;
+
+	return uid_slots[index]->server;
+}
+
+void
+uid_directory_stats(void (*cb)(const char *line, void *privdata), void *privdata)
+{
+	unsigned int servers = 0;
+	unsigned int pages = 0;
+	unsigned int users = 0;
+	char buf[BUFSIZE];
+
+	for (unsigned int i = 0; uid_slots != NULL && i < UID_SID_SLOTS; i++)
+	{
+		if (uid_slots[i] == NULL)
+			continue;
+
+		servers++;
+		pages += uid_slots[i]->live_pages;
+		users += uid_slots[i]->users;
+	}
+
+	(void) snprintf(buf, sizeof buf, "UID directory: %u users on %u SIDs, %u pages of %u", users, servers,
+	                pages, UID_PAGE_SIZE);
+	(void) cb(buf, privdata);
+}
+
 /* vim:cinoptions=>s,e0,n0,f0,{0,}0,^0,=s,ps,t0,c3,+s,(2s,us,)20,*30,gs,hs
  * vim:ts=8
  * vim:sw=8
@@ -160,6 +160,135 @@ uplink_connect(void)
 		mowgli_timer_add_once(base_eventloop, "reconn", reconn, NULL, me.recontime);
 }
 
+/*
+ * uplink_resume()
+ *
+ * inputs:
+ *       name of the uplink{} block the connection was made for, and the
+ *       file descriptor of the connection
+ *
+ * outputs:
+ *       the uplink connection, or NULL on error
+ *
+ * side effects:
+ *       a connection inherited from the process we were exec'd from is
+ *       taken over without logging in again; if the uplink is no longer
+ *       configured, the first one is assumed
+ */
+struct connection *
+uplink_resume(const char *name, int fd)
+{
+	struct connection *cptr;
+	struct uplink *u;
+
+	if (uplinks.head == NULL)
+	{
+		slog(LG_ERROR, "uplink_resume(): no uplinks configured");
+		return NULL;
+	}
+
+	if ((u = uplink_find(name)) == NULL)
+		u = uplinks.head->data;
+
+	if (!(cptr = connection_add("uplink", fd, 0, recvq_put, NULL)))
+		return NULL;
+
+	curr_uplink = u;
+	curr_uplink->conn = cptr;
+	curr_uplink->conn->close_handler = uplink_close;
+	sendq_set_limit(curr_uplink->conn, config_options.uplink_sendq_limit);
+
+	irc_handle_resume(cptr);
+
+	return cptr;
+}
+
+/*
+ * uplink_connect_loopback()
+ *
+ * inputs:
+ *       where to store the file descriptor of the other end
+ *
+ * outputs:
+ *       the uplink connection, or NULL on error
+ *
+ * side effects:
+ *       services are linked to one end of a socketpair as if it were a
+ *       connection to the first configured uplink; the caller feeds lines
+ *       to parse() itself, and must read whatever services send from the
+ *       other end with uplink_loopback_drain(). This is used by tools that
+ *       benchmark services offline.
+ */
+struct connection *
+uplink_connect_loopback(int *peerfd)
+{
+	struct connection *cptr;
+	int fds[2];
+
+	if (uplinks.head == NULL)
+	{
+		slog(LG_ERROR, "uplink_connect_loopback(): no uplinks configured");
+		return NULL;
+	}
+
+	if (socketpair(AF_UNIX, SOCK_STREAM, 0, fds) != 0)
+	{
+		slog(LG_ERROR, "uplink_connect_loopback(): socketpair(2): %s", strerror(errno));
+		return NULL;
+	}
+
+	if (!(cptr = connection_add("uplink", fds[0], 0, recvq_put, NULL)))
+	{
+		close(fds[0]);
+		close(fds[1]);
+		return NULL;
+	}
+
+	(void) fcntl(fds[1], F_SETFL, fcntl(fds[1], F_GETFL) | O_NONBLOCK);
+	*peerfd = fds[1];
+
+	curr_uplink = uplinks.head->data;
+	curr_uplink->conn = cptr;
+	curr_uplink->conn->close_handler = uplink_close;
+
+	irc_handle_connect(cptr);
+
+	return cptr;
+}
+
+/*
+ * uplink_loopback_drain()
+ *
+ * inputs:
+ *       file descriptor of the other end of a loopback uplink
+ *
+ * outputs:
+ *       the number of lines services sent
+ *
+ * side effects:
+ *       the sendq of the uplink is flushed, and what was sent is discarded
+ */
+uint64_t
+uplink_loopback_drain(int peerfd)
+{
+	struct connection *cptr = curr_uplink->conn;
+	char buf[BUFSIZE * 16];
+	uint64_t lines = 0;
+	ssize_t len, i;
+
+	while (cptr != NULL && sendq_nonempty(cptr) && !CF_IS_DEAD(cptr))
+	{
+		sendq_flush(cptr);
+
+		while ((len = recv(peerfd, buf, sizeof buf, 0)) > 0)
+			for (i = 0; i < len; i++)
+				if (buf[i] == '\n')
+					lines++;
+	}
+
+	return lines;
+}
+
 /*
  * uplink_close()
  *
@@ -183,6 +312,7 @@ uplink_close(struct connection *cptr)
 
 	mowgli_timer_add_once(base_eventloop, "reconn", reconn, NULL, me.recontime);
 
+	warmstate_resume_cancel();
 	me.connected = false;
 
 	if (curr_uplink->flags & UPF_ILLEGAL)
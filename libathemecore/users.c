@@ -20,6 +20,8 @@ static mowgli_heap_t *user_heap = NULL;
 
 mowgli_patricia_t *userlist;
 mowgli_patricia_t *uidlist;
+struct hashmap *userlist_index;
+struct hashmap *uidlist_index;
 
 static void
 user_delete_cb(void *const restrict user)
@@ -54,6 +56,8 @@ init_users(void)
 
 	userlist = mowgli_patricia_create(irccasecanon);
 	uidlist = mowgli_patricia_create(noopcanon);
+	userlist_index = hashmap_create(true);
+	uidlist_index = hashmap_create(false);
 }
 
 /*
@@ -158,6 +162,8 @@ user_add(const char *nick, const char *user, const char *host,
 	{
 		u->uid = strshare_get(uid);
 		mowgli_patricia_add(uidlist, u->uid, u);
+		hashmap_add(uidlist_index, u->uid, u);
+		uid_directory_add(u);
 	}
 
 	u->nick = strshare_get(nick);
@@ -177,6 +183,7 @@ user_add(const char *nick, const char *user, const char *host,
 	u->ts = ts ? ts : CURRTIME;
 
 	mowgli_patricia_add(userlist, u->nick, u);
+	hashmap_add(userlist_index, u->nick, u);
 
 	cnt.user++;
 
@@ -187,23 +194,36 @@ user_add(const char *nick, const char *user, const char *host,
 	return hdata.u;
 }
 
+static void
+user_masks_release(struct user_masks *um)
+{
+	strshare_unref(um->nick);
+	strshare_unref(um->user);
+	strshare_unref(um->host);
+	strshare_unref(um->chost);
+	strshare_unref(um->vhost);
+	strshare_unref(um->ip);
+	sfree(um->buf);
+}
+
 /*
- * user_delete(struct user *u, const char *comment)
+ * user_destroy(struct user *u)
  *
- * Destroys a user object and deletes the object from the users DTree.
+ * Frees a user object once the user_delete hooks have been called.
  *
  * Inputs:
- *     - user object to delete
- *     - quit comment
+ *     - user object to destroy
  *
  * Outputs:
  *     - nothing
  *
  * Side Effects:
- *     - on success, a user is deleted from the users DTree.
+ *     - the user is removed from all channels it is still on
+ *     - the user is deleted from the users DTree and freed
+ *     - an enforcer is introduced for its nick if one was pending
  */
-void
-user_delete(struct user *u, const char *comment)
+static void
+user_destroy(struct user *u)
 {
 	mowgli_node_t *n, *tn;
 	struct chanuser *cu;
@@ -211,8 +231,6 @@ user_delete(struct user *u, const char *comment)
 	char oldnick[NICKLEN + 1];
 	bool doenforcer = false;
 
-	return_if_fail(u != NULL);
-
 	if (u->flags & UF_DOENFORCE)
 	{
 		doenforcer = true;
@@ -220,14 +238,6 @@ user_delete(struct user *u, const char *comment)
 		u->flags &= ~UF_DOENFORCE;
 	}
 
-	if (!comment)
-		comment = "";
-
-	slog(LG_DEBUG, "user_delete(): removing user: %s -> %s (%s)", u->nick, u->server->name, comment);
-
-	hook_call_user_delete_info((&(struct hook_user_delete_info){.u = u, .comment = comment}));
-	hook_call_user_delete(u);
-
 	u->server->users--;
 	if (is_ircop(u))
 		u->server->opers--;
@@ -245,9 +255,14 @@ user_delete(struct user *u, const char *comment)
 	}
 
 	mowgli_patricia_delete(userlist, u->nick);
+	hashmap_delete(userlist_index, u->nick);
 
 	if (u->uid != NULL)
+	{
 		mowgli_patricia_delete(uidlist, u->uid);
+		hashmap_delete(uidlist_index, u->uid);
+		uid_directory_delete(u);
+	}
 
 	mowgli_node_delete(&u->snode, &u->server->userlist);
 
@@ -278,6 +293,12 @@ user_delete(struct user *u, const char *comment)
 	strshare_unref(u->chost);
 	strshare_unref(u->ip);
 
+	if (u->masks != NULL)
+	{
+		user_masks_release(u->masks);
+		sfree(u->masks);
+	}
+
 	mowgli_heap_free(user_heap, u);
 
 	cnt.user--;
@@ -286,6 +307,84 @@ user_delete(struct user *u, const char *comment)
 		introduce_enforcer(oldnick);
 }
 
+/*
+ * user_delete(struct user *u, const char *comment)
+ *
+ * Destroys a user object and deletes the object from the users DTree.
+ *
+ * Inputs:
+ *     - user object to delete
+ *     - quit comment
+ *
+ * Outputs:
+ *     - nothing
+ *
+ * Side Effects:
+ *     - on success, a user is deleted from the users DTree.
+ */
+void
+user_delete(struct user *u, const char *comment)
+{
+	return_if_fail(u != NULL);
+
+	if (!comment)
+		comment = "";
+
+	slog(LG_DEBUG, "user_delete(): removing user: %s -> %s (%s)", u->nick, u->server->name, comment);
+
+	hook_call_user_delete_info((&(struct hook_user_delete_info){.u = u, .comment = comment}));
+	hook_call_user_delete(u);
+	command_stream_user_delete(u);
+
+	user_destroy(u);
+}
+
+/*
+ * user_delete_batch(struct user **users, size_t count, const char *comment)
+ *
+ * Destroys a set of user objects that leave the network together, such as
+ * all users behind a server that split. This is equivalent to calling
+ * user_delete() for each of them, except that channel memberships are
+ * removed one channel at a time.
+ *
+ * Inputs:
+ *     - array of user objects to delete
+ *     - number of users in the array
+ *     - quit comment
+ *
+ * Outputs:
+ *     - nothing
+ *
+ * Side Effects:
+ *     - the user_delete_info and user_delete hooks are called for every
+ *       user before any of them is removed
+ *     - the users are removed from their channels with
+ *       chanuser_delete_users() (q.v.)
+ *     - the users are deleted from the users DTree
+ */
+void
+user_delete_batch(struct user **users, size_t count, const char *comment)
+{
+	size_t i;
+
+	return_if_fail(users != NULL || count == 0);
+
+	if (!comment)
+		comment = "";
+
+	for (i = 0; i < count; i++)
+	{
+		hook_call_user_delete_info((&(struct hook_user_delete_info){.u = users[i], .comment = comment}));
+		hook_call_user_delete(users[i]);
+		command_stream_user_delete(users[i]);
+	}
+
+	chanuser_delete_users(users, count);
+
+	for (i = 0; i < count; i++)
+		user_destroy(users[i]);
+}
+
 /*
  * user_find(const char *nick)
  *
@@ -310,13 +409,17 @@ user_find(const char *nick)
 
 	if (ircd->uses_uid)
 	{
-		u = mowgli_patricia_retrieve(uidlist, nick);
+		bool decoded;
+
+		// A UID that decodes is in the directory if it is anywhere
+		if ((u = uid_directory_find(nick, &decoded)) == NULL && ! decoded)
+			u = hashmap_retrieve(uidlist_index, nick);
 
 		if (u != NULL)
 			return u;
 	}
 
-	u = mowgli_patricia_retrieve(userlist, nick);
+	u = hashmap_retrieve(userlist_index, nick);
 
 	if (u != NULL)
 	{
@@ -346,7 +449,7 @@ user_find(const char *nick)
 struct user *
 user_find_named(const char *nick)
 {
-	return mowgli_patricia_retrieve(userlist, nick);
+	return hashmap_retrieve(userlist_index, nick);
 }
 
 /*
@@ -370,13 +473,21 @@ user_changeuid(struct user *u, const char *uid)
 	return_if_fail(u != NULL);
 
 	if (u->uid != NULL)
+	{
 		mowgli_patricia_delete(uidlist, u->uid);
+		hashmap_delete(uidlist_index, u->uid);
+		uid_directory_delete(u);
+	}
 
 	strshare_unref(u->uid);
 	u->uid = strshare_get(uid);
 
 	if (u->uid != NULL)
+	{
 		mowgli_patricia_add(uidlist, u->uid, u);
+		hashmap_add(uidlist_index, u->uid, u);
+		uid_directory_add(u);
+	}
 }
 
 /*
@@ -494,6 +605,7 @@ user_changenick(struct user *u, const char *nick, time_t ts)
 			mn->owner == u->myuser)
 		mn->lastseen = CURRTIME;
 	mowgli_patricia_delete(userlist, u->nick);
+	hashmap_delete(userlist_index, u->nick);
 
 	strshare_unref(u->nick);
 	u->nick = strshare_get(nick);
@@ -501,6 +613,7 @@ user_changenick(struct user *u, const char *nick, time_t ts)
 	u->ts = ts;
 
 	mowgli_patricia_add(userlist, u->nick, u);
+	hashmap_add(userlist_index, u->nick, u);
 
 	if (doenforcer)
 		introduce_enforcer(oldnick);
@@ -645,6 +758,91 @@ user_get_umodestr(struct user *u)
 	return result;
 }
 
+/*
+ * user_get_masks(struct user *u)
+ *
+ * Returns the nick!user@host forms of a user, building them if they are not
+ * cached yet or the user's nick, username, hosts or IP changed since.
+ *
+ * Inputs:
+ *     - user object
+ *
+ * Outputs:
+ *     - the user's mask forms, valid until the user changes or is deleted
+ *
+ * Side Effects:
+ *     - the cache on the user object is (re)built
+ */
+const struct user_masks *
+user_get_masks(struct user *u)
+{
+	char forms[USER_MASK_COUNT][USER_MASK_BUFLEN];
+	size_t lens[USER_MASK_COUNT];
+	struct user_masks *um;
+	const char *at;
+	size_t nickuserlen, total;
+	char *p;
+
+	return_val_if_fail(u != NULL, NULL);
+
+	um = u->masks;
+
+	if (um != NULL && um->nick == u->nick && um->user == u->user && um->host == u->host &&
+	    um->chost == u->chost && um->vhost == u->vhost && um->ip == u->ip)
+		return um;
+
+	if (um == NULL)
+		um = u->masks = smalloc(sizeof *um);
+	else
+		user_masks_release(um);
+
+	const stringref hosts[USER_MASK_COUNT] = {
+		[USER_MASK_VHOST] = u->vhost,
+		[USER_MASK_CHOST] = u->chost,
+		[USER_MASK_HOST] = u->host,
+		[USER_MASK_IP] = u->ip,
+	};
+
+	total = 0;
+
+	for (unsigned int i = 0; i < USER_MASK_COUNT; i++)
+	{
+		/* will be nick!user@ if ip unknown, doesn't matter */
+		snprintf(forms[i], sizeof forms[i], "%s!%s@%s", u->nick, u->user, hosts[i]);
+
+		lens[i] = strlen(forms[i]);
+		total += lens[i] + 1;
+	}
+
+	at = strrchr(forms[USER_MASK_IP], '@');
+	nickuserlen = (at != NULL) ? (size_t) (at - forms[USER_MASK_IP]) : 0;
+	total += nickuserlen + 1;
+
+	p = um->buf = smalloc(total);
+
+	for (unsigned int i = 0; i < USER_MASK_COUNT; i++)
+	{
+		memcpy(p, forms[i], lens[i] + 1);
+		um->form[i] = p;
+		p += lens[i] + 1;
+	}
+
+	memcpy(p, forms[USER_MASK_IP], nickuserlen);
+	p[nickuserlen] = '\0';
+	um->nickuser = p;
+
+	um->addr_valid = (at != NULL && cidr_parse(at + 1, &um->addr));
+
+	um->nick = strshare_ref(u->nick);
+	um->user = strshare_ref(u->user);
+	um->host = strshare_ref(u->host);
+	um->chost = strshare_ref(u->chost);
+	um->vhost = strshare_ref(u->vhost);
+	um->ip = strshare_ref(u->ip);
+
+	return um;
+}
+
 struct chanuser *
 find_user_banned_channel(struct user *const restrict u, const char ban_type)
 {
@@ -0,0 +1,995 @@
+/*
+ * SPDX-License-Identifier: ISC
+ * SPDX-URL: https://spdx.org/licenses/ISC.html
+ *
+ * Copyright (C) 2026 Atheme Development Group (https://atheme.github.io/)
+ *
+ * Permission to use, copy, modify, and/or distribute this software for any
+ * purpose with or without fee is hereby granted, provided that the above
+ * copyright notice and this permission notice appear in all copies.
+ *
+ * atheme-services: A collection of minimalist IRC services
+ * warmstate.c: Warm restarts
+ */
+
+#include <atheme.h>
+#include "internal.h"
+
+// How long the uplink has to answer our PING after a warm restart
+#define WARMSTATE_RESUME_TIMEOUT        SECONDS_PER_MINUTE
+
+struct warmstate_reader
+{
+	const unsigned char *   buf;
+	size_t                  len;
+	size_t                  pos;
+	bool                    error;
+};
+
+// What warmstate_restore() has put back so far
+struct warmstate_restore
+{
+	struct server **        servers;        // by their index in the snapshot; ours is 0
+	unsigned int *          server_flags;   // applied once everything has been restored
+	size_t                  nservers;
+	size_t                  alloc;
+	struct server *         current;        // server of the user records that follow
+	const char *            actual;         // name of the uplink server
+	unsigned int            users;
+	unsigned int            channels;
+	unsigned int            lost;           // records that could not be restored
+};
+
+static mowgli_eventloop_timer_t *warmstate_resume_timer = NULL;
+
+static void
+warmstate_path(char *const restrict buf, const size_t len)
+{
+	(void) snprintf(buf, len, "%s/%s", datadir, WARMSTATE_FILE);
+}
+
+static void
+warmstate_write_varint(FILE *const restrict fp, uint64_t value)
+{
+	while (value >= 0x80U)
+	{
+		(void) putc((int) ((value & 0x7FU) | 0x80U), fp);
+		value >>= 7;
+	}
+
+	(void) putc((int) value, fp);
+}
+
+static void
+warmstate_write_data(FILE *const restrict fp, const char *const restrict buf, const size_t len)
+{
+	(void) warmstate_write_varint(fp, (uint64_t) len + 1U);
+	(void) fwrite(buf, 1, len, fp);
+	(void) putc(0x00, fp);
+}
+
+static void
+warmstate_write_string(FILE *const restrict fp, const char *const restrict str)
+{
+	if (str == NULL)
+		(void) warmstate_write_varint(fp, 0);
+	else
+		(void) warmstate_write_data(fp, str, strlen(str));
+}
+
+static void
+warmstate_write_user(FILE *const restrict fp, struct user *const restrict u)
+{
+	(void) putc(WARMSTATE_USER, fp);
+	(void) warmstate_write_string(fp, u->nick);
+	(void) warmstate_write_string(fp, u->user);
+	(void) warmstate_write_string(fp, u->host);
+	(void) warmstate_write_string(fp, u->vhost);
+	(void) warmstate_write_string(fp, u->chost);
+	(void) warmstate_write_string(fp, u->ip);
+	(void) warmstate_write_string(fp, u->uid);
+	(void) warmstate_write_string(fp, u->gecos);
+	(void) warmstate_write_varint(fp, (uint64_t) u->ts);
+	(void) warmstate_write_varint(fp, u->flags);
+	(void) warmstate_write_string(fp, user_get_umodestr(u));
+	(void) warmstate_write_string(fp, u->certfp);
+	(void) warmstate_write_string(fp, u->myuser != NULL ? entity(u->myuser)->id : NULL);
+	(void) warmstate_write_string(fp, u->myuser != NULL ? entity(u->myuser)->name : NULL);
+}
+
+static void
+warmstate_write_server(FILE *const restrict fp, const struct server *const restrict s, const uint64_t parent,
+                       uint64_t *const restrict index, unsigned int *const restrict users)
+{
+	const uint64_t self = ++(*index);
+	mowgli_node_t *n;
+
+	(void) putc(WARMSTATE_SERVER, fp);
+	(void) warmstate_write_varint(fp, parent);
+	(void) warmstate_write_string(fp, s->name);
+	(void) warmstate_write_string(fp, s->sid);
+	(void) warmstate_write_string(fp, s->desc);
+	(void) warmstate_write_varint(fp, s->hops);
+	(void) warmstate_write_varint(fp, s->flags);
+	(void) warmstate_write_varint(fp, (uint64_t) s->connected_since);
+
+	MOWGLI_ITER_FOREACH(n, s->userlist.head)
+	{
+		(void) warmstate_write_user(fp, n->data);
+		(*users)++;
+	}
+
+	MOWGLI_ITER_FOREACH(n, s->children.head)
+		(void) warmstate_write_server(fp, n->data, self, index, users);
+}
+
+// Masked servers have no name of their own, so they could not be linked back up
+static bool
+warmstate_masked_server(const struct server *const restrict s)
+{
+	mowgli_node_t *n;
+
+	if (s->flags & SF_MASKED)
+		return true;
+
+	MOWGLI_ITER_FOREACH(n, s->children.head)
+		if (warmstate_masked_server(n->data))
+			return true;
+
+	return false;
+}
+
+static void
+warmstate_write_channel(FILE *const restrict fp, struct channel *const restrict c)
+{
+	struct chanuser_iter iter;
+	struct chanuser *cu;
+	mowgli_node_t *n;
+
+	(void) putc(WARMSTATE_CHANNEL, fp);
+	(void) warmstate_write_string(fp, c->name);
+	(void) warmstate_write_varint(fp, (uint64_t) c->ts);
+	(void) warmstate_write_string(fp, channel_modes(c, true));
+	(void) warmstate_write_varint(fp, c->flags);
+	(void) warmstate_write_string(fp, c->topic);
+	(void) warmstate_write_string(fp, c->topic_setter);
+	(void) warmstate_write_varint(fp, (uint64_t) c->topicts);
+
+	(void) warmstate_write_varint(fp, MOWGLI_LIST_LENGTH(&c->bans));
+
+	MOWGLI_ITER_FOREACH(n, c->bans.head)
+	{
+		const struct chanban *const cb = n->data;
+
+		(void) warmstate_write_string(fp, cb->mask);
+		(void) warmstate_write_varint(fp, (uint64_t) cb->type);
+		(void) warmstate_write_varint(fp, cb->flags);
+	}
+
+	(void) warmstate_write_varint(fp, c->nummembers);
+
+	CHANNEL_MEMBER_FOREACH(cu, &iter, c)
+	{
+		(void) warmstate_write_string(fp, CLIENT_NAME(cu->user));
+		(void) warmstate_write_varint(fp, cu->modes);
+	}
+}
+
+static void
+warmstate_free_state(struct hashmap *const restrict state)
+{
+	struct hashmap_iter iter;
+	char *value;
+
+	HASHMAP_FOREACH(value, &iter, state)
+		(void) sfree(value);
+
+	(void) hashmap_destroy(state);
+}
+
+/* warmstate_save()
+ *
+ * Writes the network state to the snapshot file and detaches the uplink
+ * connection, so that the process services are about to exec can carry on
+ * from where we stopped.
+ *
+ * Inputs:
+ *       none
+ *
+ * Outputs:
+ *       the file descriptor of the uplink connection, or -1 if a warm
+ *       restart is not possible and services have to restart cold
+ *
+ * Side Effects:
+ *       everything queued for the uplink is sent first, blocking if need be
+ *
+ * Nothing reads from the uplink from the database save before this until
+ * the new process has loaded the database again. The uplink's ping timeout
+ * for services has to be longer than that, and its sendq for them large
+ * enough for what the network sends meanwhile, or it drops the link.
+ */
+int
+warmstate_save(void)
+{
+	struct connection *const cptr = (curr_uplink != NULL) ? curr_uplink->conn : NULL;
+	struct hook_warm_restart hdata = { .state = NULL, .supported = false };
+	mowgli_patricia_iteration_state_t state;
+	struct channel *c;
+	mowgli_node_t *n;
+	char path[BUFSIZE];
+	uint64_t index = 0;
+	unsigned int users = 0;
+	FILE *fp;
+
+	if (cptr == NULL || ! me.connected || ! me.recvsvr || me.actual == NULL || ircd == NULL)
+	{
+		(void) slog(LG_ERROR, "%s: not linked to an uplink, restarting cold", MOWGLI_FUNC_NAME);
+		return -1;
+	}
+
+	if (me.bursting)
+	{
+		(void) slog(LG_ERROR, "%s: still receiving the burst, restarting cold", MOWGLI_FUNC_NAME);
+		return -1;
+	}
+
+	if (warmstate_masked_server(me.me))
+	{
+		(void) slog(LG_ERROR, "%s: a masked server is linked, restarting cold", MOWGLI_FUNC_NAME);
+		return -1;
+	}
+
+	hdata.state = hashmap_create(false);
+	(void) hook_call_warm_restart_save(&hdata);
+
+	if (! hdata.supported)
+	{
+		(void) slog(LG_ERROR, "%s: the protocol module cannot resume a link, restarting cold", MOWGLI_FUNC_NAME);
+		(void) warmstate_free_state(hdata.state);
+		return -1;
+	}
+
+	// Whatever we sent has to reach the uplink before it is handed over
+	(void) fcntl(cptr->fd, F_SETFL, fcntl(cptr->fd, F_GETFL) & ~O_NONBLOCK);
+
+	while (sendq_nonempty(cptr) && ! CF_IS_DEAD(cptr))
+		(void) sendq_flush(cptr);
+
+	if (CF_IS_DEAD(cptr))
+	{
+		(void) slog(LG_ERROR, "%s: lost the uplink while flushing its sendq, restarting cold", MOWGLI_FUNC_NAME);
+		(void) warmstate_free_state(hdata.state);
+		return -1;
+	}
+
+	(void) warmstate_path(path, sizeof path);
+
+	if (! (fp = fopen(path, "wb")))
+	{
+		(void) slog(LG_ERROR, "%s: cannot open %s for writing: %s; restarting cold", MOWGLI_FUNC_NAME, path,
+		            strerror(errno));
+		(void) warmstate_free_state(hdata.state);
+		return -1;
+	}
+
+	(void) fwrite(WARMSTATE_MAGIC, 1, WARMSTATE_MAGIC_LEN, fp);
+
+	(void) putc(WARMSTATE_HEADER, fp);
+	(void) warmstate_write_string(fp, curr_uplink->name);
+	(void) warmstate_write_string(fp, me.actual);
+	(void) warmstate_write_varint(fp, ircd->uses_uid ? 1U : 0U);
+	(void) warmstate_write_varint(fp, uid_get_count());
+
+	struct hashmap_iter iter;
+	const char *value;
+
+	HASHMAP_FOREACH(value, &iter, hdata.state)
+	{
+		(void) putc(WARMSTATE_PROTOCOL, fp);
+		(void) warmstate_write_string(fp, iter.key);
+		(void) warmstate_write_string(fp, value);
+	}
+
+	(void) warmstate_free_state(hdata.state);
+
+	MOWGLI_ITER_FOREACH(n, me.me->userlist.head)
+	{
+		const struct user *const u = n->data;
+
+		(void) putc(WARMSTATE_SERVICE, fp);
+		(void) warmstate_write_string(fp, u->nick);
+		(void) warmstate_write_string(fp, u->uid);
+	}
+
+	MOWGLI_ITER_FOREACH(n, me.me->children.head)
+		(void) warmstate_write_server(fp, n->data, 0, &index, &users);
+
+	MOWGLI_PATRICIA_FOREACH(c, &state, chanlist)
+		(void) warmstate_write_channel(fp, c);
+
+	const int pending = recvq_length(cptr);
+
+	if (pending > 0)
+	{
+		char *const buf = smalloc((size_t) pending);
+		const int len = recvq_get(cptr, buf, (size_t) pending);
+
+		(void) putc(WARMSTATE_RECVQ, fp);
+		(void) warmstate_write_data(fp, buf, (size_t) len);
+		(void) sfree(buf);
+	}
+
+	(void) putc(WARMSTATE_END, fp);
+	(void) warmstate_write_varint(fp, index);
+	(void) warmstate_write_varint(fp, users);
+	(void) warmstate_write_varint(fp, mowgli_patricia_size(chanlist));
+
+	if (fflush(fp) != 0 || ferror(fp))
+	{
+		(void) slog(LG_ERROR, "%s: error writing to %s: %s; restarting cold", MOWGLI_FUNC_NAME, path,
+		            strerror(errno));
+		(void) fclose(fp);
+		(void) unlink(path);
+		return -1;
+	}
+
+	(void) fclose(fp);
+
+	(void) slog(LG_INFO, "%s: saved %" PRIu64 " servers, %u users and %u channels to %s", MOWGLI_FUNC_NAME, index,
+	            users, mowgli_patricia_size(chanlist), path);
+
+	curr_uplink->conn = NULL;
+
+	return connection_detach(cptr);
+}
+
+static uint64_t
+warmstate_read_varint(struct warmstate_reader *const restrict r)
+{
+	uint64_t value = 0;
+
+	for (unsigned int shift = 0; shift < 64U && r->pos < r->len; shift += 7U)
+	{
+		const unsigned char c = r->buf[r->pos++];
+
+		value |= ((uint64_t) (c & 0x7FU)) << shift;
+
+		if (! (c & 0x80U))
+			return value;
+	}
+
+	r->error = true;
+	return 0;
+}
+
+// Strings are returned in place, so they are only valid as long as the snapshot is loaded
+static const char *
+warmstate_read_data(struct warmstate_reader *const restrict r, size_t *const restrict len)
+{
+	const uint64_t n = warmstate_read_varint(r);
+
+	*len = 0;
+
+	if (r->error || ! n)
+		return NULL;
+
+	if (n > r->len - r->pos || r->buf[r->pos + n - 1U] != 0x00)
+	{
+		r->error = true;
+		return NULL;
+	}
+
+	const char *const str = (const char *) &r->buf[r->pos];
+
+	r->pos += n;
+	*len = (size_t) (n - 1U);
+
+	return str;
+}
+
+static const char *
+warmstate_read_string(struct warmstate_reader *const restrict r)
+{
+	size_t len;
+
+	return warmstate_read_data(r, &len);
+}
+
+static int
+warmstate_read_type(struct warmstate_reader *const restrict r)
+{
+	if (r->error || r->pos >= r->len)
+		return EOF;
+
+	return r->buf[r->pos++];
+}
+
+static bool
+warmstate_load(const char *const restrict path, struct warmstate_reader *const restrict r)
+{
+	unsigned char *buf;
+	FILE *fp;
+	long size;
+
+	(void) memset(r, 0x00, sizeof *r);
+
+	if (! (fp = fopen(path, "rb")))
+	{
+		(void) slog(LG_ERROR, "%s: cannot open %s: %s", MOWGLI_FUNC_NAME, path, strerror(errno));
+		return false;
+	}
+
+	if (fseek(fp, 0, SEEK_END) != 0 || (size = ftell(fp)) < 0 || fseek(fp, 0, SEEK_SET) != 0)
+	{
+		(void) slog(LG_ERROR, "%s: cannot seek in %s: %s", MOWGLI_FUNC_NAME, path, strerror(errno));
+		(void) fclose(fp);
+		return false;
+	}
+
+	buf = smalloc((size_t) size + 1U);
+
+	if (fread(buf, 1, (size_t) size, fp) != (size_t) size)
+	{
+		(void) slog(LG_ERROR, "%s: error reading %s", MOWGLI_FUNC_NAME, path);
+		(void) sfree(buf);
+		(void) fclose(fp);
+		return false;
+	}
+
+	(void) fclose(fp);
+
+	if ((size_t) size < WARMSTATE_MAGIC_LEN || memcmp(buf, WARMSTATE_MAGIC, WARMSTATE_MAGIC_LEN) != 0)
+	{
+		(void) slog(LG_ERROR, "%s: %s is not a warm restart snapshot", MOWGLI_FUNC_NAME, path);
+		(void) sfree(buf);
+		return false;
+	}
+
+	r->buf = buf;
+	r->len = (size_t) size;
+	r->pos = WARMSTATE_MAGIC_LEN;
+
+	return true;
+}
+
+/* One of our clients that the new process does not have any more; the
+ * uplink still has it, so it has to quit.
+ */
+static void
+warmstate_quit_stale(const char *const restrict nick, const char *const restrict uid)
+{
+	struct user *u;
+
+	if (user_find_named(nick) != NULL || (uid != NULL && user_find(uid) != NULL))
+		return;
+
+	if ((u = user_add(nick, "services", me.name, NULL, NULL, uid, nick, me.me, CURRTIME)) == NULL)
+		return;
+
+	(void) quit_sts(u, "Service removed");
+	(void) user_delete(u, "Service removed");
+}
+
+static void
+warmstate_restore_service(struct warmstate_reader *const restrict r)
+{
+	const char *const nick = warmstate_read_string(r);
+	const char *const uid = warmstate_read_string(r);
+	struct user *u;
+
+	if (r->error || nick == NULL)
+		return;
+
+	if ((u = user_find_named(nick)) == NULL || u->server != me.me)
+	{
+		(void) slog(LG_DEBUG, "%s: %s is gone", MOWGLI_FUNC_NAME, nick);
+		(void) warmstate_quit_stale(nick, uid);
+		return;
+	}
+
+	if (uid != NULL && ircd->uses_uid)
+		(void) user_changeuid(u, uid);
+}
+
+static void
+warmstate_restore_server(struct warmstate_reader *const restrict r, struct warmstate_restore *const restrict ws)
+{
+	const uint64_t parent = warmstate_read_varint(r);
+	const char *const name = warmstate_read_string(r);
+	const char *const sid = warmstate_read_string(r);
+	const char *const desc = warmstate_read_string(r);
+	const uint64_t hops = warmstate_read_varint(r);
+	const uint64_t flags = warmstate_read_varint(r);
+	const uint64_t since = warmstate_read_varint(r);
+	struct server *s = NULL;
+
+	if (r->error)
+		return;
+
+	if (parent >= ws->nservers || ws->servers[parent] == NULL || name == NULL || server_find(name) != NULL)
+		ws->lost++;
+	else if ((s = server_add(name, (unsigned int) hops, ws->servers[parent], sid, desc ? desc : "")) != NULL)
+	{
+		s->connected_since = (time_t) since;
+		s->flags = (unsigned int) flags & ~(SF_EOB | SF_EOB2);
+
+		if (parent == 0 && ! irccasecmp(name, ws->actual))
+			me.actual = s->name;
+	}
+
+	// Keep the indexes in step even for a server that could not be restored, so its users are skipped
+	if (ws->nservers == ws->alloc)
+	{
+		ws->alloc *= 2U;
+		ws->servers = srealloc(ws->servers, ws->alloc * sizeof *ws->servers);
+		ws->server_flags = srealloc(ws->server_flags, ws->alloc * sizeof *ws->server_flags);
+	}
+
+	ws->servers[ws->nservers] = s;
+	ws->server_flags[ws->nservers] = (unsigned int) flags;
+	ws->nservers++;
+	ws->current = s;
+}
+
+static void
+warmstate_restore_login(struct user *const restrict u, const char *const restrict id, const char *const restrict name)
+{
+	struct myuser *mu = NULL;
+
+	if (id != NULL)
+		mu = user(myentity_find_uid(id));
+
+	if (mu == NULL && name != NULL)
+		mu = myuser_find(name);
+
+	if (mu == NULL)
+	{
+		// Dropped while we were restarting; there is no other way to log them out
+		(void) slog(LG_INFO, "%s: account %s of %s is gone", MOWGLI_FUNC_NAME, name ? name : id, u->nick);
+
+		if (authservice_loaded)
+			(void) ircd_logout_or_kill(u, name ? name : id);
+
+		return;
+	}
+
+	/* Not handle_burstlogin(): the login is known to be good, even for
+	 * accounts that do not accept logins from a burst.
+	 */
+	u->myuser = mu;
+	(void) mowgli_node_add(u, mowgli_node_create(), &mu->logins);
+}
+
+static void
+warmstate_restore_user(struct warmstate_reader *const restrict r, struct warmstate_restore *const restrict ws)
+{
+	const char *const nick = warmstate_read_string(r);
+	const char *const username = warmstate_read_string(r);
+	const char *const host = warmstate_read_string(r);
+	const char *const vhost = warmstate_read_string(r);
+	const char *const chost = warmstate_read_string(r);
+	const char *const ip = warmstate_read_string(r);
+	const char *const uid = warmstate_read_string(r);
+	const char *const gecos = warmstate_read_string(r);
+	const uint64_t ts = warmstate_read_varint(r);
+	const uint64_t flags = warmstate_read_varint(r);
+	const char *const umodes = warmstate_read_string(r);
+	const char *const certfp = warmstate_read_string(r);
+	const char *const account_id = warmstate_read_string(r);
+	const char *const account_name = warmstate_read_string(r);
+	struct user *u;
+
+	if (r->error)
+		return;
+
+	ws->users++;
+
+	if (nick == NULL || username == NULL || host == NULL || gecos == NULL || umodes == NULL)
+	{
+		r->error = true;
+		return;
+	}
+
+	// user_add() would kill the other user too; neither should be here yet
+	if (ws->current == NULL || user_find_named(nick) != NULL || (uid != NULL && user_find(uid) != NULL))
+	{
+		ws->lost++;
+		return;
+	}
+
+	if ((u = user_add(nick, username, host, vhost, ip, uid, gecos, ws->current, (time_t) ts)) == NULL)
+		return;
+
+	(void) user_mode(u, umodes);
+	u->flags |= (unsigned int) flags & ~UF_DOING_SASL;
+
+	if (chost != NULL && strcmp(chost, u->chost) != 0)
+	{
+		(void) strshare_unref(u->chost);
+		u->chost = strshare_get(chost);
+	}
+
+	if (certfp != NULL)
+		u->certfp = sstrdup(certfp);
+
+	if (account_id != NULL || account_name != NULL)
+		(void) warmstate_restore_login(u, account_id, account_name);
+}
+
+static void
+warmstate_restore_member(struct channel *const restrict c, struct user *const restrict u, const unsigned int modes)
+{
+	char buf[BUFSIZE];
+	size_t len = 0;
+
+	for (unsigned int i = 0; prefix_mode_list[i].mode != '\0' && len < 16U; i++)
+		if (modes & prefix_mode_list[i].value)
+			buf[len++] = prefix_mode_list[i].mode;
+
+	(void) mowgli_strlcpy(buf + len, CLIENT_NAME(u), sizeof buf - len);
+	(void) chanuser_add(c, buf);
+}
+
+static void
+warmstate_restore_channel(struct warmstate_reader *const restrict r, struct warmstate_restore *const restrict ws)
+{
+	const char *const name = warmstate_read_string(r);
+	const uint64_t ts = warmstate_read_varint(r);
+	const char *const modes = warmstate_read_string(r);
+	const uint64_t flags = warmstate_read_varint(r);
+	const char *const topic = warmstate_read_string(r);
+	const char *const setter = warmstate_read_string(r);
+	const uint64_t topicts = warmstate_read_varint(r);
+	struct channel *c = NULL;
+	char modebuf[BUFSIZE];
+	char *parv[256];
+
+	if (r->error)
+		return;
+
+	ws->channels++;
+
+	if (name == NULL || channel_find(name) != NULL || (c = channel_add(name, (time_t) ts, me.me)) == NULL)
+		ws->lost++;
+
+	if (c != NULL)
+	{
+		if (modes != NULL)
+		{
+			(void) mowgli_strlcpy(modebuf, modes, sizeof modebuf);
+			(void) channel_mode(NULL, c, sjtoken(modebuf, ' ', parv), parv);
+		}
+
+		c->flags |= (unsigned int) flags;
+
+		if (topic != NULL && setter != NULL)
+		{
+			c->topic = sstrdup(topic);
+			c->topic_setter = sstrdup(setter);
+			c->topicts = (time_t) topicts;
+		}
+	}
+
+	const uint64_t nbans = warmstate_read_varint(r);
+
+	for (uint64_t i = 0; i < nbans && ! r->error; i++)
+	{
+		const char *const mask = warmstate_read_string(r);
+		const uint64_t type = warmstate_read_varint(r);
+		const uint64_t banflags = warmstate_read_varint(r);
+		struct chanban *cb;
+
+		if (c != NULL && mask != NULL && (cb = chanban_add(c, mask, (int) type)) != NULL)
+			cb->flags = (unsigned int) banflags;
+	}
+
+	const uint64_t nmembers = warmstate_read_varint(r);
+
+	if (r->error || nmembers > r->len - r->pos)
+	{
+		r->error = true;
+		return;
+	}
+
+	const char **const members = smalloc((size_t) nmembers * sizeof *members);
+	unsigned int *const member_modes = smalloc((size_t) nmembers * sizeof *member_modes);
+
+	for (uint64_t i = 0; i < nmembers && ! r->error; i++)
+	{
+		members[i] = warmstate_read_string(r);
+		member_modes[i] = (unsigned int) warmstate_read_varint(r);
+	}
+
+	/* Like a channel created by a burst, but with its modes, topic and
+	 * bans known before anyone has seen it; our own clients go in first,
+	 * so that nothing joins them again.
+	 */
+	if (c != NULL && ! r->error)
+	{
+		(void) hook_call_channel_add(c);
+
+		for (unsigned int pass = 0; pass < 2U; pass++)
+		{
+			for (uint64_t i = 0; i < nmembers; i++)
+			{
+				struct user *const u = members[i] ? user_find(members[i]) : NULL;
+
+				// Killed since, or one of our clients that is gone
+				if (u == NULL || (u->server == me.me) != (pass == 0))
+					continue;
+
+				(void) warmstate_restore_member(c, u, member_modes[i]);
+			}
+		}
+
+		if (c->nummembers == 0 && ! (c->modes & ircd->perm_mode))
+			(void) channel_delete(c);
+	}
+
+	(void) sfree(members);
+	(void) sfree(member_modes);
+}
+
+static void
+warmstate_resume_timeout(void ATHEME_VATTR_UNUSED *const restrict unused)
+{
+	warmstate_resume_timer = NULL;
+
+	if (! me.bursting || curr_uplink == NULL || curr_uplink->conn == NULL)
+		return;
+
+	(void) slog(LG_ERROR, "%s: %s did not answer within %u seconds of a warm restart, reconnecting",
+	            MOWGLI_FUNC_NAME, curr_uplink->name, (unsigned int) WARMSTATE_RESUME_TIMEOUT);
+
+	errno = 0;
+	(void) connection_close(curr_uplink->conn);
+}
+
+/* warmstate_resume_cancel()
+ *
+ * Stops waiting for the uplink to answer after a warm restart, because the
+ * link is gone.
+ *
+ * Inputs:
+ *       none
+ *
+ * Outputs:
+ *       none
+ *
+ * Side Effects:
+ *       none
+ */
+void
+warmstate_resume_cancel(void)
+{
+	if (warmstate_resume_timer == NULL)
+		return;
+
+	(void) mowgli_timer_destroy(base_eventloop, warmstate_resume_timer);
+	warmstate_resume_timer = NULL;
+}
+
+/* warmstate_restore()
+ *
+ * Takes over the uplink connection and the network state from the process
+ * that exec'd us for a warm restart, instead of connecting and receiving a
+ * burst. The counts of what was restored are compared with the counts the
+ * snapshot was written with, and the uplink is pinged; services stay in
+ * burst mode until it answers. If the counts differ, or no answer comes
+ * within WARMSTATE_RESUME_TIMEOUT, the link is dropped, and services
+ * reconnect and receive a full burst.
+ *
+ * Inputs:
+ *       file descriptor of the uplink connection
+ *
+ * Outputs:
+ *       false if services still have to connect to an uplink
+ *
+ * Side Effects:
+ *       the snapshot file is deleted
+ */
+bool
+warmstate_restore(const int fd)
+{
+	struct hook_warm_restart hdata = { .state = NULL, .supported = false };
+	struct warmstate_restore ws;
+	struct warmstate_reader r;
+	struct connection *cptr;
+	mowgli_node_t *n;
+	char path[BUFSIZE];
+	uint64_t saved_servers = 0;
+	uint64_t saved_users = 0;
+	uint64_t saved_channels = 0;
+	bool complete = false;
+	int type;
+
+	(void) warmstate_path(path, sizeof path);
+
+	if (! warmstate_load(path, &r))
+	{
+		(void) close(fd);
+		return false;
+	}
+
+	// Never resume from the same snapshot twice
+	(void) unlink(path);
+
+	const char *uplink_name = NULL;
+
+	if (warmstate_read_type(&r) == WARMSTATE_HEADER)
+		uplink_name = warmstate_read_string(&r);
+
+	const char *const actual = warmstate_read_string(&r);
+	const bool uses_uid = (warmstate_read_varint(&r) != 0);
+	const uint64_t uid_count = warmstate_read_varint(&r);
+
+	if (r.error || uplink_name == NULL || actual == NULL || ircd == NULL)
+	{
+		(void) slog(LG_ERROR, "%s: %s is damaged, restarting cold", MOWGLI_FUNC_NAME, path);
+		(void) sfree((void *) r.buf);
+		(void) close(fd);
+		return false;
+	}
+
+	hdata.state = hashmap_create(false);
+
+	while (r.pos < r.len && r.buf[r.pos] == WARMSTATE_PROTOCOL)
+	{
+		r.pos++;
+
+		const char *const key = warmstate_read_string(&r);
+		const char *const value = warmstate_read_string(&r);
+
+		if (key != NULL && value != NULL)
+			(void) hashmap_add(hdata.state, key, (void *) value);
+	}
+
+	(void) hook_call_warm_restart_restore(&hdata);
+	(void) hashmap_destroy(hdata.state);
+
+	if (! hdata.supported)
+	{
+		(void) slog(LG_ERROR, "%s: the protocol module cannot resume a link, restarting cold", MOWGLI_FUNC_NAME);
+		(void) sfree((void *) r.buf);
+		(void) close(fd);
+		return false;
+	}
+
+	ircd->uses_uid = uses_uid;
+
+	if ((cptr = uplink_resume(uplink_name, fd)) == NULL)
+	{
+		(void) slog(LG_ERROR, "%s: cannot take over the uplink connection, restarting cold", MOWGLI_FUNC_NAME);
+		(void) sfree((void *) r.buf);
+		(void) close(fd);
+		return false;
+	}
+
+	(void) memset(&ws, 0x00, sizeof ws);
+	ws.alloc = 64U;
+	ws.servers = smalloc(ws.alloc * sizeof *ws.servers);
+	ws.server_flags = smalloc(ws.alloc * sizeof *ws.server_flags);
+	ws.servers[0] = me.me;
+	ws.server_flags[0] = me.me->flags;
+	ws.nservers = 1U;
+	ws.actual = actual;
+
+	me.bursting = true;
+
+	// Our clients get back the UIDs the uplink knows them by, or new ones below
+	if (ircd->uses_uid)
+		MOWGLI_ITER_FOREACH(n, me.me->userlist.head)
+			(void) user_changeuid(n->data, NULL);
+
+	while (! complete && (type = warmstate_read_type(&r)) != EOF)
+	{
+		switch (type)
+		{
+			case WARMSTATE_SERVICE:
+				(void) warmstate_restore_service(&r);
+				break;
+
+			case WARMSTATE_SERVER:
+				(void) warmstate_restore_server(&r, &ws);
+				break;
+
+			case WARMSTATE_USER:
+				(void) warmstate_restore_user(&r, &ws);
+				break;
+
+			case WARMSTATE_CHANNEL:
+				(void) warmstate_restore_channel(&r, &ws);
+				break;
+
+			case WARMSTATE_RECVQ:
+			{
+				size_t len;
+				const char *const data = warmstate_read_data(&r, &len);
+
+				if (data != NULL)
+					(void) recvq_add(cptr, data, len);
+
+				break;
+			}
+
+			case WARMSTATE_END:
+				saved_servers = warmstate_read_varint(&r);
+				saved_users = warmstate_read_varint(&r);
+				saved_channels = warmstate_read_varint(&r);
+				complete = ! r.error;
+				break;
+
+			default:
+				r.error = true;
+				break;
+		}
+	}
+
+	(void) uid_skip((unsigned int) uid_count);
+
+	MOWGLI_ITER_FOREACH(n, me.me->userlist.head)
+	{
+		struct user *const u = n->data;
+
+		if (! ircd->uses_uid || u->uid != NULL)
+			continue;
+
+		// New since the restart; nobody has seen it yet
+		(void) user_changeuid(u, uid_get());
+
+		if (complete)
+			(void) introduce_nick(u);
+	}
+
+	for (size_t i = 1; i < ws.nservers; i++)
+		if (ws.servers[i] != NULL)
+			ws.servers[i]->flags = ws.server_flags[i];
+
+	if (! complete || ws.lost || me.actual == NULL || saved_servers != ws.nservers - 1U
+	    || saved_users != ws.users || saved_channels != ws.channels)
+	{
+		(void) slog(LG_ERROR, "%s: restored %zu of %" PRIu64 " servers, %u of %" PRIu64 " users and %u of %"
+		            PRIu64 " channels, %u lost%s; reconnecting", MOWGLI_FUNC_NAME, ws.nservers - 1U,
+		            saved_servers, ws.users, saved_users, ws.channels, saved_channels, ws.lost,
+		            complete ? "" : ", snapshot damaged");
+
+		me.bursting = false;
+
+		errno = 0;
+		(void) connection_close(cptr);
+	}
+	else
+	{
+		(void) slog(LG_INFO, "%s: resumed the link to %s with %zu servers, %u users and %u channels; "
+		            "waiting for it to answer", MOWGLI_FUNC_NAME, me.actual, ws.nservers - 1U, ws.users,
+		            ws.channels);
+
+		/* The PONG ends the burst as it does after a connect; until then
+		 * services keep to what they do while bursting.
+		 */
+#ifdef HAVE_GETTIMEOFDAY
+		(void) s_time(&burstime);
+#endif
+		(void) ping_sts();
+
+		(void) warmstate_resume_cancel();
+		warmstate_resume_timer = mowgli_timer_add_once(base_eventloop, "warmstate_resume_timeout",
+		                                               &warmstate_resume_timeout, NULL,
+		                                               WARMSTATE_RESUME_TIMEOUT);
+
+		// Parse what the old process had received but not got round to, as recvq_put() would
+		int l, ll = 0;
+
+		while (curr_uplink->conn == cptr && cptr->recvq_handler != NULL && (l = recvq_length(cptr)) != 0 && l != ll)
+		{
+			ll = l;
+			(void) cptr->recvq_handler(cptr);
+		}
+	}
+
+	(void) sfree(ws.servers);
+	(void) sfree(ws.server_flags);
+	(void) sfree((void *) r.buf);
+
+	return true;
+}
@@ -44,6 +44,9 @@
 #define ALIS_MAXMATCH_DEF       64U
 #define ALIS_MAXMATCH_MAX       128U
 
+// A topic with more distinct trigrams than this is not indexed, and is a candidate for every topic search
+#define ALIS_TOPIC_TRIGRAMS_MAX 256U
+
 enum alis_mode_cmp
 {
 	MODECMP_NONE            = 0,
@@ -70,11 +73,44 @@ struct alis_query
 	bool                    show_unregonly;
 	char                    mask[BUFSIZE];
 	char                    topic[BUFSIZE];
+	struct match_pattern *  mask_pattern;
+	struct match_pattern *  topic_pattern;
 };
 
 static struct service *alissvs = NULL;
 static unsigned int alis_max_matches = ALIS_MAXMATCH_DEF;
 
+/* Channels are indexed by their number of members, and by the trigrams of
+ * their topic (folded as match() folds them), so that a search with -min,
+ * -max or -topic only looks at the channels that can match it. The indexes
+ * are built by the first search and kept up to date from hooks after that.
+ */
+struct alis_trigram
+{
+	char                    key[4];
+	mowgli_list_t           channels;
+};
+
+struct alis_channel
+{
+	struct channel *        chan;
+	mowgli_node_t           count_node;
+	unsigned int            count;          // member count it is filed under
+	mowgli_node_t           topic_node;     // in alis_topic_unindexed
+	bool                    topic_unindexed;
+	mowgli_node_t *         trigram_nodes;
+	struct alis_trigram **  trigrams;
+	size_t                  ntrigrams;
+};
+
+static bool alis_indexed = false;
+static int alis_indexed_mapping;
+static struct hashmap *alis_channels = NULL;
+static mowgli_list_t *alis_counts = NULL;
+static unsigned int alis_ncounts = 0;
+static struct hashmap *alis_trigrams = NULL;
+static mowgli_list_t alis_topic_unindexed;
+
 static bool
 alis_parse_mode(struct sourceinfo *const restrict si, const char *restrict arg,
                 struct alis_query *const restrict query)
@@ -335,7 +371,7 @@ alis_show_channel(const struct alis_query *const restrict query, const struct ch
 		if (query->mode_limit && ! chptr->limit)
 			return false;
 		for (size_t i = 0; ignore_mode_list[i].mode; i++)
-			if (query->mode_ext[i] && ! chptr->extmodes[i])
+			if (query->mode_ext[i] && ! channel_extmode(chptr, i))
 				return false;
 	}
 	else if (query->mode_cmp == MODECMP_UNSET)
@@ -347,7 +383,7 @@ alis_show_channel(const struct alis_query *const restrict query, const struct ch
 		if (query->mode_limit && chptr->limit)
 			return false;
 		for (size_t i = 0; ignore_mode_list[i].mode; i++)
-			if (query->mode_ext[i] && chptr->extmodes[i])
+			if (query->mode_ext[i] && channel_extmode(chptr, i))
 				return false;
 	}
 	else if (query->mode_cmp == MODECMP_EQUAL)
@@ -359,7 +395,7 @@ alis_show_channel(const struct alis_query *const restrict query, const struct ch
 		if (query->mode_limit && ! chptr->limit)
 			return false;
 		for (size_t i = 0; ignore_mode_list[i].mode; i++)
-			if (query->mode_ext[i] && ! chptr->extmodes[i])
+			if (query->mode_ext[i] && ! channel_extmode(chptr, i))
 				return false;
 	}
 
@@ -369,15 +405,442 @@ alis_show_channel(const struct alis_query *const restrict query, const struct ch
 	if (query->show_unregonly && chptr->mychan)
 		return false;
 
-	if (*query->mask && match(query->mask, chptr->name))
+	if (*query->mask && match_compiled(query->mask_pattern, chptr->name))
+		return false;
+
+	if (*query->topic && match_compiled(query->topic_pattern, chptr->topic))
+		return false;
+
+	return true;
+}
+
+static void
+alis_count_file(struct alis_channel *const restrict ac, const unsigned int count)
+{
+	if (count >= alis_ncounts)
+	{
+		const unsigned int ncounts = (count + 1U > alis_ncounts * 2U) ? (count + 1U) : (alis_ncounts * 2U);
+
+		// growing may move the bucket heads; the channels filed in them stay linked
+		alis_counts = srealloc(alis_counts, ncounts * sizeof *alis_counts);
+		(void) memset(alis_counts + alis_ncounts, 0x00, (ncounts - alis_ncounts) * sizeof *alis_counts);
+		alis_ncounts = ncounts;
+	}
+
+	(void) mowgli_node_add(ac, &ac->count_node, &alis_counts[count]);
+	ac->count = count;
+}
+
+static void
+alis_count_refile(struct alis_channel *const restrict ac, const unsigned int count)
+{
+	if (count == ac->count)
+		return;
+
+	(void) mowgli_node_delete(&ac->count_node, &alis_counts[ac->count]);
+	(void) alis_count_file(ac, count);
+}
+
+static void
+alis_topic_unfile(struct alis_channel *const restrict ac)
+{
+	if (ac->topic_unindexed)
+		(void) mowgli_node_delete(&ac->topic_node, &alis_topic_unindexed);
+
+	for (size_t i = 0; i < ac->ntrigrams; i++)
+	{
+		struct alis_trigram *const tg = ac->trigrams[i];
+
+		(void) mowgli_node_delete(&ac->trigram_nodes[i], &tg->channels);
+
+		if (MOWGLI_LIST_LENGTH(&tg->channels))
+			continue;
+
+		(void) hashmap_delete(alis_trigrams, tg->key);
+		(void) sfree(tg);
+	}
+
+	(void) sfree(ac->trigram_nodes);
+	(void) sfree(ac->trigrams);
+
+	ac->topic_unindexed = false;
+	ac->trigram_nodes = NULL;
+	ac->trigrams = NULL;
+	ac->ntrigrams = 0;
+}
+
+static void
+alis_topic_file(struct alis_channel *const restrict ac)
+{
+	const char *const topic = ac->chan->topic;
+	size_t len;
+
+	if (! topic || (len = strlen(topic)) < 3)
+		return;
+
+	const size_t max = ((len - 2) < ALIS_TOPIC_TRIGRAMS_MAX) ? (len - 2) : ALIS_TOPIC_TRIGRAMS_MAX;
+
+	ac->trigram_nodes = smalloc(max * sizeof *ac->trigram_nodes);
+	ac->trigrams = smalloc(max * sizeof *ac->trigrams);
+
+	for (size_t i = 0; i + 2 < len; i++)
+	{
+		const char key[4] = { (char) ToLower(topic[i]), (char) ToLower(topic[i + 1]),
+		                      (char) ToLower(topic[i + 2]), '\0' };
+		struct alis_trigram *tg;
+
+		if (! (tg = hashmap_retrieve(alis_trigrams, key)))
+		{
+			tg = smalloc(sizeof *tg);
+			(void) memcpy(tg->key, key, sizeof tg->key);
+			(void) hashmap_add(alis_trigrams, key, tg);
+		}
+
+		// repeated trigrams are added one after another
+		if (tg->channels.tail && tg->channels.tail->data == ac)
+			continue;
+
+		if (ac->ntrigrams == max)
+		{
+			if (! MOWGLI_LIST_LENGTH(&tg->channels))
+			{
+				(void) hashmap_delete(alis_trigrams, key);
+				(void) sfree(tg);
+			}
+
+			(void) alis_topic_unfile(ac);
+			(void) mowgli_node_add(ac, &ac->topic_node, &alis_topic_unindexed);
+			ac->topic_unindexed = true;
+			return;
+		}
+
+		(void) mowgli_node_add(ac, &ac->trigram_nodes[ac->ntrigrams], &tg->channels);
+		ac->trigrams[ac->ntrigrams++] = tg;
+	}
+}
+
+static struct alis_channel *
+alis_channel_add(struct channel *const restrict chptr)
+{
+	struct alis_channel *const ac = smalloc(sizeof *ac);
+
+	if (! hashmap_add(alis_channels, chptr->name, ac))
+	{
+		(void) sfree(ac);
+		return hashmap_retrieve(alis_channels, chptr->name);
+	}
+
+	ac->chan = chptr;
+
+	(void) alis_count_file(ac, chptr->nummembers);
+	(void) alis_topic_file(ac);
+
+	return ac;
+}
+
+static void
+alis_channel_delete(struct alis_channel *const restrict ac)
+{
+	(void) mowgli_node_delete(&ac->count_node, &alis_counts[ac->count]);
+	(void) alis_topic_unfile(ac);
+	(void) hashmap_delete(alis_channels, ac->chan->name);
+	(void) sfree(ac);
+}
+
+static void
+alis_index_destroy(void)
+{
+	struct hashmap_iter iter;
+	struct alis_channel *ac;
+	struct alis_trigram *tg;
+
+	if (! alis_indexed)
+		return;
+
+	HASHMAP_FOREACH(ac, &iter, alis_channels)
+	{
+		(void) sfree(ac->trigram_nodes);
+		(void) sfree(ac->trigrams);
+		(void) sfree(ac);
+	}
+
+	HASHMAP_FOREACH(tg, &iter, alis_trigrams)
+		(void) sfree(tg);
+
+	(void) hashmap_destroy(alis_channels);
+	(void) hashmap_destroy(alis_trigrams);
+	(void) sfree(alis_counts);
+
+	alis_counts = NULL;
+	alis_ncounts = 0;
+	(void) memset(&alis_topic_unindexed, 0x00, sizeof alis_topic_unindexed);
+
+	alis_indexed = false;
+}
+
+/* Builds the indexes if they are not there yet. A channel that was created
+ * without any of the hooks below being called shows up as a difference in
+ * the number of channels, and a new casemapping folds topics differently,
+ * so they are rebuilt then.
+ */
+static void
+alis_index_ensure(void)
+{
+	struct channel *chptr;
+	mowgli_patricia_iteration_state_t state;
+
+	if (alis_indexed && alis_indexed_mapping == match_mapping && hashmap_size(alis_channels) == cnt.chan)
+		return;
+
+	(void) alis_index_destroy();
+
+	alis_channels = hashmap_create(true);
+	alis_trigrams = hashmap_create(false);
+	alis_indexed_mapping = match_mapping;
+	alis_indexed = true;
+
+	MOWGLI_PATRICIA_FOREACH(chptr, &state, chanlist)
+		(void) alis_channel_add(chptr);
+
+	(void) slog(LG_DEBUG, "%s: indexed %zu channels (%zu topic trigrams)", __func__,
+	                      hashmap_size(alis_channels), hashmap_size(alis_trigrams));
+}
+
+static void
+alis_channel_refile_count(struct channel *const restrict chptr, const unsigned int count)
+{
+	struct alis_channel *ac;
+
+	if (! alis_indexed)
+		return;
+
+	// channels that services create themselves have no channel_add hook
+	if (! (ac = hashmap_retrieve(alis_channels, chptr->name)))
+		ac = alis_channel_add(chptr);
+
+	(void) alis_count_refile(ac, count);
+}
+
+static void
+alis_hook_channel_add(struct channel *const restrict chptr)
+{
+	if (alis_indexed)
+		(void) alis_channel_add(chptr);
+}
+
+static void
+alis_hook_channel_delete(struct channel *const restrict chptr)
+{
+	struct alis_channel *ac;
+
+	if (alis_indexed && (ac = hashmap_retrieve(alis_channels, chptr->name)))
+		(void) alis_channel_delete(ac);
+}
+
+static void
+alis_hook_channel_join(struct hook_channel_joinpart *const restrict hdata)
+{
+	// NULL if an earlier hook kicked the user again
+	if (hdata->cu)
+		(void) alis_channel_refile_count(hdata->cu->chan, hdata->cu->chan->nummembers);
+}
+
+static void
+alis_hook_channel_part(struct hook_channel_joinpart *const restrict hdata)
+{
+	// this is called before the user is removed; splits are filed by alis_hook_channel_split()
+	if (hdata->cu && ! hdata->split)
+		(void) alis_channel_refile_count(hdata->cu->chan, hdata->cu->chan->nummembers - 1U);
+}
+
+static void
+alis_hook_channel_split(struct hook_channel_split *const restrict hdata)
+{
+	(void) alis_channel_refile_count(hdata->c, hdata->c->nummembers - (unsigned int) hdata->count);
+}
+
+static void
+alis_hook_channel_topic(struct channel *const restrict chptr)
+{
+	struct alis_channel *ac;
+
+	if (! alis_indexed)
+		return;
+
+	if (! (ac = hashmap_retrieve(alis_channels, chptr->name)))
+		ac = alis_channel_add(chptr);
+	else
+		(void) alis_topic_unfile(ac);
+
+	(void) alis_topic_file(ac);
+}
+
+/* The trigram of the literal parts of a topic mask that the fewest topics
+ * have, or NULL if the mask has none (or escapes, which are not worth the
+ * trouble). Every topic that the mask matches has it.
+ */
+static const struct alis_trigram *
+alis_topic_trigram(const char *const restrict mask, bool *const restrict usable)
+{
+	const struct alis_trigram *best = NULL;
+	size_t run = 0;
+
+	*usable = false;
+
+	if (strchr(mask, '\\'))
+		return NULL;
+
+	for (const char *p = mask; *p; p++)
+	{
+		if (strchr("*?&#%", *p))
+		{
+			run = 0;
+			continue;
+		}
+
+		if (++run < 3)
+			continue;
+
+		const char key[4] = { (char) ToLower(p[-2]), (char) ToLower(p[-1]), (char) ToLower(p[0]), '\0' };
+		const struct alis_trigram *const tg = hashmap_retrieve(alis_trigrams, key);
+
+		// no indexed topic has this trigram
+		if (! tg)
+		{
+			*usable = true;
+			return NULL;
+		}
+
+		if (! best || MOWGLI_LIST_LENGTH(&tg->channels) < MOWGLI_LIST_LENGTH(&best->channels))
+			best = tg;
+	}
+
+	*usable = (best != NULL);
+	return best;
+}
+
+struct alis_candidate
+{
+	struct channel *        chan;
+	char *                  key;            // canonical name, as chanlist sorts it
+};
+
+static int
+alis_candidate_cmp(const void *const a, const void *const b)
+{
+	return strcmp(((const struct alis_candidate *) a)->key, ((const struct alis_candidate *) b)->key);
+}
+
+static void
+alis_candidate_add(struct alis_candidate **const restrict cand, size_t *const restrict count, struct channel *chptr)
+{
+	struct alis_candidate *const c = &(*cand)[(*count)++];
+
+	c->chan = chptr;
+	c->key = sstrdup(chptr->name);
+
+	(void) irccasecanon(c->key);
+}
+
+/* alis_collect_candidates()
+ *
+ * Collects the channels that the smallest applicable index says can match
+ * the query, in the order chanlist would be walked in, so that -skip and
+ * -maxmatches see the same channels as they would with a full walk.
+ *
+ * Returns false (and collects nothing) if no index would save anything
+ * over walking every channel.
+ */
+static bool
+alis_collect_candidates(const struct alis_query *const restrict query, struct alis_candidate **const restrict cand,
+                        size_t *const restrict ncand)
+{
+	const struct alis_trigram *tg = NULL;
+	bool use_topic = false;
+	size_t topic_estimate = SIZE_MAX;
+	size_t count_estimate = SIZE_MAX;
+	unsigned int first = 0, last = 0;
+
+	*cand = NULL;
+	*ncand = 0;
+
+	if (! query->min && ! query->max && ! *query->topic)
 		return false;
 
-	if (*query->topic && match(query->topic, chptr->topic))
+	(void) alis_index_ensure();
+
+	if (query->min || query->max)
+	{
+		first = query->min;
+		last = (query->max && query->max < alis_ncounts) ? query->max : (alis_ncounts - 1U);
+		count_estimate = 0;
+
+		for (unsigned int i = first; i <= last && i < alis_ncounts; i++)
+			count_estimate += MOWGLI_LIST_LENGTH(&alis_counts[i]);
+	}
+
+	if (*query->topic)
+	{
+		tg = alis_topic_trigram(query->topic, &use_topic);
+
+		if (use_topic)
+			topic_estimate = (tg ? MOWGLI_LIST_LENGTH(&tg->channels) : 0) +
+			                 MOWGLI_LIST_LENGTH(&alis_topic_unindexed);
+	}
+
+	if (count_estimate >= cnt.chan && topic_estimate >= cnt.chan)
 		return false;
 
+	mowgli_node_t *n;
+
+	if (topic_estimate < count_estimate)
+	{
+		*cand = smalloc((topic_estimate ? topic_estimate : 1U) * sizeof **cand);
+
+		if (tg)
+			MOWGLI_ITER_FOREACH(n, tg->channels.head)
+				(void) alis_candidate_add(cand, ncand, ((const struct alis_channel *) n->data)->chan);
+
+		MOWGLI_ITER_FOREACH(n, alis_topic_unindexed.head)
+			(void) alis_candidate_add(cand, ncand, ((const struct alis_channel *) n->data)->chan);
+	}
+	else
+	{
+		*cand = smalloc((count_estimate ? count_estimate : 1U) * sizeof **cand);
+
+		for (unsigned int i = first; i <= last && i < alis_ncounts; i++)
+			MOWGLI_ITER_FOREACH(n, alis_counts[i].head)
+				(void) alis_candidate_add(cand, ncand, ((const struct alis_channel *) n->data)->chan);
+	}
+
+	(void) qsort(*cand, *ncand, sizeof **cand, &alis_candidate_cmp);
+
 	return true;
 }
 
+// Returns false once the maximum number of matches has been shown
+static bool
+alis_list_channel(struct sourceinfo *const restrict si, struct alis_query *const restrict query,
+                  const struct channel *const restrict chptr)
+{
+	if (! alis_show_channel(query, chptr))
+		return true;
+
+	if (query->skip)
+	{
+		query->skip--;
+		return true;
+	}
+
+	(void) alis_print_channel(si, query, chptr);
+
+	if (--query->match_limit)
+		return true;
+
+	(void) command_success_nodata(si, _("Maximum channel output reached"));
+	return false;
+}
+
 static void
 alis_cmd_list_func(struct sourceinfo *const restrict si, const int parc, char **const restrict parv)
 {
@@ -403,28 +866,35 @@ alis_cmd_list_func(struct sourceinfo *const restrict si, const int parc, char **
 
 	struct channel *chptr;
 	mowgli_patricia_iteration_state_t state;
+	struct alis_candidate *cand;
+	size_t ncand;
 
-	MOWGLI_PATRICIA_FOREACH(chptr, &state, chanlist)
-	{
-		if (! alis_show_channel(&query, chptr))
-			continue;
+	// every channel is matched against the same masks
+	query.mask_pattern = match_compile(query.mask);
+	query.topic_pattern = match_compile(query.topic);
 
-		if (query.skip)
-		{
-			query.skip--;
-			continue;
-		}
+	if (alis_collect_candidates(&query, &cand, &ncand))
+	{
+		size_t i;
 
-		(void) alis_print_channel(si, &query, chptr);
+		for (i = 0; i < ncand && alis_list_channel(si, &query, cand[i].chan); i++)
+			(void) sfree(cand[i].key);
 
-		if (--query.match_limit)
-			continue;
+		for (/* */; i < ncand; i++)
+			(void) sfree(cand[i].key);
 
-		(void) command_success_nodata(si, _("Maximum channel output reached"));
-		break;
+		(void) sfree(cand);
+	}
+	else
+	{
+		MOWGLI_PATRICIA_FOREACH(chptr, &state, chanlist)
+			if (! alis_list_channel(si, &query, chptr))
+				break;
 	}
 
 end:
+	(void) match_pattern_free(query.mask_pattern);
+	(void) match_pattern_free(query.topic_pattern);
 	(void) command_success_nodata(si, _("End of output."));
 
 	if (query.show_secret)
@@ -488,11 +958,27 @@ mod_init(struct module *const restrict m)
 
 	(void) service_bind_command(alissvs, &alis_cmd_list);
 	(void) service_bind_command(alissvs, &alis_cmd_help);
+
+	(void) hook_add_channel_add(&alis_hook_channel_add);
+	(void) hook_add_channel_delete(&alis_hook_channel_delete);
+	(void) hook_add_channel_join(&alis_hook_channel_join);
+	(void) hook_add_channel_part(&alis_hook_channel_part);
+	(void) hook_add_channel_split(&alis_hook_channel_split);
+	(void) hook_add_channel_topic(&alis_hook_channel_topic);
 }
 
 static void
 mod_deinit(const enum module_unload_intent ATHEME_VATTR_UNUSED intent)
 {
+	(void) hook_del_channel_add(&alis_hook_channel_add);
+	(void) hook_del_channel_delete(&alis_hook_channel_delete);
+	(void) hook_del_channel_join(&alis_hook_channel_join);
+	(void) hook_del_channel_part(&alis_hook_channel_part);
+	(void) hook_del_channel_split(&alis_hook_channel_split);
+	(void) hook_del_channel_topic(&alis_hook_channel_topic);
+
+	(void) alis_index_destroy();
+
 	(void) del_conf_item("MAXMATCHES", &alissvs->conf_table);
 	(void) service_delete(alissvs);
 }
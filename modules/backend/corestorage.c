@@ -30,6 +30,9 @@ static time_t db_time;
 
 static bool mdep_load_mdeps = true;
 
+// memo texts read from MB rows, until the database has been loaded
+static struct hashmap *memo_bodies = NULL;
+
 #ifdef HAVE_FORK
 static pid_t child_pid;
 #endif
@@ -52,6 +55,7 @@ corestorage_db_save(struct database_handle *db)
 	mowgli_node_t *n, *tn;
 	mowgli_patricia_iteration_state_t state;
 	struct myentity_iteration_state mestate;
+	struct hashmap *memo_texts;
 
 	errno = 0;
 
@@ -86,6 +90,8 @@ corestorage_db_save(struct database_handle *db)
 
 	slog(LG_DEBUG, "db_save(): saving myusers");
 
+	memo_texts = hashmap_create(false);
+
 	MYENTITY_FOREACH_T(ment, &mestate, ENT_USER)
 	{
 		mu = user(ment);
@@ -123,10 +129,41 @@ corestorage_db_save(struct database_handle *db)
 			}
 		}
 
-		MOWGLI_ITER_FOREACH(tn, mu->memos.head)
+		MOWGLI_ITER_FOREACH(tn, myuser_cold_ro(mu)->memos.head)
 		{
 			struct mymemo *mz = (struct mymemo *)tn->data;
 
+			/* The text of a memo that was sent to many accounts is written
+			 * once as MB <body> <text>, and each copy as
+			 * MM <name> <sender> <sent> <status> <body>
+			 */
+			if (strshare_refcount(mz->text) > 1)
+			{
+				char key[32];
+				uintptr_t id;
+
+				snprintf(key, sizeof key, "%p", (const void *) mz->text);
+				if ((id = (uintptr_t) hashmap_retrieve(memo_texts, key)) == 0)
+				{
+					id = hashmap_size(memo_texts) + 1;
+					(void) hashmap_add(memo_texts, key, (void *) id);
+
+					db_start_row(db, "MB");
+					db_write_uint(db, (unsigned int) id);
+					db_write_str(db, mz->text);
+					db_commit_row(db);
+				}
+
+				db_start_row(db, "MM");
+				db_write_word(db, entity(mu)->name);
+				db_write_word(db, mz->sender);
+				db_write_time(db, mz->sent);
+				db_write_uint(db, mz->status);
+				db_write_uint(db, (unsigned int) id);
+				db_commit_row(db);
+				continue;
+			}
+
 			db_start_row(db, "ME");
 			db_write_word(db, entity(mu)->name);
 			db_write_word(db, mz->sender);
@@ -136,7 +173,7 @@ corestorage_db_save(struct database_handle *db)
 			db_commit_row(db);
 		}
 
-		MOWGLI_ITER_FOREACH(tn, mu->memo_ignores.head)
+		MOWGLI_ITER_FOREACH(tn, myuser_cold_ro(mu)->memo_ignores.head)
 		{
 			db_start_row(db, "MI");
 			db_write_word(db, entity(mu)->name);
@@ -144,7 +181,7 @@ corestorage_db_save(struct database_handle *db)
 			db_commit_row(db);
 		}
 
-		MOWGLI_ITER_FOREACH(tn, mu->access_list.head)
+		MOWGLI_ITER_FOREACH(tn, myuser_cold_ro(mu)->access_list.head)
 		{
 			db_start_row(db, "AC");
 			db_write_word(db, entity(mu)->name);
@@ -170,7 +207,7 @@ corestorage_db_save(struct database_handle *db)
 			db_commit_row(db);
 		}
 
-		MOWGLI_ITER_FOREACH(tn, mu->cert_fingerprints.head)
+		MOWGLI_ITER_FOREACH(tn, myuser_cold_ro(mu)->cert_fingerprints.head)
 		{
 			struct mycertfp *mcfp = tn->data;
 
@@ -181,6 +218,8 @@ corestorage_db_save(struct database_handle *db)
 		}
 	}
 
+	hashmap_destroy(memo_texts);
+
 	// XXX: groupserv hack.  remove when we have proper dependency resolution. --nenolod
 	hook_call_db_write_pre_ca(db);
 
@@ -533,7 +572,6 @@ corestorage_h_me(struct database_handle *db, const char *type)
 	time_t sent;
 	unsigned int status;
 	struct myuser *mu;
-	struct mymemo *mz;
 
 	dest = db_sread_word(db);
 	src = db_sread_word(db);
@@ -547,16 +585,80 @@ corestorage_h_me(struct database_handle *db, const char *type)
 		return;
 	}
 
-	mz = smalloc(sizeof *mz);
-	mowgli_strlcpy(mz->sender, src, sizeof mz->sender);
-	mowgli_strlcpy(mz->text, text, sizeof mz->text);
-	mz->sent = sent;
-	mz->status = status;
+	(void) mymemo_add(mu, src, text, sent, status);
+}
+
+static void
+corestorage_h_mb(struct database_handle *db, const char *type)
+{
+	char key[16];
+	unsigned int id;
+	const char *text;
+
+	id = db_sread_uint(db);
+	text = db_sread_str(db);
+
+	if (memo_bodies == NULL)
+		memo_bodies = hashmap_create(false);
+
+	snprintf(key, sizeof key, "%u", id);
+	if (hashmap_retrieve(memo_bodies, key) != NULL)
+	{
+		slog(LG_DEBUG, "db-h-mb: line %u: duplicate memo text %u", db->line, id);
+		return;
+	}
+
+	(void) hashmap_add(memo_bodies, key, (void *)(uintptr_t) strshare_get(text));
+}
+
+static void
+corestorage_h_mm(struct database_handle *db, const char *type)
+{
+	char key[16];
+	const char *dest, *src;
+	time_t sent;
+	unsigned int status, id;
+	struct myuser *mu;
+	stringref text, sender;
+
+	dest = db_sread_word(db);
+	src = db_sread_word(db);
+	sent = db_sread_time(db);
+	status = db_sread_uint(db);
+	id = db_sread_uint(db);
+
+	snprintf(key, sizeof key, "%u", id);
+	if (memo_bodies == NULL || (text = hashmap_retrieve(memo_bodies, key)) == NULL)
+	{
+		slog(LG_DEBUG, "db-h-mm: line %u: memo for %s with unknown text %u", db->line, dest, id);
+		return;
+	}
+
+	if (!(mu = myuser_find(dest)))
+	{
+		slog(LG_DEBUG, "db-h-mm: line %u: memo for unknown account %s", db->line, dest);
+		return;
+	}
 
-	if (!(mz->status & MEMO_READ))
-		mu->memoct_new++;
+	sender = strshare_get(src);
+	(void) mymemo_add_shared(mu, sender, text, sent, status);
+	strshare_unref(sender);
+}
 
-	mowgli_node_add(mz, mowgli_node_create(), &mu->memos);
+static void
+corestorage_memo_bodies_release(void)
+{
+	struct hashmap_iter iter;
+	stringref text;
+
+	if (memo_bodies == NULL)
+		return;
+
+	HASHMAP_FOREACH(text, &iter, memo_bodies)
+		strshare_unref(text);
+
+	hashmap_destroy(memo_bodies);
+	memo_bodies = NULL;
 }
 
 static void
@@ -575,7 +677,7 @@ corestorage_h_mi(struct database_handle *db, const char *type)
 		return;
 	}
 
-	mowgli_node_add(sstrdup(target), mowgli_node_create(), &mu->memo_ignores);
+	mowgli_node_add(sstrdup(target), mowgli_node_create(), &myuser_cold(mu)->memo_ignores);
 }
 
 static void
@@ -1047,6 +1149,8 @@ corestorage_db_load(const char *filename)
 
 	db_parse(db);
 	db_close(db);
+
+	corestorage_memo_bodies_release();
 }
 
 static void
@@ -1146,6 +1250,8 @@ mod_init(struct module *const restrict m)
 	db_register_type_handler("TS", corestorage_h_ts);
 	db_register_type_handler("MU", corestorage_h_mu);
 	db_register_type_handler("ME", corestorage_h_me);
+	db_register_type_handler("MB", corestorage_h_mb);
+	db_register_type_handler("MM", corestorage_h_mm);
 	db_register_type_handler("MI", corestorage_h_mi);
 	db_register_type_handler("AC", corestorage_h_ac);
 	db_register_type_handler("MN", corestorage_h_mn);
@@ -252,16 +252,12 @@ bs_join_registered(bool all)
 
 		if (all)
 		{
-			join(mc->name, md->value);
-			if (mc->chan && cs && chanuser_find(mc->chan, chansvs.me->me))
-				part(mc->name, chansvs.nick);
+			join_schedule(mc->name, md->value, cs ? chansvs.nick : NULL);
 			continue;
 		}
 		else if (mc->chan != NULL && mc->chan->members.count != 0)
 		{
-			join(mc->name, md->value);
-			if (mc->chan && cs && chanuser_find(mc->chan, chansvs.me->me))
-				part(mc->name, chansvs.nick);
+			join_schedule(mc->name, md->value, cs ? chansvs.nick : NULL);
 			continue;
 		}
 	}
@@ -918,6 +914,10 @@ on_shutdown(void *unused)
 {
 	mowgli_node_t *n;
 
+	// the bots stay on the network across a warm restart
+	if (runflags & RF_WARM)
+		return;
+
 	MOWGLI_ITER_FOREACH(n, bs_bots.head)
 	{
 		struct botserv_bot *bot = (struct botserv_bot *) n->data;
@@ -953,12 +953,22 @@ bs_join(struct hook_channel_joinpart *hdata)
 	if (bot == NULL)
 	{
 		if (chan->nummembers == 1 && mc->flags & MC_GUARD)
-			join(chan->name, chansvs.nick);
+		{
+			if (me.bursting)
+				join_schedule(chan->name, chansvs.nick, NULL);
+			else
+				join(chan->name, chansvs.nick);
+		}
 	}
 	else
 	{
 		if (chan->nummembers == 1)
-			join(chan->name, bot->nick);
+		{
+			if (me.bursting)
+				join_schedule(chan->name, bot->nick, NULL);
+			else
+				join(chan->name, bot->nick);
+		}
 
 		if (u->server->flags & SF_EOB &&
 				(md = metadata_find(mc, "private:entrymsg")) != NULL)
@@ -977,7 +987,7 @@ bs_part(struct hook_channel_joinpart *hdata)
 	struct botserv_bot *bot;
 
 	cu = hdata->cu;
-	if (cu == NULL)
+	if (cu == NULL || hdata->split)
 		return;
 
 	mc = mychan_from(cu->chan);
@@ -1014,6 +1024,46 @@ bs_part(struct hook_channel_joinpart *hdata)
 	}
 }
 
+// Same as bs_part(), once for all the members of a channel that left in a netsplit.
+static void
+bs_split(struct hook_channel_split *hdata)
+{
+	struct mychan *mc;
+	struct botserv_bot *bot;
+	size_t i;
+
+	mc = mychan_from(hdata->c);
+	if (mc == NULL)
+		return;
+
+	// chanserv's function handles those
+	if (metadata_find(mc, "private:botserv:bot-assigned") == NULL)
+		return;
+
+	bot = bs_mychan_find_bot(mc);
+	if ((CURRTIME - mc->used) >= SECONDS_PER_HOUR)
+	{
+		for (i = 0; i < hdata->count; i++)
+		{
+			if (chanacs_user_flags(mc, hdata->members[i]->user) & CA_USEDUPDATE)
+			{
+				mc->used = CURRTIME;
+				break;
+			}
+		}
+	}
+
+	if (config_options.leave_chans
+			&& !(mc->flags & MC_INHABIT)
+			&& (hdata->c->nummembers - hdata->c->numsvcmembers == hdata->count))
+	{
+		if (bot)
+			part(hdata->c->name, bot->nick);
+		else
+			part(hdata->c->name, chansvs.nick);
+	}
+}
+
 static struct command bs_bot = {
 	.name           = "BOT",
 	.desc           = N_("Maintains network bot list."),
@@ -1087,6 +1137,7 @@ mod_init(struct module *const restrict m)
 	hook_add_operserv_info(osinfo_hook);
 	hook_add_first_channel_join(bs_join);
 	hook_add_channel_part(bs_part);
+	hook_add_channel_split(bs_split);
 
 	modestack_mode_simple = bs_modestack_mode_simple;
 	modestack_mode_limit  = bs_modestack_mode_limit;
@@ -24,6 +24,11 @@
 #define CHANFIX_GATHER_INTERVAL (5U * SECONDS_PER_MINUTE)
 #define CHANFIX_EXPIRE_INTERVAL SECONDS_PER_HOUR
 
+/* Channels scored per step of a gather pass; the steps are a second apart,
+ * so a pass over 80000 opped channels takes well under CHANFIX_GATHER_INTERVAL.
+ */
+#define CHANFIX_GATHER_SLICE    1024U
+
 /* This value has been chosen such that the maximum score is about 8064,
  * which is the number of CHANFIX_GATHER_INTERVALs in CHANFIX_RETENTION_TIME.
  * Higher scores would decay more than they can gain (12 per hour).
@@ -37,6 +42,8 @@ struct chanfix_channel
 	char *name;
 
 	mowgli_list_t oprecords;
+	struct hashmap *oprecord_index;         // by entity ID or user@host
+	unsigned int decay_epoch;               // chanfix_decay_epoch when the records were last decayed
 	time_t ts;
 	time_t lastupdate;
 
@@ -44,6 +51,9 @@ struct chanfix_channel
 
 	time_t fix_started;
 	bool fix_requested;
+
+	mowgli_node_t gather_node;              // in the gather queue while the channel has ops
+	bool gathering;
 };
 
 struct chanfix_oprecord
@@ -70,12 +80,46 @@ struct chanfix_persist_record
 	mowgli_heap_t *chanfix_oprecord_heap;
 
 	mowgli_patricia_t *chanfix_channels;
+
+	mowgli_list_t chanfix_gather_queue;
+	unsigned int chanfix_decay_epoch;
+};
+
+/* What version 2 of the persist record and its channels looked like, so that
+ * a reload from it can convert them; op records have not changed since.
+ */
+struct chanfix_channel_v2
+{
+	struct atheme_object parent;
+
+	char *name;
+
+	mowgli_list_t oprecords;
+	time_t ts;
+	time_t lastupdate;
+
+	struct channel *chan;
+
+	time_t fix_started;
+	bool fix_requested;
+};
+
+struct chanfix_persist_record_v2
+{
+	int version;
+
+	mowgli_heap_t *chanfix_channel_heap;
+	mowgli_heap_t *chanfix_oprecord_heap;
+
+	mowgli_patricia_t *chanfix_channels;
 };
 
 extern struct service *chanfix;
 extern mowgli_patricia_t *chanfix_channels;
+extern unsigned int chanfix_decay_epoch;
 
 void chanfix_gather_init(struct chanfix_persist_record *);
+void chanfix_gather_init_v2(struct chanfix_persist_record_v2 *);
 void chanfix_gather_deinit(struct chanfix_persist_record *);
 
 void chanfix_oprecord_update(struct chanfix_channel *chan, struct user *u);
@@ -85,6 +129,8 @@ struct chanfix_oprecord *chanfix_oprecord_find(struct chanfix_channel *chan, str
 struct chanfix_channel *chanfix_channel_create(const char *name, struct channel *chan);
 struct chanfix_channel *chanfix_channel_find(const char *name);
 struct chanfix_channel *chanfix_channel_get(struct channel *chan);
+void chanfix_channel_decay(struct chanfix_channel *chan);
+void chanfix_gather_watch(struct channel *ch);
 void chanfix_gather(void *unused);
 void chanfix_expire(void *unused);
 
@@ -195,6 +195,9 @@ chanfix_fix_channel(struct chanfix_channel *chan)
 	// flush the modestacker.
 	modestack_flush_channel(ch);
 
+	// our own modes do not go through the mode change hook
+	chanfix_gather_watch(ch);
+
 	// now report the damage
 	msg(chanfix->me->nick, chan->name, "\2%u\2 clients should have been opped.", opped);
 
@@ -315,6 +318,8 @@ chanfix_autofix_ev(void *unused)
 
 		if (chanfix_should_handle(chan, chan->chan))
 		{
+			chanfix_channel_decay(chan);
+
 			if (chan->fix_started == 0)
 			{
 				if (chanfix_can_start_fix(chan))
@@ -469,6 +474,8 @@ chanfix_cmd_fix(struct sourceinfo *si, int parc, char *parv[])
 		return;
 	}
 
+	chanfix_channel_decay(chan);
+
 	highscore = chanfix_get_highscore(chan);
 	if (highscore < CHANFIX_MIN_FIX_SCORE)
 	{
@@ -516,6 +523,8 @@ chanfix_cmd_scores(struct sourceinfo *si, int parc, char *parv[])
 		return;
 	}
 
+	chanfix_channel_decay(chan);
+
 	// sort records by score.
 	mowgli_list_sort(&chan->oprecords, chanfix_compare_records, NULL);
 
@@ -580,6 +589,8 @@ chanfix_cmd_info(struct sourceinfo *si, int parc, char *parv[])
 		return;
 	}
 
+	chanfix_channel_decay(chan);
+
 	// sort records by score.
 	mowgli_list_sort(&chan->oprecords, chanfix_compare_records, NULL);
 
@@ -831,6 +842,9 @@ chanfix_can_register(struct hook_channel_register_check *req)
 	chan = chanfix_channel_find(req->name);
 	if (chan == NULL)
 		return;
+
+	chanfix_channel_decay(chan);
+
 	highscore = chanfix_get_highscore(chan);
 	if (highscore < CHANFIX_MIN_FIX_SCORE)
 		return;
@@ -17,10 +17,62 @@ static unsigned int loading_cfdbv = 0;
 static mowgli_heap_t *chanfix_channel_heap = NULL;
 static mowgli_heap_t *chanfix_oprecord_heap = NULL;
 static mowgli_eventloop_timer_t *chanfix_gather_timer = NULL;
+static mowgli_eventloop_timer_t *chanfix_gather_slice_timer = NULL;
 static mowgli_eventloop_timer_t *chanfix_expire_timer = NULL;
 
+/* Channels that had ops when they were last looked at, in the order the
+ * gather pass visits them. A channel joins it from the join and mode hooks
+ * and leaves it once a pass finds it opless or registered.
+ */
+static mowgli_list_t chanfix_gather_queue;
+static mowgli_node_t *chanfix_gather_cursor = NULL;
+static unsigned int chanfix_gather_chans = 0;
+static unsigned int chanfix_gather_oprecords = 0;
+
 mowgli_patricia_t *chanfix_channels = NULL;
 
+/* Bumped by chanfix_expire(); records are decayed once for every epoch that
+ * has passed when their channel is next looked at.
+ */
+unsigned int chanfix_decay_epoch = 0;
+
+static void
+chanfix_oprecord_key(char *const restrict buf, const size_t bufsize, const char *const restrict user,
+                     const char *const restrict host)
+{
+	// An entity ID never contains '@', so the two kinds of key cannot collide
+	(void) snprintf(buf, bufsize, "%s@%s", user, host);
+}
+
+static void
+chanfix_oprecord_index(struct chanfix_oprecord *orec)
+{
+	char key[USERLEN + 1 + HOSTLEN + 1];
+
+	if (orec->entity != NULL)
+		(void) hashmap_add(orec->chan->oprecord_index, orec->entity->id, orec);
+
+	if (*orec->user == '\0' && *orec->host == '\0')
+		return;
+
+	chanfix_oprecord_key(key, sizeof key, orec->user, orec->host);
+	(void) hashmap_add(orec->chan->oprecord_index, key, orec);
+}
+
+static void
+chanfix_oprecord_unindex(struct chanfix_oprecord *orec)
+{
+	char key[USERLEN + 1 + HOSTLEN + 1];
+
+	if (orec->entity != NULL && hashmap_retrieve(orec->chan->oprecord_index, orec->entity->id) == orec)
+		(void) hashmap_delete(orec->chan->oprecord_index, orec->entity->id);
+
+	chanfix_oprecord_key(key, sizeof key, orec->user, orec->host);
+
+	if (hashmap_retrieve(orec->chan->oprecord_index, key) == orec)
+		(void) hashmap_delete(orec->chan->oprecord_index, key);
+}
+
 struct chanfix_oprecord *
 chanfix_oprecord_create(struct chanfix_channel *chan, struct user *u)
 {
@@ -48,6 +100,8 @@ chanfix_oprecord_create(struct chanfix_channel *chan, struct user *u)
 
 		mowgli_strlcpy(orec->user, u->user, sizeof orec->user);
 		mowgli_strlcpy(orec->host, u->vhost, sizeof orec->host);
+
+		chanfix_oprecord_index(orec);
 	}
 
 	mowgli_node_add(orec, &orec->node, &chan->oprecords);
@@ -58,23 +112,18 @@ chanfix_oprecord_create(struct chanfix_channel *chan, struct user *u)
 struct chanfix_oprecord *
 chanfix_oprecord_find(struct chanfix_channel *chan, struct user *u)
 {
-	mowgli_node_t *n;
+	struct chanfix_oprecord *orec;
+	char key[USERLEN + 1 + HOSTLEN + 1];
 
 	return_val_if_fail(chan != NULL, NULL);
 	return_val_if_fail(u != NULL, NULL);
 
-	MOWGLI_ITER_FOREACH(n, chan->oprecords.head)
-	{
-		struct chanfix_oprecord *orec = n->data;
+	if (u->myuser != NULL && (orec = hashmap_retrieve(chan->oprecord_index, entity(u->myuser)->id)) != NULL)
+		return orec;
 
-		if (orec->entity != NULL && orec->entity == entity(u->myuser))
-			return orec;
+	chanfix_oprecord_key(key, sizeof key, u->user, u->vhost);
 
-		if (!irccasecmp(orec->user, u->user) && !irccasecmp(orec->host, u->vhost))
-			return orec;
-	}
-
-	return NULL;
+	return hashmap_retrieve(chan->oprecord_index, key);
 }
 
 void
@@ -92,7 +141,10 @@ chanfix_oprecord_update(struct chanfix_channel *chan, struct user *u)
 		orec->lastevent = CURRTIME;
 
 		if (orec->entity == NULL && u->myuser != NULL)
+		{
 			orec->entity = entity(u->myuser);
+			(void) hashmap_add(chan->oprecord_index, orec->entity->id, orec);
+		}
 
 		return;
 	}
@@ -106,10 +158,25 @@ chanfix_oprecord_delete(struct chanfix_oprecord *orec)
 {
 	return_if_fail(orec != NULL);
 
+	chanfix_oprecord_unindex(orec);
+
 	mowgli_node_delete(&orec->node, &orec->chan->oprecords);
 	mowgli_heap_free(chanfix_oprecord_heap, orec);
 }
 
+static void
+chanfix_gather_unwatch(struct chanfix_channel *chan)
+{
+	if (! chan->gathering)
+		return;
+
+	if (chanfix_gather_cursor == &chan->gather_node)
+		chanfix_gather_cursor = chanfix_gather_cursor->next;
+
+	mowgli_node_delete(&chan->gather_node, &chanfix_gather_queue);
+	chan->gathering = false;
+}
+
 static void
 chanfix_channel_delete(struct chanfix_channel *c)
 {
@@ -118,6 +185,7 @@ chanfix_channel_delete(struct chanfix_channel *c)
 	return_if_fail(c != NULL);
 
 	mowgli_patricia_delete(chanfix_channels, c->name);
+	chanfix_gather_unwatch(c);
 
 	MOWGLI_ITER_FOREACH_SAFE(n, tn, c->oprecords.head)
 	{
@@ -126,6 +194,8 @@ chanfix_channel_delete(struct chanfix_channel *c)
 		chanfix_oprecord_delete(orec);
 	}
 
+	hashmap_destroy(c->oprecord_index);
+
 	sfree(c->name);
 	mowgli_heap_free(chanfix_channel_heap, c);
 }
@@ -143,6 +213,8 @@ chanfix_channel_create(const char *name, struct channel *chan)
 	c->name = sstrdup(name);
 	c->chan = chan;
 	c->fix_started = 0;
+	c->oprecord_index = hashmap_create(true);
+	c->decay_epoch = chanfix_decay_epoch;
 
 	if (c->chan != NULL)
 		c->ts = c->chan->ts;
@@ -166,6 +238,69 @@ chanfix_channel_get(struct channel *chan)
 	return mowgli_patricia_retrieve(chanfix_channels, chan->name);
 }
 
+/* chanfix_channel_decay()
+ *
+ * Applies the decay of every expiry interval that has passed since the
+ * channel was last looked at, and deletes the records that it brings down to
+ * nothing or that have not been seen for CHANFIX_RETENTION_TIME. Call this
+ * before reading the scores of a channel.
+ */
+void
+chanfix_channel_decay(struct chanfix_channel *chan)
+{
+	mowgli_node_t *n, *tn;
+	unsigned int epochs;
+
+	return_if_fail(chan != NULL);
+
+	epochs = chanfix_decay_epoch - chan->decay_epoch;
+	if (epochs == 0)
+		return;
+
+	chan->decay_epoch = chanfix_decay_epoch;
+
+	MOWGLI_ITER_FOREACH_SAFE(n, tn, chan->oprecords.head)
+	{
+		struct chanfix_oprecord *orec = n->data;
+
+		/* Simple exponential decay, rounding the decay up
+		 * so that low scores expire sooner.
+		 */
+		for (unsigned int i = 0; i < epochs && orec->age > 0; i++)
+			orec->age -= (orec->age + CHANFIX_EXPIRE_DIVISOR - 1) /
+				CHANFIX_EXPIRE_DIVISOR;
+
+		if (orec->age > 0 && CURRTIME - orec->lastevent < CHANFIX_RETENTION_TIME)
+			continue;
+
+		chanfix_oprecord_delete(orec);
+	}
+}
+
+/* chanfix_gather_watch()
+ *
+ * Puts a channel that has just gained an op in the gather queue, if it is
+ * not there already.
+ */
+void
+chanfix_gather_watch(struct channel *ch)
+{
+	struct chanfix_channel *chan;
+
+	return_if_fail(ch != NULL);
+
+	if ((chan = chanfix_channel_get(ch)) == NULL)
+		chan = chanfix_channel_create(ch->name, ch);
+
+	chan->chan = ch;
+
+	if (chan->gathering)
+		return;
+
+	mowgli_node_add(chan, &chan->gather_node, &chanfix_gather_queue);
+	chan->gathering = true;
+}
+
 static void
 chanfix_channel_add_ev(struct channel *ch)
 {
@@ -192,81 +327,127 @@ chanfix_channel_delete_ev(struct channel *ch)
 	if ((chan = chanfix_channel_get(ch)) != NULL)
 	{
 		chan->chan = NULL;
+		chanfix_gather_unwatch(chan);
 		return;
 	}
 
 	chanfix_channel_create(ch->name, NULL);
 }
 
-void
-chanfix_gather(void *unused)
+static void
+chanfix_channel_join_ev(struct hook_channel_joinpart *hdata)
 {
-	struct channel *ch;
-	mowgli_patricia_iteration_state_t state;
-	unsigned int chans = 0, oprecords = 0;
+	return_if_fail(hdata != NULL);
 
-	MOWGLI_PATRICIA_FOREACH(ch, &state, chanlist)
+	if (hdata->cu != NULL && (hdata->cu->modes & CSTATUS_OP))
+		chanfix_gather_watch(hdata->cu->chan);
+}
+
+static void
+chanfix_channel_mode_change_ev(struct hook_channel_mode_change *hdata)
+{
+	return_if_fail(hdata != NULL);
+
+	if (hdata->mvalue == CSTATUS_OP)
+		chanfix_gather_watch(hdata->cu->chan);
+}
+
+static void
+chanfix_channel_drop_ev(struct mychan *mc)
+{
+	return_if_fail(mc != NULL);
+
+	// The next pass finds out whether anybody is opped there
+	if (mc->chan != NULL)
+		chanfix_gather_watch(mc->chan);
+}
+
+static void
+chanfix_gather_slice(void *unused)
+{
+	unsigned int chans = 0;
+
+	chanfix_gather_slice_timer = NULL;
+
+	while (chanfix_gather_cursor != NULL && chans < CHANFIX_GATHER_SLICE)
 	{
-		struct mychan *mc;
-		mowgli_node_t *n;
-		struct chanfix_channel *chan;
+		struct chanfix_channel *chan = chanfix_gather_cursor->data;
+		struct chanuser_iter iter;
+		struct chanuser *cu;
+		unsigned int ops = 0;
 
-		if ((mc = mychan_find(ch->name)) != NULL)
+		chanfix_gather_cursor = chanfix_gather_cursor->next;
+		chans++;
+
+		if (chan->chan == NULL || mychan_find(chan->chan->name) != NULL)
+		{
+			chanfix_gather_unwatch(chan);
 			continue;
+		}
 
-		chan = chanfix_channel_get(ch);
-		if (chan == NULL)
-			chan = chanfix_channel_create(ch->name, ch);
+		chanfix_channel_decay(chan);
 
-		MOWGLI_ITER_FOREACH(n, ch->members.head)
+		CHANNEL_MEMBER_FOREACH(cu, &iter, chan->chan)
 		{
-			struct chanuser *cu = n->data;
-
 			if (cu->modes & CSTATUS_OP)
 			{
 				chanfix_oprecord_update(chan, cu->user);
-				oprecords++;
+				ops++;
 			}
 		}
 
-		chans++;
+		if (ops == 0)
+		{
+			chanfix_gather_unwatch(chan);
+			continue;
+		}
+
+		chanfix_gather_chans++;
+		chanfix_gather_oprecords += ops;
+	}
+
+	if (chanfix_gather_cursor != NULL)
+	{
+		chanfix_gather_slice_timer = mowgli_timer_add_once(base_eventloop, "chanfix_gather_slice",
+		                                                   chanfix_gather_slice, NULL, 1);
+		return;
 	}
 
-	slog(LG_DEBUG, "chanfix_gather(): gathered %u channels and %u oprecords.", chans, oprecords);
+	slog(LG_DEBUG, "chanfix_gather(): gathered %u channels and %u oprecords.",
+	     chanfix_gather_chans, chanfix_gather_oprecords);
 }
 
+/* chanfix_gather()
+ *
+ * Starts a pass over the channels in the gather queue, crediting every op
+ * with another interval. The pass runs in steps of CHANFIX_GATHER_SLICE
+ * channels.
+ */
 void
-chanfix_expire(void *unused)
+chanfix_gather(void *unused)
 {
-	struct chanfix_channel *chan;
-	mowgli_patricia_iteration_state_t state;
-
-	MOWGLI_PATRICIA_FOREACH(chan, &state, chanfix_channels)
+	if (chanfix_gather_slice_timer != NULL)
 	{
-		mowgli_node_t *n, *tn;
-
-		MOWGLI_ITER_FOREACH_SAFE(n, tn, chan->oprecords.head)
-		{
-			struct chanfix_oprecord *orec = n->data;
-
-			/* Simple exponential decay, rounding the decay up
-			 * so that low scores expire sooner.
-			 */
-			orec->age -= (orec->age + CHANFIX_EXPIRE_DIVISOR - 1) /
-				CHANFIX_EXPIRE_DIVISOR;
-
-			if (orec->age > 0 && CURRTIME - orec->lastevent < CHANFIX_RETENTION_TIME)
-				continue;
+		slog(LG_DEBUG, "chanfix_gather(): previous pass has not finished yet, skipping this one");
+		return;
+	}
 
-			chanfix_oprecord_delete(orec);
-		}
+	chanfix_gather_cursor = chanfix_gather_queue.head;
+	chanfix_gather_chans = 0;
+	chanfix_gather_oprecords = 0;
 
-		if (MOWGLI_LIST_LENGTH(&chan->oprecords) > 0 &&
-				CURRTIME - chan->lastupdate < CHANFIX_RETENTION_TIME)
-			continue;
+	chanfix_gather_slice(NULL);
+}
 
-		atheme_object_unref(chan);
-	}
+/* chanfix_expire()
+ *
+ * Starts a new decay epoch. The records themselves are decayed when their
+ * channel is next gathered, looked at, or written out.
+ */
+void
+chanfix_expire(void *unused)
+{
+	chanfix_decay_epoch++;
 }
 
 static void
@@ -285,6 +466,18 @@ write_chanfixdb(struct database_handle *db)
 	{
 		mowgli_node_t *n;
 
+		/* Every record is visited here anyway, so this is where the
+		 * decay catches up with the channels nobody has looked at.
+		 */
+		chanfix_channel_decay(chan);
+
+		if (! chan->gathering && (MOWGLI_LIST_LENGTH(&chan->oprecords) == 0 ||
+				CURRTIME - chan->lastupdate >= CHANFIX_RETENTION_TIME))
+		{
+			atheme_object_unref(chan);
+			continue;
+		}
+
 		db_start_row(db, "CFCHAN");
 		db_write_word(db, chan->name);
 		db_write_time(db, chan->ts);
@@ -384,6 +577,8 @@ db_h_cfop(struct database_handle *db, const char *type)
 	orec->lastevent = lastevent;
 
 	orec->age = age;
+
+	chanfix_oprecord_index(orec);
 }
 
 static void
@@ -403,9 +598,15 @@ db_h_cfmd(struct database_handle *db, const char *type)
 void
 chanfix_gather_init(struct chanfix_persist_record *rec)
 {
+	struct channel *ch;
+	mowgli_patricia_iteration_state_t state;
+
 	hook_add_db_write(write_chanfixdb);
 	hook_add_channel_add(chanfix_channel_add_ev);
 	hook_add_channel_delete(chanfix_channel_delete_ev);
+	hook_add_channel_join(chanfix_channel_join_ev);
+	hook_add_channel_mode_change(chanfix_channel_mode_change_ev);
+	hook_add_channel_drop(chanfix_channel_drop_ev);
 
 	db_register_type_handler("CFDBV", db_h_cfdbv);
 	db_register_type_handler("CFCHAN", db_h_cfchan);
@@ -421,6 +622,8 @@ chanfix_gather_init(struct chanfix_persist_record *rec)
 		chanfix_oprecord_heap = rec->chanfix_oprecord_heap;
 
 		chanfix_channels = rec->chanfix_channels;
+		chanfix_gather_queue = rec->chanfix_gather_queue;
+		chanfix_decay_epoch = rec->chanfix_decay_epoch;
 		return;
 	}
 
@@ -428,6 +631,77 @@ chanfix_gather_init(struct chanfix_persist_record *rec)
 	chanfix_oprecord_heap = mowgli_heap_create(sizeof(struct chanfix_oprecord), 32, BH_LAZY);
 
 	chanfix_channels = mowgli_patricia_create(irccasecanon);
+
+	// The first pass drops the channels that were opless before we were loaded
+	MOWGLI_PATRICIA_FOREACH(ch, &state, chanlist)
+		chanfix_gather_watch(ch);
+}
+
+/* chanfix_gather_init_v2()
+ *
+ * Like chanfix_gather_init(), for a reload from a module that kept its
+ * channels in the version 2 layout: they are copied into channels of the
+ * current layout, their op records are indexed, and every channel is
+ * watched as on a fresh load.
+ */
+void
+chanfix_gather_init_v2(struct chanfix_persist_record_v2 *rec)
+{
+	struct chanfix_persist_record converted = {
+		.chanfix_channel_heap   = mowgli_heap_create(sizeof(struct chanfix_channel), 32, BH_LAZY),
+		.chanfix_oprecord_heap  = rec->chanfix_oprecord_heap,
+		.chanfix_channels       = mowgli_patricia_create(irccasecanon),
+		.chanfix_decay_epoch    = 0,
+	};
+	struct chanfix_channel_v2 *old;
+	struct channel *ch;
+	mowgli_patricia_iteration_state_t state;
+	mowgli_node_t *n;
+
+	MOWGLI_PATRICIA_FOREACH(old, &state, rec->chanfix_channels)
+	{
+		struct chanfix_channel *const c = mowgli_heap_alloc(converted.chanfix_channel_heap);
+
+		atheme_object_init(atheme_object(c), old->name, (atheme_object_destructor_fn) chanfix_channel_delete);
+		c->parent.refcount = old->parent.refcount;
+		c->parent.metadata = old->parent.metadata;
+		c->parent.privatedata = old->parent.privatedata;
+#ifdef OBJECT_DEBUG
+		mowgli_node_delete(&old->parent.dnode, &object_list);
+#endif
+
+		c->name = old->name;
+		c->oprecords = old->oprecords;
+		c->oprecord_index = hashmap_create(true);
+		c->decay_epoch = converted.chanfix_decay_epoch;
+		c->ts = old->ts;
+		c->lastupdate = old->lastupdate;
+		c->chan = old->chan;
+		c->fix_started = old->fix_started;
+		c->fix_requested = old->fix_requested;
+
+		MOWGLI_ITER_FOREACH(n, c->oprecords.head)
+		{
+			struct chanfix_oprecord *const orec = n->data;
+
+			orec->chan = c;
+			chanfix_oprecord_index(orec);
+		}
+
+		mowgli_patricia_add(converted.chanfix_channels, c->name, c);
+	}
+
+	slog(LG_INFO, "chanfix_gather_init_v2(): converted %u channels from version 2 of the persist record",
+	     mowgli_patricia_size(converted.chanfix_channels));
+
+	mowgli_patricia_destroy(rec->chanfix_channels, NULL, NULL);
+	mowgli_heap_destroy(rec->chanfix_channel_heap);
+
+	chanfix_gather_init(&converted);
+
+	// The gather queue is new in version 3; fill it as a fresh load does
+	MOWGLI_PATRICIA_FOREACH(ch, &state, chanlist)
+		chanfix_gather_watch(ch);
 }
 
 void
@@ -436,6 +710,9 @@ chanfix_gather_deinit(struct chanfix_persist_record *rec)
 	hook_del_db_write(write_chanfixdb);
 	hook_del_channel_add(chanfix_channel_add_ev);
 	hook_del_channel_delete(chanfix_channel_delete_ev);
+	hook_del_channel_join(chanfix_channel_join_ev);
+	hook_del_channel_mode_change(chanfix_channel_mode_change_ev);
+	hook_del_channel_drop(chanfix_channel_drop_ev);
 
 	db_unregister_type_handler("CFDBV");
 	db_unregister_type_handler("CFCHAN");
@@ -445,7 +722,12 @@ chanfix_gather_deinit(struct chanfix_persist_record *rec)
 	mowgli_timer_destroy(base_eventloop, chanfix_expire_timer);
 	mowgli_timer_destroy(base_eventloop, chanfix_gather_timer);
 
+	if (chanfix_gather_slice_timer != NULL)
+		mowgli_timer_destroy(base_eventloop, chanfix_gather_slice_timer);
+
 	rec->chanfix_channel_heap  = chanfix_channel_heap;
 	rec->chanfix_oprecord_heap = chanfix_oprecord_heap;
 	rec->chanfix_channels      = chanfix_channels;
+	rec->chanfix_gather_queue  = chanfix_gather_queue;
+	rec->chanfix_decay_epoch   = chanfix_decay_epoch;
 }
@@ -12,7 +12,7 @@
 #include "chanfix.h"
 
 #define CHANFIX_PERSIST_STORAGE_NAME "atheme.chanfix.main.persist"
-#define CHANFIX_PERSIST_VERSION      2
+#define CHANFIX_PERSIST_VERSION      3
 
 static mowgli_eventloop_timer_t *chanfix_autofix_timer = NULL;
 
@@ -34,7 +34,17 @@ mod_init(struct module *const restrict m)
 		return;
 	}
 
-	chanfix_gather_init(rec);
+	if (rec && rec->version < 2)
+	{
+		slog(LG_ERROR, "chanfix/main: cannot upgrade persisted channels in place (from %d to %d); restart services instead", rec->version, CHANFIX_PERSIST_VERSION);
+		m->mflags = MODFLAG_FAIL;
+		return;
+	}
+
+	if (rec && rec->version == 2)
+		chanfix_gather_init_v2((struct chanfix_persist_record_v2 *) rec);
+	else
+		chanfix_gather_init(rec);
 
 	if (rec != NULL)
 	{
@@ -33,27 +33,47 @@ struct antiflood_enforce_method_impl
 	void (*unenforce)(struct channel *);
 };
 
-struct flood_message_queue
+/* Each channel keeps its last ANTIFLOOD_MSG_COUNT + 1 messages (as many as
+ * the old list of messages did) in a ring, as a fingerprint of the text and
+ * of the sender. Two small hash tables count how often every fingerprint
+ * occurs in the ring, so deciding whether to enforce does not look at the
+ * ring at all.
+ */
+#define ANTIFLOOD_MSG_COUNT     10U
+#define MQUEUE_RING_SIZE        (ANTIFLOOD_MSG_COUNT + 1U)
+#define MQUEUE_COUNT_SLOTS      32U     // a power of two, comfortably above MQUEUE_RING_SIZE
+
+struct flood_message
 {
-	char *name;
-	size_t max;
-	time_t last_used;
-	mowgli_list_t entries;
+	uint64_t        fingerprint;    // of the text, folded like strcasecmp() does
+	uint64_t        source;         // of the UID (or nick)
+	time_t          time;
+	unsigned char   next_same;      // ring index of the next message from the same source
 };
 
-struct flood_message
+struct flood_count
 {
-	stringref source;
-	char *message;
-	time_t time;
-	mowgli_node_t node;
+	uint64_t        key;
+	unsigned char   count;          // 0 if the slot is empty
+	unsigned char   first;          // ring index of the oldest message with this key
+	unsigned char   last;           // ring index of the newest message with this key
+};
+
+struct flood_message_queue
+{
+	char *name;
+	time_t last_used;
+	unsigned int head;
+	unsigned int length;
+	struct flood_message ring[MQUEUE_RING_SIZE];
+	struct flood_count messages[MQUEUE_COUNT_SLOTS];
+	struct flood_count sources[MQUEUE_COUNT_SLOTS];
 };
 
 static struct chanban *(*place_quietmask)(struct channel *, int, const char *) = NULL;
 
 static enum antiflood_enforce_method antiflood_enforce_method = ANTIFLOOD_ENFORCE_QUIET;
 
-static mowgli_heap_t *msg_heap = NULL;
 static mowgli_heap_t *mqueue_heap = NULL;
 static mowgli_patricia_t *mqueue_trie = NULL;
 static mowgli_patricia_t **cs_set_cmdtree = NULL;
@@ -61,35 +81,107 @@ static mowgli_eventloop_timer_t *mqueue_gc_timer = NULL;
 static mowgli_eventloop_timer_t *antiflood_unenforce_timer = NULL;
 
 static time_t antiflood_msg_time = SECONDS_PER_MINUTE;
-static size_t antiflood_msg_count = 10;
+
+static uint64_t
+msg_fingerprint(const char *str, const bool fold)
+{
+	const unsigned char *p = (const unsigned char *) str;
+	uint64_t hash = 0xCBF29CE484222325ULL;
+
+	// FNV-1a, then the MurmurHash3 finalizer, as the low bits pick the slot
+	for (; *p; p++)
+		hash = (hash ^ (uint64_t) (fold ? tolower(*p) : *p)) * 0x100000001B3ULL;
+
+	hash ^= hash >> 33;
+	hash *= 0xFF51AFD7ED558CCDULL;
+	hash ^= hash >> 33;
+	hash *= 0xC4CEB9FE1A85EC53ULL;
+	hash ^= hash >> 33;
+
+	return hash;
+}
+
+static struct flood_count *
+msg_count_get(struct flood_count *const table, const uint64_t key)
+{
+	unsigned int i = key & (MQUEUE_COUNT_SLOTS - 1U);
+
+	// The ring is much smaller than the table, so there is always a free slot
+	while (table[i].count && table[i].key != key)
+		i = (i + 1U) & (MQUEUE_COUNT_SLOTS - 1U);
+
+	table[i].key = key;
+
+	return &table[i];
+}
+
+static void
+msg_count_release(struct flood_count *const table, struct flood_count *const slot)
+{
+	unsigned int i = slot - table;
+
+	if (--slot->count)
+		return;
+
+	// Shift the entries that follow back over the hole, as hashmap_delete() does
+	for (unsigned int j = (i + 1U) & (MQUEUE_COUNT_SLOTS - 1U); table[j].count; j = (j + 1U) & (MQUEUE_COUNT_SLOTS - 1U))
+	{
+		const unsigned int home = table[j].key & (MQUEUE_COUNT_SLOTS - 1U);
+
+		// Leave it alone if its home slot lies cyclically in (i, j]
+		if (((j - home) & (MQUEUE_COUNT_SLOTS - 1U)) < ((j - i) & (MQUEUE_COUNT_SLOTS - 1U)))
+			continue;
+
+		table[i] = table[j];
+		table[j].count = 0;
+		i = j;
+	}
+}
 
 static void
-msg_destroy(struct flood_message *mesg, struct flood_message_queue *mq)
+msg_destroy_oldest(struct flood_message_queue *mq)
 {
-	sfree(mesg->message);
-	strshare_unref(mesg->source);
-	mowgli_node_delete(&mesg->node, &mq->entries);
+	const struct flood_message *const mesg = &mq->ring[mq->head];
+	struct flood_count *const src = msg_count_get(mq->sources, mesg->source);
+
+	// The oldest message in the ring is the oldest one from its source too
+	src->first = mesg->next_same;
 
-	mowgli_heap_free(msg_heap, mesg);
+	msg_count_release(mq->messages, msg_count_get(mq->messages, mesg->fingerprint));
+	msg_count_release(mq->sources, src);
+
+	mq->head = (mq->head + 1U) % MQUEUE_RING_SIZE;
+	mq->length--;
 }
 
-static struct flood_message *
+static const struct flood_message *
 msg_create(struct flood_message_queue *mq, struct user *u, const char *message)
 {
 	struct flood_message *mesg;
+	struct flood_count *cnt;
+	unsigned int idx;
+
+	if (mq->length == MQUEUE_RING_SIZE)
+		msg_destroy_oldest(mq);
 
-	mesg = mowgli_heap_alloc(msg_heap);
-	mesg->message = sstrdup(message);
+	idx = (mq->head + mq->length) % MQUEUE_RING_SIZE;
+	mq->length++;
+
+	mesg = &mq->ring[idx];
+	mesg->fingerprint = msg_fingerprint(message, true);
+	mesg->source = msg_fingerprint(u->uid != NULL ? u->uid : u->nick, false);
 	mesg->time = CURRTIME;
-	mesg->source = u->uid != NULL ? strshare_ref(u->uid) : strshare_ref(u->nick);
 
-	if (MOWGLI_LIST_LENGTH(&mq->entries) > mq->max)
-	{
-		struct flood_message *head_mesg = mq->entries.head->data;
-		msg_destroy(head_mesg, mq);
-	}
+	cnt = msg_count_get(mq->messages, mesg->fingerprint);
+	cnt->count++;
+
+	cnt = msg_count_get(mq->sources, mesg->source);
+	if (cnt->count++)
+		mq->ring[cnt->last].next_same = idx;
+	else
+		cnt->first = idx;
+	cnt->last = idx;
 
-	mowgli_node_add(mesg, &mesg->node, &mq->entries);
 	mq->last_used = CURRTIME;
 
 	return mesg;
@@ -103,7 +195,6 @@ mqueue_create(const char *name)
 	mq = mowgli_heap_alloc(mqueue_heap);
 	mq->name = sstrdup(name);
 	mq->last_used = CURRTIME;
-	mq->max = antiflood_msg_count;
 
 	mowgli_patricia_add(mqueue_trie, mq->name, mq);
 
@@ -113,15 +204,6 @@ mqueue_create(const char *name)
 static void
 mqueue_free(struct flood_message_queue *mq)
 {
-	mowgli_node_t *n, *tn;
-
-	MOWGLI_ITER_FOREACH_SAFE(n, tn, mq->entries.head)
-	{
-		struct flood_message *mesg = n->data;
-
-		msg_destroy(mesg, mq);
-	}
-
 	sfree(mq->name);
 	mowgli_heap_free(mqueue_heap, mq);
 }
@@ -168,48 +250,27 @@ mqueue_gc(void *unused)
 }
 
 static enum mqueue_enforce_strategy
-mqueue_should_enforce(struct flood_message_queue *mq)
+mqueue_should_enforce(struct flood_message_queue *mq, const struct flood_message *newest)
 {
-	struct flood_message *oldest, *newest;
+	const struct flood_message *oldest;
 	time_t age_delta;
 
-	if (MOWGLI_LIST_LENGTH(&mq->entries) < mq->max)
-		return MQ_ENFORCE_NONE;
-
-	oldest = mq->entries.head->data;
-	newest = mq->entries.tail->data;
-
-	if (oldest == NULL || newest == NULL || oldest == newest)
+	if (mq->length < ANTIFLOOD_MSG_COUNT)
 		return MQ_ENFORCE_NONE;
 
+	oldest = &mq->ring[mq->head];
 	age_delta = newest->time - oldest->time;
 
 	if (age_delta <= antiflood_msg_time)
 	{
-		mowgli_node_t *n;
-		size_t msg_matches = 0, usr_matches = 0;
-		time_t usr_first_seen = 0;
+		const struct flood_count *msg_matches = msg_count_get(mq->messages, newest->fingerprint);
+		const struct flood_count *usr_matches = msg_count_get(mq->sources, newest->source);
+		const time_t usr_first_seen = mq->ring[usr_matches->first].time;
 
-		MOWGLI_ITER_FOREACH(n, mq->entries.head)
-		{
-			struct flood_message *mesg = n->data;
-
-			if (!strcasecmp(mesg->message, newest->message))
-				msg_matches++;
-
-			if (mesg->source == newest->source)
-			{
-				usr_matches++;
-
-				if (!usr_first_seen)
-					usr_first_seen = mesg->time;
-			}
-		}
-
-		if (msg_matches > (antiflood_msg_count / 2))
+		if (msg_matches->count > (ANTIFLOOD_MSG_COUNT / 2))
 			return MQ_ENFORCE_MSG;
 
-		if (usr_matches > (antiflood_msg_count / 2) &&
+		if (usr_matches->count > (ANTIFLOOD_MSG_COUNT / 2) &&
 			((newest->time - usr_first_seen) < antiflood_msg_time / 4))
 			return MQ_ENFORCE_LINE;
 	}
@@ -333,6 +394,7 @@ on_channel_message(struct hook_channel_message *data)
 	struct chanuser *cu;
 	struct mychan *mc;
 	struct flood_message_queue *mq;
+	const struct flood_message *mesg;
 
 	return_if_fail(data != NULL);
 	return_if_fail(data->msg != NULL);
@@ -350,7 +412,7 @@ on_channel_message(struct hook_channel_message *data)
 	mq = mqueue_get(mc);
 	return_if_fail(mq != NULL);
 
-	msg_create(mq, data->u, data->msg);
+	mesg = msg_create(mq, data->u, data->msg);
 
 	// never enforce against any user who has special CSTATUS flags.
 	if (cu->modes)
@@ -360,7 +422,7 @@ on_channel_message(struct hook_channel_message *data)
 	if (!(mc->flags & MC_ANTIFLOOD))
 		return;
 
-	if (mqueue_should_enforce(mq) != MQ_ENFORCE_NONE)
+	if (mqueue_should_enforce(mq, mesg) != MQ_ENFORCE_NONE)
 	{
 		const struct antiflood_enforce_method_impl *enf = antiflood_enforce_method_impl_get(mc);
 
@@ -513,8 +575,6 @@ mod_init(struct module *m)
 	hook_add_channel_message(on_channel_message);
 	hook_add_channel_drop(on_channel_drop);
 
-	msg_heap = sharedheap_get(sizeof(struct flood_message));
-
 	mqueue_heap = sharedheap_get(sizeof(struct flood_message_queue));
 	mqueue_trie = mowgli_patricia_create(irccasecanon);
 	mqueue_gc_timer = mowgli_timer_add(base_eventloop, "mqueue_gc", mqueue_gc, NULL, 5 * SECONDS_PER_MINUTE);
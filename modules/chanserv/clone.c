@@ -128,6 +128,8 @@ cs_cmd_clone(struct sourceinfo *si, int parc, char *parv[])
 	if (mc2->flags & MC_HOLD)
 		mc2->flags &= ~MC_HOLD;
 
+	hook_call_mychan_changed_flags(mc2);
+
 	command_add_flood(si, FLOOD_MODERATE);
 
 	logcommand(si, CMDLOG_SET, "CLONE: \2%s\2 to \2%s\2", mc->name, mc2->name);
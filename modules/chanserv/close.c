@@ -88,6 +88,7 @@ cs_cmd_close(struct sourceinfo *si, int parc, char *parv[])
 		metadata_add(mc, "private:close:closer", get_oper_name(si));
 		metadata_add(mc, "private:close:reason", reason);
 		metadata_add(mc, "private:close:timestamp", int64_to_string(CURRTIME));
+		hook_call_mychan_changed_flags(mc);
 
 		if ((c = channel_find(target)))
 		{
@@ -125,6 +126,7 @@ cs_cmd_close(struct sourceinfo *si, int parc, char *parv[])
 		metadata_delete(mc, "private:close:closer");
 		metadata_delete(mc, "private:close:reason");
 		metadata_delete(mc, "private:close:timestamp");
+		hook_call_mychan_changed_flags(mc);
 		mc->flags &= ~MC_INHABIT;
 		c = channel_find(target);
 		if (c != NULL)
@@ -44,6 +44,7 @@ cs_cmd_hold(struct sourceinfo *si, int parc, char *parv[])
 		}
 
 		mc->flags |= MC_HOLD;
+		hook_call_mychan_changed_flags(mc);
 
 		wallops("\2%s\2 set the HOLD option for the channel \2%s\2.", get_oper_name(si), target);
 		logcommand(si, CMDLOG_ADMIN, "HOLD:ON: \2%s\2", mc->name);
@@ -58,6 +59,7 @@ cs_cmd_hold(struct sourceinfo *si, int parc, char *parv[])
 		}
 
 		mc->flags &= ~MC_HOLD;
+		hook_call_mychan_changed_flags(mc);
 
 		wallops("\2%s\2 removed the HOLD option on the channel \2%s\2.", get_oper_name(si), target);
 		logcommand(si, CMDLOG_ADMIN, "HOLD:OFF: \2%s\2", mc->name);
@@ -40,6 +40,69 @@ struct list_option
 	unsigned int flag;
 };
 
+/* The indexes over registration time, last use time and the flags that are
+ * commonly listed are built the first time a LIST could use them, and kept
+ * up to date from hooks after that. The last use time is set in many places
+ * without a hook; a stale entry is filed under an earlier day than its
+ * channel was really last used, which only makes a scan visit a channel that
+ * does not match, so the entry is refiled when that happens.
+ */
+enum list_index_flag
+{
+	LIST_FLAG_HOLD,
+	LIST_FLAG_NOOP,
+	LIST_FLAG_PRIVATE,
+	LIST_FLAG_CLOSED,
+	LIST_FLAG_MARKED,
+	LIST_FLAG_COUNT,
+};
+
+struct list_channel
+{
+	struct mychan *         mc;
+	mowgli_node_t           registered_node;
+	mowgli_node_t           used_node;
+	mowgli_node_t           flag_nodes[LIST_FLAG_COUNT];
+	unsigned int            registered_day;
+	unsigned int            used_day;
+	unsigned int            flags;          // LIST_FLAG_* bits it is filed under
+};
+
+static bool list_indexed = false;
+static struct hashmap *list_channels = NULL;
+static struct hashmap *list_pending = NULL;             // registered since, not filed yet
+static struct time_index list_registered;
+static struct time_index list_used;
+static mowgli_list_t list_flagged[LIST_FLAG_COUNT];
+
+// The criteria of one LIST, and its output
+struct list_query
+{
+	const char *            chanpattern;
+	const char *            markpattern;
+	const char *            closedpattern;
+	const char *            mlock;
+	unsigned int            flagset;
+	int                     aclsize;
+	time_t                  age;
+	time_t                  lastused;
+	bool                    closed;
+	bool                    marked;
+
+	struct match_pattern *  chancompiled;
+	struct match_pattern *  markcompiled;
+	struct match_pattern *  closedcompiled;
+	unsigned int            mlock_on;
+	unsigned int            mlock_off;
+	bool                    mlock_key;
+	bool                    mlock_limit;
+	bool *                  extmlock_on;
+	bool *                  extmlock_off;
+
+	struct command_stream * out;
+	unsigned int            matches;
+};
+
 static time_t
 parse_age(const char *s)
 {
@@ -169,39 +232,412 @@ check_extmlock(const struct metadata *md, const bool *modes, bool on)
 	return true;
 }
 
+static unsigned int
+list_channel_flags(struct mychan *mc)
+{
+	unsigned int flags = 0;
+
+	if (mc->flags & MC_HOLD)
+		flags |= (1U << LIST_FLAG_HOLD);
+	if (mc->flags & MC_NOOP)
+		flags |= (1U << LIST_FLAG_NOOP);
+	if (mc->flags & MC_PRIVATE)
+		flags |= (1U << LIST_FLAG_PRIVATE);
+	if (metadata_find(mc, "private:close:closer"))
+		flags |= (1U << LIST_FLAG_CLOSED);
+	if (metadata_find(mc, "private:mark:setter"))
+		flags |= (1U << LIST_FLAG_MARKED);
+
+	return flags;
+}
+
+static void
+list_channel_file_flags(struct list_channel *lc)
+{
+	const unsigned int flags = list_channel_flags(lc->mc);
+
+	for (unsigned int i = 0; i < LIST_FLAG_COUNT; i++)
+	{
+		const unsigned int bit = 1U << i;
+
+		if ((flags & bit) && !(lc->flags & bit))
+			mowgli_node_add(lc, &lc->flag_nodes[i], &list_flagged[i]);
+		else if (!(flags & bit) && (lc->flags & bit))
+			mowgli_node_delete(&lc->flag_nodes[i], &list_flagged[i]);
+	}
+
+	lc->flags = flags;
+}
+
+static void
+list_channel_add(struct mychan *mc)
+{
+	struct list_channel *lc = smalloc(sizeof *lc);
+
+	if (! hashmap_add(list_channels, mc->name, lc))
+	{
+		sfree(lc);
+		return;
+	}
+
+	lc->mc = mc;
+	lc->registered_day = time_index_day(mc->registered);
+	lc->used_day = time_index_day(mc->used);
+
+	time_index_add(&list_registered, lc, &lc->registered_node, lc->registered_day);
+	time_index_add(&list_used, lc, &lc->used_node, lc->used_day);
+	list_channel_file_flags(lc);
+}
+
+static void
+list_channel_delete(struct list_channel *lc)
+{
+	time_index_delete(&list_registered, &lc->registered_node, lc->registered_day);
+	time_index_delete(&list_used, &lc->used_node, lc->used_day);
+
+	for (unsigned int i = 0; i < LIST_FLAG_COUNT; i++)
+		if (lc->flags & (1U << i))
+			mowgli_node_delete(&lc->flag_nodes[i], &list_flagged[i]);
+
+	(void) hashmap_delete(list_channels, lc->mc->name);
+
+	sfree(lc);
+}
+
+static void
+list_index_destroy(void)
+{
+	struct hashmap_iter iter;
+	struct list_channel *lc;
+
+	if (! list_indexed)
+		return;
+
+	HASHMAP_FOREACH(lc, &iter, list_channels)
+		sfree(lc);
+
+	hashmap_destroy(list_channels);
+	hashmap_destroy(list_pending);
+
+	time_index_clear(&list_registered);
+	time_index_clear(&list_used);
+	memset(list_flagged, 0, sizeof list_flagged);
+
+	list_indexed = false;
+}
+
+/* Builds the indexes if they are not there yet. Channels registered since
+ * then (by whatever means; the mychan_add hook is called for all of them) are
+ * filed here rather than as they are registered, when their registrant may
+ * not have filled them in yet.
+ */
+static void
+list_index_ensure(void)
+{
+	mowgli_patricia_iteration_state_t state;
+	struct hashmap_iter iter;
+	struct mychan *mc;
+
+	if (list_indexed)
+	{
+		if (hashmap_size(list_pending) == 0)
+			return;
+
+		HASHMAP_FOREACH(mc, &iter, list_pending)
+			list_channel_add(mc);
+
+		hashmap_destroy(list_pending);
+		list_pending = hashmap_create(true);
+		return;
+	}
+
+	list_channels = hashmap_create(true);
+	list_pending = hashmap_create(true);
+	list_indexed = true;
+
+	MOWGLI_PATRICIA_FOREACH(mc, &state, mclist)
+		list_channel_add(mc);
+
+	slog(LG_DEBUG, "list_index_ensure(): indexed %zu channels", hashmap_size(list_channels));
+}
+
+static void
+list_mychan_add(struct mychan *mc)
+{
+	if (list_indexed)
+		(void) hashmap_add(list_pending, mc->name, mc);
+}
+
+static void
+list_mychan_delete(struct mychan *mc)
+{
+	struct list_channel *lc;
+
+	if (! list_indexed || hashmap_delete(list_pending, mc->name) != NULL)
+		return;
+
+	if ((lc = hashmap_retrieve(list_channels, mc->name)) != NULL)
+		list_channel_delete(lc);
+}
+
+static void
+list_mychan_changed_flags(struct mychan *mc)
+{
+	struct list_channel *lc;
+
+	if (list_indexed && (lc = hashmap_retrieve(list_channels, mc->name)) != NULL)
+		list_channel_file_flags(lc);
+}
+
+static void
+list_used_refile(struct list_channel *lc)
+{
+	const unsigned int day = time_index_day(lc->mc->used);
+
+	time_index_delete(&list_used, &lc->used_node, lc->used_day);
+	time_index_add(&list_used, lc, &lc->used_node, day);
+	lc->used_day = day;
+}
+
+// The LIST_FLAG_* bits that every matching channel has
+static unsigned int
+list_query_flags(const struct list_query *q)
+{
+	unsigned int flags = 0;
+
+	if (q->flagset & MC_HOLD)
+		flags |= (1U << LIST_FLAG_HOLD);
+	if (q->flagset & MC_NOOP)
+		flags |= (1U << LIST_FLAG_NOOP);
+	if (q->flagset & MC_PRIVATE)
+		flags |= (1U << LIST_FLAG_PRIVATE);
+	if (q->closed)
+		flags |= (1U << LIST_FLAG_CLOSED);
+	if (q->marked)
+		flags |= (1U << LIST_FLAG_MARKED);
+
+	return flags;
+}
+
+static bool
+list_query_match(const struct list_query *q, struct mychan *mc)
+{
+	if (q->chanpattern != NULL && match_compiled(q->chancompiled, mc->name))
+		return false;
+
+	if (q->markpattern)
+	{
+		const struct metadata *md = metadata_find(mc, "private:mark:reason");
+		if (md == NULL || match_compiled(q->markcompiled, md->value) != 0)
+			return false;
+	}
+
+	if (q->closedpattern)
+	{
+		const struct metadata *md = metadata_find(mc, "private:close:reason");
+		if (md == NULL || match_compiled(q->closedcompiled, md->value) != 0)
+			return false;
+	}
+
+	if (q->marked && !metadata_find(mc, "private:mark:setter"))
+		return false;
+
+	if (q->closed && !metadata_find(mc, "private:close:closer"))
+		return false;
+
+	if (q->flagset && (mc->flags & q->flagset) != q->flagset)
+		return false;
+
+	if (q->aclsize && MOWGLI_LIST_LENGTH(&mc->chanacs) < (unsigned int)q->aclsize)
+		return false;
+
+	if (q->age && (CURRTIME - mc->registered) < q->age)
+		return false;
+
+	if (q->lastused && (CURRTIME - mc->used) < q->lastused)
+		return false;
+
+	if ((q->mlock_on & mc->mlock_on) != q->mlock_on)
+		return false;
+
+	if ((q->mlock_off & mc->mlock_off) != q->mlock_off)
+		return false;
+
+	if (q->mlock_key && !mc->mlock_key)
+		return false;
+
+	if (q->mlock_limit && !mc->mlock_limit)
+		return false;
+
+	const struct metadata *extmlock_md = metadata_find(mc, "private:mlockext");
+
+	if (!check_extmlock(extmlock_md, q->extmlock_on, true))
+		return false;
+
+	if (!check_extmlock(extmlock_md, q->extmlock_off, false))
+		return false;
+
+	return true;
+}
+
+static void
+list_query_check(struct list_query *q, struct mychan *mc)
+{
+	if (!list_query_match(q, mc))
+		return;
+
+	// in the future we could add a LIMIT parameter
+	char buf[BUFSIZE] = { 0 };
+
+	if (metadata_find(mc, "private:mark:setter")) {
+		mowgli_strlcat(buf, "\2[marked]\2", BUFSIZE);
+	}
+	if (metadata_find(mc, "private:close:closer")) {
+		if (*buf)
+			mowgli_strlcat(buf, " ", BUFSIZE);
+
+		mowgli_strlcat(buf, "\2[closed]\2", BUFSIZE);
+	}
+	if (mc->flags & MC_HOLD) {
+		if (*buf)
+			mowgli_strlcat(buf, " ", BUFSIZE);
+
+		mowgli_strlcat(buf, "\2[held]\2", BUFSIZE);
+	}
+
+	command_stream_printf(q->out, "- %s (%s) %s", mc->name, mychan_founder_names(mc), buf);
+	q->matches++;
+}
+
+static void
+list_query_scan_days(struct list_query *q, struct time_index *ti, const unsigned int last_day)
+{
+	for (unsigned int i = 0; i < ti->ndays && ti->first_day + i <= last_day; i++)
+	{
+		mowgli_node_t *n, *tn;
+
+		MOWGLI_ITER_FOREACH_SAFE(n, tn, ti->days[i].head)
+		{
+			struct list_channel *lc = n->data;
+
+			list_query_check(q, lc->mc);
+
+			// refile a stale last use entry, if that does not make us visit it again
+			if (ti == &list_used && time_index_day(lc->mc->used) > last_day)
+				list_used_refile(lc);
+		}
+	}
+}
+
+/* list_query_run()
+ *
+ * Scans the index that narrows the search down the most, or every registered
+ * channel if none of the criteria has an index or the index would not save
+ * anything.
+ */
+static void
+list_query_run(struct list_query *q)
+{
+	const unsigned int flags = list_query_flags(q);
+	struct time_index *ti = NULL;
+	unsigned int last_day = 0;
+	mowgli_list_t *flagged = NULL;
+	size_t best = cnt.mychan;
+
+	if (flags || q->age || q->lastused)
+		list_index_ensure();
+
+	if (q->age)
+	{
+		const unsigned int day = time_index_day(CURRTIME - q->age);
+		const size_t estimate = time_index_count(&list_registered, day);
+
+		if (estimate < best)
+		{
+			ti = &list_registered;
+			last_day = day;
+			best = estimate;
+		}
+	}
+
+	if (q->lastused)
+	{
+		const unsigned int day = time_index_day(CURRTIME - q->lastused);
+		const size_t estimate = time_index_count(&list_used, day);
+
+		if (estimate < best)
+		{
+			ti = &list_used;
+			last_day = day;
+			best = estimate;
+		}
+	}
+
+	for (unsigned int i = 0; i < LIST_FLAG_COUNT; i++)
+	{
+		if (!(flags & (1U << i)) || MOWGLI_LIST_LENGTH(&list_flagged[i]) >= best)
+			continue;
+
+		ti = NULL;
+		flagged = &list_flagged[i];
+		best = MOWGLI_LIST_LENGTH(flagged);
+	}
+
+	if (flagged != NULL)
+	{
+		mowgli_node_t *n;
+
+		MOWGLI_ITER_FOREACH(n, flagged->head)
+		{
+			const struct list_channel *lc = n->data;
+
+			list_query_check(q, lc->mc);
+		}
+	}
+	else if (ti != NULL)
+		list_query_scan_days(q, ti, last_day);
+	else
+	{
+		mowgli_patricia_iteration_state_t state;
+		struct mychan *mc;
+
+		MOWGLI_PATRICIA_FOREACH(mc, &state, mclist)
+			list_query_check(q, mc);
+	}
+}
+
 static void
 cs_cmd_list(struct sourceinfo *si, int parc, char *parv[])
 {
-	const char *chanpattern = NULL, *markpattern = NULL, *closedpattern = NULL, *mlock = NULL;
-	unsigned int flagset = 0;
-	int aclsize = 0;
-	time_t age = 0, lastused = 0;
-	bool closed = false, marked = false;
+	struct list_query q;
+
+	memset(&q, 0, sizeof q);
+
 	struct list_option optstable[] = {
-		{"pattern",      OPT_STRING,    {.strval = &chanpattern}, 0},
-		{"mark-reason",  OPT_STRING,    {.strval = &markpattern}, 0},
-		{"close-reason", OPT_STRING,    {.strval = &closedpattern}, 0},
-		{"noexpire",     OPT_FLAG,      {.flagval = &flagset}, MC_HOLD},
-		{"held",         OPT_FLAG,      {.flagval = &flagset}, MC_HOLD},
-		{"hold",         OPT_FLAG,      {.flagval = &flagset}, MC_HOLD},
-		{"noop",         OPT_FLAG,      {.flagval = &flagset}, MC_NOOP},
-		{"limitflags",   OPT_FLAG,      {.flagval = &flagset}, MC_LIMITFLAGS},
-		{"secure",       OPT_FLAG,      {.flagval = &flagset}, MC_SECURE},
-		{"nosync",       OPT_FLAG,      {.flagval = &flagset}, MC_NOSYNC},
-		{"verbose",      OPT_FLAG,      {.flagval = &flagset}, MC_VERBOSE},
-		{"restricted",   OPT_FLAG,      {.flagval = &flagset}, MC_RESTRICTED},
-		{"keeptopic",    OPT_FLAG,      {.flagval = &flagset}, MC_KEEPTOPIC},
-		{"verbose-ops",  OPT_FLAG,      {.flagval = &flagset}, MC_VERBOSE_OPS},
-		{"topiclock",    OPT_FLAG,      {.flagval = &flagset}, MC_TOPICLOCK},
-		{"guard",        OPT_FLAG,      {.flagval = &flagset}, MC_GUARD},
-		{"private",      OPT_FLAG,      {.flagval = &flagset}, MC_PRIVATE},
-		{"pubacl",       OPT_FLAG,      {.flagval = &flagset}, MC_PUBACL},
-		{"mlock",        OPT_STRING,    {.strval = &mlock}, 0},
-		{"closed",       OPT_BOOL,      {.boolval = &closed}, 0},
-		{"marked",       OPT_BOOL,      {.boolval = &marked}, 0},
-		{"aclsize",      OPT_INT,       {.intval = &aclsize}, 0},
-		{"registered",   OPT_AGE,       {.ageval = &age}, 0},
-		{"lastused",     OPT_AGE,       {.ageval = &lastused}, 0},
+		{"pattern",      OPT_STRING,    {.strval = &q.chanpattern}, 0},
+		{"mark-reason",  OPT_STRING,    {.strval = &q.markpattern}, 0},
+		{"close-reason", OPT_STRING,    {.strval = &q.closedpattern}, 0},
+		{"noexpire",     OPT_FLAG,      {.flagval = &q.flagset}, MC_HOLD},
+		{"held",         OPT_FLAG,      {.flagval = &q.flagset}, MC_HOLD},
+		{"hold",         OPT_FLAG,      {.flagval = &q.flagset}, MC_HOLD},
+		{"noop",         OPT_FLAG,      {.flagval = &q.flagset}, MC_NOOP},
+		{"limitflags",   OPT_FLAG,      {.flagval = &q.flagset}, MC_LIMITFLAGS},
+		{"secure",       OPT_FLAG,      {.flagval = &q.flagset}, MC_SECURE},
+		{"nosync",       OPT_FLAG,      {.flagval = &q.flagset}, MC_NOSYNC},
+		{"verbose",      OPT_FLAG,      {.flagval = &q.flagset}, MC_VERBOSE},
+		{"restricted",   OPT_FLAG,      {.flagval = &q.flagset}, MC_RESTRICTED},
+		{"keeptopic",    OPT_FLAG,      {.flagval = &q.flagset}, MC_KEEPTOPIC},
+		{"verbose-ops",  OPT_FLAG,      {.flagval = &q.flagset}, MC_VERBOSE_OPS},
+		{"topiclock",    OPT_FLAG,      {.flagval = &q.flagset}, MC_TOPICLOCK},
+		{"guard",        OPT_FLAG,      {.flagval = &q.flagset}, MC_GUARD},
+		{"private",      OPT_FLAG,      {.flagval = &q.flagset}, MC_PRIVATE},
+		{"pubacl",       OPT_FLAG,      {.flagval = &q.flagset}, MC_PUBACL},
+		{"mlock",        OPT_STRING,    {.strval = &q.mlock}, 0},
+		{"closed",       OPT_BOOL,      {.boolval = &q.closed}, 0},
+		{"marked",       OPT_BOOL,      {.boolval = &q.marked}, 0},
+		{"aclsize",      OPT_INT,       {.intval = &q.aclsize}, 0},
+		{"registered",   OPT_AGE,       {.ageval = &q.age}, 0},
+		{"lastused",     OPT_AGE,       {.ageval = &q.lastused}, 0},
 	};
 
 	// This isn't a channel-specific command. Exclude it from fantasy;
@@ -224,18 +660,18 @@ cs_cmd_list(struct sourceinfo *si, int parc, char *parv[])
 	char criteriastr[BUFSIZE];
 	build_criteriastr(criteriastr, parc, parv);
 
-	unsigned int mlock_on = 0, mlock_off = 0;
-	bool mlock_key = false, mlock_limit = false;
 	bool extmlock_on[ignore_mode_list_size];
 	bool extmlock_off[ignore_mode_list_size];
 	memset(extmlock_on, 0, sizeof extmlock_on);
 	memset(extmlock_off, 0, sizeof extmlock_off);
+	q.extmlock_on = extmlock_on;
+	q.extmlock_off = extmlock_off;
 
-	if (mlock)
+	if (q.mlock)
 	{
 		int dir = MTYPE_NUL;
 
-		for (const char *c = mlock; *c; c++)
+		for (const char *c = q.mlock; *c; c++)
 		{
 			int flag;
 			switch (*c)
@@ -250,16 +686,16 @@ cs_cmd_list(struct sourceinfo *si, int parc, char *parv[])
 
 				case 'l':
 					if (dir == MTYPE_DEL)
-						mlock_off |= CMODE_LIMIT;
+						q.mlock_off |= CMODE_LIMIT;
 					else
-						mlock_limit = true;
+						q.mlock_limit = true;
 					break;
 
 				case 'k':
 					if (dir == MTYPE_DEL)
-						mlock_off |= CMODE_KEY;
+						q.mlock_off |= CMODE_KEY;
 					else
-						mlock_key = true;
+						q.mlock_key = true;
 					break;
 
 				default:
@@ -267,9 +703,9 @@ cs_cmd_list(struct sourceinfo *si, int parc, char *parv[])
 					if (flag)
 					{
 						if (dir == MTYPE_DEL)
-							mlock_off |= flag;
+							q.mlock_off |= flag;
 						else
-							mlock_on |= flag;
+							q.mlock_on |= flag;
 					}
 					else
 					{
@@ -293,100 +729,28 @@ cs_cmd_list(struct sourceinfo *si, int parc, char *parv[])
 		}
 	}
 
-	command_success_nodata(si, _("Channels matching \2%s\2:"), criteriastr);
+	q.out = command_stream_begin(si);
+	command_stream_printf(q.out, _("Channels matching \2%s\2:"), criteriastr);
 
-	unsigned int matches = 0;
+	q.chancompiled = q.chanpattern ? match_compile(q.chanpattern) : NULL;
+	q.markcompiled = q.markpattern ? match_compile(q.markpattern) : NULL;
+	q.closedcompiled = q.closedpattern ? match_compile(q.closedpattern) : NULL;
 
-	struct mychan *mc;
-	mowgli_patricia_iteration_state_t state;
+	list_query_run(&q);
 
-	MOWGLI_PATRICIA_FOREACH(mc, &state, mclist)
-	{
-		if (chanpattern != NULL && match(chanpattern, mc->name))
-			continue;
-
-		if (markpattern)
-		{
-			const struct metadata *md = metadata_find(mc, "private:mark:reason");
-			if (md == NULL || match(markpattern, md->value) != 0)
-				continue;
-		}
-
-		if (closedpattern)
-		{
-			const struct metadata *md = metadata_find(mc, "private:close:reason");
-			if (md == NULL || match(closedpattern, md->value) != 0)
-				continue;
-		}
-
-		if (marked && !metadata_find(mc, "private:mark:setter"))
-			continue;
-
-		if (closed && !metadata_find(mc, "private:close:closer"))
-			continue;
-
-		if (flagset && (mc->flags & flagset) != flagset)
-			continue;
-
-		if (aclsize && MOWGLI_LIST_LENGTH(&mc->chanacs) < (unsigned int)aclsize)
-			continue;
-
-		if (age && (CURRTIME - mc->registered) < age)
-			continue;
+	match_pattern_free(q.chancompiled);
+	match_pattern_free(q.markcompiled);
+	match_pattern_free(q.closedcompiled);
 
-		if (lastused && (CURRTIME - mc->used) < lastused)
-			continue;
-
-		if ((mlock_on & mc->mlock_on) != mlock_on)
-			continue;
-
-		if ((mlock_off & mc->mlock_off) != mlock_off)
-			continue;
-
-		if (mlock_key && !mc->mlock_key)
-			continue;
-
-		if (mlock_limit && !mc->mlock_limit)
-			continue;
-
-		const struct metadata *extmlock_md = metadata_find(mc, "private:mlockext");
-
-		if (!check_extmlock(extmlock_md, extmlock_on, true))
-			continue;
-
-		if (!check_extmlock(extmlock_md, extmlock_off, false))
-			continue;
-
-		// in the future we could add a LIMIT parameter
-		char buf[BUFSIZE] = { 0 };
-
-		if (metadata_find(mc, "private:mark:setter")) {
-			mowgli_strlcat(buf, "\2[marked]\2", BUFSIZE);
-		}
-		if (metadata_find(mc, "private:close:closer")) {
-			if (*buf)
-				mowgli_strlcat(buf, " ", BUFSIZE);
-
-			mowgli_strlcat(buf, "\2[closed]\2", BUFSIZE);
-		}
-		if (mc->flags & MC_HOLD) {
-			if (*buf)
-				mowgli_strlcat(buf, " ", BUFSIZE);
-
-			mowgli_strlcat(buf, "\2[held]\2", BUFSIZE);
-		}
-
-		command_success_nodata(si, "- %s (%s) %s", mc->name, mychan_founder_names(mc), buf);
-		matches++;
-	}
-
-	logcommand(si, CMDLOG_ADMIN, "LIST: \2%s\2 (\2%u\2 matches)", criteriastr, matches);
-	if (matches == 0)
-		command_success_nodata(si, _("No channel matched criteria \2%s\2"), criteriastr);
+	logcommand(si, CMDLOG_ADMIN, "LIST: \2%s\2 (\2%u\2 matches)", criteriastr, q.matches);
+	if (q.matches == 0)
+		command_stream_printf(q.out, _("No channel matched criteria \2%s\2"), criteriastr);
 	else
-		command_success_nodata(si, ngettext(N_("\2%u\2 match for criteria \2%s\2."),
-		                                    N_("\2%u\2 matches for criteria \2%s\2."),
-		                                    matches), matches, criteriastr);
+		command_stream_printf(q.out, ngettext(N_("\2%u\2 match for criteria \2%s\2."),
+		                                      N_("\2%u\2 matches for criteria \2%s\2."),
+		                                      q.matches), q.matches, criteriastr);
+
+	command_stream_end(q.out);
 }
 
 static struct command cs_list = {
@@ -404,12 +768,22 @@ mod_init(struct module *const restrict m)
 	MODULE_TRY_REQUEST_DEPENDENCY(m, "chanserv/main")
 
 	service_named_bind_command("chanserv", &cs_list);
+
+	hook_add_mychan_add(list_mychan_add);
+	hook_add_mychan_delete(list_mychan_delete);
+	hook_add_mychan_changed_flags(list_mychan_changed_flags);
 }
 
 static void
 mod_deinit(const enum module_unload_intent ATHEME_VATTR_UNUSED intent)
 {
 	service_named_unbind_command("chanserv", &cs_list);
+
+	hook_del_mychan_add(list_mychan_add);
+	hook_del_mychan_delete(list_mychan_delete);
+	hook_del_mychan_changed_flags(list_mychan_changed_flags);
+
+	list_index_destroy();
 }
 
 SIMPLE_DECLARE_MODULE_V1("chanserv/list", MODULE_UNLOAD_CAPABILITY_OK)
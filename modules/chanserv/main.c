@@ -27,12 +27,12 @@ join_registered(bool all)
 
 		if (all)
 		{
-			join(mc->name, chansvs.nick);
+			join_schedule(mc->name, chansvs.nick, NULL);
 			continue;
 		}
 		else if (mc->chan != NULL && mc->chan->members.count != 0)
 		{
-			join(mc->name, chansvs.nick);
+			join_schedule(mc->name, chansvs.nick, NULL);
 			continue;
 		}
 	}
@@ -383,9 +383,16 @@ cs_join(struct hook_channel_joinpart *hdata)
 	secure = mc->flags & MC_SECURE || (!chansvs.changets &&
 			chan->nummembers == 1 && chan->ts > CURRTIME - 300);
 
+	/* during the burst, queue the join so that guarding every channel does
+	 * not flood the uplink while it is still sending us its state */
 	if (chan->nummembers == 1 && mc->flags & MC_GUARD &&
 		metadata_find(mc, "private:botserv:bot-assigned") == NULL)
-		join(chan->name, chansvs.nick);
+	{
+		if (me.bursting)
+			join_schedule(chan->name, chansvs.nick, NULL);
+		else
+			join(chan->name, chansvs.nick);
+	}
 
 	/* Kick out users who may be recreating channels mlocked +i.
 	 * Users with +i flag are allowed to join, as are users matching
@@ -456,7 +463,7 @@ cs_part(struct hook_channel_joinpart *hdata)
 	struct mychan *mc;
 
 	cu = hdata->cu;
-	if (cu == NULL)
+	if (cu == NULL || hdata->split)
 		return;
 	mc = mychan_find(cu->chan->name);
 	if (mc == NULL)
@@ -501,6 +508,47 @@ cs_part(struct hook_channel_joinpart *hdata)
 	part(cu->chan->name, chansvs.nick);
 }
 
+// Same as cs_part(), once for all the members of a channel that left in a netsplit.
+static void
+cs_split(struct hook_channel_split *hdata)
+{
+	struct mychan *mc;
+	size_t i;
+
+	mc = mychan_find(hdata->c->name);
+	if (mc == NULL)
+		return;
+	if (metadata_find(mc, "private:botserv:bot-assigned") != NULL)
+		return;
+
+	if ((CURRTIME - mc->used) >= SECONDS_PER_HOUR)
+	{
+		for (i = 0; i < hdata->count; i++)
+		{
+			if (chanacs_user_flags(mc, hdata->members[i]->user) & CA_USEDUPDATE)
+			{
+				mc->used = CURRTIME;
+				break;
+			}
+		}
+	}
+
+	if (!config_options.leave_chans)
+		return;
+
+	// we're not parting if anyone but services stays behind
+	if (hdata->c->nummembers - hdata->c->numsvcmembers > hdata->count)
+		return;
+
+	if (mc->flags & MC_INHABIT)
+	{
+		slog(LG_DEBUG, "cs_split(): not leaving channel %s due to MC_INHABIT flag", mc->name);
+		return;
+	}
+
+	part(hdata->c->name, chansvs.nick);
+}
+
 static struct user *
 get_changets_user(struct mychan *mc)
 {
@@ -748,6 +796,10 @@ cs_tschange(struct channel *c)
 static void
 on_shutdown(void *unused)
 {
+	// chanserv stays on the network across a warm restart
+	if (runflags & RF_WARM)
+		return;
+
 	if (chansvs.me != NULL && chansvs.me->me != NULL)
 		quit_sts(chansvs.me->me, "shutting down");
 }
@@ -828,6 +880,7 @@ mod_init(struct module ATHEME_VATTR_UNUSED *const restrict m)
 
 	hook_add_channel_join(cs_join);
 	hook_add_channel_part(cs_part);
+	hook_add_channel_split(cs_split);
 	hook_add_channel_register(cs_register);
 	hook_add_channel_succession(cs_succession);
 	hook_add_channel_add(cs_newchan);
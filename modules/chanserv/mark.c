@@ -54,6 +54,7 @@ cs_cmd_mark(struct sourceinfo *si, int parc, char *parv[])
 		metadata_add(mc, "private:mark:setter", get_oper_name(si));
 		metadata_add(mc, "private:mark:reason", info);
 		metadata_add(mc, "private:mark:timestamp", int64_to_string(CURRTIME));
+		hook_call_mychan_changed_flags(mc);
 
 		wallops("\2%s\2 marked the channel \2%s\2.", get_oper_name(si), target);
 		logcommand(si, CMDLOG_ADMIN, "MARK:ON: \2%s\2 (reason: \2%s\2)", mc->name, info);
@@ -70,6 +71,7 @@ cs_cmd_mark(struct sourceinfo *si, int parc, char *parv[])
 		metadata_delete(mc, "private:mark:setter");
 		metadata_delete(mc, "private:mark:reason");
 		metadata_delete(mc, "private:mark:timestamp");
+		hook_call_mychan_changed_flags(mc);
 
 		wallops("\2%s\2 unmarked the channel \2%s\2.", get_oper_name(si), target);
 		logcommand(si, CMDLOG_ADMIN, "MARK:OFF: \2%s\2", mc->name);
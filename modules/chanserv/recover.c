@@ -118,7 +118,7 @@ cs_cmd_recover(struct sourceinfo *si, int parc, char *parv[])
 		for (i = 0; ignore_mode_list[i].mode != '\0'; i++)
 		{
 			str[1] = ignore_mode_list[i].mode;
-			if (mc->chan->extmodes[i] != NULL)
+			if (channel_extmode(mc->chan, i) != NULL)
 				channel_mode_va(si->service->me, mc->chan, 1, str);
 		}
 	}
@@ -181,7 +181,7 @@ cs_cmd_set_mlock(struct sourceinfo *si, int parc, char *parv[])
 							  command_fail(si, fault_badparams, _("Invalid value \2%s\2 for mode +%c."), arg, c);
 							  return;
 						  }
-						  if ((mc->chan == NULL || mc->chan->extmodes[i] == NULL || strcmp(mc->chan->extmodes[i], arg)) && !ignore_mode_list[i].check(arg, mc->chan, mc, si->su, si->smu))
+						  if ((mc->chan == NULL || channel_extmode(mc->chan, i) == NULL || strcmp(channel_extmode(mc->chan, i), arg)) && !ignore_mode_list[i].check(arg, mc->chan, mc, si->su, si->smu))
 						  {
 							  command_fail(si, fault_badparams, _("Invalid value \2%s\2 for mode +%c."), arg, c);
 							  return;
@@ -53,6 +53,7 @@ cs_cmd_set_private(struct sourceinfo *si, int parc, char *parv[])
 		verbose(mc, "\2%s\2 enabled the PRIVATE flag", get_source_name(si));
 
 		mc->flags |= MC_PRIVATE;
+		hook_call_mychan_changed_flags(mc);
 
 		command_success_nodata(si, _("The \2%s\2 flag has been set for \2%s\2."), "PRIVATE", mc->name);
 
@@ -71,6 +72,7 @@ cs_cmd_set_private(struct sourceinfo *si, int parc, char *parv[])
 		verbose(mc, "\2%s\2 disabled the PRIVATE flag", get_source_name(si));
 
 		mc->flags &= ~MC_PRIVATE;
+		hook_call_mychan_changed_flags(mc);
 
 		command_success_nodata(si, _("The \2%s\2 flag has been removed for \2%s\2."), "PRIVATE", mc->name);
 
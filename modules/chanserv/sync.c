@@ -56,7 +56,7 @@ do_channel_sync(struct mychan *mc, struct chanacs *ca)
 			}
 			else
 			{
-				if (!mask_matches_user(ca->host, cu->user))
+				if (!matcher_matches_user(&ca->matcher, ca->host, cu->user))
 					continue;
 			}
 		}
@@ -18,6 +18,7 @@ gs_cmd_list(struct sourceinfo *si, int parc, char *parv[])
 	char *pattern = parv[0];
 	unsigned int matches = 0;
 	struct myentity_iteration_state state;
+	struct match_pattern *compiled;
 
 	if (!pattern)
 	{
@@ -29,19 +30,23 @@ gs_cmd_list(struct sourceinfo *si, int parc, char *parv[])
 	// No need to say "Groups currently registered". You can't have a unregistered group.
 	command_success_nodata(si, _("Groups matching pattern \2%s\2:"), pattern);
 
+	compiled = match_compile(pattern);
+
 	MYENTITY_FOREACH_T(mt, &state, ENT_GROUP)
 	{
 		struct mygroup *mg = group(mt);
 		continue_if_fail(mt != NULL);
 		continue_if_fail(mg != NULL);
 
-		if (!match(pattern, entity(mg)->name))
+		if (!match_compiled(compiled, entity(mg)->name))
 		{
 			command_success_nodata(si, "- %s (%s)", entity(mg)->name, mygroup_founder_names(mg));
 			matches++;
 		}
 	}
 
+	match_pattern_free(compiled);
+
 	if (matches == 0)
 		command_success_nodata(si, _("No groups matched pattern \2%s\2"), pattern);
 	else
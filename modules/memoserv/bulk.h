@@ -0,0 +1,31 @@
+/*
+ * SPDX-License-Identifier: ISC
+ * SPDX-URL: https://spdx.org/licenses/ISC.html
+ *
+ * Copyright (C) 2026 Atheme Development Group (https://atheme.github.io/)
+ *
+ * bulk.h - delivery of a memo to many accounts
+ *
+ * Include this header for modules other than memoserv/main
+ * that send one memo to a list of accounts.
+ */
+
+#ifndef ATHEME_MOD_MEMOSERV_BULK_H
+#define ATHEME_MOD_MEMOSERV_BULK_H 1
+
+#include <atheme.h>
+
+struct memo_bulk;       // opaque, see memo_bulk_create() in main.c
+
+static struct memo_bulk *(*memo_bulk_create)(struct sourceinfo *si, const char *target, const char *text) = NULL;
+static void (*memo_bulk_add)(struct memo_bulk *mb, struct myuser *mu) = NULL;
+static bool (*memo_bulk_start)(struct memo_bulk *mb, struct sourceinfo *si, unsigned int *tried, unsigned int *sent) = NULL;
+
+static inline void use_memoserv_bulk_symbols(struct module *m)
+{
+	MODULE_TRY_REQUEST_SYMBOL(m, memo_bulk_create, "memoserv/main", "memo_bulk_create")
+	MODULE_TRY_REQUEST_SYMBOL(m, memo_bulk_add, "memoserv/main", "memo_bulk_add")
+	MODULE_TRY_REQUEST_SYMBOL(m, memo_bulk_start, "memoserv/main", "memo_bulk_start")
+}
+
+#endif /* !ATHEME_MOD_MEMOSERV_BULK_H */
@@ -33,7 +33,7 @@ ms_cmd_delete(struct sourceinfo *si, int parc, char *parv[])
 	}
 
 	// Do we have any memos?
-	if (!si->smu->memos.count)
+	if (!myuser_cold_ro(si->smu)->memos.count)
 	{
 		command_fail(si, fault_nochange, _("You have no memos to delete."));
 		return;
@@ -60,7 +60,7 @@ ms_cmd_delete(struct sourceinfo *si, int parc, char *parv[])
 		}
 
 		// If int, does that index exist? And do we have something to delete?
-		if (memonum > si->smu->memos.count)
+		if (memonum > myuser_cold_ro(si->smu)->memos.count)
 		{
 			command_fail(si, fault_nosuch_key, _("The specified memo doesn't exist."));
 			return;
@@ -70,7 +70,7 @@ ms_cmd_delete(struct sourceinfo *si, int parc, char *parv[])
 	delcount = 0;
 
 	// Iterate through memos, doing deletion
-	MOWGLI_ITER_FOREACH_SAFE(n, tn, si->smu->memos.head)
+	MOWGLI_ITER_FOREACH_SAFE(n, tn, myuser_cold_ro(si->smu)->memos.head)
 	{
 		i++;
 		memo = (struct mymemo *) n->data;
@@ -80,18 +80,13 @@ ms_cmd_delete(struct sourceinfo *si, int parc, char *parv[])
 		{
 			delcount++;
 
-			if (!(memo->status & MEMO_READ))
-				si->smu->memoct_new--;
-
-			// Free to node pool, remove from chain
-			mowgli_node_delete(n, &si->smu->memos);
-			mowgli_node_free(n);
-
-			sfree(memo);
+			mymemo_delete(si->smu, memo);
 		}
 
 	}
 
+	myuser_cold_trim(si->smu);
+
 	command_success_nodata(si, ngettext(N_("%u memo deleted."), N_("%u memos deleted."), delcount), delcount);
 
 	return;
@@ -15,8 +15,8 @@ ms_cmd_forward(struct sourceinfo *si, int parc, char *parv[])
 	// Misc structs etc
 	struct user *tu;
 	struct myuser *tmu;
-	struct mymemo *memo, *newmemo;
-	mowgli_node_t *n, *temp;
+	struct mymemo *memo;
+	mowgli_node_t *n;
 	unsigned int i = 1, memonum = 0;
 	struct service *const memoserv = service_find("memoserv");
 
@@ -39,7 +39,7 @@ ms_cmd_forward(struct sourceinfo *si, int parc, char *parv[])
 	}
 
 	// Check to see if any memos
-	if (!si->smu->memos.count)
+	if (!myuser_cold_ro(si->smu)->memos.count)
 	{
 		command_fail(si, fault_nosuch_key, _("You have no memos to forward."));
 		return;
@@ -75,14 +75,14 @@ ms_cmd_forward(struct sourceinfo *si, int parc, char *parv[])
 	}
 
 	// Check to see if memo n exists
-	if (memonum > si->smu->memos.count)
+	if (memonum > myuser_cold_ro(si->smu)->memos.count)
 	{
 		command_fail(si, fault_nosuch_key, _("Invalid memo number."));
 		return;
 	}
 
 	// Check to make sure target inbox not full
-	if (tmu->memos.count >= me.mdlimit)
+	if (myuser_cold_ro(tmu)->memos.count >= me.mdlimit)
 	{
 		command_fail(si, fault_toomany, _("Target inbox is full."));
 		logcommand(si, CMDLOG_SET, "failed FORWARD to \2%s\2 (target inbox full)", entity(tmu)->name);
@@ -90,18 +90,18 @@ ms_cmd_forward(struct sourceinfo *si, int parc, char *parv[])
 	}
 
 	// rate limit it -- jilles
-	if (CURRTIME - si->smu->memo_ratelimit_time > MEMO_MAX_TIME)
-		si->smu->memo_ratelimit_num = 0;
-	if (si->smu->memo_ratelimit_num > MEMO_MAX_NUM && !has_priv(si, PRIV_FLOOD))
+	if (CURRTIME - myuser_cold_ro(si->smu)->memo_ratelimit_time > MEMO_MAX_TIME)
+		myuser_cold(si->smu)->memo_ratelimit_num = 0;
+	if (myuser_cold_ro(si->smu)->memo_ratelimit_num > MEMO_MAX_NUM && !has_priv(si, PRIV_FLOOD))
 	{
 		command_fail(si, fault_toomany, _("Too many memos; please wait a while and try again"));
 		return;
 	}
-	si->smu->memo_ratelimit_num++;
-	si->smu->memo_ratelimit_time = CURRTIME;
+	myuser_cold(si->smu)->memo_ratelimit_num++;
+	myuser_cold(si->smu)->memo_ratelimit_time = CURRTIME;
 
 	// Make sure we're not on ignore
-	MOWGLI_ITER_FOREACH(n, tmu->memo_ignores.head)
+	MOWGLI_ITER_FOREACH(n, myuser_cold_ro(tmu)->memo_ignores.head)
 	{
 		struct mynick *mn;
 		struct myuser *mu;
@@ -124,23 +124,15 @@ ms_cmd_forward(struct sourceinfo *si, int parc, char *parv[])
 	logcommand(si, CMDLOG_SET, "FORWARD: to \2%s\2", entity(tmu)->name);
 
 	// Go to forwarding memos
-	MOWGLI_ITER_FOREACH(n, si->smu->memos.head)
+	MOWGLI_ITER_FOREACH(n, myuser_cold_ro(si->smu)->memos.head)
 	{
 		if (i == memonum)
 		{
 			// should have some function for send here...  ask nenolod
 			memo = (struct mymemo *)n->data;
-			newmemo = smalloc(sizeof *newmemo);
 
-			// Create memo
-			newmemo->sent = CURRTIME;
-			mowgli_strlcpy(newmemo->sender, entity(si->smu)->name, sizeof newmemo->sender);
-			mowgli_strlcpy(newmemo->text, memo->text, sizeof newmemo->text);
-
-			// Create node, add to their linked list of memos
-			temp = mowgli_node_create();
-			mowgli_node_add(newmemo, temp, &tmu->memos);
-			tmu->memoct_new++;
+			// Add a copy to their memos; the text is shared with ours
+			(void) mymemo_add_shared(tmu, entity(si->smu)->name, memo->text, CURRTIME, 0);
 
 			// Should we email this?
 			if (tmu->flags & MU_EMAILMEMOS)
@@ -158,12 +150,12 @@ ms_cmd_forward(struct sourceinfo *si, int parc, char *parv[])
 		command_success_nodata(si, _("%s is currently online, and you may talk directly, by sending a private message."), target);
 	}
 	if (si->su == NULL || !irccasecmp(si->su->nick, entity(si->smu)->name))
-		myuser_notice(si->service->nick, tmu, "You have a new forwarded memo from %s (%zu).", entity(si->smu)->name, MOWGLI_LIST_LENGTH(&tmu->memos));
+		myuser_notice(si->service->nick, tmu, "You have a new forwarded memo from %s (%zu).", entity(si->smu)->name, MOWGLI_LIST_LENGTH(&myuser_cold_ro(tmu)->memos));
 	else
-		myuser_notice(si->service->nick, tmu, "You have a new forwarded memo from %s (nick: %s) (%zu).", entity(si->smu)->name, si->su->nick, MOWGLI_LIST_LENGTH(&tmu->memos));
+		myuser_notice(si->service->nick, tmu, "You have a new forwarded memo from %s (nick: %s) (%zu).", entity(si->smu)->name, si->su->nick, MOWGLI_LIST_LENGTH(&myuser_cold_ro(tmu)->memos));
 
 	myuser_notice(si->service->nick, tmu, "To read it, type \2/msg %s READ %zu\2",
-	              memoserv->disp, MOWGLI_LIST_LENGTH(&tmu->memos));
+	              memoserv->disp, MOWGLI_LIST_LENGTH(&myuser_cold_ro(tmu)->memos));
 
 	command_success_nodata(si, _("The memo has been successfully forwarded to \2%s\2."), target);
 	return;
@@ -24,16 +24,16 @@ ms_cmd_list(struct sourceinfo *si, int parc, char *parv[])
 
 	command_success_nodata(si, ngettext(N_("You have %zu memo (%u new)."),
 					    N_("You have %zu memos (%u new)."),
-					    si->smu->memos.count), si->smu->memos.count, si->smu->memoct_new);
+					    myuser_cold_ro(si->smu)->memos.count), myuser_cold_ro(si->smu)->memos.count, myuser_cold_ro(si->smu)->memoct_new);
 
 	// Check to see if any memos
-	if (!si->smu->memos.count)
+	if (!myuser_cold_ro(si->smu)->memos.count)
 		return;
 
 	// Go to listing memos
 	command_success_nodata(si, " ");
 
-	MOWGLI_ITER_FOREACH(n, si->smu->memos.head)
+	MOWGLI_ITER_FOREACH(n, myuser_cold_ro(si->smu)->memos.head)
 	{
 		i++;
 		memo = (struct mymemo *)n->data;
@@ -16,17 +16,371 @@ static struct service *memosvs = NULL;
 extern unsigned int maxmemos;
 unsigned int maxmemos;
 
+/* Accounts a memo is delivered to per bulk delivery and event loop turn,
+ * and how often the sender is told how far the delivery has got
+ */
+#define MEMO_BULK_SLICE         500U
+#define MEMO_BULK_REPORT        60
+
+/* A memo that is sent to many accounts by SENDALL, SENDOPS or SENDGROUP.
+ * Every account gets a small header that shares the sender and the text
+ * with all the others, and the accounts are gone through MEMO_BULK_SLICE
+ * at a time on later turns of the event loop, so that a memo to the whole
+ * network does not hold up services.
+ */
+struct memo_bulk
+{
+	mowgli_node_t           node;
+	struct myuser *         smu;            // the sender, or NULL once dropped
+	stringref               sender;
+	char *                  nick;           // the sender's nick, if not the account name
+	char *                  target;         // what the memo was sent to
+	stringref               text;
+	time_t                  sent;
+	struct hashmap *        names;          // names of the sender, as memo ignores have them
+	struct myuser **        rcpt;           // sorted by address once started
+	unsigned char *         dropped;        // bit per recipient that was dropped since
+	size_t                  count;
+	size_t                  alloc;
+	size_t                  next;           // first recipient not gone through yet
+	unsigned int            delivered;      // memos added, or quietly ignored
+	time_t                  last_report;
+};
+
+extern struct memo_bulk *memo_bulk_create(struct sourceinfo *, const char *, const char *);
+extern void memo_bulk_add(struct memo_bulk *, struct myuser *);
+extern bool memo_bulk_start(struct memo_bulk *, struct sourceinfo *, unsigned int *, unsigned int *);
+
+static mowgli_list_t memo_bulks;
+static mowgli_eventloop_timer_t *memo_bulk_timer = NULL;
+
+static void
+memo_bulk_free(struct memo_bulk *mb)
+{
+	strshare_unref(mb->sender);
+	strshare_unref(mb->text);
+	hashmap_destroy(mb->names);
+	sfree(mb->nick);
+	sfree(mb->target);
+	sfree(mb->rcpt);
+	sfree(mb->dropped);
+	sfree(mb);
+}
+
+static int
+memo_bulk_rcpt_cmp(const void *a, const void *b)
+{
+	const uintptr_t x = (uintptr_t) *(struct myuser *const *) a;
+	const uintptr_t y = (uintptr_t) *(struct myuser *const *) b;
+
+	return (x > y) - (x < y);
+}
+
+static bool
+memo_bulk_ignored(const struct memo_bulk *mb, const struct myuser *tmu)
+{
+	mowgli_node_t *n;
+
+	MOWGLI_ITER_FOREACH(n, myuser_cold_ro(tmu)->memo_ignores.head)
+		if (hashmap_retrieve(mb->names, n->data) != NULL)
+			return true;
+
+	return false;
+}
+
+static void
+memo_bulk_deliver(struct memo_bulk *mb, struct myuser *tmu)
+{
+	size_t count;
+
+	// Does the user allow memos? --pfish
+	if (tmu->flags & MU_NOMEMO)
+		return;
+
+	// Check to make sure target inbox not full
+	if (myuser_cold_ro(tmu)->memos.count >= maxmemos)
+		return;
+
+	// As in SEND to a single user, make ignore fail silently
+	mb->delivered++;
+
+	if (memo_bulk_ignored(mb, tmu))
+		return;
+
+	(void) mymemo_add_shared(tmu, mb->sender, mb->text, mb->sent, MEMO_CHANNEL);
+
+	// Should we email this?
+	if (tmu->flags & MU_EMAILMEMOS)
+	{
+		struct user *u = memosvs->me;
+
+		if (mb->smu != NULL && mb->smu->logins.head != NULL)
+			u = mb->smu->logins.head->data;
+
+		(void) sendemail(u, tmu, EMAIL_MEMO, tmu->email, mb->text);
+	}
+
+	if (tmu->logins.head == NULL)
+		return;
+
+	// Is the user online? If so, tell them about the new memo.
+	count = MOWGLI_LIST_LENGTH(&myuser_cold_ro(tmu)->memos);
+
+	if (mb->nick == NULL)
+		myuser_notice(memosvs->me->nick, tmu, "You have a new memo from %s (%zu).", mb->sender, count);
+	else
+		myuser_notice(memosvs->me->nick, tmu, "You have a new memo from %s (nick: %s) (%zu).", mb->sender, mb->nick, count);
+
+	myuser_notice(memosvs->me->nick, tmu, "To read it, type \2/msg %s READ %zu\2", memosvs->disp, count);
+}
+
+// Goes through up to MEMO_BULK_SLICE more recipients; returns true once all have been
+static bool
+memo_bulk_step(struct memo_bulk *mb)
+{
+	const size_t last = mb->next + MEMO_BULK_SLICE < mb->count ? mb->next + MEMO_BULK_SLICE : mb->count;
+
+	for (; mb->next < last; mb->next++)
+		if (!(mb->dropped[mb->next / CHAR_BIT] & (1U << (mb->next % CHAR_BIT))))
+			memo_bulk_deliver(mb, mb->rcpt[mb->next]);
+
+	return mb->next == mb->count;
+}
+
+static void
+memo_bulk_finish(struct memo_bulk *mb)
+{
+	slog(LG_INFO, "memo_bulk_finish(): memo from %s to %s delivered to %u/%zu accounts",
+	     mb->sender, mb->target, mb->delivered, mb->count);
+
+	if (mb->smu != NULL)
+		myuser_notice(memosvs->me->nick, mb->smu, "Your memo to \2%s\2 has been delivered to \2%u\2 of %zu accounts.",
+		              mb->target, mb->delivered, mb->count);
+
+	mowgli_node_delete(&mb->node, &memo_bulks);
+	memo_bulk_free(mb);
+}
+
+static void
+memo_bulk_run(void *unused)
+{
+	mowgli_node_t *n, *tn;
+	const enum sendq_class prev = sts_set_class(SENDQ_BULK);
+
+	memo_bulk_timer = NULL;
+
+	MOWGLI_ITER_FOREACH_SAFE(n, tn, memo_bulks.head)
+	{
+		struct memo_bulk *mb = n->data;
+
+		if (me.connected && uplink_congested())
+			break;
+
+		if (memo_bulk_step(mb))
+		{
+			memo_bulk_finish(mb);
+			continue;
+		}
+
+		if (mb->smu != NULL && CURRTIME - mb->last_report >= MEMO_BULK_REPORT)
+		{
+			mb->last_report = CURRTIME;
+			myuser_notice(memosvs->me->nick, mb->smu, "Your memo to \2%s\2 has been delivered to %u of %zu accounts so far.",
+			              mb->target, mb->delivered, mb->count);
+		}
+	}
+
+	(void) sts_set_class(prev);
+
+	if (memo_bulks.head != NULL)
+		memo_bulk_timer = mowgli_timer_add_once(base_eventloop, "memo_bulk_run", memo_bulk_run,
+		                                        NULL, me.connected && uplink_congested() ? 1 : 0);
+}
+
+/*
+ * memo_bulk_create(struct sourceinfo *si, const char *target, const char *text)
+ *
+ * Starts a memo from the account of si to many accounts; add them with
+ * memo_bulk_add() and deliver it with memo_bulk_start().
+ *
+ * Inputs:
+ *      - the sender of the memo, who must be logged in
+ *      - what the memo is sent to, for the sender and the logs
+ *      - the text of the memo
+ *
+ * Outputs:
+ *      - the memo
+ *
+ * Side Effects:
+ *      - none
+ */
+struct memo_bulk *
+memo_bulk_create(struct sourceinfo *si, const char *target, const char *text)
+{
+	struct memo_bulk *mb = smalloc(sizeof *mb);
+	mowgli_node_t *n;
+
+	mb->smu = si->smu;
+	mb->sender = strshare_ref(entity(si->smu)->name);
+	mb->target = sstrdup(target);
+	mb->text = strshare_get(text);
+	mb->sent = CURRTIME;
+
+	if (si->su != NULL && irccasecmp(si->su->nick, entity(si->smu)->name))
+		mb->nick = sstrdup(si->su->nick);
+
+	/* A recipient ignores the sender if one of their memo ignores names
+	 * the sender; rather than looking every one of them up, look them up
+	 * among the names the sender goes by.
+	 */
+	mb->names = hashmap_create(true);
+
+	if (nicksvs.no_nick_ownership)
+		(void) hashmap_add(mb->names, entity(si->smu)->name, si->smu);
+	else
+	{
+		MOWGLI_ITER_FOREACH(n, si->smu->nicks.head)
+		{
+			const struct mynick *mn = n->data;
+
+			(void) hashmap_add(mb->names, mn->nick, si->smu);
+		}
+	}
+
+	return mb;
+}
+
+/*
+ * memo_bulk_add(struct memo_bulk *mb, struct myuser *mu)
+ *
+ * Adds an account to those a memo from memo_bulk_create() is sent to; the
+ * sender is skipped.
+ *
+ * Inputs:
+ *      - the memo
+ *      - the account
+ *
+ * Outputs:
+ *      - nothing
+ *
+ * Side Effects:
+ *      - none
+ */
+void
+memo_bulk_add(struct memo_bulk *mb, struct myuser *mu)
+{
+	if (mu == NULL || mu == mb->smu)
+		return;
+
+	if (mb->count == mb->alloc)
+	{
+		mb->alloc = mb->alloc ? mb->alloc * 2 : 16;
+		mb->rcpt = srealloc(mb->rcpt, mb->alloc * sizeof *mb->rcpt);
+	}
+
+	mb->rcpt[mb->count++] = mu;
+}
+
+/*
+ * memo_bulk_start(struct memo_bulk *mb, struct sourceinfo *si,
+ *                 unsigned int *tried, unsigned int *sent)
+ *
+ * Delivers a memo from memo_bulk_create(). If there are few recipients,
+ * this is done at once; otherwise the sender is told that the memo is
+ * being delivered, and it is delivered on later turns of the event loop,
+ * with reports of how far it has got.
+ *
+ * Inputs:
+ *      - the memo
+ *      - the sender
+ *      - where to store the number of recipients
+ *      - where to store the number of accounts the memo was delivered to
+ *
+ * Outputs:
+ *      - true if the memo has been delivered to all recipients already;
+ *        the memo has then been freed, and *sent is final
+ *      - false if it is being delivered in the background
+ *
+ * Side Effects:
+ *      - memos are added to the accounts, which are told about them
+ */
+bool
+memo_bulk_start(struct memo_bulk *mb, struct sourceinfo *si, unsigned int *tried, unsigned int *sent)
+{
+	enum sendq_class prev;
+	bool done;
+
+	/* Recipients are looked up by address if they are dropped while the
+	 * memo is being delivered.
+	 */
+	if (mb->count > 1)
+		qsort(mb->rcpt, mb->count, sizeof *mb->rcpt, memo_bulk_rcpt_cmp);
+
+	mb->dropped = scalloc(mb->count / CHAR_BIT + 1, 1);
+	mb->last_report = CURRTIME;
+
+	// The notices may wait behind more urgent output to the uplink
+	prev = sts_set_class(SENDQ_BULK);
+	done = memo_bulk_step(mb);
+	(void) sts_set_class(prev);
+
+	*tried = (unsigned int) mb->count;
+	*sent = mb->delivered;
+
+	if (done)
+	{
+		memo_bulk_free(mb);
+		return true;
+	}
+
+	command_success_nodata(si, _("The memo is being delivered to \2%zu\2 accounts; you will be told when this is done."),
+	                       mb->count);
+
+	mowgli_node_add(mb, &mb->node, &memo_bulks);
+
+	if (memo_bulk_timer == NULL)
+		memo_bulk_timer = mowgli_timer_add_once(base_eventloop, "memo_bulk_run", memo_bulk_run, NULL, 0);
+
+	return false;
+}
+
+static void
+on_myuser_delete(struct myuser *mu)
+{
+	mowgli_node_t *n;
+
+	MOWGLI_ITER_FOREACH(n, memo_bulks.head)
+	{
+		struct memo_bulk *mb = n->data;
+		struct myuser **rcpt;
+
+		if (mb->smu == mu)
+			mb->smu = NULL;
+
+		if (mb->next == mb->count)
+			continue;
+
+		rcpt = bsearch(&mu, mb->rcpt + mb->next, mb->count - mb->next, sizeof *mb->rcpt, memo_bulk_rcpt_cmp);
+		if (rcpt != NULL)
+		{
+			const size_t i = (size_t) (rcpt - mb->rcpt);
+
+			mb->dropped[i / CHAR_BIT] |= 1U << (i % CHAR_BIT);
+		}
+	}
+}
+
 static void
 on_user_identify(struct user *u)
 {
 	struct myuser *mu = u->myuser;
 
-	if (mu->memoct_new > 0)
+	if (myuser_cold_ro(mu)->memoct_new > 0)
 	{
-		notice(memosvs->me->nick, u->nick, "You have %u new memo(s).", mu->memoct_new);
+		notice(memosvs->me->nick, u->nick, "You have %u new memo(s).", myuser_cold_ro(mu)->memoct_new);
 		notice(memosvs->me->nick, u->nick, "To read them, type \2/msg %s READ NEW\2", memosvs->disp);
 	}
-	if (mu->memos.count >= maxmemos)
+	if (myuser_cold_ro(mu)->memos.count >= maxmemos)
 	{
 		notice(memosvs->me->nick, u->nick, "Your memo inbox is full! Please "
 		                                   "delete memos you no longer need.");
@@ -50,12 +404,12 @@ on_user_away(struct user *u)
 	}
 	if (mu == NULL)
 		return;
-	if (mu->memoct_new > 0)
+	if (myuser_cold_ro(mu)->memoct_new > 0)
 	{
-		notice(memosvs->me->nick, u->nick, "You have %u new memo(s).", mu->memoct_new);
+		notice(memosvs->me->nick, u->nick, "You have %u new memo(s).", myuser_cold_ro(mu)->memoct_new);
 		notice(memosvs->me->nick, u->nick, "To read them, type \2/msg %s READ NEW\2", memosvs->disp);
 	}
-	if (mu->memos.count >= maxmemos)
+	if (myuser_cold_ro(mu)->memos.count >= maxmemos)
 	{
 		notice(memosvs->me->nick, u->nick, "Your memo inbox is full! Please "
 		                                   "delete memos you no longer need.");
@@ -75,6 +429,7 @@ mod_init(struct module *const restrict m)
 
 	(void) hook_add_user_identify(&on_user_identify);
 	(void) hook_add_user_away(&on_user_away);
+	(void) hook_add_myuser_delete(&on_myuser_delete);
 
 	(void) add_uint_conf_item("MAXMEMOS", &memosvs->conf_table, 0, &maxmemos, 1, INT_MAX, 30);
 }
@@ -84,6 +439,21 @@ mod_deinit(const enum module_unload_intent ATHEME_VATTR_UNUSED intent)
 {
 	(void) hook_del_user_identify(&on_user_identify);
 	(void) hook_del_user_away(&on_user_away);
+	(void) hook_del_myuser_delete(&on_myuser_delete);
+
+	if (memo_bulk_timer != NULL)
+		mowgli_timer_destroy(base_eventloop, memo_bulk_timer);
+
+	while (memo_bulks.head != NULL)
+	{
+		struct memo_bulk *mb = memo_bulks.head->data;
+
+		slog(LG_INFO, "memoserv/main: memo from %s to %s abandoned after %u/%zu accounts",
+		     mb->sender, mb->target, mb->delivered, mb->count);
+
+		mowgli_node_delete(&mb->node, &memo_bulks);
+		memo_bulk_free(mb);
+	}
 
 	(void) service_delete(memosvs);
 }
@@ -16,10 +16,11 @@ ms_cmd_read(struct sourceinfo *si, int parc, char *parv[])
 {
 	// Misc structs etc
 	struct myuser *tmu;
-	struct mymemo *memo, *receipt;
+	struct mymemo *memo;
 	mowgli_node_t *n;
 	unsigned int i = 1, memonum = 0, numread = 0;
 	char strfbuf[BUFSIZE];
+	char text[MEMOLEN + 1];
 	struct tm *tm;
 	bool readnew;
 
@@ -36,7 +37,7 @@ ms_cmd_read(struct sourceinfo *si, int parc, char *parv[])
 	}
 
 	// Check to see if any memos
-	if (!si->smu->memos.count)
+	if (!myuser_cold_ro(si->smu)->memos.count)
 	{
 		command_fail(si, fault_nosuch_key, _("You have no memos."));
 		return;
@@ -50,14 +51,14 @@ ms_cmd_read(struct sourceinfo *si, int parc, char *parv[])
 	}
 
 	// Check to see if memonum is greater than memocount
-	if (memonum > si->smu->memos.count)
+	if (memonum > myuser_cold_ro(si->smu)->memos.count)
 	{
 		command_fail(si, fault_nosuch_key, _("Invalid message index."));
 		return;
 	}
 
 	// Go to reading memos
-	MOWGLI_ITER_FOREACH(n, si->smu->memos.head)
+	MOWGLI_ITER_FOREACH(n, myuser_cold_ro(si->smu)->memos.head)
 	{
 		memo = (struct mymemo *)n->data;
 		if (i == memonum || (readnew && !(memo->status & MEMO_READ)))
@@ -68,7 +69,7 @@ ms_cmd_read(struct sourceinfo *si, int parc, char *parv[])
 			if (!(memo->status & MEMO_READ))
 			{
 				memo->status |= MEMO_READ;
-				si->smu->memoct_new--;
+				myuser_cold(si->smu)->memoct_new--;
 				tmu = myuser_find(memo->sender);
 
 				/* If the sender is logged in, tell them the memo's been read */
@@ -80,18 +81,11 @@ ms_cmd_read(struct sourceinfo *si, int parc, char *parv[])
 				else
 				{
 					// If they have an account, their inbox is not full and they aren't memoserv
-					if ( (tmu != NULL) && (tmu->memos.count < me.mdlimit) && strcasecmp(si->service->nick, memo->sender))
+					if ( (tmu != NULL) && (myuser_cold_ro(tmu)->memos.count < me.mdlimit) && strcasecmp(si->service->nick, memo->sender))
 					{
-						// Malloc and populate memo struct
-						receipt = smalloc(sizeof *receipt);
-						receipt->sent = CURRTIME;
-						mowgli_strlcpy(receipt->sender, si->service->nick, sizeof receipt->sender);
-						snprintf(receipt->text, sizeof receipt->text, "%s has read a memo from you sent at %s", entity(si->smu)->name, strfbuf);
-
-						// Attach to their linked list
-						n = mowgli_node_create();
-						mowgli_node_add(receipt, n, &tmu->memos);
-						tmu->memoct_new++;
+						// Add a receipt to their memos
+						snprintf(text, sizeof text, "%s has read a memo from you sent at %s", entity(si->smu)->name, strfbuf);
+						(void) mymemo_add(tmu, si->service->nick, text, CURRTIME, 0);
 					}
 				}
 			}
@@ -103,7 +97,7 @@ ms_cmd_read(struct sourceinfo *si, int parc, char *parv[])
 
 			if (!readnew)
 				return;
-			if (++numread >= MAX_READ_AT_ONCE && si->smu->memoct_new > 0)
+			if (++numread >= MAX_READ_AT_ONCE && myuser_cold_ro(si->smu)->memoct_new > 0)
 			{
 				command_success_nodata(si, _("Stopping command after %u memos."), numread);
 				return;
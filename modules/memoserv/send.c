@@ -41,9 +41,9 @@ ms_cmd_send(struct sourceinfo *si, int parc, char *parv[])
 	}
 
 	// rate limit it -- jilles
-	if (CURRTIME - si->smu->memo_ratelimit_time > MEMO_MAX_TIME)
-		si->smu->memo_ratelimit_num = 0;
-	if (si->smu->memo_ratelimit_num > MEMO_MAX_NUM && !has_priv(si, PRIV_FLOOD))
+	if (CURRTIME - myuser_cold_ro(si->smu)->memo_ratelimit_time > MEMO_MAX_TIME)
+		myuser_cold(si->smu)->memo_ratelimit_num = 0;
+	if (myuser_cold_ro(si->smu)->memo_ratelimit_num > MEMO_MAX_NUM && !has_priv(si, PRIV_FLOOD))
 	{
 		command_fail(si, fault_toomany, _("You have used this command too many times; please wait a while and try again."));
 		return;
@@ -80,8 +80,8 @@ ms_cmd_send(struct sourceinfo *si, int parc, char *parv[])
 			return;
 		}
 
-		si->smu->memo_ratelimit_num++;
-		si->smu->memo_ratelimit_time = CURRTIME;
+		myuser_cold(si->smu)->memo_ratelimit_num++;
+		myuser_cold(si->smu)->memo_ratelimit_time = CURRTIME;
 
 		// Does the user allow memos? --pfish
 		if (tmu->flags & MU_NOMEMO)
@@ -91,7 +91,7 @@ ms_cmd_send(struct sourceinfo *si, int parc, char *parv[])
 		}
 
 		// Check to make sure target inbox not full
-		if (tmu->memos.count >= *maxmemos)
+		if (myuser_cold_ro(tmu)->memos.count >= *maxmemos)
 		{
 			command_fail(si, fault_toomany, _("%s's inbox is full"), target);
 			logcommand(si, CMDLOG_SET, "failed SEND to \2%s\2 (target inbox full)", entity(tmu)->name);
@@ -99,7 +99,7 @@ ms_cmd_send(struct sourceinfo *si, int parc, char *parv[])
 		}
 
 		// Make sure we're not on ignore
-		MOWGLI_ITER_FOREACH(n, tmu->memo_ignores.head)
+		MOWGLI_ITER_FOREACH(n, myuser_cold_ro(tmu)->memo_ignores.head)
 		{
 			struct mynick *mn;
 			struct myuser *mu;
@@ -120,16 +120,8 @@ ms_cmd_send(struct sourceinfo *si, int parc, char *parv[])
 		}
 		logcommand(si, CMDLOG_SET, "SEND: to \2%s\2", entity(tmu)->name);
 
-		// Malloc and populate struct
-		memo = smalloc(sizeof *memo);
-		memo->sent = CURRTIME;
-		mowgli_strlcpy(memo->sender, entity(si->smu)->name, sizeof memo->sender);
-		mowgli_strlcpy(memo->text, m, sizeof memo->text);
-
-		// Create a linked list node and add to memos
-		n = mowgli_node_create();
-		mowgli_node_add(memo, n, &tmu->memos);
-		tmu->memoct_new++;
+		// Add it to their memos
+		memo = mymemo_add(tmu, entity(si->smu)->name, m, CURRTIME, 0);
 
 		// Should we email this?
 	        if (tmu->flags & MU_EMAILMEMOS)
@@ -149,12 +141,12 @@ ms_cmd_send(struct sourceinfo *si, int parc, char *parv[])
 
 		// Is the user online? If so, tell them about the new memo.
 		if (si->su == NULL || !irccasecmp(si->su->nick, entity(si->smu)->name))
-			myuser_notice(memoserv->nick, tmu, "You have a new memo from %s (%zu).", entity(si->smu)->name, MOWGLI_LIST_LENGTH(&tmu->memos));
+			myuser_notice(memoserv->nick, tmu, "You have a new memo from %s (%zu).", entity(si->smu)->name, MOWGLI_LIST_LENGTH(&myuser_cold_ro(tmu)->memos));
 		else
-			myuser_notice(memoserv->nick, tmu, "You have a new memo from %s (nick: %s) (%zu).", entity(si->smu)->name, si->su->nick, MOWGLI_LIST_LENGTH(&tmu->memos));
+			myuser_notice(memoserv->nick, tmu, "You have a new memo from %s (nick: %s) (%zu).", entity(si->smu)->name, si->su->nick, MOWGLI_LIST_LENGTH(&myuser_cold_ro(tmu)->memos));
 
 		myuser_notice(si->service->nick, tmu, "To read it, type \2/msg %s READ %zu\2",
-		              memoserv->disp, MOWGLI_LIST_LENGTH(&tmu->memos));
+		              memoserv->disp, MOWGLI_LIST_LENGTH(&myuser_cold_ro(tmu)->memos));
 
 		// Tell user memo sent
 		command_success_nodata(si, _("The memo has been successfully sent to \2%s\2."), target);
@@ -8,19 +8,15 @@
  */
 
 #include <atheme.h>
-
-static unsigned int *maxmemos;
+#include "bulk.h"
 
 static void
 ms_cmd_sendall(struct sourceinfo *si, int parc, char *parv[])
 {
 	// misc structs etc
 	struct myentity *mt;
-	mowgli_node_t *n;
-	struct mymemo *memo;
+	struct memo_bulk *mb;
 	unsigned int sent = 0, tried = 0;
-	bool ignored;
-	struct service *memoserv;
 	struct myentity_iteration_state state;
 
 	// Grab args
@@ -45,9 +41,9 @@ ms_cmd_sendall(struct sourceinfo *si, int parc, char *parv[])
 	}
 
 	// rate limit it -- jilles
-	if (CURRTIME - si->smu->memo_ratelimit_time > MEMO_MAX_TIME)
-		si->smu->memo_ratelimit_num = 0;
-	if (si->smu->memo_ratelimit_num > MEMO_MAX_NUM && !has_priv(si, PRIV_FLOOD))
+	if (CURRTIME - myuser_cold_ro(si->smu)->memo_ratelimit_time > MEMO_MAX_TIME)
+		myuser_cold(si->smu)->memo_ratelimit_num = 0;
+	if (myuser_cold_ro(si->smu)->memo_ratelimit_num > MEMO_MAX_NUM && !has_priv(si, PRIV_FLOOD))
 	{
 		command_fail(si, fault_toomany, _("You have used this command too many times; please wait a while and try again."));
 		return;
@@ -69,79 +65,19 @@ ms_cmd_sendall(struct sourceinfo *si, int parc, char *parv[])
 		return;
 	}
 
-	si->smu->memo_ratelimit_num++;
-	si->smu->memo_ratelimit_time = CURRTIME;
+	myuser_cold(si->smu)->memo_ratelimit_num++;
+	myuser_cold(si->smu)->memo_ratelimit_time = CURRTIME;
+
+	mb = memo_bulk_create(si, "all accounts", m);
 
 	MYENTITY_FOREACH_T(mt, &state, ENT_USER)
+		memo_bulk_add(mb, user(mt));
+
+	if (!memo_bulk_start(mb, si, &tried, &sent))
 	{
-		struct myuser *tmu = user(mt);
-
-		if (tmu == si->smu)
-			continue;
-
-		tried++;
-
-		// Does the user allow memos? --pfish
-		if (tmu->flags & MU_NOMEMO)
-			continue;
-
-		// Check to make sure target inbox not full
-		if (tmu->memos.count >= *maxmemos)
-			continue;
-
-		// As in SEND to a single user, make ignore fail silently
-		sent++;
-
-		// Make sure we're not on ignore
-		ignored = false;
-		MOWGLI_ITER_FOREACH(n, tmu->memo_ignores.head)
-		{
-			struct mynick *mn;
-			struct myuser *mu;
-
-			if (nicksvs.no_nick_ownership)
-				mu = myuser_find((const char *)n->data);
-			else
-			{
-				mn = mynick_find((const char *)n->data);
-				mu = mn != NULL ? mn->owner : NULL;
-			}
-			if (mu == si->smu)
-				ignored = true;
-		}
-		if (ignored)
-			continue;
-
-		// Malloc and populate struct
-		memo = smalloc(sizeof *memo);
-		memo->sent = CURRTIME;
-		memo->status = MEMO_CHANNEL;
-		mowgli_strlcpy(memo->sender, entity(si->smu)->name, sizeof memo->sender);
-		mowgli_strlcpy(memo->text, m, sizeof memo->text);
-
-		// Create a linked list node and add to memos
-		n = mowgli_node_create();
-		mowgli_node_add(memo, n, &tmu->memos);
-		tmu->memoct_new++;
-
-		// Should we email this?
-		if (tmu->flags & MU_EMAILMEMOS)
-		{
-			sendemail(si->su, tmu, EMAIL_MEMO, tmu->email, memo->text);
-		}
-
-		memoserv = service_find("memoserv");
-		if (memoserv == NULL)
-			memoserv = si->service;
-
-		// Is the user online? If so, tell them about the new memo.
-		if (si->su == NULL || !irccasecmp(si->su->nick, entity(si->smu)->name))
-			myuser_notice(memoserv->nick, tmu, "You have a new memo from %s (%zu).", entity(si->smu)->name, MOWGLI_LIST_LENGTH(&tmu->memos));
-		else
-			myuser_notice(memoserv->nick, tmu, "You have a new memo from %s (nick: %s) (%zu).", entity(si->smu)->name, si->su->nick, MOWGLI_LIST_LENGTH(&tmu->memos));
-
-		myuser_notice(si->service->nick, tmu, "To read it, type \2/msg %s READ %zu\2",
-		              memoserv->disp, MOWGLI_LIST_LENGTH(&tmu->memos));
+		command_add_flood(si, FLOOD_HEAVY);
+		logcommand(si, CMDLOG_ADMIN, "SENDALL: \2%s\2 (%u accounts, delivering)", m, tried);
+		return;
 	}
 
 	// Tell user memo sent, return
@@ -168,7 +104,9 @@ static struct command ms_sendall = {
 static void
 mod_init(struct module *const restrict m)
 {
-        MODULE_TRY_REQUEST_SYMBOL(m, maxmemos, "memoserv/main", "maxmemos")
+        use_memoserv_bulk_symbols(m);
+        if (m->mflags & MODFLAG_FAIL)
+                return;
 
         service_named_bind_command("memoserv", &ms_sendall);
 }
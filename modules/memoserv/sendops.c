@@ -8,20 +8,18 @@
  */
 
 #include <atheme.h>
-
-static unsigned int *maxmemos;
+#include "bulk.h"
 
 static void
 ms_cmd_sendops(struct sourceinfo *si, int parc, char *parv[])
 {
 	// misc structs etc
-	struct myuser *tmu;
-	mowgli_node_t *n, *tn;
-	struct mymemo *memo;
+	mowgli_node_t *tn;
+	struct memo_bulk *mb;
 	struct mychan *mc;
 	unsigned int sent = 0, tried = 0;
-	bool ignored, operoverride = false;
-	struct service *memoserv;
+	bool operoverride = false;
+	char text[MEMOLEN + 1];
 
 	// Grab args
 	char *target = parv[0];
@@ -42,9 +40,9 @@ ms_cmd_sendops(struct sourceinfo *si, int parc, char *parv[])
 	}
 
 	// rate limit it -- jilles
-	if (CURRTIME - si->smu->memo_ratelimit_time > MEMO_MAX_TIME)
-		si->smu->memo_ratelimit_num = 0;
-	if (si->smu->memo_ratelimit_num > MEMO_MAX_NUM && !has_priv(si, PRIV_FLOOD))
+	if (CURRTIME - myuser_cold_ro(si->smu)->memo_ratelimit_time > MEMO_MAX_TIME)
+		myuser_cold(si->smu)->memo_ratelimit_num = 0;
+	if (myuser_cold_ro(si->smu)->memo_ratelimit_num > MEMO_MAX_NUM && !has_priv(si, PRIV_FLOOD))
 	{
 		command_fail(si, fault_toomany, _("You have used this command too many times; please wait a while and try again."));
 		return;
@@ -85,80 +83,28 @@ ms_cmd_sendops(struct sourceinfo *si, int parc, char *parv[])
 		}
 	}
 
-	si->smu->memo_ratelimit_num++;
-	si->smu->memo_ratelimit_time = CURRTIME;
+	myuser_cold(si->smu)->memo_ratelimit_num++;
+	myuser_cold(si->smu)->memo_ratelimit_time = CURRTIME;
+
+	snprintf(text, sizeof text, "%s %s", mc->name, m);
+	mb = memo_bulk_create(si, mc->name, text);
 
 	MOWGLI_ITER_FOREACH(tn, mc->chanacs.head)
 	{
 		struct chanacs *ca = (struct chanacs *) tn->data;
-		tmu = isuser(ca->entity) ? user(ca->entity) : NULL; // XXX
-
-		if (!(ca->level & (CA_OP | CA_AUTOOP)) || tmu == NULL || tmu == si->smu)
-			continue;
-
-		tried++;
-
-		// Does the user allow memos? --pfish
-		if (tmu->flags & MU_NOMEMO)
-			continue;
 
-		// Check to make sure target inbox not full
-		if (tmu->memos.count >= *maxmemos)
-			continue;
-
-		// As in SEND to a single user, make ignore fail silently
-		sent++;
-
-		// Make sure we're not on ignore
-		ignored = false;
-		MOWGLI_ITER_FOREACH(n, tmu->memo_ignores.head)
-		{
-			struct mynick *mn;
-			struct myuser *mu;
-
-			if (nicksvs.no_nick_ownership)
-				mu = myuser_find((const char *)n->data);
-			else
-			{
-				mn = mynick_find((const char *)n->data);
-				mu = mn != NULL ? mn->owner : NULL;
-			}
-			if (mu == si->smu)
-				ignored = true;
-		}
-		if (ignored)
-			continue;
-
-		// Malloc and populate struct
-		memo = smalloc(sizeof *memo);
-		memo->sent = CURRTIME;
-		memo->status = MEMO_CHANNEL;
-		mowgli_strlcpy(memo->sender, entity(si->smu)->name, sizeof memo->sender);
-		snprintf(memo->text, sizeof memo->text, "%s %s", mc->name, m);
-
-		// Create a linked list node and add to memos
-		n = mowgli_node_create();
-		mowgli_node_add(memo, n, &tmu->memos);
-		tmu->memoct_new++;
-
-		// Should we email this?
-		if (tmu->flags & MU_EMAILMEMOS)
-		{
-			sendemail(si->su, tmu, EMAIL_MEMO, tmu->email, memo->text);
-		}
-
-		memoserv = service_find("memoserv");
-		if (memoserv == NULL)
-			memoserv = si->service;
+		if (ca->level & (CA_OP | CA_AUTOOP))
+			memo_bulk_add(mb, user(ca->entity));
+	}
 
-		// Is the user online? If so, tell them about the new memo.
-		if (si->su == NULL || !irccasecmp(si->su->nick, entity(si->smu)->name))
-			myuser_notice(memoserv->nick, tmu, "You have a new memo from %s (%zu).", entity(si->smu)->name, MOWGLI_LIST_LENGTH(&tmu->memos));
+	if (!memo_bulk_start(mb, si, &tried, &sent))
+	{
+		command_add_flood(si, FLOOD_HEAVY);
+		if (operoverride)
+			logcommand(si, CMDLOG_ADMIN, "SENDOPS: to \2%s\2 (%u operators, delivering) (oper override)", mc->name, tried);
 		else
-			myuser_notice(memoserv->nick, tmu, "You have a new memo from %s (nick: %s) (%zu).", entity(si->smu)->name, si->su->nick, MOWGLI_LIST_LENGTH(&tmu->memos));
-
-		myuser_notice(si->service->nick, tmu, "To read it, type \2/msg %s READ %zu\2",
-		              memoserv->disp, MOWGLI_LIST_LENGTH(&tmu->memos));
+			logcommand(si, CMDLOG_SET, "SENDOPS: to \2%s\2 (%u operators, delivering)", mc->name, tried);
+		return;
 	}
 
 	// Tell user memo sent, return
@@ -189,7 +135,9 @@ static struct command ms_sendops = {
 static void
 mod_init(struct module *const restrict m)
 {
-        MODULE_TRY_REQUEST_SYMBOL(m, maxmemos, "memoserv/main", "maxmemos")
+        use_memoserv_bulk_symbols(m);
+        if (m->mflags & MODFLAG_FAIL)
+                return;
 
         service_named_bind_command("memoserv", &ms_sendops);
 }
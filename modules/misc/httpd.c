@@ -310,6 +310,15 @@ httpd_recvqhandler(struct connection *cptr)
 			else
 				check_close(cptr);
 		}
+		else if (is_get && ph->get_handler != NULL)
+		{
+			slog(LG_DEBUG, "httpd_recvqhandler(): GET handler for %s", hd->filename);
+
+			ph->get_handler(cptr);
+
+			clear_httpddata(hd);
+			check_close(cptr);
+		}
 		else
 		{
 			if (hd->length <= 0)
@@ -0,0 +1,322 @@
+/*
+ * SPDX-License-Identifier: ISC
+ * SPDX-URL: https://spdx.org/licenses/ISC.html
+ *
+ * Copyright (C) 2026 Atheme Development Group (https://atheme.github.io/)
+ *
+ * Exports the aggregate statistics in the Prometheus text format, at
+ * /metrics on the httpd. Only the addresses in prometheus::allow (or
+ * loopback, if that is not set) are given the metrics.
+ */
+
+#include <atheme.h>
+
+#ifdef HAVE_ARPA_INET_H
+#  include <arpa/inet.h>
+#endif
+
+// Imported from other modules
+static mowgli_list_t *httpd_path_handlers = NULL;
+
+static mowgli_node_t *prometheus_path_node = NULL;
+static mowgli_list_t prometheus_conf_table;
+static mowgli_list_t prometheus_allow;          // addresses and CIDR masks, as strings
+
+static void
+prometheus_allow_clear(void)
+{
+	mowgli_node_t *n, *tn;
+
+	MOWGLI_ITER_FOREACH_SAFE(n, tn, prometheus_allow.head)
+	{
+		(void) sfree(n->data);
+		(void) mowgli_node_delete(n, &prometheus_allow);
+		(void) mowgli_node_free(n);
+	}
+}
+
+static int
+prometheus_conf_allow(mowgli_config_file_entry_t *const restrict ce)
+{
+	const mowgli_config_file_entry_t *cce;
+
+	MOWGLI_ITER_FOREACH(cce, ce->entries)
+		(void) mowgli_node_add(sstrdup(cce->varname), mowgli_node_create(), &prometheus_allow);
+
+	return 0;
+}
+
+static void
+prometheus_config_purge(void ATHEME_VATTR_UNUSED *const restrict unused)
+{
+	(void) prometheus_allow_clear();
+}
+
+// The address of the client on cptr; IPv4-mapped IPv6 addresses are written as IPv4
+static bool
+prometheus_peer_address(const struct connection *const restrict cptr, char addr[const restrict static INET6_ADDRSTRLEN])
+{
+	struct sockaddr_storage ss;
+	socklen_t len = sizeof ss;
+	const void *src;
+	int family;
+
+	if (getpeername(cptr->fd, (struct sockaddr *) &ss, &len) == -1)
+		return false;
+
+	switch (ss.ss_family)
+	{
+		case AF_INET:
+			family = AF_INET;
+			src = &((const struct sockaddr_in *) &ss)->sin_addr;
+			break;
+
+		case AF_INET6:
+		{
+			const struct in6_addr *const a6 = &((const struct sockaddr_in6 *) &ss)->sin6_addr;
+
+			if (IN6_IS_ADDR_V4MAPPED(a6))
+			{
+				family = AF_INET;
+				src = &a6->s6_addr[12];
+			}
+			else
+			{
+				family = AF_INET6;
+				src = a6;
+			}
+			break;
+		}
+
+		default:
+			return false;
+	}
+
+	return inet_ntop(family, src, addr, INET6_ADDRSTRLEN) != NULL;
+}
+
+static bool
+prometheus_allowed(const struct connection *const restrict cptr)
+{
+	char addr[INET6_ADDRSTRLEN];
+	const mowgli_node_t *n;
+
+	if (! prometheus_peer_address(cptr, addr))
+		return false;
+
+	if (! MOWGLI_LIST_LENGTH(&prometheus_allow))
+		return (strcmp(addr, "::1") == 0 || match_ips("127.0.0.0/8", addr) == 0);
+
+	MOWGLI_ITER_FOREACH(n, prometheus_allow.head)
+		if (strcmp(n->data, addr) == 0 || match_ips(n->data, addr) == 0)
+			return true;
+
+	return false;
+}
+
+static void
+prometheus_header(mowgli_string_t *const restrict out, const char *const restrict name,
+                  const char *const restrict type, const char *const restrict help)
+{
+	(void) mowgli_string_append(out, "# HELP ", 7);
+	(void) mowgli_string_append(out, name, strlen(name));
+	(void) mowgli_string_append_char(out, ' ');
+	(void) mowgli_string_append(out, help, strlen(help));
+	(void) mowgli_string_append(out, "\n# TYPE ", 8);
+	(void) mowgli_string_append(out, name, strlen(name));
+	(void) mowgli_string_append_char(out, ' ');
+	(void) mowgli_string_append(out, type, strlen(type));
+	(void) mowgli_string_append_char(out, '\n');
+}
+
+/* Writes one sample. A NULL label writes a sample without labels; label
+ * values are escaped as the text format requires.
+ */
+static void
+prometheus_sample(mowgli_string_t *const restrict out, const char *const restrict name,
+                  const char *const restrict label, const char *const restrict value, const uint64_t sample)
+{
+	char buf[BUFSIZE];
+
+	(void) mowgli_string_append(out, name, strlen(name));
+
+	if (label != NULL)
+	{
+		(void) mowgli_string_append_char(out, '{');
+		(void) mowgli_string_append(out, label, strlen(label));
+		(void) mowgli_string_append(out, "=\"", 2);
+
+		for (const char *p = value; *p; p++)
+		{
+			if (*p == '\\' || *p == '"')
+				(void) mowgli_string_append_char(out, '\\');
+
+			if (*p == '\n')
+				(void) mowgli_string_append(out, "\\n", 2);
+			else
+				(void) mowgli_string_append_char(out, *p);
+		}
+
+		(void) mowgli_string_append(out, "\"}", 2);
+	}
+
+	(void) snprintf(buf, sizeof buf, " %" PRIu64 "\n", sample);
+	(void) mowgli_string_append(out, buf, strlen(buf));
+}
+
+static void
+prometheus_render(mowgli_string_t *const restrict out)
+{
+	prometheus_header(out, "atheme_uptime_seconds", "gauge", "Time since services started.");
+	prometheus_sample(out, "atheme_uptime_seconds", NULL, NULL, (uint64_t) (CURRTIME - me.start));
+
+	prometheus_header(out, "atheme_accounts", "gauge", "Registered accounts.");
+	prometheus_sample(out, "atheme_accounts", NULL, NULL, cnt.myuser);
+
+	prometheus_header(out, "atheme_nicknames", "gauge", "Registered nicknames.");
+	prometheus_sample(out, "atheme_nicknames", NULL, NULL, cnt.mynick);
+
+	prometheus_header(out, "atheme_registered_channels", "gauge", "Registered channels.");
+	prometheus_sample(out, "atheme_registered_channels", NULL, NULL, cnt.mychan);
+
+	prometheus_header(out, "atheme_account_password_hashes", "gauge", "Accounts by password hash type.");
+
+	for (enum pwhash_type i = PWHASH_NONE; i < PWHASH_TYPE_COUNT; i++)
+		prometheus_sample(out, "atheme_account_password_hashes", "type", pwhash_type_label(i),
+		                  stats_counters.pwhash[i]);
+
+	prometheus_header(out, "atheme_channels", "gauge", "Channels on the network by number of members.");
+
+	for (unsigned int i = 0; i < STATS_CHANNEL_BUCKETS; i++)
+		prometheus_sample(out, "atheme_channels", "members", stats_chansize_label(i), stats_counters.chansize[i]);
+
+	prometheus_header(out, "atheme_logins_total", "counter", "Successful logins by method.");
+
+	struct hashmap_iter iter;
+	const struct stats_login *sl;
+
+	HASHMAP_FOREACH(sl, &iter, stats_counters.logins)
+		prometheus_sample(out, "atheme_logins_total", "method", sl->method, sl->count);
+
+	prometheus_header(out, "atheme_server_users", "gauge", "Users on each server.");
+
+	struct server *s;
+	mowgli_patricia_iteration_state_t state;
+	uint64_t identified = 0;
+	uint64_t unidentified = 0;
+
+	MOWGLI_PATRICIA_FOREACH(s, &state, servlist)
+	{
+		mowgli_node_t *n;
+
+		prometheus_sample(out, "atheme_server_users", "server", s->name, s->users);
+
+		if (s == me.me)
+			continue;
+
+		/* Logins are recorded in too many places to keep this count as
+		 * they happen; a scrape is rare enough to count them here.
+		 */
+		MOWGLI_ITER_FOREACH(n, s->userlist.head)
+		{
+			const struct user *const u = n->data;
+
+			if (u->myuser != NULL)
+				identified++;
+			else
+				unidentified++;
+		}
+	}
+
+	prometheus_header(out, "atheme_users", "gauge", "Users on the network, by whether they are logged in.");
+	prometheus_sample(out, "atheme_users", "state", "identified", identified);
+	prometheus_sample(out, "atheme_users", "state", "unidentified", unidentified);
+}
+
+static void
+prometheus_get(struct connection *const restrict cptr)
+{
+	char buf[BUFSIZE];
+
+	if (! prometheus_allowed(cptr))
+	{
+		(void) snprintf(buf, sizeof buf,
+		                "HTTP/1.1 403 Forbidden\r\n"
+		                "Server: %s/%s\r\n"
+		                "Content-Length: 0\r\n"
+		                "\r\n",
+		                PACKAGE_TARNAME, PACKAGE_VERSION);
+
+		(void) sendq_add(cptr, buf, strlen(buf));
+		return;
+	}
+
+	mowgli_string_t *const out = mowgli_string_create();
+
+	(void) prometheus_render(out);
+
+	(void) snprintf(buf, sizeof buf,
+	                "HTTP/1.1 200 OK\r\n"
+	                "Server: %s/%s\r\n"
+	                "Content-Type: text/plain; version=0.0.4\r\n"
+	                "Content-Length: %zu\r\n"
+	                "\r\n",
+	                PACKAGE_TARNAME, PACKAGE_VERSION, out->pos);
+
+	(void) sendq_add(cptr, buf, strlen(buf));
+	(void) sendq_add(cptr, out->str, out->pos);
+
+	(void) mowgli_string_destroy(out);
+}
+
+static void
+prometheus_post(struct connection *const restrict cptr, void ATHEME_VATTR_UNUSED *const restrict requestbuf)
+{
+	char buf[BUFSIZE];
+
+	(void) snprintf(buf, sizeof buf,
+	                "HTTP/1.1 405 Method Not Allowed\r\n"
+	                "Server: %s/%s\r\n"
+	                "Allow: GET\r\n"
+	                "Content-Length: 0\r\n"
+	                "\r\n",
+	                PACKAGE_TARNAME, PACKAGE_VERSION);
+
+	(void) sendq_add(cptr, buf, strlen(buf));
+}
+
+static void
+mod_init(struct module *const restrict m)
+{
+	static struct path_handler path_handler = {
+		.path           = "/metrics",
+		.handler        = &prometheus_post,
+		.get_handler    = &prometheus_get,
+	};
+
+	MODULE_TRY_REQUEST_SYMBOL(m, httpd_path_handlers, "misc/httpd", "httpd_path_handlers")
+
+	prometheus_path_node = mowgli_node_create();
+	(void) mowgli_node_add(&path_handler, prometheus_path_node, httpd_path_handlers);
+
+	(void) hook_add_config_purge(&prometheus_config_purge);
+
+	(void) add_subblock_top_conf("PROMETHEUS", &prometheus_conf_table);
+	(void) add_conf_item("ALLOW", &prometheus_conf_table, &prometheus_conf_allow);
+}
+
+static void
+mod_deinit(const enum module_unload_intent ATHEME_VATTR_UNUSED intent)
+{
+	(void) mowgli_node_delete(prometheus_path_node, httpd_path_handlers);
+	(void) mowgli_node_free(prometheus_path_node);
+
+	(void) hook_del_config_purge(&prometheus_config_purge);
+
+	(void) del_conf_item("ALLOW", &prometheus_conf_table);
+	(void) del_top_conf("PROMETHEUS");
+
+	(void) prometheus_allow_clear();
+}
+
+SIMPLE_DECLARE_MODULE_V1("misc/prometheus", MODULE_UNLOAD_CAPABILITY_OK)
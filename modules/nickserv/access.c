@@ -222,7 +222,7 @@ ns_cmd_access(struct sourceinfo *si, int parc, char *parv[])
 
 		command_success_nodata(si, _("Access list for \2%s\2:"), entity(mu)->name);
 
-		MOWGLI_ITER_FOREACH(n, mu->access_list.head)
+		MOWGLI_ITER_FOREACH(n, myuser_cold_ro(mu)->access_list.head)
 		{
 			mask = n->data;
 			command_success_nodata(si, "- %s", mask);
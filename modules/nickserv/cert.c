@@ -57,7 +57,7 @@ ns_cmd_cert(struct sourceinfo *si, int parc, char *parv[])
 
 		command_success_nodata(si, _("Clearing all fingerprints for \2%s\2:"), entity(mu)->name);
 
-		MOWGLI_ITER_FOREACH_SAFE(n, tn, mu->cert_fingerprints.head)
+		MOWGLI_ITER_FOREACH_SAFE(n, tn, myuser_cold_ro(mu)->cert_fingerprints.head)
 		{
 			mycertfp_delete((struct mycertfp *) n->data);
 		}
@@ -99,7 +99,7 @@ ns_cmd_cert(struct sourceinfo *si, int parc, char *parv[])
 
 		command_success_nodata(si, _("Fingerprint list for \2%s\2:"), entity(mu)->name);
 
-		MOWGLI_ITER_FOREACH(n, mu->cert_fingerprints.head)
+		MOWGLI_ITER_FOREACH(n, myuser_cold_ro(mu)->cert_fingerprints.head)
 		{
 			mcfp = ((struct mycertfp *) n->data)->certfp;
 			command_success_nodata(si, "- %s", mcfp);
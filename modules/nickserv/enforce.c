@@ -490,6 +490,7 @@ ns_cmd_regain(struct sourceinfo *si, int parc, char *parv[])
 			}
 
 			myuser_login(si->service, si->su, mn->owner, true);
+			stats_login_count("REGAIN");
 		}
 
 		struct chanuser *cu = NULL;
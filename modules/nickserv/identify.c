@@ -158,6 +158,7 @@ ns_cmd_login(struct sourceinfo *si, int parc, char *parv[])
 
 		command_success_nodata(si, nicksvs.no_nick_ownership ? _("You are now logged in as \2%s\2.") : _("You are now identified for \2%s\2."), entity(mu)->name);
 		myuser_login(si->service, u, mu, true);
+		stats_login_count(COMMAND_UC);
 		logcommand(si, CMDLOG_LOGIN, COMMAND_UC);
 
 		return;
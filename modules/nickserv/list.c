@@ -16,8 +16,60 @@
 extern void list_register(const char *, struct list_param *);
 extern void list_unregister(const char *);
 
+#define LIST_MAXPARC    10
+
 static mowgli_patricia_t *list_params;
 
+/* The indexes over registration time, last login time, email domain and
+ * unverified accounts are built the first time a LIST could use them, and
+ * kept up to date from hooks after that. The last login times are set in
+ * many places without a hook; a stale entry is filed under an earlier day
+ * than its account's real last login, which only makes a scan visit an
+ * account that does not match, so the entry is refiled when that happens.
+ */
+struct list_account
+{
+	struct myuser *         mu;
+	mowgli_node_t           registered_node;
+	mowgli_node_t           lastlogin_node;
+	mowgli_node_t           domain_node;
+	struct list_domain *    domain;
+	unsigned int            registered_day;
+	unsigned int            lastlogin_day;
+};
+
+struct list_domain
+{
+	char *                  name;
+	mowgli_list_t           accounts;
+};
+
+static bool list_indexed = false;
+static struct hashmap *list_accounts = NULL;            // by entity ID
+static struct hashmap *list_domains = NULL;
+static mowgli_patricia_t *list_waitauth = NULL;         // by entity ID
+static struct hashmap *list_pending = NULL;             // by entity ID; created since, not filed yet
+static struct time_index list_registered;
+static struct time_index list_lastlogin;
+
+struct list_criterion
+{
+	const struct list_param *       param;
+	const void *                    arg;
+	bool                            boolarg;
+	int                             intarg;
+	time_t                          agearg;
+};
+
+struct list_plan
+{
+	struct list_criterion           criteria[LIST_MAXPARC];
+	size_t                          ncriteria;
+	struct sourceinfo *             si;
+	struct command_stream *         out;
+	unsigned int                    matches;
+};
+
 static bool
 email_match(const struct mynick *mn, const void *arg)
 {
@@ -113,6 +165,329 @@ has_waitauth(const struct mynick *mn, const void *arg)
 	return ( mu->flags & MU_WAITAUTH ) == MU_WAITAUTH;
 }
 
+static const char *
+list_email_domain(const char *email)
+{
+	const char *p = strrchr(email, '@');
+
+	return (p != NULL) ? p + 1 : "";
+}
+
+static void
+list_account_add(struct myuser *mu)
+{
+	struct list_account *la = smalloc(sizeof *la);
+	const char *domain = list_email_domain(mu->email);
+
+	if (! hashmap_add(list_accounts, entity(mu)->id, la))
+	{
+		sfree(la);
+		return;
+	}
+
+	la->mu = mu;
+	la->registered_day = time_index_day(mu->registered);
+	la->lastlogin_day = time_index_day(mu->lastlogin);
+
+	time_index_add(&list_registered, la, &la->registered_node, la->registered_day);
+	time_index_add(&list_lastlogin, la, &la->lastlogin_node, la->lastlogin_day);
+
+	if ((la->domain = hashmap_retrieve(list_domains, domain)) == NULL)
+	{
+		la->domain = smalloc(sizeof *la->domain);
+		la->domain->name = sstrdup(domain);
+		(void) hashmap_add(list_domains, domain, la->domain);
+	}
+
+	mowgli_node_add(la, &la->domain_node, &la->domain->accounts);
+
+	if (mu->flags & MU_WAITAUTH)
+		mowgli_patricia_add(list_waitauth, entity(mu)->id, mu);
+}
+
+static void
+list_account_unfile_domain(struct list_account *la)
+{
+	mowgli_node_delete(&la->domain_node, &la->domain->accounts);
+
+	if (MOWGLI_LIST_LENGTH(&la->domain->accounts) != 0)
+		return;
+
+	(void) hashmap_delete(list_domains, la->domain->name);
+	sfree(la->domain->name);
+	sfree(la->domain);
+}
+
+static void
+list_account_delete(struct list_account *la)
+{
+	time_index_delete(&list_registered, &la->registered_node, la->registered_day);
+	time_index_delete(&list_lastlogin, &la->lastlogin_node, la->lastlogin_day);
+	list_account_unfile_domain(la);
+
+	(void) mowgli_patricia_delete(list_waitauth, entity(la->mu)->id);
+	(void) hashmap_delete(list_accounts, entity(la->mu)->id);
+
+	sfree(la);
+}
+
+static void
+list_index_destroy(void)
+{
+	struct hashmap_iter iter;
+	struct list_account *la;
+	struct list_domain *ld;
+
+	if (! list_indexed)
+		return;
+
+	HASHMAP_FOREACH(la, &iter, list_accounts)
+		sfree(la);
+
+	HASHMAP_FOREACH(ld, &iter, list_domains)
+	{
+		sfree(ld->name);
+		sfree(ld);
+	}
+
+	hashmap_destroy(list_accounts);
+	hashmap_destroy(list_domains);
+	hashmap_destroy(list_pending);
+	mowgli_patricia_destroy(list_waitauth, NULL, NULL);
+
+	time_index_clear(&list_registered);
+	time_index_clear(&list_lastlogin);
+
+	list_indexed = false;
+}
+
+/* Builds the indexes if they are not there yet. Accounts created since then
+ * (by whatever means; the myuser_add hook is called for all of them) are
+ * filed here rather than as they are created, when their creator may not
+ * have filled them in yet.
+ */
+static void
+list_index_ensure(void)
+{
+	struct myentity_iteration_state state;
+	struct myentity *mt;
+	struct hashmap_iter iter;
+	struct myuser *mu;
+
+	if (list_indexed)
+	{
+		if (hashmap_size(list_pending) == 0)
+			return;
+
+		HASHMAP_FOREACH(mu, &iter, list_pending)
+			list_account_add(mu);
+
+		hashmap_destroy(list_pending);
+		list_pending = hashmap_create(false);
+		return;
+	}
+
+	list_accounts = hashmap_create(false);
+	list_domains = hashmap_create(true);
+	list_pending = hashmap_create(false);
+	list_waitauth = mowgli_patricia_create(noopcanon);
+	list_indexed = true;
+
+	MYENTITY_FOREACH_T(mt, &state, ENT_USER)
+		list_account_add(user(mt));
+
+	slog(LG_DEBUG, "list_index_ensure(): indexed %zu accounts", hashmap_size(list_accounts));
+}
+
+static void
+list_myuser_add(struct myuser *mu)
+{
+	if (list_indexed)
+		(void) hashmap_add(list_pending, entity(mu)->id, mu);
+}
+
+static void
+list_myuser_delete(struct myuser *mu)
+{
+	struct list_account *la;
+
+	if (! list_indexed || hashmap_delete(list_pending, entity(mu)->id) != NULL)
+		return;
+
+	if ((la = hashmap_retrieve(list_accounts, entity(mu)->id)) != NULL)
+		list_account_delete(la);
+}
+
+static void
+list_lastlogin_refile(struct list_account *la)
+{
+	const unsigned int day = time_index_day(la->mu->lastlogin);
+
+	if (day == la->lastlogin_day)
+		return;
+
+	time_index_delete(&list_lastlogin, &la->lastlogin_node, la->lastlogin_day);
+	time_index_add(&list_lastlogin, la, &la->lastlogin_node, day);
+	la->lastlogin_day = day;
+}
+
+static void
+list_user_identify(struct user *u)
+{
+	struct list_account *la;
+
+	if (list_indexed && u->myuser != NULL && (la = hashmap_retrieve(list_accounts, entity(u->myuser)->id)) != NULL)
+		list_lastlogin_refile(la);
+}
+
+static void
+list_myuser_changed_email(struct myuser *mu)
+{
+	struct list_account *la;
+	const char *domain = list_email_domain(mu->email);
+
+	if (! list_indexed || (la = hashmap_retrieve(list_accounts, entity(mu)->id)) == NULL)
+		return;
+
+	list_account_unfile_domain(la);
+
+	if ((la->domain = hashmap_retrieve(list_domains, domain)) == NULL)
+	{
+		la->domain = smalloc(sizeof *la->domain);
+		la->domain->name = sstrdup(domain);
+		(void) hashmap_add(list_domains, domain, la->domain);
+	}
+
+	mowgli_node_add(la, &la->domain_node, &la->domain->accounts);
+}
+
+static void
+list_user_verify_register(struct hook_user_req *req)
+{
+	if (list_indexed && req->mu != NULL)
+		(void) mowgli_patricia_delete(list_waitauth, entity(req->mu)->id);
+}
+
+static size_t
+registered_index_estimate(const void *arg)
+{
+	list_index_ensure();
+
+	return time_index_count(&list_registered, time_index_day(CURRTIME - *((const time_t *) arg)));
+}
+
+static void
+registered_index_scan(const void *arg, list_index_cb cb, void *privdata)
+{
+	const unsigned int last_day = time_index_day(CURRTIME - *((const time_t *) arg));
+
+	for (unsigned int i = 0; i < list_registered.ndays && list_registered.first_day + i <= last_day; i++)
+	{
+		mowgli_node_t *n;
+
+		MOWGLI_ITER_FOREACH(n, list_registered.days[i].head)
+		{
+			const struct list_account *la = n->data;
+
+			cb(la->mu, privdata);
+		}
+	}
+}
+
+static size_t
+lastlogin_index_estimate(const void *arg)
+{
+	list_index_ensure();
+
+	return time_index_count(&list_lastlogin, time_index_day(CURRTIME - *((const time_t *) arg)));
+}
+
+static void
+lastlogin_index_scan(const void *arg, list_index_cb cb, void *privdata)
+{
+	const unsigned int last_day = time_index_day(CURRTIME - *((const time_t *) arg));
+
+	for (unsigned int i = 0; i < list_lastlogin.ndays && list_lastlogin.first_day + i <= last_day; i++)
+	{
+		mowgli_node_t *n, *tn;
+
+		MOWGLI_ITER_FOREACH_SAFE(n, tn, list_lastlogin.days[i].head)
+		{
+			struct list_account *la = n->data;
+			const unsigned int day = time_index_day(la->mu->lastlogin);
+
+			cb(la->mu, privdata);
+
+			// refile a stale entry, if that does not make us visit it again
+			if (day > last_day)
+				list_lastlogin_refile(la);
+		}
+	}
+}
+
+// The domain of an email mask, if it is a literal one
+static const char *
+email_index_domain(const char *mask)
+{
+	const char *domain = strrchr(mask, '@');
+
+	if (domain == NULL || strpbrk(++domain, "*?&#%\\") != NULL)
+		return NULL;
+
+	return domain;
+}
+
+static size_t
+email_index_estimate(const void *arg)
+{
+	const char *domain = email_index_domain(arg);
+	const struct list_domain *ld;
+
+	if (domain == NULL)
+		return SIZE_MAX;
+
+	list_index_ensure();
+
+	ld = hashmap_retrieve(list_domains, domain);
+
+	return (ld != NULL) ? MOWGLI_LIST_LENGTH(&ld->accounts) : 0;
+}
+
+static void
+email_index_scan(const void *arg, list_index_cb cb, void *privdata)
+{
+	const struct list_domain *ld = hashmap_retrieve(list_domains, email_index_domain(arg));
+	mowgli_node_t *n;
+
+	if (ld == NULL)
+		return;
+
+	MOWGLI_ITER_FOREACH(n, ld->accounts.head)
+	{
+		const struct list_account *la = n->data;
+
+		cb(la->mu, privdata);
+	}
+}
+
+static size_t
+waitauth_index_estimate(const void *arg)
+{
+	list_index_ensure();
+
+	return mowgli_patricia_size(list_waitauth);
+}
+
+static void
+waitauth_index_scan(const void *arg, list_index_cb cb, void *privdata)
+{
+	mowgli_patricia_iteration_state_t state;
+	struct myuser *mu;
+
+	MOWGLI_PATRICIA_FOREACH(mu, &state, list_waitauth)
+		cb(mu, privdata);
+}
+
 void
 list_register(const char *param_name, struct list_param *param)
 {
@@ -164,7 +539,7 @@ build_criteriastr(char *buf, int parc, char *parv[])
 }
 
 static void
-list_one(struct sourceinfo *si, struct myuser *mu, struct mynick *mn)
+list_one(struct command_stream *out, struct myuser *mu, struct mynick *mn)
 {
 	char buf[BUFSIZE];
 
@@ -198,115 +573,157 @@ list_one(struct sourceinfo *si, struct myuser *mu, struct mynick *mn)
 	}
 
 	if (mn == NULL || !irccasecmp(mn->nick, entity(mu)->name))
-		command_success_nodata(si, "- %s (%s) %s", entity(mu)->name, mu->email, buf);
+		command_stream_printf(out, "- %s (%s) %s", entity(mu)->name, mu->email, buf);
 	else
-		command_success_nodata(si, "- %s (%s) (%s) %s", mn->nick, mu->email, entity(mu)->name, buf);
+		command_stream_printf(out, "- %s (%s) (%s) %s", mn->nick, mu->email, entity(mu)->name, buf);
+}
+
+/* list_plan_compile()
+ *
+ * Looks up every criterion and parses its argument once, instead of once
+ * for every nick.
+ */
+static bool
+list_plan_compile(struct list_plan *plan, struct sourceinfo *si, int parc, char *parv[])
+{
+	for (int i = 0; i < parc; i++)
+	{
+		struct list_criterion *crit = &plan->criteria[plan->ncriteria];
+
+		if ((crit->param = mowgli_patricia_retrieve(list_params, parv[i])) == NULL)
+		{
+			command_fail(si, fault_badparams, _("\2%s\2 is not a recognized LIST criterion"), parv[i]);
+			return false;
+		}
+
+		if (crit->param->opttype != OPT_BOOL && i + 1 >= parc)
+		{
+			command_fail(si, fault_needmoreparams, STR_INSUFFICIENT_PARAMS, parv[i]);
+			return false;
+		}
+
+		switch (crit->param->opttype)
+		{
+			case OPT_BOOL:
+				crit->boolarg = true;
+				crit->arg = &crit->boolarg;
+				break;
+			case OPT_INT:
+				crit->intarg = atoi(parv[++i]);
+				crit->arg = &crit->intarg;
+				break;
+			case OPT_STRING:
+				crit->arg = parv[++i];
+				break;
+			case OPT_AGE:
+				crit->agearg = parse_age(parv[++i]);
+				crit->arg = &crit->agearg;
+				break;
+			default:
+				// never handled by LIST; as before, such a criterion matches everything
+				continue;
+		}
+
+		plan->ncriteria++;
+	}
+
+	return true;
 }
 
 static void
-ns_cmd_list(struct sourceinfo *si, int parc, char *parv[])
+list_plan_check_nick(struct list_plan *plan, struct mynick *mn)
 {
-	char criteriastr[BUFSIZE];
+	for (size_t i = 0; i < plan->ncriteria; i++)
+		if (! plan->criteria[i].param->is_match(mn, plan->criteria[i].arg))
+			return;
 
-	mowgli_patricia_iteration_state_t state;
-	struct myentity_iteration_state mestate;
-	struct mynick *mn;
+	list_one(plan->out, NULL, mn);
+	plan->matches++;
+}
 
-	unsigned int matches = 0;
+static void
+list_plan_check_account(struct myuser *mu, void *privdata)
+{
+	mowgli_node_t *n;
 
-	int i;
-	bool error = false;
-	bool found;
+	MOWGLI_ITER_FOREACH(n, mu->nicks.head)
+		list_plan_check_nick(privdata, n->data);
+}
 
-	MOWGLI_PATRICIA_FOREACH(mn, &state, nicklist)
+/* list_plan_run()
+ *
+ * Scans the index of the criterion that narrows the search down the most,
+ * or every registered nick if none of them has an index or the index would
+ * not save anything.
+ */
+static void
+list_plan_run(struct list_plan *plan)
+{
+	const struct list_criterion *driver = NULL;
+	size_t best = mowgli_patricia_size(nicklist);
+
+	for (size_t i = 0; i < plan->ncriteria; i++)
 	{
-		found = true;
+		const struct list_criterion *crit = &plan->criteria[i];
+		size_t estimate;
 
-		for (i = 0; i < parc; i++)
-		{
-			struct list_param *param = mowgli_patricia_retrieve(list_params, parv[i]);
+		if (crit->param->index_estimate == NULL || crit->param->index_scan == NULL)
+			continue;
 
-			if (param == NULL) {
-				command_fail(si, fault_badparams, _("\2%s\2 is not a recognized LIST criterion"), parv[i]);
-				error = true;
-				break;
-			}
-
-			if (param->opttype == OPT_BOOL) {
-				bool arg = true;
-
-				if (!param->is_match(mn, &arg)) {
-					found = false;
-					break;
-				}
-			} else if (param->opttype == OPT_INT) {
-				if (i + 1 < parc) {
-					int arg = atoi(parv[++i]);
-
-					if (!param->is_match (mn, &arg)) {
-						found = false;
-						break;
-					}
-				} else {
-					command_fail(si, fault_needmoreparams, STR_INSUFFICIENT_PARAMS, parv[i]);
-					error = true;
-					break;
-				}
-			} else if (param->opttype == OPT_STRING) {
-				if (i + 1 < parc) {
-					if (!param->is_match (mn, parv[++i])) {
-						found = false;
-						break;
-					}
-				} else {
-					command_fail(si, fault_needmoreparams, STR_INSUFFICIENT_PARAMS, parv[i]);
-					error = true;
-					break;
-				}
-			}
-			else if (param->opttype == OPT_AGE) {
-				if (i + 1 < parc)
-				{
-					time_t age = parse_age(parv[++i]);
-
-					if (!param->is_match (mn, &age)) {
-						found = false;
-						break;
-					}
-				} else {
-					command_fail(si, fault_needmoreparams, STR_INSUFFICIENT_PARAMS, parv[i]);
-					error = true;
-					break;
-				}
-			}
-		} //for (i = 0; i < parc; i++)
-
-		if (error) {
-			break;
+		if ((estimate = crit->param->index_estimate(crit->arg)) < best)
+		{
+			driver = crit;
+			best = estimate;
 		}
+	}
 
-		if (found) {
-			list_one(si, NULL, mn);
-			matches++;
-		}
-	} //MOWGLI_PATRICIA_FOREACH(mn, &state, nicklist)
+	if (driver != NULL)
+	{
+		driver->param->index_scan(driver->arg, list_plan_check_account, plan);
+		return;
+	}
+
+	mowgli_patricia_iteration_state_t state;
+	struct mynick *mn;
+
+	MOWGLI_PATRICIA_FOREACH(mn, &state, nicklist)
+		list_plan_check_nick(plan, mn);
+}
+
+static void
+ns_cmd_list(struct sourceinfo *si, int parc, char *parv[])
+{
+	char criteriastr[BUFSIZE];
+	struct list_plan plan;
+
+	memset(&plan, 0, sizeof plan);
+
+	if (! list_plan_compile(&plan, si, parc, parv))
+		return;
+
+	plan.si = si;
+	plan.out = command_stream_begin(si);
+
+	list_plan_run(&plan);
 
 	build_criteriastr(criteriastr, parc, parv);
 
-	logcommand(si, CMDLOG_ADMIN, "LIST: \2%s\2 (\2%u\2 matches)", criteriastr, matches);
-	if (matches == 0)
-		command_success_nodata(si, _("No nicknames matched criteria \2%s\2"), criteriastr);
+	logcommand(si, CMDLOG_ADMIN, "LIST: \2%s\2 (\2%u\2 matches)", criteriastr, plan.matches);
+	if (plan.matches == 0)
+		command_stream_printf(plan.out, _("No nicknames matched criteria \2%s\2"), criteriastr);
 	else
-		command_success_nodata(si, ngettext(N_("\2%u\2 match for criteria \2%s\2."),
-		                                    N_("\2%u\2 matches for criteria \2%s\2."), matches),
-		                                    matches, criteriastr);
+		command_stream_printf(plan.out, ngettext(N_("\2%u\2 match for criteria \2%s\2."),
+		                                         N_("\2%u\2 matches for criteria \2%s\2."), plan.matches),
+		                                         plan.matches, criteriastr);
+
+	command_stream_end(plan.out);
 }
 
 static struct command ns_list = {
 	.name           = "LIST",
 	.desc           = N_("Lists nicknames registered matching a given pattern."),
 	.access         = PRIV_USER_AUSPEX,
-	.maxparc        = 10,
+	.maxparc        = LIST_MAXPARC,
 	.cmd            = &ns_cmd_list,
 	.help           = { .path = "nickserv/list" },
 };
@@ -319,14 +736,24 @@ mod_init(struct module *const restrict m)
 	list_params = mowgli_patricia_create(strcasecanon);
 	service_named_bind_command("nickserv", &ns_list);
 
+	hook_add_myuser_add(list_myuser_add);
+	hook_add_myuser_delete(list_myuser_delete);
+	hook_add_user_identify(list_user_identify);
+	hook_add_myuser_changed_email(list_myuser_changed_email);
+	hook_add_user_verify_register(list_user_verify_register);
+
 	// list email
 	static struct list_param email;
 	email.opttype = OPT_STRING;
 	email.is_match = email_match;
+	email.index_estimate = email_index_estimate;
+	email.index_scan = email_index_scan;
 
 	static struct list_param lastlogin;
 	lastlogin.opttype = OPT_AGE;
 	lastlogin.is_match = lastlogin_match;
+	lastlogin.index_estimate = lastlogin_index_estimate;
+	lastlogin.index_scan = lastlogin_index_scan;
 
 	static struct list_param pattern;
 	pattern.opttype = OPT_STRING;
@@ -335,6 +762,8 @@ mod_init(struct module *const restrict m)
 	static struct list_param registered;
 	registered.opttype = OPT_AGE;
 	registered.is_match = registered_match;
+	registered.index_estimate = registered_index_estimate;
+	registered.index_scan = registered_index_scan;
 
 	static struct list_param primary;
 	primary.opttype = OPT_BOOL;
@@ -351,6 +780,8 @@ mod_init(struct module *const restrict m)
 	static struct list_param waitauth;
 	waitauth.opttype = OPT_BOOL;
 	waitauth.is_match = has_waitauth;
+	waitauth.index_estimate = waitauth_index_estimate;
+	waitauth.index_scan = waitauth_index_scan;
 
 	list_register("waitauth", &waitauth);
 }
@@ -360,12 +791,21 @@ mod_deinit(const enum module_unload_intent ATHEME_VATTR_UNUSED intent)
 {
 	service_named_unbind_command("nickserv", &ns_list);
 
+	hook_del_myuser_add(list_myuser_add);
+	hook_del_myuser_delete(list_myuser_delete);
+	hook_del_user_identify(list_user_identify);
+	hook_del_myuser_changed_email(list_myuser_changed_email);
+	hook_del_user_verify_register(list_user_verify_register);
+
+	list_index_destroy();
+
 	list_unregister("email");
 	list_unregister("lastlogin");
 	list_unregister("mail");
 
 	list_unregister("pattern");
 	list_unregister("registered");
+	list_unregister("primary");
 
 	list_unregister("waitauth");
 }
@@ -21,10 +21,22 @@ enum list_opttype
 	OPT_AGE,
 };
 
+typedef void (*list_index_cb)(struct myuser *mu, void *privdata);
+
 struct list_param
 {
 	enum list_opttype opttype;
 	bool (*is_match)(const struct mynick *mn, const void *arg);
+
+	/* Optional. index_estimate() returns how many accounts index_scan()
+	 * would visit for this argument, or SIZE_MAX if it cannot narrow the
+	 * search down; index_scan() calls the callback once for every account
+	 * that may match (the callback still checks is_match on their nicks).
+	 * LIST scans the index of the criterion with the lowest estimate
+	 * instead of every registered nick.
+	 */
+	size_t (*index_estimate)(const void *arg);
+	void (*index_scan)(const void *arg, list_index_cb cb, void *privdata);
 };
 
 #endif /* !ATHEME_MOD_NICKSERV_LIST_COMMON_H */
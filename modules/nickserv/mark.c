@@ -14,6 +14,9 @@
 //NickServ mark module
 //Do NOT use this in combination with contrib/multimark!
 
+// Marked accounts by entity ID, built the first time LIST could use it
+static mowgli_patricia_t *marked_accounts = NULL;
+
 static bool
 mark_match(const struct mynick *mn, const void *arg)
 {
@@ -37,6 +40,47 @@ is_marked(const struct mynick *mn, const void *arg)
 	return !!metadata_find(mu, "private:mark:setter");
 }
 
+static void
+marked_index_ensure(void)
+{
+	struct myentity_iteration_state state;
+	struct myentity *mt;
+
+	if (marked_accounts != NULL)
+		return;
+
+	marked_accounts = mowgli_patricia_create(noopcanon);
+
+	MYENTITY_FOREACH_T(mt, &state, ENT_USER)
+		if (metadata_find(user(mt), "private:mark:setter"))
+			mowgli_patricia_add(marked_accounts, mt->id, user(mt));
+}
+
+static size_t
+marked_index_estimate(const void *arg)
+{
+	marked_index_ensure();
+
+	return mowgli_patricia_size(marked_accounts);
+}
+
+static void
+marked_index_scan(const void *arg, list_index_cb cb, void *privdata)
+{
+	mowgli_patricia_iteration_state_t state;
+	struct myuser *mu;
+
+	MOWGLI_PATRICIA_FOREACH(mu, &state, marked_accounts)
+		cb(mu, privdata);
+}
+
+static void
+marked_myuser_delete(struct myuser *mu)
+{
+	if (marked_accounts != NULL)
+		(void) mowgli_patricia_delete(marked_accounts, entity(mu)->id);
+}
+
 static void
 ns_cmd_mark(struct sourceinfo *si, int parc, char *parv[])
 {
@@ -87,6 +131,9 @@ ns_cmd_mark(struct sourceinfo *si, int parc, char *parv[])
 		metadata_add(mu, "private:mark:reason", info);
 		metadata_add(mu, "private:mark:timestamp", int64_to_string(time(NULL)));
 
+		if (marked_accounts != NULL)
+			mowgli_patricia_add(marked_accounts, entity(mu)->id, mu);
+
 		wallops("\2%s\2 marked the account \2%s\2.", get_oper_name(si), entity(mu)->name);
 		logcommand(si, CMDLOG_ADMIN, "MARK:ON: \2%s\2 (reason: \2%s\2)", entity(mu)->name, info);
 		command_success_nodata(si, _("\2%s\2 is now marked."), entity(mu)->name);
@@ -103,6 +150,8 @@ ns_cmd_mark(struct sourceinfo *si, int parc, char *parv[])
 		metadata_delete(mu, "private:mark:reason");
 		metadata_delete(mu, "private:mark:timestamp");
 
+		marked_myuser_delete(mu);
+
 		wallops("\2%s\2 unmarked the account \2%s\2.", get_oper_name(si), entity(mu)->name);
 		logcommand(si, CMDLOG_ADMIN, "MARK:OFF: \2%s\2", entity(mu)->name);
 		command_success_nodata(si, _("\2%s\2 is now unmarked."), entity(mu)->name);
@@ -140,6 +189,10 @@ mod_init(struct module *const restrict m)
 	static struct list_param marked;
 	marked.opttype = OPT_BOOL;
 	marked.is_match = is_marked;
+	marked.index_estimate = marked_index_estimate;
+	marked.index_scan = marked_index_scan;
+
+	hook_add_myuser_delete(marked_myuser_delete);
 
 	list_register("mark-reason", &mark);
 	list_register("marked", &marked);
@@ -152,6 +205,11 @@ mod_deinit(const enum module_unload_intent ATHEME_VATTR_UNUSED intent)
 
 	list_unregister("mark-reason");
 	list_unregister("marked");
+
+	hook_del_myuser_delete(marked_myuser_delete);
+
+	if (marked_accounts != NULL)
+		mowgli_patricia_destroy(marked_accounts, NULL, NULL);
 }
 
 SIMPLE_DECLARE_MODULE_V1("nickserv/mark", MODULE_UNLOAD_CAPABILITY_OK)
@@ -201,6 +201,7 @@ ns_cmd_register(struct sourceinfo *si, int parc, char *parv[])
 		si->su->myuser = mu;
 		n = mowgli_node_create();
 		mowgli_node_add(si->su, n, &mu->logins);
+		stats_login_count("REGISTER");
 
 		if (!(mu->flags & MU_WAITAUTH))
 			// only grant ircd registered status if it's verified
@@ -76,8 +76,7 @@ ns_cmd_return(struct sourceinfo *si, int parc, char *parv[])
 	mu->flags |= MU_CRYPTPASS;
 
 	(void) sfree(newpass);
-	(void) smemzero(mu->pass, sizeof mu->pass);
-	(void) mowgli_strlcpy(mu->pass, newhash, sizeof mu->pass);
+	(void) myuser_set_pass(mu, newhash);
 	(void) hook_call_myuser_changed_password_or_hash(mu);
 
 	if (!(mu->flags & MU_HIDEMAIL)                    // doesn't have HIDEMAIL
@@ -41,7 +41,7 @@ ns_cmd_set_nopassword(struct sourceinfo *si, int parc, char *parv[])
 			return;
 		}
 
-		if (si->smu->cert_fingerprints.head == NULL && metadata_find(si->smu, "private:pubkey") == NULL && metadata_find(si->smu, "pubkey") == NULL && metadata_find(si->smu, "ecdsa-nist521p-pubkey") == NULL)
+		if (myuser_cold_ro(si->smu)->cert_fingerprints.head == NULL && metadata_find(si->smu, "private:pubkey") == NULL && metadata_find(si->smu, "pubkey") == NULL && metadata_find(si->smu, "ecdsa-nist521p-pubkey") == NULL)
 		{
 			command_fail(si, fault_nochange, _("You are trying to enable NOPASSWORD without any possibility to identify without a password."));
 			return;
@@ -786,7 +786,10 @@ clones_newuser(struct hook_user_nick *data)
 		{
 			if (! (u->flags & UF_KLINESENT)) {
 				slog(LG_INFO, "CLONES: \2%u\2 clones on \2%s\2 (%s!%s@%s) (TKLINE due to excess clones)", i, u->ip, u->nick, u->user, u->host);
+				const enum sendq_class prev_class = sts_set_class(SENDQ_ENFORCEMENT);
+
 				kline_sts("*", "*", u->ip, kline_duration, "Excessive clones");
+				(void) sts_set_class(prev_class);
 				u->flags |= UF_KLINESENT;
 			}
 		}
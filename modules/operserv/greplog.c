@@ -67,6 +67,7 @@ os_cmd_greplog(struct sourceinfo *si, int parc, char *parv[])
 	struct tm *tm;
 	mowgli_list_t loglines = { NULL, NULL, 0 };
 	mowgli_node_t *n, *tn;
+	struct match_pattern *compiled;
 
 	// require user, channel and server auspex (channel auspex checked via in struct command)
 	if (!has_priv(si, PRIV_USER_AUSPEX))
@@ -109,6 +110,8 @@ os_cmd_greplog(struct sourceinfo *si, int parc, char *parv[])
 		return;
 	}
 
+	compiled = match_compile(pattern);
+
 	for (day = 0; day <= days; day++)
 	{
 		if (day == 0)
@@ -149,7 +152,7 @@ os_cmd_greplog(struct sourceinfo *si, int parc, char *parv[])
 			if (strcmp(service, "*") && strcasecmp(service, p))
 				continue;
 			*q++ = ' ';
-			if (match(pattern, q))
+			if (match_compiled(compiled, q))
 				continue;
 			matches++;
 			mowgli_node_add_head(sstrdup(str), mowgli_node_create(), &loglines);
@@ -181,6 +184,8 @@ os_cmd_greplog(struct sourceinfo *si, int parc, char *parv[])
 		}
 	}
 
+	match_pattern_free(compiled);
+
 	logcommand(si, CMDLOG_ADMIN, "GREPLOG: \2%s\2 \2%s\2 (\2%u\2 matches)", service, pattern, matches);
 	if (matches == 0)
 		command_success_nodata(si, _("No lines matched pattern \2%s\2"), pattern);
@@ -122,12 +122,7 @@ os_cmd_ignore_clear(struct sourceinfo *si, int parc, char *parv[])
 		svsignore = (struct svsignore *)n->data;
 
 		command_success_nodata(si, _("\2%s\2 has been removed from the services ignore list."), svsignore->mask);
-		mowgli_node_delete(n,&svs_ignore_list);
-		mowgli_node_free(n);
-		sfree(svsignore->mask);
-		sfree(svsignore->setby);
-		sfree(svsignore->reason);
-
+		svsignore_delete(svsignore);
 	}
 
 	command_success_nodata(si, _("Services ignore list has been wiped!"));
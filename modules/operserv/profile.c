@@ -0,0 +1,411 @@
+/*
+ * SPDX-License-Identifier: ISC
+ * SPDX-URL: https://spdx.org/licenses/ISC.html
+ *
+ * Copyright (C) 2026 Atheme Development Group (https://atheme.github.io/)
+ *
+ * This file contains code for OS PROFILE
+ */
+
+#include <atheme.h>
+
+#define OS_PROFILE_DEFAULT_ROWS 20U
+
+static mowgli_patricia_t *os_profile_cmds = NULL;
+
+static const char *
+os_profile_fmt_ns(const uint64_t ns, char *const restrict buf, const size_t buflen)
+{
+	const uint64_t us = ns / 1000U;
+
+	if (us < 10000U)
+		(void) snprintf(buf, buflen, "%" PRIu64 "us", us);
+	else if (us < 10000000U)
+		(void) snprintf(buf, buflen, "%" PRIu64 ".%01" PRIu64 "ms", us / 1000U, (us / 100U) % 10U);
+	else
+		(void) snprintf(buf, buflen, "%" PRIu64 ".%01" PRIu64 "s", us / 1000000U, (us / 100000U) % 10U);
+
+	return buf;
+}
+
+static void
+os_profile_show_histogram(struct sourceinfo *const restrict si, const struct profile_counter *const restrict pc)
+{
+	char lo[32];
+	char hi[32];
+
+	for (unsigned int i = 0; i < PROFILE_HIST_BUCKETS; i++)
+	{
+		if (! pc->hist[i])
+			continue;
+
+		const uint64_t limit = profile_hist_bucket_limit_us(i);
+		const unsigned int permille = (unsigned int) ((pc->hist[i] * 1000U) / pc->calls);
+
+		(void) os_profile_fmt_ns((i ? (UINT64_C(1) << i) : 0) * 1000U, lo, sizeof lo);
+
+		if (limit)
+			(void) command_success_nodata(si, _("  %8s - %-8s %12" PRIu64 " (%u.%u%%)"), lo,
+			                              os_profile_fmt_ns(limit * 1000U, hi, sizeof hi), pc->hist[i],
+			                              permille / 10U, permille % 10U);
+		else
+			(void) command_success_nodata(si, _("  %8s and more %9" PRIu64 " (%u.%u%%)"), lo, pc->hist[i],
+			                              permille / 10U, permille % 10U);
+	}
+}
+
+static void
+os_profile_show_table(struct sourceinfo *const restrict si, mowgli_patricia_t *const restrict table,
+                      const char *const restrict what, const unsigned int rows, const bool failures)
+{
+	struct profile_counter **counters;
+	char total[32];
+	char mean[32];
+	char max[32];
+	char p99[32];
+	char fails[32];
+
+	const size_t count = table ? profile_table_sorted(table, &counters) : 0;
+
+	if (! count)
+	{
+		(void) command_success_nodata(si, _("No %s have been run since the statistics were last reset."), what);
+
+		if (table)
+			(void) sfree(counters);
+
+		return;
+	}
+
+	(void) command_success_nodata(si, "%-40s %10s %10s %10s %10s %10s%s", _("Name"), _("Calls"), _("Total"),
+	                              _("Mean"), _("p99 <"), _("Max"), failures ? _("   Failures") : "");
+	(void) command_success_nodata(si, "%-40s %10s %10s %10s %10s %10s%s", "----", "-----", "-----", "----",
+	                              "-----", "---", failures ? "   --------" : "");
+
+	for (size_t i = 0; i < count && (! rows || i < rows); i++)
+	{
+		const struct profile_counter *const pc = counters[i];
+
+		*fails = '\0';
+
+		if (failures)
+			(void) snprintf(fails, sizeof fails, " %10" PRIu64, pc->failures);
+
+		(void) command_success_nodata(si, "%-40s %10" PRIu64 " %10s %10s %10s %10s%s", pc->name, pc->calls,
+		                              os_profile_fmt_ns(pc->total_ns, total, sizeof total),
+		                              os_profile_fmt_ns(pc->total_ns / pc->calls, mean, sizeof mean),
+		                              os_profile_fmt_ns(profile_hist_percentile_us(pc, 99) * 1000U,
+		                                                p99, sizeof p99),
+		                              os_profile_fmt_ns(pc->max_ns, max, sizeof max), fails);
+	}
+
+	if (rows && count > rows)
+		(void) command_success_nodata(si, ngettext(N_("\2%zu\2 more entry not shown."),
+		                                           N_("\2%zu\2 more entries not shown."),
+		                                           count - rows), count - rows);
+
+	(void) command_success_nodata(si, _("End of list."));
+	(void) sfree(counters);
+}
+
+static unsigned int
+os_profile_rows(const char *const restrict arg)
+{
+	unsigned int rows;
+
+	if (! arg || ! string_to_uint(arg, &rows))
+		return OS_PROFILE_DEFAULT_ROWS;
+
+	return rows;
+}
+
+static void
+os_cmd_profile_eventloop(struct sourceinfo *const restrict si, const int ATHEME_VATTR_UNUSED parc,
+                         char ATHEME_VATTR_UNUSED **const restrict parv)
+{
+	const struct profile_counter *const pc = &eventloop_stats.iteration;
+	const struct eventloop_stall *stall;
+	char buf[4][32];
+
+	(void) logcommand(si, CMDLOG_GET, "PROFILE:EVENTLOOP");
+
+	(void) command_success_nodata(si, _("Event loop statistics for the last %s:"),
+	                              timediff(CURRTIME - eventloop_stats.since));
+	(void) command_success_nodata(si, _("Busy iterations: %" PRIu64 ", idle iterations: %" PRIu64),
+	                              pc->calls, eventloop_stats.idle_iterations);
+
+	if (pc->calls)
+	{
+		(void) command_success_nodata(si, _("Busy time per iteration: mean %s, p50 < %s, p99 < %s, max %s"),
+		                              os_profile_fmt_ns(pc->total_ns / pc->calls, buf[0], sizeof buf[0]),
+		                              os_profile_fmt_ns(profile_hist_percentile_us(pc, 50) * 1000U,
+		                                                buf[1], sizeof buf[1]),
+		                              os_profile_fmt_ns(profile_hist_percentile_us(pc, 99) * 1000U,
+		                                                buf[2], sizeof buf[2]),
+		                              os_profile_fmt_ns(pc->max_ns, buf[3], sizeof buf[3]));
+
+		(void) os_profile_show_histogram(si, pc);
+	}
+
+	if (! config_options.stall_threshold)
+	{
+		(void) command_success_nodata(si, _("Stall detection is disabled."));
+		return;
+	}
+
+	(void) command_success_nodata(si, _("Callbacks that ran for longer than %u ms: %" PRIu64),
+	                              config_options.stall_threshold, eventloop_stats.stalls);
+
+	if (! eventloop_stats.stalls)
+		return;
+
+	stall = &eventloop_stats.last_stall;
+
+	(void) command_success_nodata(si, _("Last stall: \2%s\2 for %s, %s ago"), stall->culprit,
+	                              os_profile_fmt_ns(stall->duration_ns, buf[0], sizeof buf[0]),
+	                              time_ago(stall->when));
+
+	stall = &eventloop_stats.worst_stall;
+
+	(void) command_success_nodata(si, _("Worst stall: \2%s\2 for %s, %s ago"), stall->culprit,
+	                              os_profile_fmt_ns(stall->duration_ns, buf[0], sizeof buf[0]),
+	                              time_ago(stall->when));
+}
+
+static void
+os_cmd_profile_timers(struct sourceinfo *const restrict si, const int parc, char **const restrict parv)
+{
+	(void) logcommand(si, CMDLOG_GET, "PROFILE:TIMERS");
+
+	(void) os_profile_show_table(si, eventloop_timer_stats, _("timers"), os_profile_rows((parc > 0) ? parv[0] : NULL),
+	                             false);
+}
+
+static void
+os_cmd_profile_io(struct sourceinfo *const restrict si, const int parc, char **const restrict parv)
+{
+	(void) logcommand(si, CMDLOG_GET, "PROFILE:IO");
+
+	(void) os_profile_show_table(si, eventloop_io_stats, _("I/O callbacks"), os_profile_rows((parc > 0) ? parv[0] : NULL),
+	                             false);
+}
+
+static void
+os_cmd_profile_commands(struct sourceinfo *const restrict si, const int parc, char **const restrict parv)
+{
+	(void) logcommand(si, CMDLOG_GET, "PROFILE:COMMANDS");
+
+	if (! config_options.profile_commands)
+		(void) command_success_nodata(si, _("Command profiling is disabled; set general::profile_commands to "
+		                                    "enable it."));
+
+	(void) os_profile_show_table(si, command_profile_stats, _("commands"),
+	                             os_profile_rows((parc > 0) ? parv[0] : NULL), true);
+}
+
+static void
+os_cmd_profile_protocol(struct sourceinfo *const restrict si, int parc, char **parv)
+{
+	struct proto_cmd **pcmds;
+	char buf[4][32];
+	bool burst = false;
+
+	if (parc > 0 && ! strcasecmp(parv[0], "BURST"))
+	{
+		burst = true;
+		parc--;
+		parv++;
+	}
+
+	const unsigned int rows = os_profile_rows((parc > 0) ? parv[0] : NULL);
+
+	(void) logcommand(si, CMDLOG_GET, "PROFILE:PROTOCOL%s", burst ? ":BURST" : "");
+
+	if (burst)
+	{
+		if (! pcommand_burst.start)
+		{
+			(void) command_success_nodata(si, _("Services have not received a burst yet."));
+			return;
+		}
+
+		if (pcommand_burst.wall_ns)
+			(void) command_success_nodata(si, _("Last burst started %s ago and took %s:"),
+			                              time_ago(pcommand_burst.start),
+			                              os_profile_fmt_ns(pcommand_burst.wall_ns, buf[0], sizeof buf[0]));
+		else
+			(void) command_success_nodata(si, _("Burst in progress since %s ago:"),
+			                              time_ago(pcommand_burst.start));
+
+		(void) command_success_nodata(si, _("%" PRIu64 " messages (%" PRIu64 " bytes), %s in handlers, of which "
+		                                    "%s in hooks"), pcommand_burst.messages, pcommand_burst.bytes,
+		                              os_profile_fmt_ns(pcommand_burst.handler_ns, buf[0], sizeof buf[0]),
+		                              os_profile_fmt_ns(pcommand_burst.hook_ns, buf[1], sizeof buf[1]));
+	}
+
+	const size_t count = pcommand_stats_sorted(&pcmds, burst);
+
+	if (! count)
+	{
+		(void) command_success_nodata(si, _("No protocol messages have been processed since the statistics were "
+		                                    "last reset."));
+		(void) sfree(pcmds);
+		return;
+	}
+
+	(void) command_success_nodata(si, "%-12s %12s %14s %10s %10s %10s %10s", _("Message"), _("Count"), _("Bytes"),
+	                              _("Total"), _("In hooks"), _("Mean"), _("Max"));
+	(void) command_success_nodata(si, "%-12s %12s %14s %10s %10s %10s %10s", "-------", "-----", "-----", "-----",
+	                              "--------", "----", "---");
+
+	for (size_t i = 0; i < count && (! rows || i < rows); i++)
+	{
+		const struct pcommand_stats *const ps = burst ? &pcmds[i]->burst : &pcmds[i]->stats;
+		const struct profile_counter *const pc = &ps->handler;
+
+		(void) command_success_nodata(si, "%-12s %12" PRIu64 " %14" PRIu64 " %10s %10s %10s %10s", pcmds[i]->token,
+		                              pc->calls, ps->bytes, os_profile_fmt_ns(pc->total_ns, buf[0], sizeof buf[0]),
+		                              os_profile_fmt_ns(ps->hook_ns, buf[1], sizeof buf[1]),
+		                              os_profile_fmt_ns(pc->total_ns / pc->calls, buf[2], sizeof buf[2]),
+		                              os_profile_fmt_ns(pc->max_ns, buf[3], sizeof buf[3]));
+	}
+
+	if (rows && count > rows)
+		(void) command_success_nodata(si, ngettext(N_("\2%zu\2 more entry not shown."),
+		                                           N_("\2%zu\2 more entries not shown."),
+		                                           count - rows), count - rows);
+
+	(void) command_success_nodata(si, _("End of list."));
+	(void) sfree(pcmds);
+}
+
+static void
+os_cmd_profile_reset(struct sourceinfo *const restrict si, const int ATHEME_VATTR_UNUSED parc,
+                     char ATHEME_VATTR_UNUSED **const restrict parv)
+{
+	(void) eventloop_stats_reset();
+
+	if (command_profile_stats)
+		(void) profile_table_reset(command_profile_stats);
+
+	(void) pcommand_stats_reset();
+
+	(void) logcommand(si, CMDLOG_ADMIN, "PROFILE:RESET");
+	(void) command_success_nodata(si, _("Profiling statistics have been reset."));
+}
+
+static void
+os_cmd_profile(struct sourceinfo *const restrict si, const int parc, char **const restrict parv)
+{
+	if (parc < 1)
+	{
+		(void) command_fail(si, fault_needmoreparams, STR_INSUFFICIENT_PARAMS, "PROFILE");
+		(void) command_fail(si, fault_needmoreparams, _("Syntax: PROFILE EVENTLOOP|TIMERS|IO|COMMANDS|PROTOCOL|RESET"));
+		return;
+	}
+
+	(void) subcommand_dispatch_simple(si->service, si, parc, parv, os_profile_cmds, "PROFILE");
+}
+
+static struct command os_profile = {
+	.name           = "PROFILE",
+	.desc           = N_("Shows where services spend their time."),
+	.access         = PRIV_SERVER_AUSPEX,
+	.maxparc        = 2,
+	.cmd            = &os_cmd_profile,
+	.help           = { .path = "oservice/profile" },
+};
+
+static struct command os_profile_eventloop = {
+	.name           = "EVENTLOOP",
+	.desc           = N_("Shows event loop latency and stall statistics."),
+	.access         = AC_NONE,
+	.maxparc        = 1,
+	.cmd            = &os_cmd_profile_eventloop,
+	.help           = { .path = "" },
+};
+
+static struct command os_profile_timers = {
+	.name           = "TIMERS",
+	.desc           = N_("Shows the time spent in each timer."),
+	.access         = AC_NONE,
+	.maxparc        = 1,
+	.cmd            = &os_cmd_profile_timers,
+	.help           = { .path = "" },
+};
+
+static struct command os_profile_io = {
+	.name           = "IO",
+	.desc           = N_("Shows the time spent in each I/O callback."),
+	.access         = AC_NONE,
+	.maxparc        = 1,
+	.cmd            = &os_cmd_profile_io,
+	.help           = { .path = "" },
+};
+
+static struct command os_profile_commands = {
+	.name           = "COMMANDS",
+	.desc           = N_("Shows the time spent in each services command."),
+	.access         = AC_NONE,
+	.maxparc        = 1,
+	.cmd            = &os_cmd_profile_commands,
+	.help           = { .path = "" },
+};
+
+static struct command os_profile_protocol = {
+	.name           = "PROTOCOL",
+	.desc           = N_("Shows the time spent handling each type of protocol message."),
+	.access         = AC_NONE,
+	.maxparc        = 2,
+	.cmd            = &os_cmd_profile_protocol,
+	.help           = { .path = "" },
+};
+
+static struct command os_profile_reset = {
+	.name           = "RESET",
+	.desc           = N_("Resets the profiling statistics."),
+	.access         = PRIV_ADMIN,
+	.maxparc        = 1,
+	.cmd            = &os_cmd_profile_reset,
+	.help           = { .path = "" },
+};
+
+static void
+mod_init(struct module *const restrict m)
+{
+	MODULE_TRY_REQUEST_DEPENDENCY(m, "operserv/main")
+
+	if (! (os_profile_cmds = mowgli_patricia_create(&strcasecanon)))
+	{
+		(void) slog(LG_ERROR, "%s: mowgli_patricia_create() failed", m->name);
+
+		m->mflags |= MODFLAG_FAIL;
+		return;
+	}
+
+	(void) command_add(&os_profile_eventloop, os_profile_cmds);
+	(void) command_add(&os_profile_timers, os_profile_cmds);
+	(void) command_add(&os_profile_io, os_profile_cmds);
+	(void) command_add(&os_profile_commands, os_profile_cmds);
+	(void) command_add(&os_profile_protocol, os_profile_cmds);
+	(void) command_add(&os_profile_reset, os_profile_cmds);
+
+	(void) service_named_bind_command("operserv", &os_profile);
+}
+
+static void
+mod_deinit(const enum module_unload_intent ATHEME_VATTR_UNUSED intent)
+{
+	(void) service_named_unbind_command("operserv", &os_profile);
+
+	(void) command_delete(&os_profile_eventloop, os_profile_cmds);
+	(void) command_delete(&os_profile_timers, os_profile_cmds);
+	(void) command_delete(&os_profile_io, os_profile_cmds);
+	(void) command_delete(&os_profile_commands, os_profile_cmds);
+	(void) command_delete(&os_profile_protocol, os_profile_cmds);
+	(void) command_delete(&os_profile_reset, os_profile_cmds);
+
+	(void) mowgli_patricia_destroy(os_profile_cmds, NULL, NULL);
+}
+
+SIMPLE_DECLARE_MODULE_V1("operserv/profile", MODULE_UNLOAD_CAPABILITY_OK)
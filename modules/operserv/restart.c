@@ -12,8 +12,25 @@
 static void
 os_cmd_restart(struct sourceinfo *si, int parc, char *parv[])
 {
-	logcommand(si, CMDLOG_ADMIN, "RESTART");
-	wallops("Restarting by request of \2%s\2.", get_oper_name(si));
+	if (parc > 0 && strcasecmp(parv[0], "WARM"))
+	{
+		command_fail(si, fault_badparams, STR_INVALID_PARAMS, "RESTART");
+		command_fail(si, fault_badparams, _("Syntax: RESTART [WARM]"));
+		return;
+	}
+
+	if (parc > 0)
+	{
+		logcommand(si, CMDLOG_ADMIN, "RESTART: WARM");
+		wallops("Restarting (warm) by request of \2%s\2.", get_oper_name(si));
+
+		runflags |= RF_WARM;
+	}
+	else
+	{
+		logcommand(si, CMDLOG_ADMIN, "RESTART");
+		wallops("Restarting by request of \2%s\2.", get_oper_name(si));
+	}
 
 	runflags |= RF_RESTART;
 }
@@ -22,7 +39,7 @@ static struct command os_restart = {
 	.name           = "RESTART",
 	.desc           = N_("Restart services."),
 	.access         = PRIV_ADMIN,
-	.maxparc        = 0,
+	.maxparc        = 1,
 	.cmd            = &os_cmd_restart,
 	.help           = { .path = "oservice/restart" },
 };
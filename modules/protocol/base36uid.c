@@ -15,68 +15,57 @@
 #include <atheme.h>
 
 static char new_uid[10]; // allow for \0
-static unsigned int uindex = 0;
-
-static void
-add_one_to_uid(unsigned int i)
-{
-	if (i != strlen(me.numeric))	// Not reached server SID portion yet?
-	{
-		if (new_uid[i] == 'Z')
-			new_uid[i] = '0';
-		else if (new_uid[i] == '9')
-		{
-			new_uid[i] = 'A';
-			add_one_to_uid(i - 1);
-		}
-		else
-			new_uid[i] = new_uid[i] + 1;
-	}
-	else
-	{
-		if (new_uid[i] == 'Z')
-			for (i = strlen(me.numeric); i < 9; i++)
-				new_uid[i] = 'A';
-		else
-			new_uid[i] = new_uid[i] + 1;
-	}
-}
+static size_t sidlen = 0;
+static size_t clientlen = 0;
+static unsigned int uid_counter = 0;
+static unsigned int uid_limit = 0;
 
 static void
 base36_uid_init(const char *sid)
 {
-	unsigned int i;
 	char buf[BUFSIZE];
+	size_t uidlen;
 
 	if (ircd->uses_p10)
 	{
 		me.numeric = sstrdup(uinttobase64(buf, (uint64_t) atoi(me.numeric), 2));
-		uindex = 5;
+		uidlen = 5;
 	}
 	else
-		uindex = 9;
-
+		uidlen = 9;
 
 	memset(new_uid, 0, sizeof(new_uid));
 
-	if (me.numeric != NULL)
-		memcpy(new_uid, me.numeric, strlen(me.numeric));
-	else
+	if (me.numeric == NULL || (sidlen = strlen(me.numeric)) >= uidlen || uidlen - sidlen > 6)
 		return;
 
-	for (i = 0; i < strlen(me.numeric); i++)
-		if (new_uid[i] == '\0')
-			new_uid[i] = 'A';
+	memcpy(new_uid, me.numeric, sidlen);
+
+	/* The first character of the client part is a letter and the others
+	 * count A-Z then 0-9, so there are 26 * 36^(clientlen - 1) numerics
+	 * before we wrap around to AAAAAA again.
+	 */
+	clientlen = uidlen - sidlen;
+	uid_counter = 0;
+	uid_limit = 26;
 
-	for (i = strlen(me.numeric); i < uindex; i++)
-		new_uid[i] = 'A';
+	for (size_t i = 1; i < clientlen; i++)
+		uid_limit *= 36;
+
+	(void) uid_base36_encode(new_uid + sidlen, uid_counter, clientlen);
 }
 
 static const char *
 base36_uid_get(void)
 {
-	add_one_to_uid(uindex - 1); // index from 0
-	return (new_uid);
+	if (! clientlen)
+		return new_uid;
+
+	uid_counter = (uid_counter + 1) % uid_limit;
+
+	(void) uid_base36_encode(new_uid + sidlen, uid_counter, clientlen);
+
+	return new_uid;
 }
 
 static void
@@ -78,6 +78,52 @@ p10_join_sts(struct channel *c, struct user *u, bool isnew, char *modes)
 	}
 }
 
+/* CREATE takes a list of channels, so channels that share a TS (all of them
+ * unless chansvs.changets is set) are created a line at a time */
+static void
+p10_join_batch_sts(struct user *u, struct channel **chans, size_t count)
+{
+	char names[400];
+	size_t i = 0;
+
+	while (i < count)
+	{
+		const time_t ts = chans[i]->ts;
+		size_t len = 0, j;
+
+		for (j = i; j < count && chans[j]->ts == ts; j++)
+		{
+			const size_t namelen = strlen(chans[j]->name);
+
+			if (len + namelen + 2 > sizeof names)
+				break;
+
+			if (len != 0)
+				names[len++] = ',';
+			memcpy(names + len, chans[j]->name, namelen + 1);
+			len += namelen;
+		}
+
+		// a name too long to be listed at all
+		if (j == i)
+		{
+			join_sts(chans[i], u, true, channel_modes(chans[i], true));
+			i++;
+			continue;
+		}
+
+		sts("%s C %s %lu", u->uid, names, (unsigned long)ts);
+
+		for (; i < j; i++)
+		{
+			const char *modes = channel_modes(chans[i], true);
+
+			if (modes[0] && modes[1])
+				sts("%s M %s %s", u->uid, chans[i]->name, modes);
+		}
+	}
+}
+
 static void
 p10_chan_lowerts(struct channel *c, struct user *u)
 {
@@ -1044,6 +1090,7 @@ mod_init(struct module *const restrict m)
 	quit_sts = &p10_quit_sts;
 	wallops_sts = &p10_wallops_sts;
 	join_sts = &p10_join_sts;
+	join_batch_sts = &p10_join_batch_sts;
 	chan_lowerts = &p10_chan_lowerts;
 	kick = &p10_kick;
 	msg = &p10_msg;
@@ -1520,6 +1520,60 @@ channel_drop(struct mychan *mc)
 			mc->chan->name);
 }
 
+static void
+ts6_warm_restart_save(struct hook_warm_restart *hdata)
+{
+	char capab[BUFSIZE];
+
+	/* what m_capab() found out, which the uplink will not tell a
+	 * process that takes over the link again */
+	snprintf(capab, sizeof capab, "%s%s%s%s%s",
+			use_euid ? " EUID" : "",
+			use_rserv_support ? " SERVICES" : "",
+			use_tb ? " TB" : "",
+			use_eopmod ? " EOPMOD" : "",
+			use_mlock ? " MLOCK" : "");
+
+	hashmap_add(hdata->state, "ts6.capab", sstrdup(capab));
+	hashmap_add(hdata->state, "ts6.sid", sstrdup(ts6sid));
+	hdata->supported = true;
+}
+
+static void
+ts6_warm_restart_restore(struct hook_warm_restart *hdata)
+{
+	const char *capab = hashmap_retrieve(hdata->state, "ts6.capab");
+	const char *sid = hashmap_retrieve(hdata->state, "ts6.sid");
+	char buf[BUFSIZE];
+	char *p;
+
+	if (capab == NULL || sid == NULL)
+		return;
+
+	use_euid = false;
+	use_rserv_support = false;
+	use_tb = false;
+	use_eopmod = false;
+	use_mlock = false;
+	mowgli_strlcpy(buf, capab, sizeof buf);
+	for (p = strtok(buf, " "); p != NULL; p = strtok(NULL, " "))
+	{
+		if (!strcmp(p, "EUID"))
+			use_euid = true;
+		else if (!strcmp(p, "SERVICES"))
+			use_rserv_support = true;
+		else if (!strcmp(p, "TB"))
+			use_tb = true;
+		else if (!strcmp(p, "EOPMOD"))
+			use_eopmod = true;
+		else if (!strcmp(p, "MLOCK"))
+			use_mlock = true;
+	}
+
+	mowgli_strlcpy(ts6sid, sid, sizeof ts6sid);
+	hdata->supported = true;
+}
+
 static void
 mod_init(struct module *const restrict m)
 {
@@ -1606,6 +1660,8 @@ mod_init(struct module *const restrict m)
 
 	hook_add_server_eob(server_eob);
 	hook_add_channel_drop(channel_drop);
+	hook_add_warm_restart_save(ts6_warm_restart_save);
+	hook_add_warm_restart_restore(ts6_warm_restart_restore);
 }
 
 static void
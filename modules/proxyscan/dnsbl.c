@@ -64,12 +64,28 @@ struct Blacklist {
 	mowgli_node_t node;
 };
 
+/* The result of looking up one IP address in one DNSBL. Entries that are
+ * still being resolved are kept out of the LRU list, and clients that look up
+ * the same address in the meantime wait for the same query.
+ */
+struct dnsbl_cache_entry {
+	char name[IRCD_RES_HOSTLEN + 1];        // the query, e.g. 4.3.2.1.dnsbl.example.net
+	struct Blacklist *blacklist;
+	bool pending;
+	bool listed;
+	time_t expires;
+	mowgli_dns_query_t dns_query;
+	mowgli_list_t waiters;                  // struct BlacklistClient
+	mowgli_node_t lru_node;                 // in dnsbl_cache_lru, or dnsbl_cache_pending
+};
+
 // A lookup in progress for a particular DNSBL for a particular client
 struct BlacklistClient {
 	struct Blacklist *blacklist;
 	struct user *u;
-	mowgli_dns_query_t dns_query;
-	mowgli_node_t node;
+	struct dnsbl_cache_entry *entry;
+	mowgli_node_t node;                     // in the client's dnsbl_queries()
+	mowgli_node_t wait_node;                // in entry->waiters
 };
 
 struct dnsbl_exemption
@@ -108,6 +124,16 @@ static struct service *proxyscan = NULL;
 static mowgli_list_t *dnsbl_elist = NULL;
 static mowgli_dns_t *dns_base = NULL;
 
+static struct hashmap *dnsbl_cache = NULL;
+static mowgli_list_t dnsbl_cache_lru = { NULL, NULL, 0 };      // least recently used first
+static mowgli_list_t dnsbl_cache_pending = { NULL, NULL, 0 };
+static unsigned int dnsbl_cache_size;
+static unsigned int dnsbl_cache_listed_ttl;
+static unsigned int dnsbl_cache_unlisted_ttl;
+static uint64_t dnsbl_cache_hits;
+static uint64_t dnsbl_cache_misses;
+static uint64_t dnsbl_cache_coalesced;
+
 static inline mowgli_list_t *
 dnsbl_queries(struct user *u)
 {
@@ -260,12 +286,14 @@ abort_blacklist_queries(struct user *u)
 	mowgli_node_t *n, *tn;
 	mowgli_list_t *l = dnsbl_queries(u);
 
+	// the queries themselves go on, to fill the cache for whoever asks next
 	MOWGLI_ITER_FOREACH_SAFE(n, tn, l->head)
 	{
 		struct BlacklistClient *blcptr = n->data;
 
-		mowgli_dns_delete_query(dns_base, &blcptr->dns_query);
+		mowgli_node_delete(&blcptr->wait_node, &blcptr->entry->waiters);
 		mowgli_node_delete(n, l);
+		atheme_object_unref(blcptr->blacklist);
 		sfree(blcptr);
 	}
 }
@@ -279,6 +307,8 @@ dnsbl_hit(struct user *u, struct Blacklist *blptr)
 
 	abort_blacklist_queries(u);
 
+	blptr->hits++;
+
 	switch (action)
 	{
 		case DNSBL_ACT_KLINE:
@@ -303,98 +333,235 @@ dnsbl_hit(struct user *u, struct Blacklist *blptr)
 	}
 }
 
+static void
+dnsbl_cache_entry_free(struct dnsbl_cache_entry *e)
+{
+	if (e->pending)
+	{
+		mowgli_dns_delete_query(dns_base, &e->dns_query);
+		mowgli_node_delete(&e->lru_node, &dnsbl_cache_pending);
+	}
+	else
+		mowgli_node_delete(&e->lru_node, &dnsbl_cache_lru);
+
+	while (e->waiters.head != NULL)
+	{
+		struct BlacklistClient *blcptr = e->waiters.head->data;
+
+		mowgli_node_delete(&blcptr->wait_node, &e->waiters);
+		mowgli_node_delete(&blcptr->node, dnsbl_queries(blcptr->u));
+		atheme_object_unref(blcptr->blacklist);
+		sfree(blcptr);
+	}
+
+	(void) hashmap_delete(dnsbl_cache, e->name);
+	atheme_object_unref(e->blacklist);
+	sfree(e);
+}
+
+// drop resolved entries, least recently used first, until there is room for one more
+static void
+dnsbl_cache_trim(unsigned int room)
+{
+	while (dnsbl_cache_lru.head != NULL && hashmap_size(dnsbl_cache) + room > dnsbl_cache_size)
+		dnsbl_cache_entry_free(dnsbl_cache_lru.head->data);
+}
+
+// forget every result, e.g. because the list of blacklists may have changed
+static void
+dnsbl_cache_clear(void)
+{
+	while (dnsbl_cache_lru.head != NULL)
+		dnsbl_cache_entry_free(dnsbl_cache_lru.head->data);
+}
+
 static void
 blacklist_dns_callback(mowgli_dns_reply_t *reply, int result, void *vptr)
 {
-	struct BlacklistClient *blcptr = (struct BlacklistClient *) vptr;
-	int listed = 0;
-	mowgli_list_t *l;
+	struct dnsbl_cache_entry *e = vptr;
+	bool listed = false;
 
-	if (blcptr == NULL)
+	if (e == NULL)
 		return;
 
-	if (blcptr->u == NULL)
+	/* A timeout or resolver error says nothing about the address; let the
+	 * clients waiting on it go and forget the entry, so that it is looked
+	 * up again next time instead of being taken as unlisted
+	 */
+	if (result != MOWGLI_DNS_RES_SUCCESS && result != MOWGLI_DNS_RES_NXDOMAIN)
 	{
-		sfree(blcptr);
+		e->pending = false;
+		mowgli_node_delete(&e->lru_node, &dnsbl_cache_pending);
+		mowgli_node_add(e, &e->lru_node, &dnsbl_cache_lru);
+		dnsbl_cache_entry_free(e);
 		return;
 	}
 
-	l = dnsbl_queries(blcptr->u);
-	mowgli_node_delete(&blcptr->node, l);
-
 	if (reply != NULL)
 	{
 		// only accept 127.x.y.z as a listing
 		if (reply->addr.addr.ss_family == AF_INET &&
 				!memcmp(&((struct sockaddr_in *)&reply->addr.addr)->sin_addr, "\177", 1))
-			listed++;
-		else if (blcptr->blacklist->lastwarning + SECONDS_PER_HOUR < CURRTIME)
+			listed = true;
+		else if (e->blacklist->lastwarning + SECONDS_PER_HOUR < CURRTIME)
 		{
 			slog(LG_DEBUG,
 					"Garbage reply from blacklist %s",
-					blcptr->blacklist->host);
-			blcptr->blacklist->lastwarning = CURRTIME;
+					e->blacklist->host);
+			e->blacklist->lastwarning = CURRTIME;
 		}
 	}
 
-	// they have a blacklist entry for this client
-	if (listed)
-		dnsbl_hit(blcptr->u, blcptr->blacklist);
+	e->pending = false;
+	e->listed = listed;
+	e->expires = CURRTIME + (listed ? dnsbl_cache_listed_ttl : dnsbl_cache_unlisted_ttl);
+	mowgli_node_delete(&e->lru_node, &dnsbl_cache_pending);
+	mowgli_node_add(e, &e->lru_node, &dnsbl_cache_lru);
 
-	atheme_object_unref(blcptr->blacklist);
-	sfree(blcptr);
+	/* dnsbl_hit() aborts the other queries of the same client, which may be
+	 * waiting on this entry as well, so always take the first waiter */
+	while (e->waiters.head != NULL)
+	{
+		struct BlacklistClient *blcptr = e->waiters.head->data;
+		struct user *u = blcptr->u;
+
+		mowgli_node_delete(&blcptr->wait_node, &e->waiters);
+		mowgli_node_delete(&blcptr->node, dnsbl_queries(u));
+		atheme_object_unref(blcptr->blacklist);
+		sfree(blcptr);
+
+		// they have a blacklist entry for this client
+		if (listed)
+			dnsbl_hit(u, e->blacklist);
+	}
+
+	dnsbl_cache_trim(0);
 }
 
-static void
-initiate_blacklist_dnsquery(struct Blacklist *blptr, struct user *u)
+// builds the name to look an IP address up with in a DNSBL, e.g. 4.3.2.1.dnsbl.example.net
+static bool
+blacklist_query_name(const struct Blacklist *blptr, const char *ip, char *buf)
 {
-	char buf[IRCD_RES_HOSTLEN + 1];
+	static const char hexdigits[] = "0123456789abcdef";
 	unsigned char ipoct[16];
-	char tmp[16];
-
-	if (u->ip == NULL)
-		return;
-
-	(void) memset(buf, 0x00, sizeof buf);
+	char *p = buf;
 
-	if (inet_pton(AF_INET, u->ip, ipoct) == 1)
+	if (inet_pton(AF_INET, ip, ipoct) == 1)
 	{
 		if (strlen(blptr->host) >= (IRCD_RES_HOSTLEN - 16))
-			return;
+			return false;
 
 		for (unsigned int i = 0; i < 4; i++)
 		{
-			(void) snprintf(tmp, sizeof tmp, "%u.", (unsigned int) ipoct[3 - i]);
-			(void) mowgli_strlcat(buf, tmp, sizeof buf);
+			const unsigned int oct = ipoct[3 - i];
+
+			if (oct >= 100)
+				*p++ = (char) ('0' + oct / 100);
+			if (oct >= 10)
+				*p++ = (char) ('0' + (oct / 10) % 10);
+			*p++ = (char) ('0' + oct % 10);
+			*p++ = '.';
 		}
 	}
-	else if (inet_pton(AF_INET6, u->ip, ipoct) == 1)
+	else if (inet_pton(AF_INET6, ip, ipoct) == 1)
 	{
 		if (strlen(blptr->host) >= (IRCD_RES_HOSTLEN - 64))
-			return;
+			return false;
 
 		for (unsigned int i = 0; i < 16; i++)
 		{
-			(void) snprintf(tmp, sizeof tmp, "%1x.%1x.", (unsigned int) (ipoct[15 - i] & 0xFU),
-			                                             (unsigned int) (ipoct[15 - i] >> 4U));
+			*p++ = hexdigits[ipoct[15 - i] & 0xFU];
+			*p++ = '.';
+			*p++ = hexdigits[ipoct[15 - i] >> 4U];
+			*p++ = '.';
+		}
+	}
+	else
+		return false;
+
+	(void) strcpy(p, blptr->host);
+	return true;
+}
+
+/* looks an IP address up in a DNSBL, from the cache if possible; returns
+ * true if the client was found to be listed right away */
+static bool
+initiate_blacklist_dnsquery(struct Blacklist *blptr, struct user *u)
+{
+	char buf[IRCD_RES_HOSTLEN + 1];
+	struct dnsbl_cache_entry *e;
+	mowgli_list_t *uql;
+	mowgli_node_t *n;
+
+	if (u->ip == NULL)
+		return false;
+
+	if (!blacklist_query_name(blptr, u->ip, buf))
+		return false;
+
+	uql = dnsbl_queries(u);
+	e = hashmap_retrieve(dnsbl_cache, buf);
+
+	if (e != NULL && !e->pending && e->expires > CURRTIME)
+	{
+		dnsbl_cache_hits++;
+
+		mowgli_node_delete(&e->lru_node, &dnsbl_cache_lru);
+		mowgli_node_add(e, &e->lru_node, &dnsbl_cache_lru);
+
+		if (!e->listed)
+			return false;
+
+		dnsbl_hit(u, blptr);
+		return true;
+	}
+
+	if (e != NULL && e->pending)
+	{
+		// this client may be waiting on it already (DNSBLSCAN)
+		MOWGLI_ITER_FOREACH(n, uql->head)
+		{
+			struct BlacklistClient *blcptr = n->data;
 
-			(void) mowgli_strlcat(buf, tmp, sizeof buf);
+			if (blcptr->entry == e)
+				return false;
 		}
+
+		dnsbl_cache_coalesced++;
 	}
 	else
-		return;
+	{
+		dnsbl_cache_misses++;
+
+		if (e == NULL)
+		{
+			dnsbl_cache_trim(1);
+
+			e = smalloc(sizeof *e);
+			mowgli_strlcpy(e->name, buf, sizeof e->name);
+			e->blacklist = atheme_object_ref(blptr);
+			(void) hashmap_add(dnsbl_cache, e->name, e);
+		}
+		else
+			mowgli_node_delete(&e->lru_node, &dnsbl_cache_lru);
+
+		mowgli_node_add(e, &e->lru_node, &dnsbl_cache_pending);
+		e->pending = true;
+		e->dns_query.callback = blacklist_dns_callback;
+		e->dns_query.ptr = e;
+		(void) mowgli_dns_gethost_byname(dns_base, e->name, &e->dns_query, MOWGLI_DNS_T_A);
+	}
 
 	struct BlacklistClient *const blcptr = smalloc(sizeof *blcptr);
-	mowgli_list_t *const uql = dnsbl_queries(u);
 
 	blcptr->blacklist = atheme_object_ref(blptr);
-	blcptr->dns_query.callback = blacklist_dns_callback;
-	blcptr->dns_query.ptr = blcptr;
 	blcptr->u = u;
+	blcptr->entry = e;
 
-	(void) mowgli_strlcat(buf, blptr->host, sizeof buf);
-	(void) mowgli_dns_gethost_byname(dns_base, buf, &blcptr->dns_query, MOWGLI_DNS_T_A);
 	(void) mowgli_node_add(blcptr, &blcptr->node, uql);
+	(void) mowgli_node_add(blcptr, &blcptr->wait_node, &e->waiters);
+
+	return false;
 }
 
 static void
@@ -402,14 +569,16 @@ lookup_blacklists(struct user *u)
 {
 	mowgli_node_t *n;
 
+	if (u == NULL)
+		return;
+
 	MOWGLI_ITER_FOREACH(n, blacklist_list.head)
 	{
 		struct Blacklist *blptr = (struct Blacklist *) n->data;
 
-		if (u == NULL)
+		// one listing is enough
+		if (initiate_blacklist_dnsquery(blptr, u))
 			return;
-
-		initiate_blacklist_dnsquery(blptr, u);
 	}
 }
 
@@ -514,6 +683,7 @@ dnsbl_config_handler(mowgli_config_file_entry_t *ce)
 static void
 dnsbl_config_purge(void *unused)
 {
+	dnsbl_cache_clear();
 	destroy_blacklists();
 }
 
@@ -581,6 +751,10 @@ osinfo_hook(struct sourceinfo *si)
 
 		command_success_nodata(si, _("Using DNSBL: %s"), blptr->host);
 	}
+
+	command_success_nodata(si, _("DNSBL cache: %zu of %u entries, %" PRIu64 " hits, %" PRIu64 " misses, "
+	                             "%" PRIu64 " lookups joined to one in progress"), hashmap_size(dnsbl_cache),
+	                       dnsbl_cache_size, dnsbl_cache_hits, dnsbl_cache_misses, dnsbl_cache_coalesced);
 }
 
 static void
@@ -685,6 +859,8 @@ mod_init(struct module *const restrict m)
 		return;
 	}
 
+	dnsbl_cache = hashmap_create(true);
+
 	hook_add_config_purge(dnsbl_config_purge);
 	hook_add_db_write(write_dnsbl_exempt_db);
 	hook_add_operserv_info(osinfo_hook);
@@ -700,6 +876,9 @@ mod_init(struct module *const restrict m)
 
 	add_conf_item("DNSBL_ACTION", &proxyscan->conf_table, dnsbl_action_config_handler);
 	add_conf_item("BLACKLISTS", &proxyscan->conf_table, dnsbl_config_handler);
+	add_uint_conf_item("DNSBL_CACHE_SIZE", &proxyscan->conf_table, 0, &dnsbl_cache_size, 0, INT_MAX, 16384);
+	add_duration_conf_item("DNSBL_CACHE_LISTED_TTL", &proxyscan->conf_table, 0, &dnsbl_cache_listed_ttl, "m", 900);
+	add_duration_conf_item("DNSBL_CACHE_UNLISTED_TTL", &proxyscan->conf_table, 0, &dnsbl_cache_unlisted_ttl, "m", 300);
 
 	m->mflags |= MODFLAG_DBHANDLER;
 }
@@ -708,6 +887,13 @@ static void
 mod_deinit(const enum module_unload_intent ATHEME_VATTR_UNUSED intent)
 {
 	mowgli_global_storage_put(DNSBL_ELIST_PERSIST_MDNAME, dnsbl_elist);
+
+	dnsbl_cache_clear();
+
+	while (dnsbl_cache_pending.head != NULL)
+		dnsbl_cache_entry_free(dnsbl_cache_pending.head->data);
+
+	hashmap_destroy(dnsbl_cache);
 	mowgli_dns_destroy(dns_base);
 
 	hook_del_config_purge(dnsbl_config_purge);
@@ -725,6 +911,9 @@ mod_deinit(const enum module_unload_intent ATHEME_VATTR_UNUSED intent)
 
 	del_conf_item("DNSBL_ACTION", &proxyscan->conf_table);
 	del_conf_item("BLACKLISTS", &proxyscan->conf_table);
+	del_conf_item("DNSBL_CACHE_SIZE", &proxyscan->conf_table);
+	del_conf_item("DNSBL_CACHE_LISTED_TTL", &proxyscan->conf_table);
+	del_conf_item("DNSBL_CACHE_UNLISTED_TTL", &proxyscan->conf_table);
 }
 
 SIMPLE_DECLARE_MODULE_V1("proxyscan/dnsbl", MODULE_UNLOAD_CAPABILITY_RELOAD_ONLY)
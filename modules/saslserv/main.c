@@ -15,9 +15,21 @@
 #endif
 
 #define ASASL_OUTFLAGS_WIPE_FREE_BUF    (ASASL_OUTFLAG_WIPE_BUF | ASASL_OUTFLAG_FREE_BUF)
+#define SASL_SESSION_TIMEOUT            SECONDS_PER_MINUTE
+#define SASL_DELETE_STALE_INTERVAL      5U
 #define LOGIN_CANCELLED_STR             "There was a problem logging you in; login cancelled"
 
-static mowgli_list_t sasl_sessions;
+struct sasl_mechanism_stats
+{
+	char            name[SASL_MECHANISM_MAXLEN + 1];
+	unsigned int    active;         // Sessions currently using the mechanism
+	uint64_t        started;        // Sessions that have ever selected it
+};
+
+static mowgli_list_t sasl_sessions;                     // Ordered by deadline, soonest first
+static struct hashmap *sasl_session_index = NULL;       // Sessions by UID
+static mowgli_patricia_t *sasl_mechanism_stats = NULL;  // struct sasl_mechanism_stats by mechanism name
+static mowgli_patricia_t *sasl_step_stats = NULL;       // struct profile_counter by message type
 static mowgli_list_t sasl_mechanisms;
 static char sasl_mechlist_string[SASL_S2S_MAXLEN_ATONCE_B64];
 static bool sasl_hide_server_names;
@@ -108,17 +120,40 @@ sasl_session_find(const char *const restrict uid)
 	if (! uid || ! *uid)
 		return NULL;
 
-	mowgli_node_t *n;
+	return hashmap_retrieve(sasl_session_index, uid);
+}
+
+static void
+sasl_session_touch(struct sasl_session *const restrict p)
+{
+	// Every session has the same timeout, so moving it to the tail keeps the queue ordered
+	p->deadline = CURRTIME + SASL_SESSION_TIMEOUT;
 
-	MOWGLI_ITER_FOREACH(n, sasl_sessions.head)
+	(void) mowgli_node_delete(&p->node, &sasl_sessions);
+	(void) mowgli_node_add(p, &p->node, &sasl_sessions);
+}
+
+static struct sasl_mechanism_stats *
+sasl_mechanism_stats_get(const struct sasl_mechanism *const restrict mech)
+{
+	struct sasl_mechanism_stats *stats = mowgli_patricia_retrieve(sasl_mechanism_stats, mech->name);
+
+	if (! stats)
 	{
-		struct sasl_session *const p = n->data;
+		stats = smalloc(sizeof *stats);
 
-		if (strcmp(p->uid, uid) == 0)
-			return p;
+		(void) mowgli_strlcpy(stats->name, mech->name, sizeof stats->name);
+		(void) mowgli_patricia_add(sasl_mechanism_stats, mech->name, stats);
 	}
 
-	return NULL;
+	return stats;
+}
+
+static void
+sasl_mechanism_stats_free(const char ATHEME_VATTR_UNUSED *const restrict key, void *const restrict data,
+                          void ATHEME_VATTR_UNUSED *const restrict privdata)
+{
+	(void) sfree(data);
 }
 
 static struct sasl_session *
@@ -132,8 +167,11 @@ sasl_session_find_or_make(const struct sasl_message *const restrict smsg)
 
 		p->server = smsg->server;
 
+		p->deadline = CURRTIME + SASL_SESSION_TIMEOUT;
+
 		(void) mowgli_strlcpy(p->uid, smsg->uid, sizeof p->uid);
 		(void) mowgli_node_add(p, &p->node, &sasl_sessions);
+		(void) hashmap_add(sasl_session_index, p->uid, p);
 	}
 
 	return p;
@@ -316,8 +354,13 @@ sasl_user_can_login(struct sasl_session *const restrict p)
 static void
 sasl_session_reset(struct sasl_session *const restrict p)
 {
-	if (p->mechptr && p->mechptr->mech_finish)
-		(void) p->mechptr->mech_finish(p);
+	if (p->mechptr)
+	{
+		sasl_mechanism_stats_get(p->mechptr)->active--;
+
+		if (p->mechptr->mech_finish)
+			(void) p->mechptr->mech_finish(p);
+	}
 	p->mechptr = NULL;
 
 	struct user *const u = user_find(p->uid);
@@ -329,18 +372,10 @@ sasl_session_reset(struct sasl_session *const restrict p)
 static void
 sasl_session_destroy(struct sasl_session *const restrict p)
 {
-	mowgli_node_t *n;
-
 	sasl_session_reset(p);
 
-	MOWGLI_ITER_FOREACH(n, sasl_sessions.head)
-	{
-		if (n == &p->node && n->data == p)
-		{
-			(void) mowgli_node_delete(n, &sasl_sessions);
-			break;
-		}
-	}
+	(void) hashmap_delete(sasl_session_index, p->uid);
+	(void) mowgli_node_delete(&p->node, &sasl_sessions);
 
 	if (p->si)
 		(void) atheme_object_unref(p->si);
@@ -455,7 +490,11 @@ sasl_handle_login(struct sasl_session *const restrict p, struct user *const u, s
 		if (u->myuser != mu)
 		{
 			// If they're not logged in, or logging in to a different account, do a full login
+			char method[BUFSIZE];
+
+			(void) snprintf(method, sizeof method, "SASL/%s", p->mechptr->name);
 			(void) myuser_login(saslsvs, u, mu, false);
+			(void) stats_login_count(method);
 			(void) logcommand_user(saslsvs, u, CMDLOG_LOGIN, "LOGIN (%s)", p->mechptr->name);
 		}
 		else
@@ -601,6 +640,11 @@ sasl_process_packet(struct sasl_session *const restrict p, char *const restrict
 			return false;
 		}
 
+		struct sasl_mechanism_stats *const stats = sasl_mechanism_stats_get(p->mechptr);
+
+		stats->active++;
+		stats->started++;
+
 		(void) sasl_sourceinfo_recreate(p);
 
 		if (p->mechptr->mech_start)
@@ -627,7 +671,7 @@ sasl_process_packet(struct sasl_session *const restrict p, char *const restrict
 	}
 
 	// Some progress has been made, reset timeout.
-	p->flags &= ~ASASL_SFLAG_MARKED_FOR_DELETION;
+	(void) sasl_session_touch(p);
 
 	switch (rc)
 	{
@@ -855,33 +899,61 @@ sasl_input(struct sasl_message *const restrict smsg)
 {
 	struct sasl_session *const p = sasl_session_find_or_make(smsg);
 
+	/* Nothing else we send concerns a client that is still registering,
+	 * so the replies may overtake the rest of our output
+	 */
+	enum sendq_class prev_class = SENDQ_CONTROL;
+	const bool registering = (user_find(smsg->uid) == NULL);
+
+	if (registering)
+		prev_class = sts_set_class(SENDQ_LOGIN);
+
+	const uint64_t start_ns = profile_time_ns();
+	const char *step = NULL;
 	bool ret = true;
 
 	switch (smsg->mode)
 	{
 		case 'H':
 			// (H)ost information
+			step = "hostinfo";
 			(void) sasl_input_hostinfo(smsg, p);
 			break;
 
 		case 'S':
 			// (S)tart authentication
+			step = "start";
 			ret = sasl_input_startauth(smsg, p);
 			break;
 
 		case 'C':
 			// (C)lient data
+			step = "clientdata";
 			ret = sasl_input_clientdata(smsg, p);
 			break;
 
 		case 'D':
 			// (D)one -- when we receive it, means client abort
+			step = "done";
 			(void) sasl_session_reset_or_destroy(p);
 			break;
 	}
 
 	if (! ret)
 		(void) sasl_session_abort(p);
+
+	if (step)
+	{
+		struct profile_counter *const pc = profile_counter_get(sasl_step_stats, step);
+
+		(void) profile_counter_record(pc, profile_time_ns() - start_ns);
+
+		if (! ret)
+			pc->failures++;
+	}
+
+	if (registering)
+		(void) sts_set_class(prev_class);
 }
 
 static void
@@ -904,16 +976,16 @@ sasl_user_add(struct hook_user_nick *const restrict data)
 static void
 sasl_delete_stale(void ATHEME_VATTR_UNUSED *const restrict vptr)
 {
-	mowgli_node_t *n, *tn;
-
-	MOWGLI_ITER_FOREACH_SAFE(n, tn, sasl_sessions.head)
+	// Only the expired sessions at the head of the deadline queue are looked at
+	while (sasl_sessions.head)
 	{
-		struct sasl_session *const p = n->data;
+		struct sasl_session *const p = sasl_sessions.head->data;
 
-		if (p->flags & ASASL_SFLAG_MARKED_FOR_DELETION)
-			(void) sasl_session_destroy(p);
-		else
-			p->flags |= ASASL_SFLAG_MARKED_FOR_DELETION;
+		if (p->deadline > CURRTIME)
+			break;
+
+		(void) slog(LG_DEBUG, "%s: destroying stale session %s", MOWGLI_FUNC_NAME, p->uid);
+		(void) sasl_session_destroy(p);
 	}
 }
 
@@ -1094,6 +1166,37 @@ saslserv_message_handler(struct sourceinfo *const restrict si, const int parc, c
 	                                         "to the network. It has no public interface."));
 }
 
+static void
+sasl_osinfo(struct sourceinfo *const restrict si)
+{
+	mowgli_patricia_iteration_state_t state;
+	struct profile_counter **counters;
+	struct sasl_mechanism_stats *stats;
+
+	if (! has_priv(si, PRIV_SERVER_AUSPEX))
+		return;
+
+	(void) command_success_nodata(si, _("SASL sessions in progress: %zu"), hashmap_size(sasl_session_index));
+
+	MOWGLI_PATRICIA_FOREACH(stats, &state, sasl_mechanism_stats)
+		(void) command_success_nodata(si, _("SASL mechanism %s: %u in progress, %" PRIu64 " started"),
+		                              stats->name, stats->active, stats->started);
+
+	const size_t count = profile_table_sorted(sasl_step_stats, &counters);
+
+	for (size_t i = 0; i < count; i++)
+	{
+		const struct profile_counter *const pc = counters[i];
+
+		(void) command_success_nodata(si, _("SASL step %s: %" PRIu64 " messages (%" PRIu64 " failed), "
+		                                    "average %" PRIu64 " us, 99%% under %" PRIu64 " us"), pc->name,
+		                              pc->calls, pc->failures, (pc->total_ns / pc->calls) / 1000U,
+		                              profile_hist_percentile_us(pc, 99));
+	}
+
+	(void) sfree(counters);
+}
+
 static void
 mod_init(struct module *const restrict m)
 {
@@ -1104,11 +1207,16 @@ mod_init(struct module *const restrict m)
 		return;
 	}
 
+	sasl_session_index = hashmap_create(false);
+	sasl_mechanism_stats = mowgli_patricia_create(&noopcanon);
+	sasl_step_stats = mowgli_patricia_create(&noopcanon);
+
 	(void) hook_add_sasl_input(&sasl_input);
 	(void) hook_add_user_add(&sasl_user_add);
 	(void) hook_add_server_eob(&sasl_server_eob);
+	(void) hook_add_operserv_info(&sasl_osinfo);
 
-	sasl_delete_stale_timer = mowgli_timer_add(base_eventloop, "sasl_delete_stale", &sasl_delete_stale, NULL, SECONDS_PER_MINUTE / 2);
+	sasl_delete_stale_timer = mowgli_timer_add(base_eventloop, "sasl_delete_stale", &sasl_delete_stale, NULL, SASL_DELETE_STALE_INTERVAL);
 	authservice_loaded++;
 
 	(void) add_bool_conf_item("HIDE_SERVER_NAMES", &saslsvs->conf_table, 0, &sasl_hide_server_names, false);
@@ -1120,6 +1228,7 @@ mod_deinit(const enum module_unload_intent ATHEME_VATTR_UNUSED intent)
 	(void) hook_del_sasl_input(&sasl_input);
 	(void) hook_del_user_add(&sasl_user_add);
 	(void) hook_del_server_eob(&sasl_server_eob);
+	(void) hook_del_operserv_info(&sasl_osinfo);
 
 	(void) mowgli_timer_destroy(base_eventloop, sasl_delete_stale_timer);
 
@@ -1131,6 +1240,10 @@ mod_deinit(const enum module_unload_intent ATHEME_VATTR_UNUSED intent)
 	if (sasl_sessions.head)
 		(void) slog(LG_ERROR, "saslserv/main: shutting down with a non-empty session list; "
 		                      "a mechanism did not unregister itself! (BUG)");
+
+	(void) hashmap_destroy(sasl_session_index);
+	(void) mowgli_patricia_destroy(sasl_mechanism_stats, &sasl_mechanism_stats_free, NULL);
+	(void) profile_table_destroy(sasl_step_stats);
 }
 
 SIMPLE_DECLARE_MODULE_V1("saslserv/main", MODULE_UNLOAD_CAPABILITY_OK)
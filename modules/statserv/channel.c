@@ -18,7 +18,7 @@ ss_cmd_channel(struct sourceinfo *const restrict si, const int parc, char **cons
 	if (parc < 1)
 	{
 		(void) command_fail(si, fault_needmoreparams, STR_INSUFFICIENT_PARAMS, "CHANNEL");
-		(void) command_fail(si, fault_needmoreparams, _("Syntax: CHANNEL [TOPIC|COUNT] [parameters]"));
+		(void) command_fail(si, fault_needmoreparams, _("Syntax: CHANNEL [TOPIC|COUNT|SIZES] [parameters]"));
 		return;
 	}
 
@@ -66,6 +66,16 @@ ss_cmd_channel_count(struct sourceinfo *const restrict si, const int ATHEME_VATT
 	                                           chancount), chancount);
 }
 
+static void
+ss_cmd_channel_sizes(struct sourceinfo *const restrict si, const int ATHEME_VATTR_UNUSED parc,
+                     char ATHEME_VATTR_UNUSED **const restrict parv)
+{
+	for (unsigned int i = 0; i < STATS_CHANNEL_BUCKETS; i++)
+		if (stats_counters.chansize[i])
+			(void) command_success_nodata(si, _("Channels with %s members: %u"),
+			                              stats_chansize_label(i), stats_counters.chansize[i]);
+}
+
 static struct command ss_channel = {
 	.name           = "CHANNEL",
 	.desc           = N_("Obtain various information about a channel."),
@@ -93,6 +103,15 @@ static struct command ss_channel_count = {
 	.help           = { .path = "" },
 };
 
+static struct command ss_channel_sizes = {
+	.name           = "SIZES",
+	.desc           = N_("Count the channels on the network by number of members."),
+	.access         = AC_NONE,
+	.maxparc        = 1,
+	.cmd            = &ss_cmd_channel_sizes,
+	.help           = { .path = "" },
+};
+
 static void
 mod_init(struct module *const restrict m)
 {
@@ -108,6 +127,7 @@ mod_init(struct module *const restrict m)
 
 	(void) command_add(&ss_channel_topic, ss_channel_cmds);
 	(void) command_add(&ss_channel_count, ss_channel_cmds);
+	(void) command_add(&ss_channel_sizes, ss_channel_cmds);
 
 	(void) service_named_bind_command("statserv", &ss_channel);
 }
@@ -57,7 +57,7 @@ ss_cmd_server_info(struct sourceinfo *const restrict si, const int parc, char **
 		return;
 	}
 
-	const struct server *const s = mowgli_patricia_retrieve(servlist, parv[0]);
+	const struct server *const s = hashmap_retrieve(servlist_index, parv[0]);
 
 	if (! s)
 	{
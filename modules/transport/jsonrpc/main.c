@@ -648,6 +648,226 @@ jsonrpcmethod_metadata(void *conn, mowgli_list_t *params, char *id)
 	return 0;
 }
 
+static mowgli_json_t *
+jsonrpc_profile_uint(const uint64_t value)
+{
+	// mowgli's JSON integers are ints; larger values are still exact as doubles up to 2^53
+	if (value <= INT_MAX)
+		return mowgli_json_create_integer((int) value);
+
+	return mowgli_json_create_float((double) value);
+}
+
+static mowgli_json_t *
+jsonrpc_profile_counter(const struct profile_counter *const restrict pc)
+{
+	mowgli_json_t *const obj = mowgli_json_create_object();
+	mowgli_json_t *const hist = mowgli_json_create_array();
+	mowgli_patricia_t *const patricia = MOWGLI_JSON_OBJECT(obj);
+
+	// The histogram is sent in full so that clients can rely on bucket i covering [2^i, 2^(i+1)) us
+	for (unsigned int i = 0; i < PROFILE_HIST_BUCKETS; i++)
+		mowgli_node_add(jsonrpc_profile_uint(pc->hist[i]), mowgli_node_create(), MOWGLI_JSON_ARRAY(hist));
+
+	mowgli_patricia_add(patricia, "name", mowgli_json_create_string(pc->name));
+	mowgli_patricia_add(patricia, "calls", jsonrpc_profile_uint(pc->calls));
+	mowgli_patricia_add(patricia, "failures", jsonrpc_profile_uint(pc->failures));
+	mowgli_patricia_add(patricia, "total_us", jsonrpc_profile_uint(pc->total_ns / 1000U));
+	mowgli_patricia_add(patricia, "max_us", jsonrpc_profile_uint(pc->max_ns / 1000U));
+	mowgli_patricia_add(patricia, "histogram", hist);
+
+	return obj;
+}
+
+static mowgli_json_t *
+jsonrpc_profile_table(mowgli_patricia_t *const restrict table)
+{
+	mowgli_json_t *const array = mowgli_json_create_array();
+	struct profile_counter **counters;
+
+	if (! table)
+		return array;
+
+	const size_t count = profile_table_sorted(table, &counters);
+
+	for (size_t i = 0; i < count; i++)
+		mowgli_node_add(jsonrpc_profile_counter(counters[i]), mowgli_node_create(), MOWGLI_JSON_ARRAY(array));
+
+	sfree(counters);
+
+	return array;
+}
+
+static mowgli_json_t *
+jsonrpc_profile_stall(const struct eventloop_stall *const restrict stall)
+{
+	if (! stall->duration_ns)
+		return mowgli_json_null;
+
+	mowgli_json_t *const obj = mowgli_json_create_object();
+	mowgli_patricia_t *const patricia = MOWGLI_JSON_OBJECT(obj);
+
+	mowgli_patricia_add(patricia, "culprit", mowgli_json_create_string(stall->culprit));
+	mowgli_patricia_add(patricia, "duration_us", jsonrpc_profile_uint(stall->duration_ns / 1000U));
+	mowgli_patricia_add(patricia, "when", jsonrpc_profile_uint((uint64_t) stall->when));
+
+	return obj;
+}
+
+static mowgli_json_t *
+jsonrpc_profile_pcommands(const bool burst)
+{
+	mowgli_json_t *const array = mowgli_json_create_array();
+	struct proto_cmd **pcmds;
+
+	const size_t count = pcommand_stats_sorted(&pcmds, burst);
+
+	for (size_t i = 0; i < count; i++)
+	{
+		const struct pcommand_stats *const ps = burst ? &pcmds[i]->burst : &pcmds[i]->stats;
+		mowgli_json_t *const obj = jsonrpc_profile_counter(&ps->handler);
+
+		mowgli_patricia_add(MOWGLI_JSON_OBJECT(obj), "bytes", jsonrpc_profile_uint(ps->bytes));
+		mowgli_patricia_add(MOWGLI_JSON_OBJECT(obj), "hooks_us", jsonrpc_profile_uint(ps->hook_ns / 1000U));
+		mowgli_node_add(obj, mowgli_node_create(), MOWGLI_JSON_ARRAY(array));
+	}
+
+	sfree(pcmds);
+
+	return array;
+}
+
+static mowgli_json_t *
+jsonrpc_profile_protocol(void)
+{
+	mowgli_json_t *const obj = mowgli_json_create_object();
+	mowgli_json_t *const burst = mowgli_json_create_object();
+	mowgli_patricia_t *patricia = MOWGLI_JSON_OBJECT(burst);
+
+	mowgli_patricia_add(patricia, "start", jsonrpc_profile_uint((uint64_t) pcommand_burst.start));
+	mowgli_patricia_add(patricia, "complete", pcommand_burst.wall_ns ? mowgli_json_true : mowgli_json_false);
+	mowgli_patricia_add(patricia, "duration_us", jsonrpc_profile_uint(pcommand_burst.wall_ns / 1000U));
+	mowgli_patricia_add(patricia, "messages", jsonrpc_profile_uint(pcommand_burst.messages));
+	mowgli_patricia_add(patricia, "bytes", jsonrpc_profile_uint(pcommand_burst.bytes));
+	mowgli_patricia_add(patricia, "handlers_us", jsonrpc_profile_uint(pcommand_burst.handler_ns / 1000U));
+	mowgli_patricia_add(patricia, "hooks_us", jsonrpc_profile_uint(pcommand_burst.hook_ns / 1000U));
+	mowgli_patricia_add(patricia, "messages_by_type", jsonrpc_profile_pcommands(true));
+
+	patricia = MOWGLI_JSON_OBJECT(obj);
+
+	mowgli_patricia_add(patricia, "messages_by_type", jsonrpc_profile_pcommands(false));
+	mowgli_patricia_add(patricia, "burst", burst);
+
+	return obj;
+}
+
+static mowgli_json_t *
+jsonrpc_profile_eventloop(void)
+{
+	mowgli_json_t *const obj = mowgli_json_create_object();
+	mowgli_patricia_t *const patricia = MOWGLI_JSON_OBJECT(obj);
+
+	mowgli_patricia_add(patricia, "since", jsonrpc_profile_uint((uint64_t) eventloop_stats.since));
+	mowgli_patricia_add(patricia, "iterations", jsonrpc_profile_counter(&eventloop_stats.iteration));
+	mowgli_patricia_add(patricia, "idle_iterations", jsonrpc_profile_uint(eventloop_stats.idle_iterations));
+	mowgli_patricia_add(patricia, "stall_threshold_ms", jsonrpc_profile_uint(config_options.stall_threshold));
+	mowgli_patricia_add(patricia, "stalls", jsonrpc_profile_uint(eventloop_stats.stalls));
+	mowgli_patricia_add(patricia, "last_stall", jsonrpc_profile_stall(&eventloop_stats.last_stall));
+	mowgli_patricia_add(patricia, "worst_stall", jsonrpc_profile_stall(&eventloop_stats.worst_stall));
+	mowgli_patricia_add(patricia, "timers", jsonrpc_profile_table(eventloop_timer_stats));
+	mowgli_patricia_add(patricia, "io", jsonrpc_profile_table(eventloop_io_stats));
+
+	return obj;
+}
+
+/* atheme.profile
+ *
+ * JSON inputs:
+ *       authcookie, account name, section ("eventloop", "commands" or "protocol")
+ *
+ * JSON outputs:
+ *       fault 1 - insufficient parameters
+ *       fault 2 - invalid parameters (unknown section)
+ *       fault 3 - unknown user
+ *       fault 6 - account lacks the general:auspex privilege
+ *       fault 15 - validation failed
+ *       default - an object with the profiling statistics of that section;
+ *                 durations are in microseconds, histogram bucket i counts
+ *                 durations in [2^i, 2^(i+1)) microseconds
+ */
+static bool
+jsonrpcmethod_profile(void *conn, mowgli_list_t *params, char *id)
+{
+	struct myuser *mu;
+	mowgli_json_t *resultobj;
+
+	char *cookie = mowgli_node_nth_data(params, 0);
+	char *accountname = mowgli_node_nth_data(params, 1);
+	char *section = mowgli_node_nth_data(params, 2);
+
+	if (MOWGLI_LIST_LENGTH(params) < 3)
+	{
+		jsonrpc_failure_string(conn, fault_needmoreparams, "Insufficient parameters.", id);
+		return false;
+	}
+
+	if ((mu = myuser_find(accountname)) == NULL)
+	{
+		jsonrpc_failure_string(conn, fault_nosuch_source, "Unknown user.", id);
+		return false;
+	}
+
+	if (authcookie_validate(cookie, mu) == false)
+	{
+		jsonrpc_failure_string(conn, fault_badauthcookie, "Invalid authcookie for this account.", id);
+		return false;
+	}
+
+	if (! has_priv_myuser(mu, PRIV_SERVER_AUSPEX))
+	{
+		jsonrpc_failure_string(conn, fault_noprivs, "You do not have permission to view profiling statistics.", id);
+		return false;
+	}
+
+	if (! strcasecmp(section, "eventloop"))
+		resultobj = jsonrpc_profile_eventloop();
+	else if (! strcasecmp(section, "protocol"))
+		resultobj = jsonrpc_profile_protocol();
+	else if (! strcasecmp(section, "commands"))
+	{
+		resultobj = mowgli_json_create_object();
+
+		mowgli_patricia_add(MOWGLI_JSON_OBJECT(resultobj), "enabled",
+		                    config_options.profile_commands ? mowgli_json_true : mowgli_json_false);
+		mowgli_patricia_add(MOWGLI_JSON_OBJECT(resultobj), "commands", jsonrpc_profile_table(command_profile_stats));
+	}
+	else
+	{
+		jsonrpc_failure_string(conn, fault_badparams, "Unknown profiling section.", id);
+		return false;
+	}
+
+	logcommand_external(nicksvs.me, "jsonrpc", conn, NULL, mu, CMDLOG_GET, "PROFILE %s", section);
+
+	mowgli_json_t *obj = mowgli_json_create_object();
+	mowgli_patricia_t *patricia = MOWGLI_JSON_OBJECT(obj);
+
+	mowgli_patricia_add(patricia, "result", resultobj);
+	mowgli_patricia_add(patricia, "id", mowgli_json_create_string(id));
+	mowgli_patricia_add(patricia, "error", mowgli_json_null);
+
+	mowgli_string_t *str = mowgli_string_create();
+
+	mowgli_json_serialize_to_string(obj, str, 0);
+
+	jsonrpc_send_data(conn, str->str);
+
+	mowgli_string_destroy(str);
+	mowgli_json_decref(obj);
+
+	return true;
+}
+
 void
 jsonrpc_send_data(void *conn, char *str)
 {
@@ -703,6 +923,7 @@ mod_init(struct module *const restrict m)
 	jsonrpc_register_method("atheme.privset", jsonrpcmethod_privset);
 	jsonrpc_register_method("atheme.ison", jsonrpcmethod_ison);
 	jsonrpc_register_method("atheme.metadata", jsonrpcmethod_metadata);
+	jsonrpc_register_method("atheme.profile", jsonrpcmethod_profile);
 
 	jsonrpc_path_node = mowgli_node_create();
 	mowgli_node_add(&path_handler, jsonrpc_path_node, httpd_path_handlers);
@@ -720,6 +941,7 @@ mod_deinit(const enum module_unload_intent ATHEME_VATTR_UNUSED intent)
 	jsonrpc_unregister_method("atheme.privset");
 	jsonrpc_unregister_method("atheme.ison");
 	jsonrpc_unregister_method("atheme.metadata");
+	jsonrpc_unregister_method("atheme.profile");
 
 	mowgli_node_delete(jsonrpc_path_node, httpd_path_handlers);
 	mowgli_node_free(jsonrpc_path_node);
@@ -27,6 +27,7 @@ irc_parse(char *line)
 	char *parv[MAXPARC + 1];
 	static char coreLine[BUFSIZE];
 	int parc = 0;
+	size_t len;
 	unsigned int i;
 	struct proto_cmd *pcmd;
 
@@ -50,7 +51,7 @@ irc_parse(char *line)
 
 		// copy the original line so we know what we crashed on
 		memset((char *)&coreLine, '\0', BUFSIZE);
-		mowgli_strlcpy(coreLine, line, BUFSIZE);
+		len = mowgli_strlcpy(coreLine, line, BUFSIZE);
 
 		slog(LG_RAWDATA, "-> %s", line);
 
@@ -176,10 +177,7 @@ irc_parse(char *line)
 				slog(LG_INFO, "irc_parse(): insufficient parameters for command %s", pcmd->token);
 				goto cleanup;
 			}
-			if (pcmd->handler)
-			{
-				pcmd->handler(si, parc, parv);
-			}
+			(void) pcommand_exec(pcmd, si, parc, parv, len);
 		}
 	}
 
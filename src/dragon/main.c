@@ -7,14 +7,840 @@
  * Permission to use, copy, modify, and/or distribute this software for any
  * purpose with or without fee is hereby granted, provided that the above
  * copyright notice and this permission notice appear in all copies.
+ *
+ * dragon: a synthetic network benchmark.
+ *
+ * By default everything happens inside this process: a database of the
+ * requested size is written and loaded through the configured backend, and a
+ * synthetic TS6 network is burst into services over a socketpair standing in
+ * for the uplink, followed by a netsplit, a rejoin and a stream of ordinary
+ * traffic. With --live, services instead link to the uplink in the
+ * configuration file and burst a synthetic network of their own to it.
+ *
+ * Results are written as JSON to standard output (or to --output), so that
+ * they can be compared between builds; see doc/BENCHMARKS.
  */
 
 #include <atheme.h>
 #include <atheme/libathemecore.h>
 
+#include <ext/getopt_long.h>
+
+#define DRAGON_DATABASE         "dragon.db"
+#define DRAGON_SJOIN_MEMBERS    40U
+
+struct dragon_options
+{
+	unsigned int    servers;
+	unsigned int    users;
+	unsigned int    channels;
+	unsigned int    joins;          // average channels per user
+	double          zipf;           // channel size distribution exponent
+	unsigned int    accounts;
+	unsigned int    regchannels;
+	unsigned int    chanacs;        // per registered channel, including the founder
+	unsigned int    akicks;         // per registered channel
+	unsigned int    klines;
+	unsigned int    messages;       // steady state messages
+	unsigned int    seed;
+	const char *    config;
+	const char *    database;
+	const char *    output;
+	bool            live;
+};
+
+// A sequence of protocol lines, stored back to back with their terminators
+struct dragon_script
+{
+	char *          buf;
+	size_t          len;
+	size_t          size;
+	unsigned int    lines;
+};
+
+struct dragon_phase
+{
+	uint64_t        messages;
+	uint64_t        bytes;
+	uint64_t        ns;
+};
+
+struct dragon_results
+{
+	uint64_t                db_rows;
+	uint64_t                db_generate_ns;
+	uint64_t                db_load_ns;
+	uint64_t                db_save_ns;
+	struct dragon_phase     burst_in;
+	struct dragon_phase     burst_out;
+	struct dragon_phase     netsplit;
+	struct dragon_phase     rejoin;
+	struct dragon_phase     steady;
+	unsigned int            split_users;
+	struct proto_cmd **     handlers;
+	size_t                  handler_count;
+};
+
+static struct dragon_options opts = {
+	.servers        = 10,
+	.users          = 100000,
+	.channels       = 25000,
+	.joins          = 3,
+	.zipf           = 1.0,
+	.accounts       = 50000,
+	.regchannels    = 5000,
+	.chanacs        = 5,
+	.akicks         = 2,
+	.klines         = 1000,
+	.messages       = 200000,
+	.seed           = 1,
+	.config         = "./dragon.conf",
+	.database       = NULL,
+	.output         = NULL,
+	.live           = false,
+};
+
+static struct dragon_results results;
+static unsigned int *chansize = NULL;
+static unsigned int *chanoff = NULL;
+static char (*sids)[4] = NULL;
+static unsigned int dragon_rand_state = 1;
+static int dragon_peerfd = -1;
+static time_t dragon_ts = 0;
+
 static struct timeval burstbegin;
 static bool bursting = false;
 
+static const mowgli_getopt_option_t dragon_long_opts[] = {
+	{                "help",       no_argument, NULL, 'h', 0 },
+	{              "config", required_argument, NULL, 'c', 0 },
+	{            "database", required_argument, NULL, 'd', 0 },
+	{              "output", required_argument, NULL, 'o', 0 },
+	{                "live",       no_argument, NULL, 'l', 0 },
+	{             "servers", required_argument, NULL, 'S', 0 },
+	{               "users", required_argument, NULL, 'U', 0 },
+	{            "channels", required_argument, NULL, 'C', 0 },
+	{               "joins", required_argument, NULL, 'j', 0 },
+	{                "zipf", required_argument, NULL, 'z', 0 },
+	{            "accounts", required_argument, NULL, 'A', 0 },
+	{ "registered-channels", required_argument, NULL, 'R', 0 },
+	{             "chanacs", required_argument, NULL, 'a', 0 },
+	{              "akicks", required_argument, NULL, 'k', 0 },
+	{              "klines", required_argument, NULL, 'K', 0 },
+	{            "messages", required_argument, NULL, 'm', 0 },
+	{                "seed", required_argument, NULL, 'r', 0 },
+	{ NULL, 0, NULL, 0, 0 },
+};
+
+static void
+print_usage(const char *const progname)
+{
+	(void) fprintf(stderr, "Usage: %s [options]\n"
+	                       "\n"
+	                       "  -c, --config=FILE             configuration file (default ./dragon.conf)\n"
+	                       "  -d, --database=NAME           load this database (relative to the data directory)\n"
+	                       "                                instead of generating " DRAGON_DATABASE "\n"
+	                       "  -o, --output=FILE             write the results here instead of standard output\n"
+	                       "  -l, --live                    link to the configured uplink and burst to it\n"
+	                       "\n"
+	                       "  -S, --servers=N               servers on the synthetic network (default %u)\n"
+	                       "  -U, --users=N                 users (default %u)\n"
+	                       "  -C, --channels=N              channels (default %u)\n"
+	                       "  -j, --joins=N                 average channels per user (default %u)\n"
+	                       "  -z, --zipf=S                  channel size distribution exponent (default %.2f)\n"
+	                       "  -A, --accounts=N              registered accounts (default %u)\n"
+	                       "  -R, --registered-channels=N   registered channels (default %u)\n"
+	                       "  -a, --chanacs=N               access list entries per channel (default %u)\n"
+	                       "  -k, --akicks=N                AKICK entries per channel (default %u)\n"
+	                       "  -K, --klines=N                K-lines (default %u)\n"
+	                       "  -m, --messages=N              steady state messages (default %u)\n"
+	                       "  -r, --seed=N                  random seed (default %u)\n",
+	               progname, opts.servers, opts.users, opts.channels, opts.joins, opts.zipf, opts.accounts,
+	               opts.regchannels, opts.chanacs, opts.akicks, opts.klines, opts.messages, opts.seed);
+}
+
+static bool
+process_options(int argc, char *argv[])
+{
+	char short_opts[BUFSIZE];
+	char *ptr = short_opts;
+	int c;
+
+	(void) memset(short_opts, 0x00, sizeof short_opts);
+
+	for (size_t x = 0; dragon_long_opts[x].name != NULL; x++)
+	{
+		*ptr++ = dragon_long_opts[x].val;
+
+		if (dragon_long_opts[x].has_arg == required_argument)
+			*ptr++ = ':';
+	}
+
+	while ((c = mowgli_getopt_long(argc, argv, short_opts, dragon_long_opts, NULL)) != -1)
+	{
+		unsigned int *uval = NULL;
+
+		switch (c)
+		{
+			case 'h':
+				(void) print_usage(argv[0]);
+				exit(EXIT_SUCCESS);
+
+			case 'c':
+				opts.config = mowgli_optarg;
+				break;
+
+			case 'd':
+				opts.database = mowgli_optarg;
+				break;
+
+			case 'o':
+				opts.output = mowgli_optarg;
+				break;
+
+			case 'l':
+				opts.live = true;
+				break;
+
+			case 'z':
+			{
+				char *end = NULL;
+
+				errno = 0;
+				opts.zipf = strtod(mowgli_optarg, &end);
+
+				if (errno != 0 || (end && *end) || opts.zipf < 0.0)
+				{
+					(void) fprintf(stderr, "'%s' is not a valid value for option '%c'\n", mowgli_optarg, c);
+					return false;
+				}
+				break;
+			}
+
+			case 'S': uval = &opts.servers;         break;
+			case 'U': uval = &opts.users;           break;
+			case 'C': uval = &opts.channels;        break;
+			case 'j': uval = &opts.joins;           break;
+			case 'A': uval = &opts.accounts;        break;
+			case 'R': uval = &opts.regchannels;     break;
+			case 'a': uval = &opts.chanacs;         break;
+			case 'k': uval = &opts.akicks;          break;
+			case 'K': uval = &opts.klines;          break;
+			case 'm': uval = &opts.messages;        break;
+			case 'r': uval = &opts.seed;            break;
+
+			default:
+				(void) print_usage(argv[0]);
+				return false;
+		}
+
+		if (uval != NULL && ! string_to_uint(mowgli_optarg, uval))
+		{
+			(void) fprintf(stderr, "'%s' is not a valid value for integer option '%c'\n", mowgli_optarg, c);
+			return false;
+		}
+	}
+
+	if (! opts.servers || ! opts.users || opts.servers > 2600U)
+	{
+		(void) fprintf(stderr, "there must be between 1 and 2600 servers, and at least 1 user\n");
+		return false;
+	}
+
+	if (opts.accounts > opts.users)
+		opts.accounts = opts.users;
+
+	if (opts.regchannels > opts.channels || ! opts.accounts)
+		opts.regchannels = opts.accounts ? opts.channels : 0;
+
+	if (opts.chanacs > opts.accounts)
+		opts.chanacs = opts.accounts;
+
+	return true;
+}
+
+static unsigned int
+dragon_rand(void)
+{
+	// xorshift32; reproducible across platforms for a given --seed
+	dragon_rand_state ^= dragon_rand_state << 13;
+	dragon_rand_state ^= dragon_rand_state >> 17;
+	dragon_rand_state ^= dragon_rand_state << 5;
+
+	return dragon_rand_state;
+}
+
+static void
+build_sids(void)
+{
+	sids = scalloc(opts.servers, sizeof *sids);
+
+	for (unsigned int i = 0; i < opts.servers; i++)
+		(void) snprintf(sids[i], sizeof sids[i], "%u%c%c", i % 10U, 'A' + (i / 10U) % 26U, 'A' + (i / 260U) % 26U);
+}
+
+static const char *
+dragon_sid(const unsigned int server)
+{
+	return sids[server];
+}
+
+/* TS6 UIDs are the SID followed by a letter and five alphanumerics; the
+ * suffix encodes the user's index, so every user has a stable UID.
+ */
+static const char *
+dragon_uid(const unsigned int user)
+{
+	static const char alnum[] = "ABCDEFGHIJKLMNOPQRSTUVWXYZ0123456789";
+	static char uid[IDLEN + 1];
+	unsigned int rest = user;
+
+	(void) mowgli_strlcpy(uid, dragon_sid(user % opts.servers), sizeof uid);
+
+	for (unsigned int i = 8; i > 3; i--)
+	{
+		uid[i] = alnum[rest % 36U];
+		rest /= 36U;
+	}
+
+	uid[3] = alnum[rest % 26U];
+	uid[9] = '\0';
+
+	return uid;
+}
+
+static void ATHEME_FATTR_PRINTF(2, 3)
+script_add(struct dragon_script *const restrict script, const char *const restrict fmt, ...)
+{
+	char line[BUFSIZE];
+	va_list ap;
+
+	va_start(ap, fmt);
+	int len = vsnprintf(line, sizeof line, fmt, ap);
+	va_end(ap);
+
+	if (len <= 0)
+		return;
+
+	// The line was truncated; only what fit in it is there
+	if ((size_t) len >= sizeof line)
+		len = (int) sizeof line - 1;
+
+	if (script->len + (size_t) len + 1U > script->size)
+	{
+		script->size = (script->size * 2U) + (size_t) len + 65536U;
+		script->buf = srealloc(script->buf, script->size);
+	}
+
+	(void) memcpy(script->buf + script->len, line, (size_t) len + 1U);
+
+	script->len += (size_t) len + 1U;
+	script->lines++;
+}
+
+static void
+script_free(struct dragon_script *const restrict script)
+{
+	(void) sfree(script->buf);
+	(void) memset(script, 0x00, sizeof *script);
+}
+
+/* Feeds every line of a script through the protocol module's parser, the
+ * same way irc_recvq_handler() does for lines received from the uplink.
+ */
+static void
+script_replay(const struct dragon_script *const restrict script, struct dragon_phase *const restrict phase)
+{
+	char line[BUFSIZE + 1];
+	size_t off = 0;
+
+	const uint64_t start_ns = profile_time_ns();
+
+	while (off < script->len)
+	{
+		const size_t len = strlen(script->buf + off);
+
+		(void) memcpy(line, script->buf + off, len + 1U);
+
+		cnt.bin += len + 2U;
+		me.uplinkpong = CURRTIME;
+
+		(void) parse(line);
+
+		off += len + 1U;
+	}
+
+	phase->ns += profile_time_ns() - start_ns;
+	phase->messages += script->lines;
+	phase->bytes += script->len + script->lines;
+}
+
+/* Channel k (counting from 1) gets a share of the memberships proportional
+ * to 1/k^s, which is what channel sizes on real networks look like; its
+ * members are consecutive users starting at a random offset.
+ */
+static void
+build_channel_sizes(void)
+{
+	const double memberships = (double) opts.users * opts.joins;
+	double harmonic = 0.0;
+
+	if (! opts.channels)
+		return;
+
+	chansize = scalloc(opts.channels, sizeof *chansize);
+	chanoff = scalloc(opts.channels, sizeof *chanoff);
+
+	for (unsigned int k = 1; k <= opts.channels; k++)
+		harmonic += 1.0 / pow((double) k, opts.zipf);
+
+	for (unsigned int k = 1; k <= opts.channels; k++)
+	{
+		const double size = floor((memberships / pow((double) k, opts.zipf) / harmonic) + 0.5);
+
+		chansize[k - 1] = (size < 1.0) ? 1U : (size > opts.users) ? opts.users : (unsigned int) size;
+		chanoff[k - 1] = dragon_rand() % opts.users;
+	}
+}
+
+static void
+db_row(struct database_handle *const restrict db)
+{
+	(void) db_commit_row(db);
+
+	results.db_rows++;
+}
+
+static bool
+generate_database(const char *const restrict filename)
+{
+	struct database_handle *db;
+	char name[BUFSIZE];
+	char target[BUFSIZE];
+
+	const uint64_t start_ns = profile_time_ns();
+
+	if (! (db = db_open(filename, DB_WRITE)))
+		return false;
+
+	(void) db_start_row(db, "DBV");
+	(void) db_write_uint(db, 12);
+	(void) db_row(db);
+
+	(void) db_start_row(db, "CF");
+	(void) db_write_word(db, bitmask_to_flags(ca_all));
+	(void) db_row(db);
+
+	(void) db_start_row(db, "TS");
+	(void) db_write_time(db, dragon_ts);
+	(void) db_row(db);
+
+	for (unsigned int i = 0; i < opts.accounts; i++)
+	{
+		char id[IDLEN + 1];
+		char email[BUFSIZE];
+
+		(void) snprintf(name, sizeof name, "User%u", i);
+		(void) snprintf(email, sizeof email, "user%u@dragon.test", i);
+		(void) snprintf(id, sizeof id, "%s%s", me.numeric, dragon_uid(i) + 3);
+
+		(void) db_start_row(db, "MU");
+		(void) db_write_word(db, id);
+		(void) db_write_word(db, name);
+		(void) db_write_word(db, "*");
+		(void) db_write_word(db, email);
+		(void) db_write_time(db, dragon_ts);
+		(void) db_write_time(db, dragon_ts);
+		(void) db_write_word(db, gflags_tostr(mu_flags, MU_CRYPTPASS));
+		(void) db_write_word(db, "default");
+		(void) db_row(db);
+
+		(void) db_start_row(db, "MN");
+		(void) db_write_word(db, name);
+		(void) db_write_word(db, name);
+		(void) db_write_time(db, dragon_ts);
+		(void) db_write_time(db, dragon_ts);
+		(void) db_row(db);
+	}
+
+	for (unsigned int k = 0; k < opts.regchannels; k++)
+	{
+		const unsigned int founder = chanoff[k] % opts.accounts;
+
+		(void) snprintf(name, sizeof name, "#channel%u", k);
+
+		(void) db_start_row(db, "MC");
+		(void) db_write_word(db, name);
+		(void) db_write_time(db, dragon_ts);
+		(void) db_write_time(db, dragon_ts);
+		(void) db_write_word(db, gflags_tostr(mc_flags, MC_GUARD));
+		(void) db_write_uint(db, CMODE_NOEXT | CMODE_TOPIC);
+		(void) db_write_uint(db, 0);
+		(void) db_write_uint(db, 0);
+		(void) db_write_word(db, "");
+		(void) db_row(db);
+
+		for (unsigned int j = 0; j < opts.chanacs; j++)
+		{
+			(void) snprintf(target, sizeof target, "User%u", (founder + j) % opts.accounts);
+
+			(void) db_start_row(db, "CA");
+			(void) db_write_word(db, name);
+			(void) db_write_word(db, target);
+			(void) db_write_word(db, bitmask_to_flags(j ? ((j % 2U) ? CA_AOP_DEF : CA_VOP_DEF) : CA_FOUNDER_0));
+			(void) db_write_time(db, dragon_ts);
+			(void) db_write_word(db, "*");
+			(void) db_row(db);
+		}
+
+		for (unsigned int j = 0; j < opts.akicks; j++)
+		{
+			(void) snprintf(target, sizeof target, "*!*@banned%u.dragon.test", (k * opts.akicks) + j);
+
+			(void) db_start_row(db, "CA");
+			(void) db_write_word(db, name);
+			(void) db_write_word(db, target);
+			(void) db_write_word(db, bitmask_to_flags(CA_AKICK));
+			(void) db_write_time(db, dragon_ts);
+			(void) db_write_word(db, "*");
+			(void) db_row(db);
+		}
+	}
+
+	(void) db_start_row(db, "KID");
+	(void) db_write_uint(db, opts.klines);
+	(void) db_row(db);
+
+	for (unsigned int i = 0; i < opts.klines; i++)
+	{
+		(void) snprintf(target, sizeof target, "klined%u.dragon.test", i);
+
+		(void) db_start_row(db, "KL");
+		(void) db_write_uint(db, i + 1U);
+		(void) db_write_word(db, "*");
+		(void) db_write_word(db, target);
+		(void) db_write_uint(db, 0);
+		(void) db_write_time(db, dragon_ts);
+		(void) db_write_word(db, "dragon");
+		(void) db_write_str(db, "synthetic K-line");
+		(void) db_row(db);
+	}
+
+	(void) db_close(db);
+
+	results.db_generate_ns = profile_time_ns() - start_ns;
+
+	return true;
+}
+
+static void
+script_add_user(struct dragon_script *const restrict script, const unsigned int user)
+{
+	(void) script_add(script, ":%s UID User%u 1 %lu +i ~user host%u.users.dragon.test 10.%u.%u.%u %s "
+	                          ":dragon user %u", dragon_sid(user % opts.servers), user,
+	                  (unsigned long) dragon_ts, user, (user >> 16) & 0xFFU, (user >> 8) & 0xFFU, user & 0xFFU,
+	                  dragon_uid(user), user);
+}
+
+/* One server's part of the burst: the server itself, its users, and SJOINs
+ * for its members of every channel, then the PONG that ends its burst. The
+ * uplink (server 0) is introduced by the handshake instead.
+ */
+static void
+build_server_burst(struct dragon_script *const restrict script, const unsigned int server)
+{
+	char members[BUFSIZE];
+	const char *const sid = dragon_sid(server);
+	char name[HOSTLEN + 1];
+
+	(void) snprintf(name, sizeof name, "irc%u.dragon.test", server);
+
+	if (server)
+		(void) script_add(script, ":%s SID %s 2 %s :dragon leaf", dragon_sid(0), name, sid);
+
+	for (unsigned int i = server; i < opts.users; i += opts.servers)
+		(void) script_add_user(script, i);
+
+	for (unsigned int k = 0; k < opts.channels; k++)
+	{
+		unsigned int count = 0;
+		size_t len = 0;
+
+		for (unsigned int j = 0; j < chansize[k]; j++)
+		{
+			const unsigned int user = (chanoff[k] + j) % opts.users;
+
+			if (user % opts.servers != server)
+				continue;
+
+			len += (size_t) snprintf(members + len, sizeof members - len, "%s%s%s", len ? " " : "",
+			                         j ? "" : "@", dragon_uid(user));
+
+			if (++count < DRAGON_SJOIN_MEMBERS && j + 1U < chansize[k])
+				continue;
+
+			(void) script_add(script, ":%s SJOIN %lu #channel%u +nt :%s", sid, (unsigned long) dragon_ts, k,
+			                  members);
+
+			count = 0;
+			len = 0;
+		}
+
+		if (len)
+			(void) script_add(script, ":%s SJOIN %lu #channel%u +nt :%s", sid, (unsigned long) dragon_ts, k,
+			                  members);
+	}
+
+	(void) script_add(script, ":%s PONG %s :%s", sid, name, me.name);
+}
+
+static void
+build_burst(struct dragon_script *const restrict script)
+{
+	(void) script_add(script, "PASS %s TS 6 :%s", curr_uplink->receive_pass, dragon_sid(0));
+	(void) script_add(script, "CAPAB :QS EX IE KLN UNKLN ENCAP TB SERVICES EUID EOPMOD MLOCK");
+	(void) script_add(script, "SERVER irc0.dragon.test 1 :dragon uplink");
+
+	// Leaves first, so that the uplink's PONG really is the end of the burst
+	for (unsigned int s = 1; s < opts.servers; s++)
+		(void) build_server_burst(script, s);
+
+	(void) build_server_burst(script, 0);
+}
+
+/* Ordinary traffic between bursts: channel messages, nick changes, joins
+ * and parts, status changes, away toggles, and reconnects. Everything that
+ * is changed is changed back, so the size of the network stays the same.
+ */
+static void
+build_steady_state(struct dragon_script *const restrict script)
+{
+	while (script->lines < opts.messages)
+	{
+		const unsigned int k = opts.channels ? (dragon_rand() % opts.channels) : 0;
+		const unsigned int user = opts.channels ? ((chanoff[k] + (dragon_rand() % chansize[k])) % opts.users)
+		                                        : (dragon_rand() % opts.users);
+		const char *const sid = dragon_sid(user % opts.servers);
+		char uid[IDLEN + 1];
+
+		(void) mowgli_strlcpy(uid, dragon_uid(user), sizeof uid);
+
+		switch (dragon_rand() % 10U)
+		{
+			case 0:
+			case 1:
+			case 2:
+			case 3:
+				(void) script_add(script, ":%s PRIVMSG #channel%u :message %u", uid, k, script->lines);
+				break;
+
+			case 4:
+				(void) script_add(script, ":%s NICK Away%u :%lu", uid, user, (unsigned long) dragon_ts);
+				(void) script_add(script, ":%s NICK User%u :%lu", uid, user, (unsigned long) dragon_ts);
+				break;
+
+			case 5:
+			case 6:
+			{
+				const unsigned int other = opts.channels ? (dragon_rand() % opts.channels) : 0;
+
+				(void) script_add(script, ":%s JOIN %lu #channel%u +", uid, (unsigned long) dragon_ts, other);
+				(void) script_add(script, ":%s PART #channel%u", uid, other);
+				break;
+			}
+
+			case 7:
+				(void) script_add(script, ":%s TMODE %lu #channel%u +v %s", sid, (unsigned long) dragon_ts, k, uid);
+				(void) script_add(script, ":%s TMODE %lu #channel%u -v %s", sid, (unsigned long) dragon_ts, k, uid);
+				break;
+
+			case 8:
+				(void) script_add(script, ":%s AWAY :gone", uid);
+				(void) script_add(script, ":%s AWAY", uid);
+				break;
+
+			case 9:
+				(void) script_add(script, ":%s QUIT :reconnecting", uid);
+				(void) script_add_user(script, user);
+				break;
+		}
+	}
+}
+
+static void
+phase_database(void)
+{
+	const char *const filename = (opts.database != NULL) ? opts.database : DRAGON_DATABASE;
+
+	if (opts.database == NULL && ! generate_database(filename))
+		exit(EXIT_FAILURE);
+
+	(void) slog(LG_INFO, "dragon: loading database %s", filename);
+
+	uint64_t start_ns = profile_time_ns();
+
+	runflags &= ~RF_LIVE;
+	(void) db_load(filename);
+	runflags |= RF_LIVE;
+
+	results.db_load_ns = profile_time_ns() - start_ns;
+
+	start_ns = profile_time_ns();
+	(void) db_save((void *)(uintptr_t) filename, DB_SAVE_BLOCKING);
+	results.db_save_ns = profile_time_ns() - start_ns;
+}
+
+static void
+phase_network(void)
+{
+	struct dragon_script burst = { NULL, 0, 0, 0 };
+	struct dragon_script leaf = { NULL, 0, 0, 0 };
+	struct dragon_script steady = { NULL, 0, 0, 0 };
+	char squit[BUFSIZE];
+
+	(void) slog(LG_INFO, "dragon: building network, please wait");
+
+	(void) build_burst(&burst);
+	(void) build_steady_state(&steady);
+
+	if (opts.servers > 1)
+		(void) build_server_burst(&leaf, opts.servers - 1U);
+
+	(void) pcommand_stats_reset();
+
+	const uint64_t bout = cnt.bout;
+
+	if (! uplink_connect_loopback(&dragon_peerfd))
+		exit(EXIT_FAILURE);
+
+	(void) slog(LG_INFO, "dragon: bursting %u lines", burst.lines);
+	(void) script_replay(&burst, &results.burst_in);
+
+	if (me.bursting)
+		(void) slog(LG_ERROR, "dragon: burst did not complete; is the protocol module TS6?");
+
+	results.burst_out.bytes = cnt.bout - bout;
+
+	const uint64_t start_ns = profile_time_ns();
+	results.burst_out.messages = uplink_loopback_drain(dragon_peerfd);
+	results.burst_out.ns = profile_time_ns() - start_ns;
+
+	results.handler_count = pcommand_stats_sorted(&results.handlers, true);
+
+	if (opts.servers > 1)
+	{
+		struct dragon_script split = { NULL, 0, 0, 0 };
+		const unsigned int users = cnt.user;
+
+		(void) snprintf(squit, sizeof squit, ":%s SQUIT %s :dragon netsplit", dragon_sid(0),
+		                dragon_sid(opts.servers - 1U));
+		(void) script_add(&split, "%s", squit);
+
+		(void) slog(LG_INFO, "dragon: splitting %s", dragon_sid(opts.servers - 1U));
+		(void) script_replay(&split, &results.netsplit);
+
+		results.split_users = users - cnt.user;
+
+		(void) uplink_loopback_drain(dragon_peerfd);
+		(void) script_replay(&leaf, &results.rejoin);
+		(void) uplink_loopback_drain(dragon_peerfd);
+		(void) script_free(&split);
+	}
+
+	(void) slog(LG_INFO, "dragon: replaying %u lines of steady state traffic", steady.lines);
+	(void) script_replay(&steady, &results.steady);
+	(void) uplink_loopback_drain(dragon_peerfd);
+
+	(void) script_free(&burst);
+	(void) script_free(&leaf);
+	(void) script_free(&steady);
+}
+
+static void
+json_string(FILE *const restrict out, const char *const restrict str)
+{
+	(void) fputc('"', out);
+
+	for (const char *p = str; *p; p++)
+	{
+		if (*p == '"' || *p == '\\')
+			(void) fprintf(out, "\\%c", *p);
+		else if ((unsigned char) *p < 0x20U)
+			(void) fprintf(out, "\\u%04x", (unsigned int) (unsigned char) *p);
+		else
+			(void) fputc(*p, out);
+	}
+
+	(void) fputc('"', out);
+}
+
+static double
+json_ms(const uint64_t ns)
+{
+	return (double) ns / 1000000.0;
+}
+
+static double
+json_rate(const uint64_t count, const uint64_t ns)
+{
+	return ns ? ((double) count * 1000000000.0 / (double) ns) : 0.0;
+}
+
+static void
+json_phase(FILE *const restrict out, const char *const restrict name, const struct dragon_phase *const restrict ph,
+           const bool last)
+{
+	(void) fprintf(out, "\t\"%s\": {\"messages\": %" PRIu64 ", \"bytes\": %" PRIu64 ", \"ms\": %.3f, "
+	                    "\"messages_per_sec\": %.1f, \"bytes_per_sec\": %.1f}%s\n", name, ph->messages, ph->bytes,
+	               json_ms(ph->ns), json_rate(ph->messages, ph->ns), json_rate(ph->bytes, ph->ns), last ? "" : ",");
+}
+
+static void
+write_results(FILE *const restrict out)
+{
+	(void) fprintf(out, "{\n\t\"version\": ");
+	(void) json_string(out, PACKAGE_VERSION);
+	(void) fprintf(out, ",\n\t\"serno\": ");
+	(void) json_string(out, SERNO);
+	(void) fprintf(out, ",\n\t\"protocol\": ");
+	(void) json_string(out, ircd->ircdname);
+	(void) fprintf(out, ",\n\t\"parameters\": {\"servers\": %u, \"users\": %u, \"channels\": %u, \"joins\": %u, "
+	                    "\"zipf\": %.3f, \"accounts\": %u, \"registered_channels\": %u, \"chanacs\": %u, "
+	                    "\"akicks\": %u, \"klines\": %u, \"messages\": %u, \"seed\": %u},\n", opts.servers,
+	               opts.users, opts.channels, opts.joins, opts.zipf, opts.accounts, opts.regchannels, opts.chanacs,
+	               opts.akicks, opts.klines, opts.messages, opts.seed);
+
+	(void) fprintf(out, "\t\"database\": {\"file\": ");
+	(void) json_string(out, (opts.database != NULL) ? opts.database : DRAGON_DATABASE);
+	(void) fprintf(out, ", \"rows_generated\": %" PRIu64 ", \"generate_ms\": %.3f, \"load_ms\": %.3f, "
+	                    "\"save_ms\": %.3f, \"accounts\": %u, \"channels\": %u, \"chanacs\": %u},\n",
+	               results.db_rows, json_ms(results.db_generate_ns), json_ms(results.db_load_ns),
+	               json_ms(results.db_save_ns), cnt.myuser, cnt.mychan, cnt.chanacs);
+
+	(void) fprintf(out, "\t\"network\": {\"users\": %u, \"channels\": %u, \"memberships\": %u, "
+	                    "\"split_users\": %u},\n", cnt.user, cnt.chan, cnt.chanuser, results.split_users);
+
+	(void) json_phase(out, "burst_in", &results.burst_in, false);
+	(void) json_phase(out, "burst_out", &results.burst_out, false);
+	(void) json_phase(out, "netsplit", &results.netsplit, false);
+	(void) json_phase(out, "rejoin", &results.rejoin, false);
+	(void) json_phase(out, "steady_state", &results.steady, false);
+
+	(void) fprintf(out, "\t\"burst_handlers\": [");
+
+	for (size_t i = 0; i < results.handler_count; i++)
+	{
+		const struct pcommand_stats *const ps = &results.handlers[i]->burst;
+
+		(void) fprintf(out, "%s\n\t\t{\"message\": ", i ? "," : "");
+		(void) json_string(out, results.handlers[i]->token);
+		(void) fprintf(out, ", \"count\": %" PRIu64 ", \"ms\": %.3f, \"hooks_ms\": %.3f}", ps->handler.calls,
+		               json_ms(ps->handler.total_ns), json_ms(ps->hook_ns));
+	}
+
+	(void) fprintf(out, "\n\t]\n}\n");
+}
+
 void
 bootstrap(void)
 {
@@ -38,15 +864,18 @@ conf_check(void)
 	return true;
 }
 
+/* --live: services burst a network of local clients to a real ircd, and the
+ * time until the ircd answers our PING after the burst is measured.
+ */
 void
 build_world(void)
 {
-	int i;
+	unsigned int i;
 	char userbuf[BUFSIZE];
 
-	for (i = 100000; i > 0; i--)
+	for (i = opts.users; i > 0; i--)
 	{
-		snprintf(userbuf, sizeof userbuf, "User%d", i);
+		snprintf(userbuf, sizeof userbuf, "User%u", i);
 		user_add(userbuf, "user", "localhost", NULL, NULL, ircd->uses_uid ? uid_get() : NULL, "User", me.me, CURRTIME);
 	}
 }
@@ -96,6 +925,9 @@ m_pong(struct sourceinfo *si, int parc, char *parv[])
 
 	slog(LG_INFO, "burst took %d msec", tv2ms(&te));
 
+	results.burst_out.messages = opts.users;
+	results.burst_out.ns = (uint64_t) tv2ms(&te) * UINT64_C(1000000);
+
 	runflags |= RF_SHUTDOWN;
 }
 
@@ -109,40 +941,97 @@ hijack_pong_handler(void)
 int
 main(int argc, char *argv[])
 {
+	FILE *out = stdout;
+
 	if (! libathemecore_early_init())
 		return EXIT_FAILURE;
 
+	if (! process_options(argc, argv))
+		return EXIT_FAILURE;
+
 	atheme_bootstrap();
-	atheme_init(argv[0], LOGDIR "/dbverify.log");
+	atheme_init(argv[0], LOGDIR "/dragon.log");
 	atheme_setup();
-	struct module *m;
-	unsigned int errcnt;
-	char *config_file = argv[1] != NULL ? argv[1] : "./dragon.conf";
 
 	runflags = RF_LIVE;
 	datadir = DATADIR;
 	strict_mode = false;
 	cold_start = true;
+	dragon_rand_state = opts.seed ? opts.seed : 1;
 
-	slog(LG_INFO, "dragon: an ircd linking performance benchmark");
-	slog(LG_INFO, "atheme.org, 2013");
+	slog(LG_INFO, "dragon: a synthetic network benchmark");
+
+	// Synthetic traffic has no place in the configured capture file
+	capture_suppressed = true;
+
+	if (! conf_parse(opts.config))
+		return EXIT_FAILURE;
 
-	conf_parse(config_file);
 	bootstrap();
 
 	slog(LG_INFO, "link implementation: %s @%p", ircd->ircdname, ircd);
 
-	hijack_pong_handler();
+	if (uplinks.head == NULL)
+	{
+		slog(LG_ERROR, "dragon: no uplink configured in %s", opts.config);
+		return EXIT_FAILURE;
+	}
+
+	if (opts.output != NULL && ! (out = fopen(opts.output, "w")))
+	{
+		slog(LG_ERROR, "dragon: cannot open %s: %s", opts.output, strerror(errno));
+		return EXIT_FAILURE;
+	}
 
 	mowgli_eventloop_synchronize(base_eventloop);
 	CURRTIME = mowgli_eventloop_get_time(base_eventloop);
+	dragon_ts = CURRTIME - SECONDS_PER_DAY;
 
-	phase_buildworld();
-	uplink_connect();
+	if (opts.live)
+	{
+		hijack_pong_handler();
+		phase_buildworld();
+		uplink_connect();
+
+		slog(LG_INFO, "uplink: %s @%p", curr_uplink->name, curr_uplink);
+
+		io_loop();
+
+		(void) fprintf(out, "{\n\t\"version\": ");
+		(void) json_string(out, PACKAGE_VERSION);
+		(void) fprintf(out, ",\n\t\"protocol\": ");
+		(void) json_string(out, ircd->ircdname);
+		(void) fprintf(out, ",\n\t\"live\": {\"users\": %u, \"burst_ms\": %.3f}\n}\n", opts.users,
+		               json_ms(results.burst_out.ns));
+	}
+	else
+	{
+		if (! ircd->uses_uid || ! pcommand_find("UID") || ! pcommand_find("SJOIN") || ! pcommand_find("SID"))
+		{
+			slog(LG_ERROR, "dragon: the synthetic network speaks TS6; please load a TS6 protocol module");
+			return EXIT_FAILURE;
+		}
+
+		if (! backend_loaded)
+		{
+			slog(LG_ERROR, "dragon: please load a database backend (e.g. backend/opensex)");
+			return EXIT_FAILURE;
+		}
+
+		(void) build_sids();
+		(void) build_channel_sizes();
+		(void) phase_database();
+		(void) phase_network();
+		(void) write_results(out);
+	}
 
-	slog(LG_INFO, "uplink: %s @%p", curr_uplink->name, curr_uplink);
+	if (out != stdout)
+		(void) fclose(out);
 
-	io_loop();
+	(void) sfree(results.handlers);
+	(void) sfree(chansize);
+	(void) sfree(chanoff);
+	(void) sfree(sids);
 
 	return EXIT_SUCCESS;
 }
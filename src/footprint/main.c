@@ -4,77 +4,370 @@
  *
  * Copyright (C) 2005-2010 William Pitcock <nenolod@dereferenced.org>
  *
- * Initialization stub for libathemecore.
+ * Measures the memory footprint of services state.
+ *
+ * A database is loaded through the opensex backend and a synthetic network
+ * (servers, users, channels and memberships) is built on top of it; every
+ * step is measured as the change in bytes allocated from the heap, so that
+ * block allocator slack, shared strings, metadata and index nodes are all
+ * accounted for, rather than multiplying sizeof by a guess.
  */
 
 #include <atheme.h>
 #include <atheme/libathemecore.h>
 
-int
-main(int argc, char *argv[])
+#ifdef __GLIBC__
+#  include <malloc.h>
+#endif
+
+static const struct cmode footprint_prefix_modes[] = {
+	{ '@', CSTATUS_OP    },
+	{ '+', CSTATUS_VOICE },
+	{ '\0', 0 }
+};
+
+static size_t
+heap_in_use(void)
 {
-	if (! libathemecore_early_init())
-		return EXIT_FAILURE;
+#if defined(__GLIBC__) && defined(__GLIBC_PREREQ)
+#  if __GLIBC_PREREQ(2, 33)
+	const struct mallinfo2 mi = mallinfo2();
+
+	return mi.uordblks + mi.hblkhd;
+#  else
+	const struct mallinfo mi = mallinfo();
+
+	return (size_t) (unsigned int) mi.uordblks + (size_t) (unsigned int) mi.hblkhd;
+#  endif
+#else
+	return 0;
+#endif
+}
+
+static bool
+heap_stats_available(void)
+{
+#ifdef __GLIBC__
+	return true;
+#else
+	return false;
+#endif
+}
+
+static size_t
+heap_delta(const size_t before, const size_t after)
+{
+	return (after > before) ? (after - before) : (before - after);
+}
+
+static void
+report(const char *const what, const size_t bytes, const unsigned int count, const size_t structsize)
+{
+	if (! count)
+	{
+		(void) printf("%-24s %10u\n", what, count);
+		return;
+	}
+
+	(void) printf("%-24s %10u  %12zu B  %8.1f B/each  (sizeof %zu B)\n", what, count, bytes,
+	              (double) bytes / count, structsize);
+}
+
+/* Rebuilds an index into a scratch patricia with the same canonizer and
+ * reports how much memory the copy takes; this is the cost of the index
+ * itself, excluding the objects it points at.
+ */
+static void
+report_index(const char *const what, mowgli_patricia_t *const index, void (*canon)(char *),
+             const char *(*keyof)(void *))
+{
+	mowgli_patricia_iteration_state_t state;
+	void *elem;
+	unsigned int count = 0;
+
+	const size_t before = heap_in_use();
+	mowgli_patricia_t *const scratch = mowgli_patricia_create(canon);
+
+	MOWGLI_PATRICIA_FOREACH(elem, &state, index)
+	{
+		const char *const key = keyof(elem);
+
+		if (key != NULL && mowgli_patricia_add(scratch, key, elem))
+			count++;
+	}
+
+	const size_t bytes = heap_delta(before, heap_in_use());
+
+	(void) mowgli_patricia_destroy(scratch, NULL, NULL);
+
+	(void) report(what, bytes, count, 0);
+}
+
+static const char *
+key_user_nick(void *const elem)
+{
+	return ((struct user *) elem)->nick;
+}
+
+static const char *
+key_user_uid(void *const elem)
+{
+	return ((struct user *) elem)->uid;
+}
+
+static const char *
+key_channel(void *const elem)
+{
+	return ((struct channel *) elem)->name;
+}
+
+static const char *
+key_server(void *const elem)
+{
+	return ((struct server *) elem)->name;
+}
+
+static const char *
+key_mynick(void *const elem)
+{
+	return ((struct mynick *) elem)->nick;
+}
+
+static const char *
+key_mychan(void *const elem)
+{
+	return ((struct mychan *) elem)->name;
+}
+
+static void
+handle_mdep(struct database_handle *db, const char *type)
+{
+	const char *modname = db_sread_word(db);
+
+	if (! module_request(modname))
+		exit(EXIT_FAILURE);
+}
 
-	unsigned int usercount = 0, channelcount = 0, membercount = 0,
-		klinecount = 0, qlinecount = 0, xlinecount = 0, regchannelcount = 0,
-		servercount = 0, regusercount = 0;
+static void
+measure_database(const char *const filename)
+{
+	mowgli_patricia_iteration_state_t state;
+	struct myentity_iteration_state estate;
+	struct myentity *mt;
+	struct mychan *mc;
+	mowgli_list_t doomed = { NULL, NULL, 0 };
+	mowgli_node_t *n, *tn;
+	size_t before;
+
+	(void) printf("* * * database: %s\n\n", filename);
+
+	before = heap_in_use();
+
+	runflags &= ~RF_LIVE;
+	(void) db_load(filename);
+	runflags |= RF_LIVE;
+
+	(void) report("database (total)", heap_delta(before, heap_in_use()), cnt.myuser + cnt.mychan, 0);
+
+	const unsigned int myusers = cnt.myuser;
+	const unsigned int mynicks = cnt.mynick;
+	const unsigned int mychans = cnt.mychan;
+	const unsigned int chanacs = cnt.chanacs;
+	unsigned int colds = 0;
+
+	MYENTITY_FOREACH_T(mt, &estate, ENT_USER)
+		if (user(mt)->cold != NULL)
+			colds++;
+
+	(void) printf("\n");
+	(void) printf("%u of %u accounts have a cold extension (sizeof %zu B)\n\n", colds, myusers,
+	              sizeof(struct myuser_cold));
+
+	(void) report_index("index: nicklist", nicklist, irccasecanon, &key_mynick);
+	(void) report_index("index: mclist", mclist, irccasecanon, &key_mychan);
+
+	(void) printf("\n");
+
+	/* Tear the database down again type by type; what each step frees is
+	 * what that type of object actually costs, including its chanacs,
+	 * nicks, memos, metadata and index entries.
+	 */
+	MOWGLI_PATRICIA_FOREACH(mc, &state, mclist)
+		(void) mowgli_node_add(mc, mowgli_node_create(), &doomed);
+
+	before = heap_in_use();
+
+	MOWGLI_ITER_FOREACH_SAFE(n, tn, doomed.head)
+	{
+		(void) atheme_object_unref(n->data);
+		(void) mowgli_node_delete(n, &doomed);
+		(void) mowgli_node_free(n);
+	}
+
+	(void) report("mychan (+chanacs)", heap_delta(before, heap_in_use()), mychans, sizeof(struct mychan));
+	(void) printf("%-24s %10u                                (sizeof %zu B)\n", "  of which chanacs",
+	              chanacs, sizeof(struct chanacs));
+
+	MYENTITY_FOREACH_T(mt, &estate, ENT_USER)
+		(void) mowgli_node_add(mt, mowgli_node_create(), &doomed);
+
+	before = heap_in_use();
+
+	MOWGLI_ITER_FOREACH_SAFE(n, tn, doomed.head)
+	{
+		(void) atheme_object_unref(n->data);
+		(void) mowgli_node_delete(n, &doomed);
+		(void) mowgli_node_free(n);
+	}
+
+	(void) report("myuser (+mynick)", heap_delta(before, heap_in_use()), myusers, sizeof(struct myuser));
+	(void) printf("%-24s %10u                                (sizeof %zu B)\n", "  of which mynick",
+	              mynicks, sizeof(struct mynick));
+	(void) printf("\n");
+}
+
+static void
+measure_network(const unsigned int nservers, const unsigned int nusers, const unsigned int nchans,
+                const unsigned int nmembers)
+{
+	struct server **servers = scalloc(nservers, sizeof *servers);
+	char name[BUFSIZE];
+	char id[BUFSIZE];
+	size_t before;
 	unsigned int i;
 
-	/* make up some statistics */
-	srand(time(NULL));
+	(void) printf("* * * synthetic network\n\n");
+
+	prefix_mode_list = footprint_prefix_modes;
+
+	before = heap_in_use();
+
+	for (i = 0; i < nservers; i++)
+	{
+		(void) snprintf(name, sizeof name, "irc%u.footprint.test", i);
+		(void) snprintf(id, sizeof id, "%u%c%c", i % 10U, 'A' + (i / 10U) % 26U, 'A' + (i / 260U) % 26U);
+
+		servers[i] = server_add(name, 1, NULL, id, "footprint");
+	}
+
+	(void) report("server", heap_delta(before, heap_in_use()), cnt.server, sizeof(struct server));
 
-	servercount = (rand() % 30) + 1;
+	before = heap_in_use();
 
-	for (i = 0; i < servercount; i++)
-		usercount += ((rand() % 6000) + 1);
+	for (i = 0; i < nusers; i++)
+	{
+		struct server *const s = servers[i % nservers];
+		char host[BUFSIZE];
+		char ip[BUFSIZE];
 
-	channelcount = usercount / servercount;
-	membercount = (usercount + channelcount) * ((rand() % 3) + 1);
-	regchannelcount = channelcount * 0.65;
-	regusercount = usercount * 0.65;
+		(void) snprintf(name, sizeof name, "User%u", i);
+		(void) snprintf(id, sizeof id, "%s%06u", s->sid, i);
+		(void) snprintf(host, sizeof host, "host%u.users.footprint.test", i);
+		(void) snprintf(ip, sizeof ip, "10.%u.%u.%u", (i >> 16) & 0xFFU, (i >> 8) & 0xFFU, i & 0xFFU);
 
-	/* 5% of users are probably misbehaving in some way... */
-	klinecount = xlinecount = qlinecount = (usercount * 0.05);
+		(void) user_add(name, "~user", host, NULL, ip, id, "footprint user", s, CURRTIME);
+	}
 
-	printf("footprint for atheme %s (%s)\n", PACKAGE_VERSION, SERNO);
+	(void) report("user", heap_delta(before, heap_in_use()), cnt.user, sizeof(struct user));
 
-	printf("\n* * *\n\n");
+	before = heap_in_use();
 
-	printf("%u servers\n", servercount);
-	printf("%u users\n", usercount);
-	printf("%u registered users\n", regusercount);
-	printf("%u channels\n", channelcount);
-	printf("%u registered channels\n", regchannelcount);
-	printf("%u memberships\n", membercount);
-	printf("%u klines / xlines / qlines\n", klinecount);
+	for (i = 0; i < nchans; i++)
+	{
+		(void) snprintf(name, sizeof name, "#channel%u", i);
+		(void) channel_add(name, CURRTIME, servers[i % nservers]);
+	}
 
-	printf("\n* * *\n\n");
+	(void) report("channel", heap_delta(before, heap_in_use()), cnt.chan, sizeof(struct channel));
 
-	printf("sizeof object_t: %zu B\n", sizeof(struct atheme_object));
+	before = heap_in_use();
 
-	printf("\n* * *\n\n");
+	for (i = 0; nchans && nusers && i < nmembers; i++)
+	{
+		/* Skew memberships towards low-numbered channels, like real networks */
+		const unsigned int chan = (i % nchans) / (1U + (i % 4U));
+		struct channel *c;
 
-	printf("sizeof myentity_t: %zu B --> %zu KB\n", sizeof(struct myentity), (regusercount * sizeof(struct myentity)) / 1024);
-	printf("sizeof myuser_t: %zu B --> %zu KB\n", sizeof(struct myuser), (regusercount * sizeof(struct myuser)) / 1024);
-	printf("sizeof mychan_t: %zu B --> %zu KB\n", sizeof(struct mychan), (regchannelcount * sizeof(struct mychan)) / 1024);
-	printf("sizeof mynick_t: %zu B --> %zu KB\n", sizeof(struct mynick), (regusercount * sizeof(struct mynick)) / 1024);
+		(void) snprintf(name, sizeof name, "#channel%u", chan);
 
-	printf("\n* * *\n\n");
+		if (! (c = channel_find(name)))
+			continue;
+
+		(void) snprintf(name, sizeof name, "%sUser%u", (i % 8U) ? "" : "@", i % nusers);
+
+		(void) chanuser_add(c, name);
+	}
+
+	(void) report("chanuser", heap_delta(before, heap_in_use()), cnt.chanuser, sizeof(struct chanuser));
+
+	(void) printf("\n");
+
+	(void) report_index("index: userlist", userlist, irccasecanon, &key_user_nick);
+	(void) report_index("index: uidlist", uidlist, noopcanon, &key_user_uid);
+	(void) report_index("index: chanlist", chanlist, irccasecanon, &key_channel);
+	(void) report_index("index: servlist", servlist, irccasecanon, &key_server);
+
+	(void) printf("\n");
+
+	sfree(servers);
+}
+
+static unsigned int
+arg_uint(const char *const arg, const unsigned int def)
+{
+	unsigned int val;
+
+	if (arg == NULL || ! string_to_uint(arg, &val))
+		return def;
+
+	return val;
+}
+
+int
+main(int argc, char *argv[])
+{
+	if (! libathemecore_early_init())
+		return EXIT_FAILURE;
+
+	atheme_bootstrap();
+	atheme_init(argv[0], LOGDIR "/footprint.log");
+	atheme_setup();
+
+	runflags = RF_LIVE;
+	datadir = DATADIR;
+	strict_mode = false;
+	offline_mode = true;
+
+	/* atheme-footprint [database [servers [users [channels [memberships]]]]] */
+	const char *const filename = (argc > 1) ? argv[1] : NULL;
+	const unsigned int nservers = arg_uint((argc > 2) ? argv[2] : NULL, 20);
+	const unsigned int nusers = arg_uint((argc > 3) ? argv[3] : NULL, 50000);
+	const unsigned int nchans = arg_uint((argc > 4) ? argv[4] : NULL, nusers / 4);
+	const unsigned int nmembers = arg_uint((argc > 5) ? argv[5] : NULL, nusers * 3);
+
+	(void) printf("footprint for atheme %s (%s)\n\n", PACKAGE_VERSION, SERNO);
+
+	if (! nservers)
+	{
+		(void) fprintf(stderr, "usage: %s [database [servers [users [channels [memberships]]]]]\n", argv[0]);
+		return EXIT_FAILURE;
+	}
 
-	printf("sizeof user_t: %zu B --> %zu KB\n", sizeof(struct user), (usercount * sizeof(struct user)) / 1024);
-	printf("sizeof channel_t: %zu B --> %zu KB\n", sizeof(struct channel), (channelcount * sizeof(struct channel)) / 1024);
-	printf("sizeof chanuser_t: %zu B --> %zu KB\n", sizeof(struct chanuser), (membercount * sizeof(struct chanuser)) / 1024);
+	if (! heap_stats_available())
+		(void) printf("warning: heap statistics are not available on this platform; byte counts are zero\n\n");
 
-	printf("\n* * *\n\n");
+	if (filename != NULL)
+	{
+		if (! module_load("backend/opensex"))
+			return EXIT_FAILURE;
 
-	printf("sizeof kline_t: %zu B --> %zu KB\n", sizeof(struct kline), (klinecount * sizeof(struct kline)) / 1024);
-	printf("sizeof xline_t: %zu B --> %zu KB\n", sizeof(struct xline), (xlinecount * sizeof(struct xline)) / 1024);
-	printf("sizeof qline_t: %zu B --> %zu KB\n", sizeof(struct qline), (qlinecount * sizeof(struct qline)) / 1024);
+		db_unregister_type_handler("MDEP");
+		db_register_type_handler("MDEP", handle_mdep);
 
-	printf("\n* * *\n\n");
+		(void) measure_database(filename);
+	}
 
-	printf("sizeof server_t: %zu B --> %zu KB\n", sizeof(struct server), (servercount * sizeof(struct server)) / 1024);
+	(void) measure_network(nservers, nusers, nchans, nmembers);
 
 	return EXIT_SUCCESS;
 }
@@ -0,0 +1,431 @@
+/*
+ * SPDX-License-Identifier: ISC
+ * SPDX-URL: https://spdx.org/licenses/ISC.html
+ *
+ * Copyright (C) 2026 Atheme Development Group (https://atheme.github.io/)
+ *
+ * Permission to use, copy, modify, and/or distribute this software for any
+ * purpose with or without fee is hereby granted, provided that the above
+ * copyright notice and this permission notice appear in all copies.
+ *
+ * hashbench: compares the hash tables of the global indexes to patricia.
+ *
+ * For every size given, that many nickname-like keys are inserted into a
+ * case-insensitive hash table and into a patricia created with irccasecanon
+ * (like userlist), then looked up in random order with their case changed,
+ * looked up again with keys that are not there, and deleted. The time per
+ * operation of each phase and the memory taken by each structure are written
+ * as JSON to standard output (or to --output); see doc/BENCHMARKS.
+ */
+
+#include <atheme.h>
+#include <atheme/libathemecore.h>
+
+#include <ext/getopt_long.h>
+
+#ifdef __GLIBC__
+#  include <malloc.h>
+#endif
+
+#define HASHBENCH_MAX_SIZES     16U
+#define HASHBENCH_KEYLEN        16U
+
+struct hashbench_options
+{
+	const char *    output;
+	unsigned int    sizes[HASHBENCH_MAX_SIZES];
+	unsigned int    nsizes;
+	unsigned int    lookups;
+	unsigned int    seed;
+};
+
+struct hashbench_result
+{
+	uint64_t        insert_ns;
+	uint64_t        hit_ns;
+	uint64_t        miss_ns;
+	uint64_t        delete_ns;
+	size_t          bytes;
+};
+
+// The structure under test, behind the same four operations
+struct hashbench_ops
+{
+	const char *    name;
+	void *        (*create)(void);
+	void          (*add)(void *index, const char *key, void *value);
+	void *        (*retrieve)(void *index, const char *key);
+	void          (*delete)(void *index, const char *key);
+	void          (*destroy)(void *index);
+};
+
+static struct hashbench_options opts = {
+	.output         = NULL,
+	.sizes          = { 100000, 1000000, 5000000 },
+	.nsizes         = 3,
+	.lookups        = 1000000,
+	.seed           = 1,
+};
+
+static unsigned int hashbench_rand_state = 1;
+
+static const mowgli_getopt_option_t hashbench_long_opts[] = {
+	{    "help",       no_argument, NULL, 'h', 0 },
+	{ "lookups", required_argument, NULL, 'l', 0 },
+	{  "output", required_argument, NULL, 'o', 0 },
+	{    "seed", required_argument, NULL, 'r', 0 },
+	{   "sizes", required_argument, NULL, 's', 0 },
+	{ NULL, 0, NULL, 0, 0 },
+};
+
+static void
+print_usage(const char *const progname)
+{
+	(void) fprintf(stderr, "Usage: %s [options]\n"
+	                       "\n"
+	                       "  -l, --lookups=N       lookups per phase (default %u)\n"
+	                       "  -o, --output=FILE     write the results here instead of standard output\n"
+	                       "  -r, --seed=N          random seed (default %u)\n"
+	                       "  -s, --sizes=N[,N...]  numbers of keys (default 100000,1000000,5000000)\n",
+	               progname, opts.lookups, opts.seed);
+}
+
+static bool
+parse_sizes(const char *const restrict arg)
+{
+	char buf[BUFSIZE];
+	char *saveptr = NULL;
+
+	(void) mowgli_strlcpy(buf, arg, sizeof buf);
+
+	opts.nsizes = 0;
+
+	for (char *tok = strtok_r(buf, ",", &saveptr); tok != NULL; tok = strtok_r(NULL, ",", &saveptr))
+	{
+		if (opts.nsizes == HASHBENCH_MAX_SIZES)
+			return false;
+
+		if (! string_to_uint(tok, &opts.sizes[opts.nsizes]) || ! opts.sizes[opts.nsizes])
+			return false;
+
+		opts.nsizes++;
+	}
+
+	return opts.nsizes != 0;
+}
+
+static bool
+process_options(int argc, char *argv[])
+{
+	char short_opts[BUFSIZE];
+	char *ptr = short_opts;
+	int c;
+
+	(void) memset(short_opts, 0x00, sizeof short_opts);
+
+	for (size_t x = 0; hashbench_long_opts[x].name != NULL; x++)
+	{
+		*ptr++ = hashbench_long_opts[x].val;
+
+		if (hashbench_long_opts[x].has_arg != no_argument)
+			*ptr++ = ':';
+	}
+
+	while ((c = mowgli_getopt_long(argc, argv, short_opts, hashbench_long_opts, NULL)) != -1)
+	{
+		unsigned int *uval = NULL;
+
+		switch (c)
+		{
+			case 'h':
+				(void) print_usage(argv[0]);
+				exit(EXIT_SUCCESS);
+
+			case 'o':
+				opts.output = mowgli_optarg;
+				break;
+
+			case 's':
+				if (! parse_sizes(mowgli_optarg))
+				{
+					(void) fprintf(stderr, "'%s' is not a valid list of sizes\n", mowgli_optarg);
+					return false;
+				}
+				break;
+
+			case 'l': uval = &opts.lookups;         break;
+			case 'r': uval = &opts.seed;            break;
+
+			default:
+				(void) print_usage(argv[0]);
+				return false;
+		}
+
+		if (uval != NULL && ! string_to_uint(mowgli_optarg, uval))
+		{
+			(void) fprintf(stderr, "'%s' is not a valid value for integer option '%c'\n", mowgli_optarg, c);
+			return false;
+		}
+	}
+
+	if (mowgli_optind != argc)
+	{
+		(void) print_usage(argv[0]);
+		return false;
+	}
+
+	return true;
+}
+
+static unsigned int
+hashbench_rand(void)
+{
+	// xorshift32; reproducible across platforms for a given --seed
+	hashbench_rand_state ^= hashbench_rand_state << 13;
+	hashbench_rand_state ^= hashbench_rand_state >> 17;
+	hashbench_rand_state ^= hashbench_rand_state << 5;
+
+	return hashbench_rand_state;
+}
+
+static size_t
+heap_in_use(void)
+{
+#if defined(__GLIBC__) && defined(__GLIBC_PREREQ)
+#  if __GLIBC_PREREQ(2, 33)
+	const struct mallinfo2 mi = mallinfo2();
+
+	return mi.uordblks + mi.hblkhd;
+#  else
+	const struct mallinfo mi = mallinfo();
+
+	return (size_t) (unsigned int) mi.uordblks + (size_t) (unsigned int) mi.hblkhd;
+#  endif
+#else
+	return 0;
+#endif
+}
+
+/* Keys look like nicknames: a few random nick characters, followed by the
+ * index in base 36 so that they are unique. Lookups that miss use the same
+ * shape with a character no key contains.
+ */
+static void
+make_key(char *const restrict key, const unsigned int index, const bool miss)
+{
+	static const char nickchars[] = "abcdefghijklmnopqrstuvwxyz[]\\^_`{|}-";
+	static const char digits[] = "0123456789abcdefghijklmnopqrstuvwxyz";
+
+	const unsigned int prefix = 3U + (hashbench_rand() % 5U);
+	unsigned int n = index;
+	size_t len = 0;
+
+	for (unsigned int i = 0; i < prefix; i++)
+		key[len++] = nickchars[hashbench_rand() % (sizeof nickchars - 1U)];
+
+	if (miss)
+		key[len++] = '*';
+
+	do
+	{
+		key[len++] = digits[n % 36U];
+		n /= 36U;
+	}
+	while (n);
+
+	key[len] = '\0';
+}
+
+// The same key in a different case, as a client might send it
+static void
+recase_key(char *const restrict dst, const char *const restrict src)
+{
+	for (size_t i = 0; (dst[i] = src[i]) != '\0'; i++)
+		if (hashbench_rand() & 1U)
+			dst[i] = (char) ToUpper(src[i]);
+}
+
+static void *
+hashmap_op_create(void)
+{
+	return hashmap_create(true);
+}
+
+static void
+hashmap_op_add(void *const index, const char *const key, void *const value)
+{
+	(void) hashmap_add(index, key, value);
+}
+
+static void *
+hashmap_op_retrieve(void *const index, const char *const key)
+{
+	return hashmap_retrieve(index, key);
+}
+
+static void
+hashmap_op_delete(void *const index, const char *const key)
+{
+	(void) hashmap_delete(index, key);
+}
+
+static void
+hashmap_op_destroy(void *const index)
+{
+	(void) hashmap_destroy(index);
+}
+
+static void *
+patricia_op_create(void)
+{
+	return mowgli_patricia_create(irccasecanon);
+}
+
+static void
+patricia_op_add(void *const index, const char *const key, void *const value)
+{
+	(void) mowgli_patricia_add(index, key, value);
+}
+
+static void *
+patricia_op_retrieve(void *const index, const char *const key)
+{
+	return mowgli_patricia_retrieve(index, key);
+}
+
+static void
+patricia_op_delete(void *const index, const char *const key)
+{
+	(void) mowgli_patricia_delete(index, key);
+}
+
+static void
+patricia_op_destroy(void *const index)
+{
+	(void) mowgli_patricia_destroy(index, NULL, NULL);
+}
+
+static const struct hashbench_ops hashbench_structures[] = {
+	{ "hashmap",  &hashmap_op_create,  &hashmap_op_add,  &hashmap_op_retrieve,  &hashmap_op_delete,  &hashmap_op_destroy  },
+	{ "patricia", &patricia_op_create, &patricia_op_add, &patricia_op_retrieve, &patricia_op_delete, &patricia_op_destroy },
+};
+
+static void
+run_one(const struct hashbench_ops *const restrict ops, const unsigned int size, char (*const keys)[HASHBENCH_KEYLEN],
+        char (*const hits)[HASHBENCH_KEYLEN], char (*const misses)[HASHBENCH_KEYLEN],
+        struct hashbench_result *const restrict res)
+{
+	const size_t before = heap_in_use();
+	void *const index = ops->create();
+	unsigned int found = 0;
+	uint64_t start;
+
+	start = profile_time_ns();
+
+	for (unsigned int i = 0; i < size; i++)
+		(void) ops->add(index, keys[i], keys[i]);
+
+	res->insert_ns = profile_time_ns() - start;
+	res->bytes = heap_in_use() - before;
+
+	start = profile_time_ns();
+
+	for (unsigned int i = 0; i < opts.lookups; i++)
+		if (ops->retrieve(index, hits[i]) != NULL)
+			found++;
+
+	res->hit_ns = profile_time_ns() - start;
+
+	start = profile_time_ns();
+
+	for (unsigned int i = 0; i < opts.lookups; i++)
+		if (ops->retrieve(index, misses[i]) != NULL)
+			found++;
+
+	res->miss_ns = profile_time_ns() - start;
+
+	if (found != opts.lookups)
+		(void) fprintf(stderr, "hashbench: %s found %u of %u keys\n", ops->name, found, opts.lookups);
+
+	start = profile_time_ns();
+
+	for (unsigned int i = 0; i < size; i++)
+		(void) ops->delete(index, keys[i]);
+
+	res->delete_ns = profile_time_ns() - start;
+
+	(void) ops->destroy(index);
+}
+
+static double
+ns_per_op(const uint64_t ns, const unsigned int ops)
+{
+	return ops ? ((double) ns / (double) ops) : 0.0;
+}
+
+int
+main(int argc, char *argv[])
+{
+	FILE *out = stdout;
+
+	if (! libathemecore_early_init())
+		return EXIT_FAILURE;
+
+	if (! process_options(argc, argv))
+		return EXIT_FAILURE;
+
+	if (opts.output != NULL && ! (out = fopen(opts.output, "w")))
+	{
+		(void) fprintf(stderr, "hashbench: cannot open %s: %s\n", opts.output, strerror(errno));
+		return EXIT_FAILURE;
+	}
+
+	(void) fprintf(out, "{\n\t\"lookups\": %u,\n\t\"seed\": %u,\n\t\"results\": [", opts.lookups, opts.seed);
+
+	for (unsigned int s = 0; s < opts.nsizes; s++)
+	{
+		const unsigned int size = opts.sizes[s];
+
+		char (*const keys)[HASHBENCH_KEYLEN] = smalloc(size * sizeof *keys);
+		char (*const hits)[HASHBENCH_KEYLEN] = smalloc(opts.lookups * sizeof *hits);
+		char (*const misses)[HASHBENCH_KEYLEN] = smalloc(opts.lookups * sizeof *misses);
+
+		hashbench_rand_state = opts.seed ? opts.seed : 1;
+
+		for (unsigned int i = 0; i < size; i++)
+			(void) make_key(keys[i], i, false);
+
+		for (unsigned int i = 0; i < opts.lookups; i++)
+		{
+			(void) recase_key(hits[i], keys[hashbench_rand() % size]);
+			(void) make_key(misses[i], hashbench_rand() % size, true);
+		}
+
+		for (size_t n = 0; n < ARRAY_SIZE(hashbench_structures); n++)
+		{
+			const struct hashbench_ops *const ops = &hashbench_structures[n];
+			struct hashbench_result res;
+
+			(void) fprintf(stderr, "hashbench: %s, %u keys\n", ops->name, size);
+			(void) run_one(ops, size, keys, hits, misses, &res);
+
+			(void) fprintf(out, "%s\n\t\t{\"structure\": \"%s\", \"keys\": %u, \"insert_ns\": %.1f, "
+			                    "\"hit_ns\": %.1f, \"miss_ns\": %.1f, \"delete_ns\": %.1f, "
+			                    "\"bytes_per_key\": %.1f}", (s || n) ? "," : "", ops->name, size,
+			               ns_per_op(res.insert_ns, size), ns_per_op(res.hit_ns, opts.lookups),
+			               ns_per_op(res.miss_ns, opts.lookups), ns_per_op(res.delete_ns, size),
+			               (double) res.bytes / (double) size);
+		}
+
+		(void) sfree(keys);
+		(void) sfree(hits);
+		(void) sfree(misses);
+	}
+
+	(void) fprintf(out, "\n\t]\n}\n");
+
+	if (out != stdout)
+		(void) fclose(out);
+
+	return EXIT_SUCCESS;
+}
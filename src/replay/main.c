@@ -0,0 +1,491 @@
+/*
+ * SPDX-License-Identifier: ISC
+ * SPDX-URL: https://spdx.org/licenses/ISC.html
+ *
+ * Copyright (C) 2026 Atheme Development Group (https://atheme.github.io/)
+ *
+ * Permission to use, copy, modify, and/or distribute this software for any
+ * purpose with or without fee is hereby granted, provided that the above
+ * copyright notice and this permission notice appear in all copies.
+ *
+ * replay: replays recorded uplink traffic into services.
+ *
+ * A capture file written by services with general::uplink_capture set is
+ * fed, line by line, through the protocol module's parser over a socketpair
+ * standing in for the uplink, either as fast as possible or paced like it
+ * was recorded. Every connection in the capture is split into a burst phase
+ * and a steady state phase, and the throughput and per-line latency of each
+ * phase is written as JSON to standard output (or to --output), so that it
+ * can be compared between builds; see doc/BENCHMARKS.
+ *
+ * Nothing is written to the database, and the event loop does not run, so
+ * timers (expiry, enforcement, and so on) never fire.
+ */
+
+#include <atheme.h>
+#include <atheme/libathemecore.h>
+
+#include <ext/getopt_long.h>
+
+struct replay_options
+{
+	const char *    config;
+	const char *    database;
+	const char *    capture;
+	const char *    output;
+	bool            no_database;
+	bool            paced;
+	double          speed;
+};
+
+struct replay_phase
+{
+	const char *            name;           // "burst" or "steady_state"
+	unsigned int            connection;
+	uint64_t                messages;
+	uint64_t                bytes;
+	uint64_t                replies;        // lines services sent back
+	uint64_t                captured_ns;
+	uint64_t                wall_ns;
+	uint64_t                max_lag_ns;     // how far a paced replay fell behind
+	bool                    complete;       // the burst ended (or the phase was cut short)
+	struct profile_counter  latency;        // time spent in parse() per line
+};
+
+static struct replay_options opts = {
+	.config         = SYSCONFDIR "/atheme.conf",
+	.database       = NULL,
+	.capture        = NULL,
+	.output         = NULL,
+	.no_database    = false,
+	.paced          = false,
+	.speed          = 1.0,
+};
+
+static struct replay_phase *phases = NULL;
+static size_t phase_count = 0;
+static size_t phase_alloc = 0;
+static uint64_t skipped_lines = 0;
+static int replay_peerfd = -1;
+
+static const mowgli_getopt_option_t replay_long_opts[] = {
+	{        "help",       no_argument, NULL, 'h', 0 },
+	{      "config", required_argument, NULL, 'c', 0 },
+	{    "database", required_argument, NULL, 'd', 0 },
+	{ "no-database",       no_argument, NULL, 'n', 0 },
+	{      "output", required_argument, NULL, 'o', 0 },
+	{        "pace", optional_argument, NULL, 'p', 0 },
+	{ NULL, 0, NULL, 0, 0 },
+};
+
+static void
+print_usage(const char *const progname)
+{
+	(void) fprintf(stderr, "Usage: %s [options] capture-file\n"
+	                       "\n"
+	                       "  -c, --config=FILE     configuration file (default %s)\n"
+	                       "  -d, --database=NAME   load this database (relative to the data directory)\n"
+	                       "                        instead of the backend's default\n"
+	                       "  -n, --no-database     do not load a database\n"
+	                       "  -o, --output=FILE     write the results here instead of standard output\n"
+	                       "  -p, --pace[=SPEED]    replay with the recorded timing, optionally SPEED\n"
+	                       "                        times faster (default: as fast as possible)\n",
+	               progname, opts.config);
+}
+
+static bool
+process_options(int argc, char *argv[])
+{
+	char short_opts[BUFSIZE];
+	char *ptr = short_opts;
+	int c;
+
+	(void) memset(short_opts, 0x00, sizeof short_opts);
+
+	for (size_t x = 0; replay_long_opts[x].name != NULL; x++)
+	{
+		*ptr++ = replay_long_opts[x].val;
+
+		if (replay_long_opts[x].has_arg == no_argument)
+			continue;
+
+		*ptr++ = ':';
+
+		if (replay_long_opts[x].has_arg == optional_argument)
+			*ptr++ = ':';
+	}
+
+	while ((c = mowgli_getopt_long(argc, argv, short_opts, replay_long_opts, NULL)) != -1)
+	{
+		switch (c)
+		{
+			case 'h':
+				(void) print_usage(argv[0]);
+				exit(EXIT_SUCCESS);
+
+			case 'c':
+				opts.config = mowgli_optarg;
+				break;
+
+			case 'd':
+				opts.database = mowgli_optarg;
+				break;
+
+			case 'n':
+				opts.no_database = true;
+				break;
+
+			case 'o':
+				opts.output = mowgli_optarg;
+				break;
+
+			case 'p':
+			{
+				opts.paced = true;
+
+				if (mowgli_optarg == NULL)
+					break;
+
+				char *end = NULL;
+
+				errno = 0;
+				opts.speed = strtod(mowgli_optarg, &end);
+
+				if (errno != 0 || (end && *end) || opts.speed <= 0.0)
+				{
+					(void) fprintf(stderr, "'%s' is not a valid value for option '%c'\n", mowgli_optarg, c);
+					return false;
+				}
+				break;
+			}
+
+			default:
+				(void) print_usage(argv[0]);
+				return false;
+		}
+	}
+
+	if (mowgli_optind != argc - 1)
+	{
+		(void) print_usage(argv[0]);
+		return false;
+	}
+
+	opts.capture = argv[mowgli_optind];
+
+	return true;
+}
+
+static struct replay_phase *
+phase_begin(const char *const restrict name, const unsigned int connection)
+{
+	if (phase_count == phase_alloc)
+	{
+		phase_alloc = phase_alloc ? (phase_alloc * 2U) : 8U;
+		phases = srealloc(phases, phase_alloc * sizeof *phases);
+	}
+
+	struct replay_phase *const ph = &phases[phase_count++];
+
+	(void) memset(ph, 0x00, sizeof *ph);
+
+	ph->name = name;
+	ph->connection = connection;
+	ph->latency.name = (char *) name;
+
+	return ph;
+}
+
+/* Tears down the state of the previous connection the same way a real
+ * disconnect does, and links services to a fresh loopback uplink.
+ */
+static bool
+replay_connect(void)
+{
+	if (curr_uplink != NULL && curr_uplink->conn != NULL)
+	{
+		(void) connection_close(curr_uplink->conn);
+		(void) close(replay_peerfd);
+
+		replay_peerfd = -1;
+	}
+
+	return uplink_connect_loopback(&replay_peerfd) != NULL;
+}
+
+static void
+replay_sleep_until(const uint64_t when_ns)
+{
+	const uint64_t now_ns = profile_time_ns();
+
+	if (when_ns <= now_ns)
+		return;
+
+	const uint64_t ns = when_ns - now_ns;
+	const struct timespec ts = {
+		.tv_sec  = (time_t) (ns / UINT64_C(1000000000)),
+		.tv_nsec = (long) (ns % UINT64_C(1000000000)),
+	};
+
+	(void) nanosleep(&ts, NULL);
+}
+
+static bool
+replay(void)
+{
+	struct capture_reader reader;
+	struct replay_phase *ph = NULL;
+	enum capture_record type;
+	unsigned int connections = 0;
+	uint64_t phase_start_ns = 0;
+	uint64_t phase_start_cap = 0;
+	uint64_t wall_base_ns = 0;
+	uint64_t cap_base_ns = 0;
+	char line[BUFSIZE + 1];
+
+	if (! capture_reader_open(&reader, opts.capture))
+		return false;
+
+	while ((type = capture_reader_next(&reader)) != CAPTURE_EOF)
+	{
+		if (type == CAPTURE_START)
+		{
+			(void) slog(LG_INFO, "replay: capture started at %lld", (long long) reader.started);
+			continue;
+		}
+
+		if (opts.paced)
+		{
+			if (! wall_base_ns)
+			{
+				wall_base_ns = profile_time_ns();
+				cap_base_ns = reader.ns;
+			}
+
+			const uint64_t due_ns = wall_base_ns + (uint64_t) ((double) (reader.ns - cap_base_ns) / opts.speed);
+
+			(void) replay_sleep_until(due_ns);
+
+			const uint64_t now_ns = profile_time_ns();
+
+			if (ph != NULL && now_ns > due_ns && (now_ns - due_ns) > ph->max_lag_ns)
+				ph->max_lag_ns = now_ns - due_ns;
+
+			(void) mowgli_eventloop_synchronize(base_eventloop);
+		}
+
+		if (ph != NULL && type != CAPTURE_LINE)
+		{
+			ph->wall_ns = profile_time_ns() - phase_start_ns;
+			ph->captured_ns = reader.ns - phase_start_cap;
+			ph->complete = true;
+		}
+
+		if (type == CAPTURE_CONNECT || (type == CAPTURE_EOB && ph != NULL))
+		{
+			if (type == CAPTURE_CONNECT)
+			{
+				(void) slog(LG_INFO, "replay: connection %u", ++connections);
+
+				if (! replay_connect())
+				{
+					(void) capture_reader_close(&reader);
+					return false;
+				}
+
+				(void) uplink_loopback_drain(replay_peerfd);
+			}
+
+			ph = phase_begin((type == CAPTURE_CONNECT) ? "burst" : "steady_state", connections);
+			phase_start_ns = profile_time_ns();
+			phase_start_cap = reader.ns;
+			continue;
+		}
+
+		if (type != CAPTURE_LINE)
+			continue;
+
+		// Lines before the first connection lack the burst they depend on
+		if (ph == NULL)
+		{
+			skipped_lines++;
+			continue;
+		}
+
+		(void) memcpy(line, reader.line, reader.len + 1U);
+
+		cnt.bin += reader.len + 2U;
+		me.uplinkpong = CURRTIME;
+
+		const uint64_t start_ns = profile_time_ns();
+
+		(void) parse(line);
+
+		(void) profile_counter_record(&ph->latency, profile_time_ns() - start_ns);
+
+		ph->messages++;
+		ph->bytes += reader.len + 2U;
+
+		if (curr_uplink->conn != NULL && sendq_nonempty(curr_uplink->conn))
+			ph->replies += uplink_loopback_drain(replay_peerfd);
+	}
+
+	if (ph != NULL && ! ph->complete)
+	{
+		ph->wall_ns = profile_time_ns() - phase_start_ns;
+		ph->captured_ns = reader.ns - phase_start_cap;
+	}
+
+	const bool error = reader.error;
+
+	(void) capture_reader_close(&reader);
+
+	return ! error;
+}
+
+static void
+json_string(FILE *const restrict out, const char *const restrict str)
+{
+	(void) fputc('"', out);
+
+	for (const char *p = str; *p; p++)
+	{
+		if (*p == '"' || *p == '\\')
+			(void) fprintf(out, "\\%c", *p);
+		else if ((unsigned char) *p < 0x20U)
+			(void) fprintf(out, "\\u%04x", (unsigned int) (unsigned char) *p);
+		else
+			(void) fputc(*p, out);
+	}
+
+	(void) fputc('"', out);
+}
+
+static double
+json_ms(const uint64_t ns)
+{
+	return (double) ns / 1000000.0;
+}
+
+static double
+json_rate(const uint64_t count, const uint64_t ns)
+{
+	return ns ? ((double) count * 1000000000.0 / (double) ns) : 0.0;
+}
+
+static void
+write_results(FILE *const restrict out)
+{
+	(void) fprintf(out, "{\n\t\"version\": ");
+	(void) json_string(out, PACKAGE_VERSION);
+	(void) fprintf(out, ",\n\t\"serno\": ");
+	(void) json_string(out, SERNO);
+	(void) fprintf(out, ",\n\t\"protocol\": ");
+	(void) json_string(out, ircd->ircdname);
+	(void) fprintf(out, ",\n\t\"capture\": ");
+	(void) json_string(out, opts.capture);
+	(void) fprintf(out, ",\n\t\"paced\": %s,\n\t\"speed\": %.3f,\n\t\"skipped_lines\": %" PRIu64 ",\n",
+	               opts.paced ? "true" : "false", opts.paced ? opts.speed : 0.0, skipped_lines);
+
+	(void) fprintf(out, "\t\"state\": {\"accounts\": %u, \"channels_registered\": %u, \"users\": %u, "
+	                    "\"channels\": %u, \"memberships\": %u, \"servers\": %u},\n", cnt.myuser, cnt.mychan,
+	               cnt.user, cnt.chan, cnt.chanuser, cnt.server);
+
+	(void) fprintf(out, "\t\"phases\": [");
+
+	for (size_t i = 0; i < phase_count; i++)
+	{
+		const struct replay_phase *const ph = &phases[i];
+
+		(void) fprintf(out, "%s\n\t\t{\"phase\": ", i ? "," : "");
+		(void) json_string(out, ph->name);
+		(void) fprintf(out, ", \"connection\": %u, \"complete\": %s, \"messages\": %" PRIu64 ", "
+		                    "\"bytes\": %" PRIu64 ", \"replies\": %" PRIu64 ", \"captured_ms\": %.3f, "
+		                    "\"wall_ms\": %.3f, \"messages_per_sec\": %.1f, \"bytes_per_sec\": %.1f, "
+		                    "\"latency_us\": {\"mean\": %.1f, \"p50\": %" PRIu64 ", \"p99\": %" PRIu64 ", "
+		                    "\"max\": %" PRIu64 "}, \"max_lag_ms\": %.3f}",
+		               ph->connection, ph->complete ? "true" : "false", ph->messages, ph->bytes, ph->replies,
+		               json_ms(ph->captured_ns), json_ms(ph->wall_ns), json_rate(ph->messages, ph->wall_ns),
+		               json_rate(ph->bytes, ph->wall_ns),
+		               ph->latency.calls ? ((double) ph->latency.total_ns / 1000.0 / ph->latency.calls) : 0.0,
+		               profile_hist_percentile_us(&ph->latency, 50), profile_hist_percentile_us(&ph->latency, 99),
+		               ph->latency.max_ns / 1000U, json_ms(ph->max_lag_ns));
+	}
+
+	(void) fprintf(out, "\n\t]\n}\n");
+}
+
+int
+main(int argc, char *argv[])
+{
+	FILE *out = stdout;
+
+	if (! libathemecore_early_init())
+		return EXIT_FAILURE;
+
+	if (! process_options(argc, argv))
+		return EXIT_FAILURE;
+
+	atheme_bootstrap();
+	atheme_init(argv[0], LOGDIR "/replay.log");
+	atheme_setup();
+
+	runflags = RF_LIVE;
+	datadir = DATADIR;
+	readonly = true;
+
+	slog(LG_INFO, "replay: replaying %s", opts.capture);
+
+	/* A capture of the replay would be of no use to anyone, and the
+	 * configured capture file may well be the one being written live.
+	 */
+	capture_suppressed = true;
+
+	conf_init();
+	if (! conf_parse(opts.config))
+		return EXIT_FAILURE;
+
+	if (ircd == NULL || parse == NULL)
+	{
+		slog(LG_ERROR, "replay: please load the protocol module the capture was recorded with");
+		return EXIT_FAILURE;
+	}
+
+	if (uplinks.head == NULL)
+	{
+		slog(LG_ERROR, "replay: no uplink configured in %s", opts.config);
+		return EXIT_FAILURE;
+	}
+
+	cold_start = false;
+
+	if (! opts.no_database && db_load != NULL)
+	{
+		runflags &= ~RF_LIVE;
+		(void) db_load(opts.database);
+		runflags |= RF_LIVE;
+		(void) db_check();
+	}
+
+	runflags &= ~RF_STARTING;
+
+	if (opts.output != NULL && ! (out = fopen(opts.output, "w")))
+	{
+		slog(LG_ERROR, "replay: cannot open %s: %s", opts.output, strerror(errno));
+		return EXIT_FAILURE;
+	}
+
+	mowgli_eventloop_synchronize(base_eventloop);
+	CURRTIME = mowgli_eventloop_get_time(base_eventloop);
+
+	const bool ok = replay();
+
+	(void) write_results(out);
+
+	if (out != stdout)
+		(void) fclose(out);
+
+	(void) sfree(phases);
+
+	return ok ? EXIT_SUCCESS : EXIT_FAILURE;
+}
@@ -27,74 +27,143 @@
  * SUCH DAMAGE.
  */
 /*
- * make createtestdb
- * ./createtestdb 500000 >atheme.db
+ * make createburst
+ * ./createburst [-s servers] [-c channels] [-j joins] [-z zipf] [-r seed] 500000 >burst.txt
  *
- * then start atheme-services with this atheme.db
+ * then feed burst.txt to atheme-services as its uplink, e.g. with netcat
+ *
+ * Users are called User0, User1, ... and channels #channel0, #channel1,
+ * ..., the same names that createtestdb and the dragon benchmark use.
+ * Users are spread evenly over the servers; channel k (counting from 1)
+ * gets a share of joins * count memberships proportional to 1/k^zipf, as
+ * channel sizes on real networks roughly follow Zipf's law.
  */
 
+#include	<math.h>
 #include	<stdio.h>
 #include	<time.h>
 #include	<stdlib.h>
 #include	<string.h>
+#include	<unistd.h>
 
 #define		BUFSIZE 1024
-#define		SID "007"
+#define		ALNUM "ABCDEFGHIJKLMNOPQRSTUVWXYZ0123456789"
+#define		SJOIN_MEMBERS 40
+
+static unsigned int servers = 1;
+static unsigned int channels = 0;
+static unsigned int joins = 3;
+static double zipf = 1.0;
+static unsigned int seed = 1;
 
-static char new_uid[9];
-static unsigned int uindex = 9;
+static unsigned int *chansize;
+static unsigned int *chanoff;
 
-void init_uid(void)
+static unsigned int xorshift(void)
 {
-	unsigned int i;
-	char buf[BUFSIZE];
+	seed ^= seed << 13;
+	seed ^= seed >> 17;
+	seed ^= seed << 5;
+	return seed;
+}
 
-	memset(new_uid, 0, sizeof(new_uid));
-	memcpy(new_uid, SID, strlen(SID));
+static const char *sid(unsigned int server)
+{
+	static char buf[4];
 
-	for (i = 0; i < strlen(SID); i++)
-		if (new_uid[i] == '\0')
-			new_uid[i] = 'A';
+	snprintf(buf, sizeof buf, "%u%c%c", server % 10, 'A' + (server / 10) % 26,
+			'A' + (server / 260) % 26);
+	return buf;
+}
+
+/* the SID of the user's server followed by a letter and 5 alphanumerics */
+static const char *uid(unsigned int i)
+{
+	static char buf[10];
+	unsigned int rest = i;
+	int j;
+
+	memcpy(buf, sid(i % servers), 3);
+
+	for (j = 8; j > 3; j--)
+	{
+		buf[j] = ALNUM[rest % 36];
+		rest /= 36;
+	}
 
-	for (i = strlen(SID); i < uindex; i++)
-		new_uid[i] = 'A';
+	buf[3] = ALNUM[rest % 26];
+	buf[9] = '\0';
+	return buf;
 }
 
-static void add_one_to_uid(unsigned int i)
+static void build_channels(unsigned int count)
 {
-	if (i != strlen(SID))	/* Not reached server SID portion yet? */
+	double harmonic = 0, size;
+	unsigned int k;
+
+	chansize = calloc(channels + 1, sizeof *chansize);
+	chanoff = calloc(channels + 1, sizeof *chanoff);
+	if (chansize == NULL || chanoff == NULL)
 	{
-		if (new_uid[i] == 'Z')
-			new_uid[i] = '0';
-		else if (new_uid[i] == '9')
-		{
-			new_uid[i] = 'A';
-			add_one_to_uid(i - 1);
-		}
-		else
-			new_uid[i] = new_uid[i] + 1;
+		perror("calloc");
+		exit(1);
 	}
-	else
+
+	for (k = 1; k <= channels; k++)
+		harmonic += 1.0 / pow(k, zipf);
+
+	for (k = 1; k <= channels; k++)
 	{
-		if (new_uid[i] == 'Z')
-			for (i = strlen(SID); i < 9; i++)
-				new_uid[i] = 'A';
-		else
-			new_uid[i] = new_uid[i] + 1;
+		size = floor((double) count * joins / pow(k, zipf) / harmonic + 0.5);
+		chansize[k - 1] = size < 1 ? 1 : size > count ? count : (unsigned int) size;
+		chanoff[k - 1] = xorshift() % count;
 	}
 }
 
-const char *uid_get(void)
+/* one SJOIN (TS6) or SJOIN with nicks (TS5) per SJOIN_MEMBERS members */
+static void do_sjoins(unsigned int count, unsigned int server, const char *source, time_t now, int ts6)
 {
-	add_one_to_uid(uindex - 1);	/* index from 0 */
-	return (new_uid);
+	char members[BUFSIZE];
+	unsigned int k, j, n, user;
+	size_t len;
+
+	for (k = 0; k < channels; k++)
+	{
+		len = 0;
+		n = 0;
+
+		for (j = 0; j < chansize[k]; j++)
+		{
+			user = (chanoff[k] + j) % count;
+			if (user % servers != server)
+				continue;
+
+			if (ts6)
+				len += snprintf(members + len, sizeof members - len, "%s%s%s",
+						len ? " " : "", j ? "" : "@", uid(user));
+			else
+				len += snprintf(members + len, sizeof members - len, "%s%sUser%u",
+						len ? " " : "", j ? "" : "@", user);
+
+			if (++n < SJOIN_MEMBERS)
+				continue;
+
+			printf(":%s SJOIN %lu #channel%u +nt :%s\r\n", source,
+					(unsigned long) now, k, members);
+			len = 0;
+			n = 0;
+		}
+
+		if (len)
+			printf(":%s SJOIN %lu #channel%u +nt :%s\r\n", source,
+					(unsigned long) now, k, members);
+	}
 }
 
 int
-do_burst_ts5(int count, time_t now)
+do_burst_ts5(unsigned int count, time_t now)
 {
-	int i;
-	char nick[20];
+	unsigned int i;
 
 	printf("PASS linkit TS\r\n");
 	printf("CAPAB :QS EX IE KLN UNKLN ENCAP TB SERVICES EUID EOPMOD MLOCK\r\n");
@@ -102,11 +171,11 @@ do_burst_ts5(int count, time_t now)
 	printf("SVINFO 5 3 0 :%lu\r\n", (unsigned long) now);
 
 	for (i = 0; i < count; i++)
-	{
-		snprintf(nick, sizeof nick, "a%010d", i);
-		printf("NICK %s 1 %lu +i ~Guest moo.cows.go.moo irc.uplink.com :Grazing cow #%ld\r\n",
-				nick, (unsigned long) now, i);
-	}
+		printf("NICK User%u 1 %lu +i ~Guest moo.cows.go.moo irc.uplink.com :Grazing cow #%u\r\n",
+				i, (unsigned long) now, i);
+
+	servers = 1;
+	do_sjoins(count, 0, "irc.uplink.com", now, 0);
 
 	printf(":irc.uplink.com PONG irc.uplink.com :irc.uplink.com\r\n");
 
@@ -114,24 +183,36 @@ do_burst_ts5(int count, time_t now)
 }
 
 int
-do_burst_ts6(int count, time_t now)
+do_burst_ts6(unsigned int count, time_t now)
 {
-	int i;
-	char nick[20];
+	unsigned int i, s;
+	char source[4];
 
-	printf("PASS linkit TS 6 :%s\r\n", SID);
+	printf("PASS linkit TS 6 :%s\r\n", sid(0));
 	printf("CAPAB :QS EX IE KLN UNKLN ENCAP TB SERVICES EUID EOPMOD MLOCK\r\n");
-	printf("SERVER irc.uplink.com 1 :Test file\r\n");
+	printf("SERVER irc0.dragon.test 1 :Test file\r\n");
 	printf("SVINFO 6 3 0 :%lu\r\n", (unsigned long) now);
 
-	for (i = 0; i < count; i++)
+	/* leaves first, so that the uplink's PONG marks the end of the burst */
+	for (s = servers; s-- > 0; )
 	{
-		snprintf(nick, sizeof nick, "a%010d", i);
-		printf(":%s UID %s 1 %lu +i ~Guest moo.cows.go.moo 0 %s :Grazing cow #%ld\r\n",
-				SID, nick, (unsigned long) now, uid_get(), i);
+		snprintf(source, sizeof source, "%s", sid(s));
+
+		if (s != 0)
+			printf(":%s SID irc%u.dragon.test 2 %s :Test leaf\r\n", sid(0), s, source);
+
+		for (i = s; i < count; i += servers)
+			printf(":%s UID User%u 1 %lu +i ~user host%u.users.dragon.test 10.%u.%u.%u %s :Grazing cow #%u\r\n",
+					source, i, (unsigned long) now, i, (i >> 16) & 0xFF,
+					(i >> 8) & 0xFF, i & 0xFF, uid(i), i);
+
+		do_sjoins(count, s, source, now, 1);
+
+		if (s != 0)
+			printf(":%s PONG irc%u.dragon.test :irc0.dragon.test\r\n", source, s);
 	}
 
-	printf(":%s PONG %s :%s\r\n", SID, SID, SID);
+	printf(":%s PONG irc0.dragon.test :irc0.dragon.test\r\n", sid(0));
 
 	return 0;
 }
@@ -139,21 +220,57 @@ do_burst_ts6(int count, time_t now)
 int
 main(int argc, char *argv[])
 {
-	int count;
+	unsigned int count;
+	int c, ts5 = 0;
 	time_t now;
 
-	init_uid();
+	while ((c = getopt(argc, argv, "5s:c:j:z:r:")) != -1)
+	{
+		switch (c)
+		{
+			case '5':
+				ts5 = 1;
+				break;
+			case 's':
+				servers = strtoul(optarg, NULL, 10);
+				break;
+			case 'c':
+				channels = strtoul(optarg, NULL, 10);
+				break;
+			case 'j':
+				joins = strtoul(optarg, NULL, 10);
+				break;
+			case 'z':
+				zipf = strtod(optarg, NULL);
+				break;
+			case 'r':
+				seed = strtoul(optarg, NULL, 10);
+				break;
+			default:
+				optind = argc;
+				break;
+		}
+	}
 
-	if (argc < 2)
+	if (argc - optind < 1 || servers < 1 || servers > 2600 || seed == 0)
 	{
-		fprintf(stderr, "Usage: %s count\n", argv[0]);
+		fprintf(stderr, "Usage: %s [-5] [-s servers] [-c channels] [-j joins per user] [-z zipf exponent] [-r seed] count\n", argv[0]);
 		return 1;
 	}
 
-	count = atoi(argv[1]);
+	/* a second argument selects TS5, as it always has */
+	if (argc - optind > 1)
+		ts5 = 1;
+
+	count = strtoul(argv[optind], NULL, 10);
 	now = time(NULL);
 
-	if (argc > 2)
+	if (count == 0)
+		channels = 0;
+
+	build_channels(count);
+
+	if (ts5)
 		return do_burst_ts5(count, now);
 
 	return do_burst_ts6(count, now);
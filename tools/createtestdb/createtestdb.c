@@ -0,0 +1,146 @@
+/*
+ * SPDX-License-Identifier: BSD-2-Clause
+ * SPDX-URL: https://spdx.org/licenses/BSD-2-Clause.html
+ *
+ * Copyright (C) 2008 Jilles Tjoelker
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE AUTHOR AND CONTRIBUTORS ``AS IS'' AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED.  IN NO EVENT SHALL THE AUTHOR OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS
+ * OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+ * HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ * LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY
+ * OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF
+ * SUCH DAMAGE.
+ */
+/*
+ * make createtestdb
+ * ./createtestdb [-c channels] [-a chanacs] [-k akicks] [-K klines] 500000 >atheme.db
+ *
+ * then start atheme-services with this atheme.db
+ *
+ * Accounts are called User0, User1, ... and channels #channel0, #channel1,
+ * ..., the same names that createburst and the dragon benchmark use, so
+ * that a database from here matches the users and channels of their
+ * synthetic networks. Every channel has a founder, chanacs - 1 further
+ * access list entries and akicks AKICK entries.
+ */
+
+#include	<stdio.h>
+#include	<time.h>
+#include	<stdlib.h>
+#include	<unistd.h>
+
+#define ALNUM "ABCDEFGHIJKLMNOPQRSTUVWXYZ0123456789"
+
+#define CA_FOUNDER "+AFORaefhioqrstv"
+#define CA_AOP "+AOhiotv"
+#define CA_VOP "+AVv"
+#define CA_AKICK "+b"
+
+/* entity IDs look like TS6 UIDs: 3 characters, a letter and 5 alphanumerics */
+static const char *entity_id(unsigned int i)
+{
+	static char id[10] = "00A";
+	int j;
+
+	for (j = 8; j > 3; j--)
+	{
+		id[j] = ALNUM[i % 36];
+		i /= 36;
+	}
+
+	id[3] = ALNUM[i % 26];
+
+	return id;
+}
+
+int
+main(int argc, char *argv[])
+{
+	unsigned int count, channels = 0, chanacs = 1, akicks = 0, klines = 0;
+	unsigned int i, j;
+	int c;
+	time_t now;
+
+	while ((c = getopt(argc, argv, "c:a:k:K:")) != -1)
+	{
+		switch (c)
+		{
+			case 'c':
+				channels = strtoul(optarg, NULL, 10);
+				break;
+			case 'a':
+				chanacs = strtoul(optarg, NULL, 10);
+				break;
+			case 'k':
+				akicks = strtoul(optarg, NULL, 10);
+				break;
+			case 'K':
+				klines = strtoul(optarg, NULL, 10);
+				break;
+			default:
+				optind = argc;
+				break;
+		}
+	}
+
+	if (argc - optind != 1)
+	{
+		fprintf(stderr, "Usage: %s [-c channels] [-a chanacs per channel] [-k akicks per channel] [-K klines] count\n", argv[0]);
+		return 1;
+	}
+
+	count = strtoul(argv[optind], NULL, 10);
+
+	if (count == 0)
+		channels = 0;
+	if (chanacs > count)
+		chanacs = count;
+
+	now = time(NULL);
+
+	printf("# Test database with %u accounts, %u channels and %u klines\n", count, channels, klines);
+	printf("DBV 12\n");
+	printf("CF +AFHORVabefhioqrstv\n");
+	printf("TS %lu\n", (unsigned long)now);
+	for (i = 0; i < count; i++)
+	{
+		printf("MU %s User%u * user%u@example.test %lu %lu +C default\n",
+				entity_id(i), i, i, (unsigned long)now,
+				(unsigned long)now);
+		printf("MN User%u User%u %lu %lu\n", i, i, (unsigned long)now,
+				(unsigned long)now);
+	}
+	for (i = 0; i < channels; i++)
+	{
+		printf("MC #channel%u %lu %lu +g 272 0 0\n", i,
+				(unsigned long)now, (unsigned long)now);
+		for (j = 0; j < chanacs; j++)
+			printf("CA #channel%u User%u %s %lu *\n", i, (i + j) % count,
+					j == 0 ? CA_FOUNDER : (j % 2 ? CA_AOP : CA_VOP),
+					(unsigned long)now);
+		for (j = 0; j < akicks; j++)
+			printf("CA #channel%u *!*@banned%u.example.test %s %lu *\n", i,
+					i * akicks + j, CA_AKICK, (unsigned long)now);
+	}
+	printf("KID %u\n", klines);
+	for (i = 0; i < klines; i++)
+		printf("KL %u * klined%u.example.test 0 %lu createtestdb synthetic K-line\n",
+				i + 1, i, (unsigned long)now);
+
+	return 0;
+}